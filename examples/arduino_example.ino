@@ -12,11 +12,29 @@
  * - 数据位: 8
  * - 停止位: 1
  * - 校验位: None
+ *
+ * 支持上位机的上报速率命令（!PING / !RATE / !BURST），未收到命令时每 100ms 上报一次。
  */
 
 #define TRIG_PIN 9
 #define ECHO_PIN 10
 
+// 测量周期上限：按变化上报时至少每 50ms 测量一次
+#define MEASURE_PERIOD_MAX_MS 50
+
+// 上报设置（上位机 !RATE / !BURST 命令修改，默认 100ms 固定上报）
+unsigned long reportIntervalMs = 100;
+float reportDelta = 0.0;           // 与上次上报值相差该值（cm）时立即上报，0 为关闭
+unsigned int burstRemaining = 0;
+unsigned long burstIntervalMs = 0;
+
+unsigned long lastMeasureMs = 0;
+unsigned long lastReportMs = 0;
+float lastReported = -1.0;
+
+char commandLine[32];
+int commandLength = 0;
+
 void setup() {
   // 初始化串口
   Serial.begin(9600);
@@ -30,8 +48,25 @@ void setup() {
 }
 
 void loop() {
+  readCommands();
+
+  unsigned long now = millis();
+  unsigned long interval = burstRemaining > 0 ? burstIntervalMs : reportIntervalMs;
+  unsigned long measurePeriod = min(interval, (unsigned long)MEASURE_PERIOD_MAX_MS);
+  if (now - lastMeasureMs < measurePeriod) {
+    return;
+  }
+  lastMeasureMs = now;
+
   // 测量距离
   float distance = measureDistance();
+
+  // 到达上报间隔，或变化超过 delta 时上报
+  bool due = now - lastReportMs >= interval;
+  bool changed = reportDelta > 0.0 && fabs(distance - lastReported) >= reportDelta;
+  if (!due && !changed) {
+    return;
+  }
   
   // 发送数据到上位机（格式：D:xxx.xx）
   Serial.print("D:");
@@ -39,8 +74,68 @@ void loop() {
   
   // 也可以使用纯数字格式
   // Serial.println(distance, 2);
-  
-  delay(100);  // 100ms 采样一次
+
+  lastReportMs = now;
+  lastReported = distance;
+  if (burstRemaining > 0) {
+    burstRemaining--;
+  }
+}
+
+/**
+ * 读取上位机命令（以 '!' 开头的文本行），应答 "ACK <命令>"
+ *   !PING
+ *   !RATE <interval_ms> <delta_cm>
+ *   !BURST <count> <interval_ms>
+ */
+void readCommands() {
+  while (Serial.available() > 0) {
+    char c = Serial.read();
+    if (c == '\r') {
+      continue;
+    }
+    if (c != '\n') {
+      if (commandLength < (int)sizeof(commandLine) - 1) {
+        commandLine[commandLength++] = c;
+      }
+      continue;
+    }
+
+    commandLine[commandLength] = '\0';
+    commandLength = 0;
+    if (commandLine[0] != '!') {
+      continue;
+    }
+
+    bool ok = false;
+    if (strcmp(commandLine, "!PING") == 0) {
+      ok = true;
+    } else if (strncmp(commandLine, "!RATE ", 6) == 0) {
+      char *end;
+      long interval = strtol(commandLine + 6, &end, 10);
+      float delta = atof(end);
+      if (interval >= 10 && delta >= 0.0) {
+        reportIntervalMs = interval;
+        reportDelta = delta;
+        ok = true;
+      }
+    } else if (strncmp(commandLine, "!BURST ", 7) == 0) {
+      char *end;
+      long count = strtol(commandLine + 7, &end, 10);
+      long interval = strtol(end, NULL, 10);
+      if (count > 0 && interval >= 10) {
+        burstRemaining = count;
+        burstIntervalMs = interval;
+        ok = true;
+      }
+    }
+
+    // 原样回显命令参数，上位机据此确认
+    if (ok) {
+      Serial.print("ACK ");
+      Serial.println(commandLine + 1);
+    }
+  }
 }
 
 /**
@@ -0,0 +1,66 @@
+/**
+ * 实时样本共享内存读取示例
+ *
+ * 编译: cc -O2 -I../src live_reader.c -o live_reader -lm   (glibc < 2.34 需加 -lrt)
+ * 运行: ./live_reader [/ultrasonic_live]
+ *
+ * 上位机运行时持续打印新样本；出现覆盖时报告丢失个数，上位机退出（包括崩溃）后自动重连。
+ */
+
+#include "livesegment.h"
+#include <math.h>
+#include <stdio.h>
+#include <time.h>
+
+static void sleep_ms(long ms)
+{
+    struct timespec ts = { ms / 1000, (ms % 1000) * 1000000L };
+    nanosleep(&ts, NULL);
+}
+
+int main(int argc, char *argv[])
+{
+    const char *name = argc > 1 ? argv[1] : LIVE_SEGMENT_DEFAULT_NAME;
+    live_segment_reader reader;
+    live_segment_slot samples[256];
+
+    for (;;) {
+        if (live_segment_open(&reader, name) != 0) {
+            sleep_ms(1000);
+            continue;
+        }
+
+        double scale = pow(10.0, reader.header->fraction_digits);
+        uint64_t cursor = live_segment_published(&reader);
+        printf("Connected to %s (pid %lld, %u slots)\n", name,
+               (long long)reader.header->writer_pid, reader.header->capacity);
+
+        long idle_ms = 0;
+        while (!live_segment_closed(&reader)) {
+            uint64_t lost = 0;
+            size_t count = live_segment_read(&reader, &cursor, samples, 256, &lost);
+            if (lost > 0) {
+                printf("Lost %llu samples\n", (unsigned long long)lost);
+            }
+            for (size_t i = 0; i < count; ++i) {
+                printf("%lld %.2f\n", (long long)samples[i].timestamp_us, samples[i].value / scale);
+            }
+            if (count > 0) {
+                idle_ms = 0;
+                continue;
+            }
+
+            /* 崩溃的写入方不会置 closed：空闲一秒检查一次写入进程与同名段 */
+            sleep_ms(1);
+            if (++idle_ms >= 1000) {
+                idle_ms = 0;
+                if (live_segment_stale(&reader, name)) {
+                    break;
+                }
+            }
+        }
+
+        printf("Writer closed, reconnecting\n");
+        live_segment_close(&reader);
+    }
+}
@@ -8,17 +8,26 @@
  * - HC-SR04 Trig -> PA0 (TIM2_CH1)
  * - HC-SR04 Echo -> PA1 (GPIO Input)
  * - UART1 TX -> PA9
- * - UART1 RX -> PA10 (可选)
+ * - UART1 RX -> PA10 (接收上位机上报速率命令，可选)
  * 
  * CubeMX 配置:
  * - UART1: 9600 baud, 8N1
  * - TIM2: 1MHz (1us per tick)
  * - SysTick: 1ms
+ * - UART1 全局中断使能（接收命令）
+ *
+ * 上位机命令（以 '!' 开头的文本行，应答 "ACK <命令>"）：
+ *   !PING
+ *   !RATE <interval_ms> <delta_cm>   按间隔上报；变化超过 delta 时立即上报（0 为关闭）
+ *   !BURST <count> <interval_ms>     接下来 count 个样本按 interval_ms 上报
+ * 未收到命令时每 100ms 上报一次。
  */
 
 #include "main.h"
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <math.h>
 
 // 外部变量（CubeMX 生成）
 extern UART_HandleTypeDef huart1;
@@ -30,25 +39,124 @@ extern TIM_HandleTypeDef htim2;
 #define ECHO_PORT GPIOA
 #define ECHO_PIN  GPIO_PIN_1
 
+// 测量周期上限：按变化上报时至少每 50ms 测量一次
+#define MEASURE_PERIOD_MAX_MS 50
+
+// 上报设置（由命令修改）
+static uint32_t reportIntervalMs = 100;
+static float reportDelta = 0.0f;
+static uint32_t burstRemaining = 0;
+static uint32_t burstIntervalMs = 0;
+
+// 命令接收：中断里逐字节收集，整行交给主循环处理
+static uint8_t rxByte;
+static char rxLine[32];
+static uint32_t rxLength = 0;
+static char commandLine[32];
+static volatile uint8_t commandReady = 0;
+
 // 函数声明
 float measureDistance(void);
 void sendDistanceToPC(float distance);
 void delayMicroseconds(uint32_t us);
+static void handleCommand(const char *command);
 
 /**
  * 主循环
  */
 void ultrasonicTask(void)
 {
+    uint32_t lastMeasure = 0;
+    uint32_t lastReport = 0;
+    float lastReported = -1.0f;
+
+    HAL_UART_Receive_IT(&huart1, &rxByte, 1);
+
     while (1) {
+        if (commandReady) {
+            handleCommand(commandLine);
+            commandReady = 0;
+        }
+
+        uint32_t now = HAL_GetTick();
+        uint32_t interval = burstRemaining > 0 ? burstIntervalMs : reportIntervalMs;
+        uint32_t measurePeriod = interval < MEASURE_PERIOD_MAX_MS ? interval : MEASURE_PERIOD_MAX_MS;
+        if (now - lastMeasure < measurePeriod) {
+            continue;
+        }
+        lastMeasure = now;
+
         // 测量距离
         float distance = measureDistance();
-        
-        // 发送到上位机
-        sendDistanceToPC(distance);
-        
-        // 延时 100ms
-        HAL_Delay(100);
+
+        // 到达上报间隔，或变化超过 delta 时发送到上位机
+        int due = now - lastReport >= interval;
+        int changed = reportDelta > 0.0f && fabsf(distance - lastReported) >= reportDelta;
+        if (due || changed) {
+            sendDistanceToPC(distance);
+            lastReport = now;
+            lastReported = distance;
+            if (burstRemaining > 0) {
+                burstRemaining--;
+            }
+        }
+    }
+}
+
+/**
+ * UART 接收中断回调：收满一行后置位 commandReady
+ */
+void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart)
+{
+    if (huart == &huart1) {
+        char c = (char)rxByte;
+        if (c == '\n') {
+            rxLine[rxLength] = '\0';
+            // 上一行尚未处理时丢弃本行
+            if (!commandReady && rxLine[0] == '!') {
+                memcpy(commandLine, rxLine, rxLength + 1);
+                commandReady = 1;
+            }
+            rxLength = 0;
+        } else if (c != '\r' && rxLength < sizeof(rxLine) - 1) {
+            rxLine[rxLength++] = c;
+        }
+        HAL_UART_Receive_IT(&huart1, &rxByte, 1);
+    }
+}
+
+/**
+ * 处理一条命令，成功时原样回显参数作为应答
+ */
+static void handleCommand(const char *command)
+{
+    int ok = 0;
+    if (strcmp(command, "!PING") == 0) {
+        ok = 1;
+    } else if (strncmp(command, "!RATE ", 6) == 0) {
+        char *end;
+        long interval = strtol(command + 6, &end, 10);
+        float delta = strtof(end, NULL);
+        if (interval >= 10 && delta >= 0.0f) {
+            reportIntervalMs = (uint32_t)interval;
+            reportDelta = delta;
+            ok = 1;
+        }
+    } else if (strncmp(command, "!BURST ", 7) == 0) {
+        char *end;
+        long count = strtol(command + 7, &end, 10);
+        long interval = strtol(end, NULL, 10);
+        if (count > 0 && interval >= 10) {
+            burstRemaining = (uint32_t)count;
+            burstIntervalMs = (uint32_t)interval;
+            ok = 1;
+        }
+    }
+
+    if (ok) {
+        char buffer[40];
+        int length = snprintf(buffer, sizeof(buffer), "ACK %s\r\n", command + 1);
+        HAL_UART_Transmit(&huart1, (uint8_t*)buffer, length, 100);
     }
 }
 
@@ -7,20 +7,79 @@
 2. 创建虚拟串口对: 
    Linux: socat -d -d pty,raw,echo=0 pty,raw,echo=0
    或使用 com0com (Windows)
-3. 运行此脚本: python test_serial_simulator.py /dev/pts/X
+3. 运行此脚本: python test_serial_simulator.py /dev/pts/X [--envelope]
 
 功能:
 - 模拟超声波测距数据
 - 随机生成 10-300cm 的距离值
 - 每 100ms 发送一次数据
+- --envelope: 改为发送回波包络二进制帧（200 kHz 采样），由上位机计算距离
+- 应答上位机的 !PING / !RATE / !BURST 命令并按设定间隔发送
 """
 
+import math
 import serial
+import struct
 import time
 import random
 import sys
 
-def simulate_ultrasonic(port, baudrate=9600):
+ENVELOPE_RATE_HZ = 200000
+ENVELOPE_DELAY_US = 100
+SPEED_OF_SOUND = 343.0
+
+
+def crc16_ccitt(data):
+    """CRC-16/CCITT-FALSE"""
+    crc = 0xFFFF
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else (crc << 1)
+            crc &= 0xFFFF
+    return crc
+
+
+def envelope_frame(distance):
+    """生成一帧回波包络：噪声底 + 200 µs Hann 脉冲（含一个更弱的多径回波）"""
+    flight_us = distance * 2 / (SPEED_OF_SOUND * 1e-4)
+    count = int((flight_us * 1.5 - ENVELOPE_DELAY_US) * ENVELOPE_RATE_HZ / 1e6) + 64
+    count = max(64, min(4096, count))
+    width = int(200e-6 * ENVELOPE_RATE_HZ)
+    samples = [random.uniform(5, 15) for _ in range(count)]
+    for echo_us, amplitude in ((flight_us, 150), (flight_us * 1.3, 60)):
+        start = (echo_us - ENVELOPE_DELAY_US) * ENVELOPE_RATE_HZ / 1e6
+        for i in range(max(0, int(start)), min(count, int(start) + width + 1)):
+            u = (i - start + 0.5) / width
+            if 0 <= u < 1:
+                samples[i] += amplitude * (0.5 - 0.5 * math.cos(2 * math.pi * u))
+    body = struct.pack('<BBHII', 1, 0, count, ENVELOPE_RATE_HZ, ENVELOPE_DELAY_US)
+    body += bytes(min(255, int(v)) for v in samples)
+    return b'\xa5\x5a' + body + struct.pack('<H', crc16_ccitt(body))
+
+def handle_commands(ser, buffer, state):
+    """
+    处理上位机命令行，应答 ACK 并更新发送间隔
+    """
+    buffer += ser.read(ser.in_waiting or 0)
+    while b'\n' in buffer:
+        line, buffer = buffer.split(b'\n', 1)
+        command = line.strip().decode(errors='replace')
+        parts = command.split()
+        if not parts or not command.startswith('!'):
+            continue
+        if parts[0] == '!RATE' and len(parts) == 3:
+            state['interval'] = int(parts[1]) / 1000.0
+        elif parts[0] == '!BURST' and len(parts) == 3:
+            state['burst'] = int(parts[1])
+            state['burst_interval'] = int(parts[2]) / 1000.0
+        elif parts[0] != '!PING':
+            continue
+        ser.write(f"ACK {command[1:]}\n".encode())
+        print(f"命令: {command}")
+    return buffer
+
+def simulate_ultrasonic(port, baudrate=9600, envelope=False):
     """
     模拟超声波测距数据发送
     """
@@ -31,8 +90,12 @@ def simulate_ultrasonic(port, baudrate=9600):
         
         counter = 0
         base_distance = 150.0  # 基准距离
+        state = {'interval': 0.1, 'burst': 0, 'burst_interval': 0.0}
+        commands = b''
         
         while True:
+            commands = handle_commands(ser, commands, state)
+
             # 生成模拟距离数据（带随机波动）
             noise = random.uniform(-20, 20)
             trend = 30 * (random.random() - 0.5)  # 缓慢趋势变化
@@ -41,16 +104,23 @@ def simulate_ultrasonic(port, baudrate=9600):
             # 限制范围
             distance = max(10.0, min(400.0, distance))
             
-            # 发送数据（格式：D:xxx.xx）
-            data = f"D:{distance:.2f}\n"
-            ser.write(data.encode())
+            # 发送数据（格式：D:xxx.xx，或回波包络帧）
+            if envelope:
+                ser.write(envelope_frame(distance))
+            else:
+                ser.write(f"D:{distance:.2f}\n".encode())
             
             print(f"[{counter:04d}] 发送: {distance:.2f} cm")
             
             counter += 1
             base_distance = distance  # 平滑过渡
             
-            time.sleep(0.1)  # 100ms 间隔
+            # 默认 100ms 间隔，可由 !RATE / !BURST 修改
+            if state['burst'] > 0:
+                state['burst'] -= 1
+                time.sleep(state['burst_interval'])
+            else:
+                time.sleep(state['interval'])
             
     except serial.SerialException as e:
         print(f"串口错误: {e}")
@@ -63,11 +133,13 @@ def simulate_ultrasonic(port, baudrate=9600):
 
 if __name__ == "__main__":
     if len(sys.argv) < 2:
-        print("用法: python test_serial_simulator.py <串口名>")
+        print("用法: python test_serial_simulator.py <串口名> [--envelope]")
         print("示例:")
         print("  Linux:   python test_serial_simulator.py /dev/ttyUSB0")
         print("  Windows: python test_serial_simulator.py COM3")
         sys.exit(1)
     
     port = sys.argv[1]
-    simulate_ultrasonic(port)
+    envelope = "--envelope" in sys.argv[2:]
+    # 包络帧每帧数百字节，需要较高波特率
+    simulate_ultrasonic(port, 921600 if envelope else 9600, envelope)
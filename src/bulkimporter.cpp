@@ -0,0 +1,566 @@
+#include "bulkimporter.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QWaitCondition>
+#include <QThread>
+#include <QElapsedTimer>
+#include <QCryptographicHash>
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#include <vector>
+
+// 每个解析块的大小（按换行对齐后略大）
+static const qint64 kChunkBytes = 8 * 1024 * 1024;
+// 每个事务写入的行数，事务之间让出写锁给暂存回放与界面查询（约数十毫秒）
+static const qint64 kTransactionRows = 50000;
+// 文件指纹取首尾各这么多字节
+static const qint64 kFingerprintBytes = 1024 * 1024;
+// 解析最多领先写入的块数（相对线程数）
+static const int kChunksAheadPerThread = 2;
+static const int kProgressIntervalMs = 100;
+
+namespace {
+
+struct ParsedChunk {
+    QByteArray timestamps;       // 定长存储时间文本，连续存放
+    QVector<double> distances;
+    qint64 skippedLines = 0;
+    bool ready = false;
+};
+
+inline const char *skipSpaces(const char *p, const char *end)
+{
+    while (p < end && (*p == ' ' || *p == '\t')) {
+        ++p;
+    }
+    return p;
+}
+
+inline bool parseDigits(const char *&p, const char *end, int count, int &value)
+{
+    if (end - p < count) {
+        return false;
+    }
+    value = 0;
+    for (int i = 0; i < count; ++i) {
+        unsigned digit = unsigned(p[i] - '0');
+        if (digit > 9) {
+            return false;
+        }
+        value = value * 10 + int(digit);
+    }
+    p += count;
+    return true;
+}
+
+// "yyyy-MM-dd hh:mm:ss[.zzz]"（日期与时间之间允许 'T'），输出存储时间文本
+bool parseTimestamp(const char *&p, const char *end, char *out)
+{
+    int year, month, day, hour, minute, second;
+    if (!parseDigits(p, end, 4, year) || p >= end || *p++ != '-'
+        || !parseDigits(p, end, 2, month) || p >= end || *p++ != '-'
+        || !parseDigits(p, end, 2, day) || p >= end || (*p != ' ' && *p != 'T')
+        || !parseDigits(++p, end, 2, hour) || p >= end || *p++ != ':'
+        || !parseDigits(p, end, 2, minute) || p >= end || *p++ != ':'
+        || !parseDigits(p, end, 2, second)) {
+        return false;
+    }
+    if (month < 1 || month > 12 || day < 1 || day > 31 || hour > 23 || minute > 59 || second > 60) {
+        return false;
+    }
+
+    char millis[3] = {'0', '0', '0'};
+    if (p < end && *p == '.') {
+        ++p;
+        for (int i = 0; p < end && unsigned(*p - '0') <= 9; ++p, ++i) {
+            if (i < 3) {
+                millis[i] = *p;
+            }
+        }
+    }
+
+    std::memcpy(out, "0000-00-00T00:00:00.000", DataManager::kTimestampTextLength);
+    auto put = [](char *dst, int value, int width) {
+        for (int i = width - 1; i >= 0; --i, value /= 10) {
+            dst[i] = char('0' + value % 10);
+        }
+    };
+    put(out, year, 4);
+    put(out + 5, month, 2);
+    put(out + 8, day, 2);
+    put(out + 11, hour, 2);
+    put(out + 14, minute, 2);
+    put(out + 17, second, 2);
+    std::memcpy(out + 20, millis, 3);
+    return true;
+}
+
+// 定点小数（导出格式为 'f', 2），不支持指数形式
+bool parseNumber(const char *&p, const char *end, double &value)
+{
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        ++p;
+    }
+
+    qint64 mantissa = 0;
+    int digits = 0;
+    int scale = 0;
+    for (; p < end && unsigned(*p - '0') <= 9; ++p, ++digits) {
+        mantissa = mantissa * 10 + (*p - '0');
+    }
+    if (p < end && *p == '.') {
+        for (++p; p < end && unsigned(*p - '0') <= 9; ++p) {
+            if (scale < 15) {
+                mantissa = mantissa * 10 + (*p - '0');
+                ++scale;
+                ++digits;
+            }
+        }
+    }
+    if (digits == 0 || digits > 18) {
+        return false;
+    }
+
+    static const double kPowers[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7,
+                                     1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15};
+    value = double(mantissa) / kPowers[scale];
+    if (negative) {
+        value = -value;
+    }
+    return true;
+}
+
+// 解析一行；表头、说明行等无法识别的行返回 false
+bool parseLine(const char *p, const char *end, char *timestamp, double &distance)
+{
+    p = skipSpaces(p, end);
+    if (p >= end) {
+        return false;
+    }
+
+    if (*p == '[') {
+        // 旧版 TXT："[   12] 2025-12-24 10:00:00 -  45.67 cm"
+        const char *close = static_cast<const char *>(std::memchr(p, ']', end - p));
+        if (!close) {
+            return false;
+        }
+        p = skipSpaces(close + 1, end);
+        if (!parseTimestamp(p, end, timestamp)) {
+            return false;
+        }
+        p = skipSpaces(p, end);
+        if (p >= end || *p++ != '-') {
+            return false;
+        }
+        p = skipSpaces(p, end);
+        return parseNumber(p, end, distance);
+    }
+
+    // CSV：ID,Timestamp,Distance 或 Timestamp,Distance
+    const char *firstComma = static_cast<const char *>(std::memchr(p, ',', end - p));
+    if (!firstComma) {
+        return false;
+    }
+    const char *secondComma = static_cast<const char *>(std::memchr(firstComma + 1, ',', end - firstComma - 1));
+    const char *field = secondComma ? firstComma + 1 : p;
+    const char *valueField = secondComma ? secondComma + 1 : firstComma + 1;
+
+    field = skipSpaces(field, end);
+    if (!parseTimestamp(field, end, timestamp)) {
+        return false;
+    }
+    valueField = skipSpaces(valueField, end);
+    return parseNumber(valueField, end, distance);
+}
+
+inline int compareTimestamps(const char *a, const char *b)
+{
+    return std::memcmp(a, b, DataManager::kTimestampTextLength);
+}
+
+// 块内按时间升序：导出可能是最新在前，整体倒序的块直接翻转（同一时间的行恢复原有顺序），
+// 其他乱序按时间稳定排序
+void sortChunk(ParsedChunk &chunk)
+{
+    const int rows = chunk.distances.size();
+    const int length = DataManager::kTimestampTextLength;
+    const char *timestamps = chunk.timestamps.constData();
+    bool ascending = true;
+    bool descending = true;
+    for (int i = 1; i < rows && (ascending || descending); ++i) {
+        int order = compareTimestamps(timestamps + qint64(i - 1) * length, timestamps + qint64(i) * length);
+        ascending = ascending && order <= 0;
+        descending = descending && order >= 0;
+    }
+    if (ascending) {
+        return;
+    }
+
+    std::vector<int> order(static_cast<size_t>(rows));
+    std::iota(order.begin(), order.end(), 0);
+    if (descending) {
+        std::reverse(order.begin(), order.end());
+    } else {
+        std::stable_sort(order.begin(), order.end(), [timestamps, length](int a, int b) {
+            return compareTimestamps(timestamps + qint64(a) * length, timestamps + qint64(b) * length) < 0;
+        });
+    }
+
+    QByteArray sortedTimestamps(chunk.timestamps.size(), Qt::Uninitialized);
+    QVector<double> sortedDistances(rows);
+    for (int i = 0; i < rows; ++i) {
+        std::memcpy(sortedTimestamps.data() + qint64(i) * length, timestamps + qint64(order[i]) * length, length);
+        sortedDistances[i] = chunk.distances[order[i]];
+    }
+    chunk.timestamps = sortedTimestamps;
+    chunk.distances = sortedDistances;
+}
+
+// 从 [begin, end) 的开头（forward）或末尾找第一条可解析的行，取其存储时间文本
+bool boundaryTimestamp(const char *begin, const char *end, bool forward, char *timestamp)
+{
+    double distance;
+    if (forward) {
+        for (const char *line = begin; line < end;) {
+            const char *newline = static_cast<const char *>(std::memchr(line, '\n', end - line));
+            const char *lineEnd = newline ? newline : end;
+            if (parseLine(line, lineEnd, timestamp, distance)) {
+                return true;
+            }
+            line = lineEnd + 1;
+        }
+        return false;
+    }
+    const char *lineEnd = end;
+    while (lineEnd > begin) {
+        const char *line = lineEnd;
+        while (line > begin && line[-1] != '\n') {
+            --line;
+        }
+        if (parseLine(line, lineEnd, timestamp, distance)) {
+            return true;
+        }
+        lineEnd = line > begin ? line - 1 : begin;
+    }
+    return false;
+}
+
+// 文件指纹：大小与首尾各 1 MB 的 SHA-1，用于识别重复导入同一个导出文件
+QString fileFingerprint(const char *data, qint64 size)
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(QByteArray::number(size));
+    qint64 head = qMin(size, kFingerprintBytes);
+    hash.addData(QByteArrayView(data, head));
+    qint64 tailStart = qMax(head, size - kFingerprintBytes);
+    hash.addData(QByteArrayView(data + tailStart, size - tailStart));
+    return QString::fromLatin1(hash.result().toHex());
+}
+
+void parseChunk(const char *begin, const char *end, ParsedChunk &chunk)
+{
+    // 导出行约 30 字节，按此预估容量
+    qint64 estimate = (end - begin) / 28 + 16;
+    chunk.timestamps.resize(estimate * DataManager::kTimestampTextLength);
+    chunk.distances.reserve(estimate);
+
+    char *out = chunk.timestamps.data();
+    int rows = 0;
+    const char *line = begin;
+    while (line < end) {
+        const char *newline = static_cast<const char *>(std::memchr(line, '\n', end - line));
+        const char *lineEnd = newline ? newline : end;
+        const char *contentEnd = lineEnd;
+        if (contentEnd > line && contentEnd[-1] == '\r') {
+            --contentEnd;
+        }
+
+        if (contentEnd > line) {
+            if (rows >= estimate) {
+                estimate *= 2;
+                chunk.timestamps.resize(estimate * DataManager::kTimestampTextLength);
+                out = chunk.timestamps.data() + qint64(rows) * DataManager::kTimestampTextLength;
+            }
+            double distance;
+            if (parseLine(line, contentEnd, out, distance)) {
+                chunk.distances.append(distance);
+                out += DataManager::kTimestampTextLength;
+                ++rows;
+            } else {
+                ++chunk.skippedLines;
+            }
+        }
+        line = lineEnd + 1;
+    }
+    chunk.timestamps.resize(qint64(rows) * DataManager::kTimestampTextLength);
+    sortChunk(chunk);
+}
+
+} // namespace
+
+BulkImporter::BulkImporter(const QString &dbPath, QObject *parent)
+    : QObject(parent)
+    , m_dbPath(dbPath)
+    , m_dataManager(nullptr)
+    , m_cancelled(false)
+    , m_rows(0)
+    , m_skippedLines(0)
+    , m_rowsInTransaction(0)
+{
+}
+
+BulkImporter::~BulkImporter()
+{
+}
+
+void BulkImporter::open()
+{
+    if (m_dataManager) {
+        return;
+    }
+
+    m_dataManager = new DataManager(this);
+    connect(m_dataManager, &DataManager::errorOccurred, this, &BulkImporter::errorOccurred);
+    if (!m_dataManager->initialize(m_dbPath, "bulk_importer")) {
+        delete m_dataManager;
+        m_dataManager = nullptr;
+    }
+}
+
+void BulkImporter::importFiles(const QStringList &filePaths)
+{
+    m_cancelled = false;
+    m_rows = 0;
+    m_skippedLines = 0;
+    m_rowsInTransaction = 0;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    if (!m_dataManager) {
+        emit errorOccurred("Database not available");
+        emit importFinished(0, 0, 0);
+        return;
+    }
+
+    qint64 bytesTotal = 0;
+    for (const QString &path : filePaths) {
+        bytesTotal += QFileInfo(path).size();
+    }
+
+    qint64 bytesBefore = 0;
+    for (const QString &path : filePaths) {
+        if (m_cancelled || !importFile(path, bytesBefore, bytesTotal)) {
+            break;
+        }
+        bytesBefore += QFileInfo(path).size();
+    }
+
+    emit progressChanged(bytesTotal, bytesTotal, m_rows);
+    emit importFinished(m_rows, m_skippedLines, timer.elapsed());
+}
+
+bool BulkImporter::importFile(const QString &filePath, qint64 bytesBefore, qint64 bytesTotal)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        emit errorOccurred(QString("Cannot open %1: %2").arg(filePath, file.errorString()));
+        return false;
+    }
+    qint64 size = file.size();
+    if (size == 0) {
+        return true;
+    }
+
+    const char *data = reinterpret_cast<const char *>(file.map(0, size));
+    if (!data) {
+        emit errorOccurred(QString("Cannot map %1: %2").arg(filePath, file.errorString()));
+        return false;
+    }
+
+    // 同一文件再次导入会重复写入全部记录：拒绝并继续下一个文件；
+    // 上次只提交了前若干块（取消或出错）时跳过这些块，从其后继续
+    QString fingerprint = fileFingerprint(data, size);
+    QString previous;
+    int resumeChunk = 0;
+    qint64 committedRows = 0;
+    if (m_dataManager->isFileImported(fingerprint, previous, resumeChunk, committedRows)) {
+        emit errorOccurred(QString("Skipped %1: already imported from %2").arg(filePath, previous));
+        file.unmap(reinterpret_cast<uchar *>(const_cast<char *>(data)));
+        return true;
+    }
+    const QString absolutePath = QFileInfo(filePath).absoluteFilePath();
+
+    // 最新在前的导出（首行晚于末行）按块倒序写入，与块内翻转合起来即按时间顺序写入
+    char firstTimestamp[DataManager::kTimestampTextLength];
+    char lastTimestamp[DataManager::kTimestampTextLength];
+    const bool descending = boundaryTimestamp(data, data + size, true, firstTimestamp)
+        && boundaryTimestamp(data, data + size, false, lastTimestamp)
+        && compareTimestamps(lastTimestamp, firstTimestamp) < 0;
+
+    // 按换行切分
+    QVector<qint64> boundaries{0};
+    while (boundaries.last() < size) {
+        qint64 end = qMin(size, boundaries.last() + kChunkBytes);
+        if (end < size) {
+            const char *newline = static_cast<const char *>(std::memchr(data + end, '\n', size - end));
+            end = newline ? (newline - data) + 1 : size;
+        }
+        boundaries.append(end);
+    }
+    const int chunkCount = boundaries.size() - 1;
+    // 块边界只取决于文件内容与 kChunkBytes，与上次导入时相同
+    resumeChunk = qMin(resumeChunk, chunkCount);
+    if (resumeChunk > 0) {
+        emit errorOccurred(QString("Resuming import of %1 after %2 row(s) committed previously")
+                           .arg(filePath).arg(committedRows));
+    }
+    // 写入顺序中的第 index 块对应文件中的块
+    auto fileChunk = [descending, chunkCount](int index) { return descending ? chunkCount - 1 - index : index; };
+
+    // 解析线程按序领取块，写入线程按序消费
+    QVector<ParsedChunk> chunkStorage(chunkCount);
+    ParsedChunk *chunks = chunkStorage.data();
+    QMutex mutex;
+    QWaitCondition parsedCondition;
+    QWaitCondition writtenCondition;
+    int nextChunk = resumeChunk;
+    int writtenChunks = resumeChunk;
+    bool stopping = false;
+
+    const int threadCount = qBound(1, QThread::idealThreadCount() - 1, qMax(1, chunkCount - resumeChunk));
+    const int maxAhead = threadCount * kChunksAheadPerThread;
+
+    auto parseLoop = [&]() {
+        while (true) {
+            int index;
+            {
+                QMutexLocker locker(&mutex);
+                while (!stopping && nextChunk < chunkCount && nextChunk >= writtenChunks + maxAhead) {
+                    writtenCondition.wait(&mutex);
+                }
+                if (stopping || nextChunk >= chunkCount) {
+                    return;
+                }
+                index = nextChunk++;
+            }
+
+            int source = fileChunk(index);
+            parseChunk(data + boundaries[source], data + boundaries[source + 1], chunks[index]);
+
+            QMutexLocker locker(&mutex);
+            chunks[index].ready = true;
+            parsedCondition.wakeAll();
+        }
+    };
+
+    QVector<QThread *> threads;
+    for (int i = 0; i < threadCount; ++i) {
+        QThread *thread = QThread::create(parseLoop);
+        thread->start();
+        threads.append(thread);
+    }
+
+    bool ok = true;
+    qint64 fileRows = committedRows;
+    QElapsedTimer progressTimer;
+    progressTimer.start();
+    for (int index = resumeChunk; index < chunkCount; ++index) {
+        {
+            QMutexLocker locker(&mutex);
+            while (!chunks[index].ready) {
+                parsedCondition.wait(&mutex);
+            }
+        }
+
+        ParsedChunk &chunk = chunks[index];
+        m_skippedLines += chunk.skippedLines;
+        int rows = chunk.distances.size();
+        if (rows > 0) {
+            if (m_rowsInTransaction == 0 && !m_dataManager->beginBulkImport()) {
+                ok = false;
+            } else if (!m_dataManager->bulkInsert(chunk.timestamps.constData(), chunk.distances.constData(), rows)) {
+                m_dataManager->rollbackBulkImport();
+                m_rows -= m_rowsInTransaction;
+                m_rowsInTransaction = 0;
+                ok = false;
+            } else {
+                m_rows += rows;
+                fileRows += rows;
+                m_rowsInTransaction += rows;
+                // 中间事务一并登记已提交到第几块，取消或出错后再次导入时从这里继续
+                if (m_rowsInTransaction >= kTransactionRows && index + 1 < chunkCount) {
+                    if (!m_dataManager->recordImportedFile(fingerprint, absolutePath, fileRows, index + 1)
+                        || !m_dataManager->commitBulkImport()) {
+                        m_dataManager->rollbackBulkImport();
+                        m_rows -= m_rowsInTransaction;
+                        fileRows -= m_rowsInTransaction;
+                        ok = false;
+                    }
+                    m_rowsInTransaction = 0;
+                }
+            }
+        }
+
+        // 释放已写入的块
+        chunk.timestamps = QByteArray();
+        chunk.distances = QVector<double>();
+
+        {
+            QMutexLocker locker(&mutex);
+            writtenChunks = index + 1;
+            stopping = !ok || m_cancelled;
+            writtenCondition.wakeAll();
+        }
+
+        if (progressTimer.elapsed() >= kProgressIntervalMs) {
+            progressTimer.restart();
+            emit progressChanged(bytesBefore + qint64(index + 1) * size / chunkCount, bytesTotal, m_rows);
+        }
+        if (!ok || m_cancelled) {
+            break;
+        }
+    }
+
+    {
+        QMutexLocker locker(&mutex);
+        stopping = true;
+        writtenCondition.wakeAll();
+    }
+    for (QThread *thread : threads) {
+        thread->wait();
+        delete thread;
+    }
+
+    // 文件的最后一个事务登记整个文件已写完；取消或出错时回滚未提交的部分，
+    // 已提交的事务连同其登记的块数保留，再次导入时从其后继续
+    if (ok && !m_cancelled && fileRows > 0) {
+        if (m_rowsInTransaction == 0 && !m_dataManager->beginBulkImport()) {
+            ok = false;
+        } else if (!m_dataManager->recordImportedFile(fingerprint, absolutePath, fileRows)
+                   || !m_dataManager->commitBulkImport()) {
+            m_dataManager->rollbackBulkImport();
+            m_rows -= m_rowsInTransaction;
+            fileRows -= m_rowsInTransaction;
+            ok = false;
+        }
+        m_rowsInTransaction = 0;
+    } else if (m_rowsInTransaction > 0) {
+        m_dataManager->rollbackBulkImport();
+        m_rows -= m_rowsInTransaction;
+        fileRows -= m_rowsInTransaction;
+        m_rowsInTransaction = 0;
+    }
+    if ((m_cancelled || !ok) && fileRows > 0) {
+        emit errorOccurred(QString("Import of %1 stopped after %2 committed row(s); importing it again resumes from there")
+                           .arg(filePath).arg(fileRows));
+    }
+
+    file.unmap(reinterpret_cast<uchar *>(const_cast<char *>(data)));
+    return ok;
+}
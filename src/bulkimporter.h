@@ -0,0 +1,48 @@
+#ifndef BULKIMPORTER_H
+#define BULKIMPORTER_H
+
+#include <QObject>
+#include <QStringList>
+#include <atomic>
+
+#include "datamanager.h"
+
+/**
+ * @brief 批量导入导出文件（CSV：ID,Timestamp,Distance(cm)，以及旧版 TXT 导出格式）
+ *
+ * 文件整体内存映射后按换行切分为固定大小的块，多线程并行解析，
+ * 单个写入线程按时间顺序分批提交（每个事务数万行），不长时间占用写锁。解析领先写入的块数有上限，内存占用恒定。
+ * 最新在前的导出按块倒序、块内翻转后写入；按文件指纹登记已导入的文件，重复导入会被跳过。
+ * 每个事务同时登记已提交的块数，取消或出错后再次导入同一文件时从中断处继续。
+ */
+class BulkImporter : public QObject {
+    Q_OBJECT
+
+public:
+    explicit BulkImporter(const QString &dbPath, QObject *parent = nullptr);
+    ~BulkImporter();
+
+    // 可从任意线程调用
+    void cancel() { m_cancelled = true; }
+
+public slots:
+    void open();
+    void importFiles(const QStringList &filePaths);
+
+signals:
+    void progressChanged(qint64 bytesDone, qint64 bytesTotal, qint64 rows);
+    void importFinished(qint64 rows, qint64 skippedLines, qint64 elapsedMs);
+    void errorOccurred(const QString &error);
+
+private:
+    bool importFile(const QString &filePath, qint64 bytesBefore, qint64 bytesTotal);
+
+    QString m_dbPath;
+    DataManager *m_dataManager;
+    std::atomic<bool> m_cancelled;
+    qint64 m_rows;
+    qint64 m_skippedLines;
+    qint64 m_rowsInTransaction;
+};
+
+#endif // BULKIMPORTER_H
@@ -1,22 +1,17 @@
 #include "chartwidget.h"
 #include <QVBoxLayout>
-#include <QtCharts/QChart>
 
 ChartWidget::ChartWidget(QWidget *parent)
     : QWidget(parent)
-    , m_chartView(new QChartView(this))
-    , m_chart(new QChart())
-    , m_series(new QLineSeries())
-    , m_axisX(new QValueAxis())
-    , m_axisY(new QValueAxis())
+    , m_waveform(new WaveformWidget(this))
+    , m_distanceChannel(-1)
     , m_maxDataPoints(100)
-    , m_dataCounter(0)
     , m_isPaused(false)
 {
     setupChart();
 
     QVBoxLayout *layout = new QVBoxLayout(this);
-    layout->addWidget(m_chartView);
+    layout->addWidget(m_waveform);
     layout->setContentsMargins(0, 0, 0, 0);
     setLayout(layout);
 }
@@ -27,37 +22,13 @@ ChartWidget::~ChartWidget()
 
 void ChartWidget::setupChart()
 {
-    // 设置曲线样式
-    QPen pen(QColor(0, 120, 215));
-    pen.setWidth(2);
-    m_series->setPen(pen);
-    m_series->setName("Distance");
-
     // 配置图表
-    m_chart->addSeries(m_series);
-    m_chart->setTitle("Real-time Distance Measurement");
-    m_chart->legend()->setVisible(true);
-    m_chart->legend()->setAlignment(Qt::AlignBottom);
-
-    // 设置X轴（时间序列）
-    m_axisX->setTitleText("Time (samples)");
-    m_axisX->setLabelFormat("%d");
-    m_axisX->setRange(0, m_maxDataPoints);
-    m_axisX->setTickCount(11);
-    m_chart->addAxis(m_axisX, Qt::AlignBottom);
-    m_series->attachAxis(m_axisX);
+    m_waveform->setTitle("Real-time Distance Measurement");
+    m_waveform->setWindowSize(m_maxDataPoints);
+    m_waveform->setYRange(0, 400);
 
-    // 设置Y轴（距离）
-    m_axisY->setTitleText("Distance (cm)");
-    m_axisY->setLabelFormat("%.1f");
-    m_axisY->setRange(0, 400);
-    m_axisY->setTickCount(9);
-    m_chart->addAxis(m_axisY, Qt::AlignLeft);
-    m_series->attachAxis(m_axisY);
-
-    // 配置图表视图
-    m_chartView->setChart(m_chart);
-    m_chartView->setRenderHint(QPainter::Antialiasing);
+    // 距离曲线
+    m_distanceChannel = m_waveform->addChannel("Distance", QColor(0, 120, 215));
 }
 
 void ChartWidget::addDataPoint(double distance)
@@ -66,37 +37,36 @@ void ChartWidget::addDataPoint(double distance)
         return;
     }
 
-    // 添加数据点
-    m_series->append(m_dataCounter, distance);
-    m_dataCounter++;
+    m_waveform->appendSample(m_distanceChannel, static_cast<float>(distance));
+}
 
-    // 限制显示的数据点数量
-    if (m_series->count() > m_maxDataPoints) {
-        m_series->remove(0);
-        // 更新X轴范围以显示最新数据
-        m_axisX->setRange(m_dataCounter - m_maxDataPoints, m_dataCounter);
+void ChartWidget::addDataPoints(const QVector<float> &distances)
+{
+    if (m_isPaused) {
+        return;
     }
+
+    m_waveform->appendSamples(m_distanceChannel, distances.constData(), distances.size());
 }
 
 void ChartWidget::setMaxDataPoints(int count)
 {
     m_maxDataPoints = count;
-    m_axisX->setRange(0, m_maxDataPoints);
+    m_waveform->setWindowSize(m_maxDataPoints);
 }
 
 void ChartWidget::setYAxisRange(double min, double max)
 {
-    m_axisY->setRange(min, max);
+    m_waveform->setYRange(min, max);
 }
 
 void ChartWidget::clearData()
 {
-    m_series->clear();
-    m_dataCounter = 0;
-    m_axisX->setRange(0, m_maxDataPoints);
+    m_waveform->clear();
 }
 
 void ChartWidget::setPaused(bool paused)
 {
     m_isPaused = paused;
+    m_waveform->setPaused(paused);
 }
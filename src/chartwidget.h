@@ -2,14 +2,10 @@
 #define CHARTWIDGET_H
 
 #include <QWidget>
-#include <QtCharts/QChartView>
-#include <QtCharts/QChart>
-#include <QtCharts/QLineSeries>
-#include <QtCharts/QValueAxis>
-#include <QtCharts/QDateTimeAxis>
-#include <QDateTime>
 #include <QVector>
 
+#include "waveformwidget.h"
+
 /**
  * @brief 波形图显示组件，实时显示距离变化曲线
  */
@@ -22,9 +18,11 @@ public:
 
     // 添加数据点
     void addDataPoint(double distance);
+    void addDataPoints(const QVector<float> &distances);
 
     // 设置显示参数
     void setMaxDataPoints(int count);  // 最大显示点数
+    int maxDataPoints() const { return m_maxDataPoints; }
     void setYAxisRange(double min, double max);  // Y轴范围
 
     // 清空数据
@@ -33,15 +31,14 @@ public:
     // 暂停/恢复更新
     void setPaused(bool paused);
 
+    // 底层绘制组件，用于添加更多通道
+    WaveformWidget *waveform() const { return m_waveform; }
+
 private:
-    QChartView *m_chartView;
-    QChart *m_chart;
-    QLineSeries *m_series;
-    QValueAxis *m_axisX;
-    QValueAxis *m_axisY;
+    WaveformWidget *m_waveform;
+    int m_distanceChannel;
 
     int m_maxDataPoints;
-    int m_dataCounter;
     bool m_isPaused;
 
     void setupChart();
@@ -1,26 +1,151 @@
 #include "datamanager.h"
+#include "spoolreplayer.h"
+#include "samplefixed.h"
 #include <QSqlQuery>
 #include <QSqlError>
 #include <QFile>
 #include <QTextStream>
+#include <QFileInfo>
+#include <QDir>
+#include <QThread>
+#include <QTimer>
+#include <QElapsedTimer>
 #include <QDebug>
+#include <cmath>
+#include <limits>
+
+// 汇总层级：1 秒、1 分钟、1 小时、1 天（按宽度升序）
+static const struct { int level; qint64 widthMs; } kRollupLevels[] = {
+    {0, 1000},
+    {1, 60 * 1000},
+    {2, 60 * 60 * 1000},
+    {3, 24 * 60 * 60 * 1000},
+};
+static const int kRollupLevelCount = sizeof(kRollupLevels) / sizeof(kRollupLevels[0]);
+
+// 启动时打开失败的最长重试间隔
+static const int kMaxOpenRetryDelayMs = 30000;
+
+// 文本时间戳 -> 存储毫秒（与 DataManager::toStorageMs 一致）
+#define STORAGE_MS_SQL(column) \
+    "CAST(ROUND((julianday(" column ") - 2440587.5) * 86400000.0) AS INTEGER)"
+
+static QString storageString(qint64 ms)
+{
+    return QDateTime::fromMSecsSinceEpoch(ms, Qt::UTC).toString("yyyy-MM-dd'T'hh:mm:ss.zzz");
+}
+
+// 随插入维护汇总表的触发器；批量导入期间临时移除
+static QString rollupTriggerSql()
+{
+    return R"(
+        CREATE TRIGGER IF NOT EXISTS trg_history_rollup AFTER INSERT ON distance_records
+        BEGIN
+            INSERT INTO history_rollup (level, bucket_start, min_distance, max_distance, count,
+                                        sum_distance, sumsq_distance)
+            SELECT l.level, ()" STORAGE_MS_SQL("NEW.timestamp") R"( / l.width) * l.width,
+                   NEW.distance, NEW.distance, 1, NEW.distance, NEW.distance * NEW.distance
+            FROM rollup_levels l WHERE 1
+            ON CONFLICT(level, bucket_start) DO UPDATE SET
+                min_distance = MIN(min_distance, excluded.min_distance),
+                max_distance = MAX(max_distance, excluded.max_distance),
+                count = count + 1,
+                sum_distance = sum_distance + excluded.sum_distance,
+                sumsq_distance = sumsq_distance + excluded.sumsq_distance;
+        END
+    )";
+}
+
+// 删除记录时写入墓碑，序号取自记录的自增序列，与新记录 id 统一排序；清空时临时移除
+static QString tombstoneTriggerSql()
+{
+    return R"(
+        CREATE TRIGGER IF NOT EXISTS trg_record_tombstone AFTER DELETE ON distance_records
+        BEGIN
+            UPDATE sqlite_sequence SET seq = seq + 1 WHERE name = 'distance_records';
+            INSERT INTO record_tombstones (sequence, record_id, scope)
+            SELECT seq, OLD.id, 0 FROM sqlite_sequence WHERE name = 'distance_records';
+        END
+    )";
+}
+
+// 增量导出二进制格式：文件头后为定长变更记录，均为本机字节序
+struct ChangeFileHeader {
+    char magic[4];            // "ULCF"
+    quint32 version;
+    qint32 fractionDigits;    // 距离定点小数位数
+    quint32 reserved;
+    qint64 sinceWatermark;
+    qint64 watermark;
+    quint64 count;
+};
+
+struct ChangeFileRecord {
+    qint64 sequence;
+    qint64 recordId;
+    qint64 timestampMs;
+    qint32 value;             // SampleFixed 定点值
+    quint32 type;             // RecordChange::Type
+};
+
+static_assert(sizeof(ChangeFileHeader) == 40, "ChangeFileHeader layout changed");
+static_assert(sizeof(ChangeFileRecord) == 32, "ChangeFileRecord layout changed");
 
 DataManager::DataManager(QObject *parent)
     : QObject(parent)
+    , m_openThread(nullptr)
+    , m_isOpening(false)
+    , m_openRetryDelayMs(0)
+    , m_spool(nullptr)
+    , m_replayThread(nullptr)
+    , m_replayer(nullptr)
+    , m_directWriter(nullptr)
+    , m_bulkFirstId(-1)
+    , m_rollupsReady(false)
+    , m_compressionTolerance(0)
+    , m_compressionSamples(0)
+    , m_compressionStored(0)
+    , m_compressionInputUs(0)
+    , m_lastInputUs(-1)
+    , m_compressionSpanId(-1)
+    , m_spanSamples(0)
+    , m_spanInputUs(0)
 {
 }
 
 DataManager::~DataManager()
 {
+    if (m_openThread) {
+        m_openThread->wait();
+        delete m_openThread;
+    }
+    if (m_replayThread) {
+        m_replayThread->quit();
+        m_replayThread->wait();
+    }
+    delete m_spool;
+
+    if (m_compressionSpanId >= 0 && m_database.isOpen()) {
+        updateCompressionSpan(0);
+    }
+
+    QString connectionName = m_database.connectionName();
     if (m_database.isOpen()) {
         m_database.close();
     }
+    if (!connectionName.isEmpty() && connectionName != QLatin1String(QSqlDatabase::defaultConnection)) {
+        m_database = QSqlDatabase();
+        QSqlDatabase::removeDatabase(connectionName);
+    }
 }
 
-bool DataManager::initialize(const QString &dbPath)
+bool DataManager::initialize(const QString &dbPath, const QString &connectionName)
 {
-    m_database = QSqlDatabase::addDatabase("QSQLITE");
+    m_database = connectionName.isEmpty()
+        ? QSqlDatabase::addDatabase("QSQLITE")
+        : QSqlDatabase::addDatabase("QSQLITE", connectionName);
     m_database.setDatabaseName(dbPath);
+    m_databasePath = dbPath;
 
     if (!m_database.open()) {
         QString error = QString("Database open failed: %1").arg(m_database.lastError().text());
@@ -29,6 +154,10 @@ bool DataManager::initialize(const QString &dbPath)
         return false;
     }
 
+    // WAL 模式下后台写入不会阻塞界面线程的查询
+    QSqlQuery pragma(m_database);
+    pragma.exec("PRAGMA journal_mode=WAL");
+
     if (!createTables()) {
         return false;
     }
@@ -37,10 +166,214 @@ bool DataManager::initialize(const QString &dbPath)
     return true;
 }
 
+bool DataManager::openReadOnly(const QString &dbPath, const QString &connectionName)
+{
+    if (!QFileInfo::exists(dbPath)) {
+        emit errorOccurred(QString("Database not found: %1").arg(dbPath));
+        return false;
+    }
+
+    m_database = connectionName.isEmpty()
+        ? QSqlDatabase::addDatabase("QSQLITE")
+        : QSqlDatabase::addDatabase("QSQLITE", connectionName);
+    m_database.setDatabaseName(dbPath);
+    m_database.setConnectOptions("QSQLITE_OPEN_READONLY");
+    m_databasePath = dbPath;
+
+    if (!m_database.open()) {
+        emit errorOccurred(QString("Database open failed: %1").arg(m_database.lastError().text()));
+        return false;
+    }
+    return true;
+}
+
+void DataManager::initializeAsync(const QString &dbPath)
+{
+    if (m_isOpening) {
+        return;
+    }
+    m_databasePath = dbPath;
+    m_isOpening = true;
+    m_openRetryDelayMs = 0;
+    m_openClock.start();
+    startOpen();
+}
+
+void DataManager::startOpen()
+{
+    QString dbPath = m_databasePath;
+    m_openThread = QThread::create([this, dbPath]() {
+        // 耗时部分用独立连接完成，完成后主连接只需打开已就绪的库
+        RangeStatistics stats;
+        bool ok;
+        {
+            DataManager probe;
+            connect(&probe, &DataManager::errorOccurred, this, &DataManager::errorOccurred);
+            ok = probe.initialize(dbPath, "storage_open") && probe.ensureRollups();
+            qint64 firstMs;
+            qint64 lastMs;
+            if (ok && probe.queryTimeBounds(firstMs, lastMs)) {
+                probe.queryStatistics(firstMs, lastMs + 1, stats);
+            }
+        }
+
+        QMetaObject::invokeMethod(this, [this, ok, stats]() { finishOpen(ok, stats); });
+    });
+    m_openThread->start();
+}
+
+void DataManager::finishOpen(bool ok, const RangeStatistics &stats)
+{
+    m_openThread->wait();
+    delete m_openThread;
+    m_openThread = nullptr;
+
+    if (!ok || !initialize(m_databasePath)) {
+        // 库暂时不可用（被占用、所在磁盘未挂载等）：样本照常写入暂存，按指数退避重试打开；
+        // 只在第一次失败时通知
+        bool first = m_openRetryDelayMs == 0;
+        m_openRetryDelayMs = first ? 500 : qMin(m_openRetryDelayMs * 2, kMaxOpenRetryDelayMs);
+        QTimer::singleShot(m_openRetryDelayMs, this, &DataManager::startOpen);
+        if (first) {
+            emit storageReady(false, stats, m_openClock.elapsed());
+        }
+        return;
+    }
+
+    // 上次异常退出时未结束的压缩时间段到此结束（间隔未知）；当前已开启压缩时从此刻重新记录
+    QSqlQuery query(m_database);
+    query.prepare("UPDATE compression_spans SET end_ms = ? WHERE end_ms IS NULL");
+    query.addBindValue(toStorageMs(QDateTime::currentDateTime()));
+    if (!query.exec()) {
+        emit errorOccurred(QString("Compression span update failed: %1").arg(query.lastError().text()));
+    }
+    if (m_compressionTolerance.load() > 0) {
+        updateCompressionSpan(m_compressionTolerance.load());
+    }
+
+    // 迁移与汇总补建已完成，回放写入不再与之竞争
+    m_isOpening = false;
+    startReplay();
+    emit storageReady(true, stats, m_openClock.elapsed());
+}
+
+QString DataManager::databasePath() const
+{
+    return m_databasePath;
+}
+
+bool DataManager::openSpool(const QString &filePath)
+{
+    if (m_spool) {
+        return true;
+    }
+
+    QString path = filePath;
+    if (path.isEmpty()) {
+        path = QFileInfo(databasePath()).absoluteDir().filePath("ultrasonic_spool.bin");
+    }
+
+    m_spool = new SampleSpool(path);
+    if (!m_spool->open()) {
+        emit errorOccurred(QString("Spool open failed: %1").arg(m_spool->errorString()));
+        delete m_spool;
+        m_spool = nullptr;
+        return false;
+    }
+
+    // 数据库即使当前不可用，回放线程也会持续重试；后台打开期间暂不启动，见 startReplay()
+    m_replayThread = new QThread(this);
+    m_replayer = new SpoolReplayer(m_spool, databasePath());
+    m_replayer->moveToThread(m_replayThread);
+    connect(m_replayThread, &QThread::started, m_replayer, &SpoolReplayer::start);
+    connect(m_replayThread, &QThread::finished, m_replayer, &QObject::deleteLater);
+    connect(m_replayer, &SpoolReplayer::errorOccurred, this, &DataManager::errorOccurred);
+    connect(m_replayer, &SpoolReplayer::storageAvailabilityChanged,
+            this, &DataManager::storageAvailabilityChanged);
+    connect(m_replayer, &SpoolReplayer::recordsReplayed, this, &DataManager::recordsChanged);
+    connect(m_replayer, &SpoolReplayer::replayed, this, &DataManager::spoolReplayed);
+    if (!m_isOpening) {
+        startReplay();
+    }
+
+    qDebug() << "Spool opened:" << path << "pending" << m_spool->pendingCount();
+    return true;
+}
+
+void DataManager::startReplay()
+{
+    // 回放连接的建表与写入会触发汇总触发器，必须等 initializeAsync() 的迁移和补建结束
+    if (m_replayThread && !m_replayThread->isRunning()) {
+        m_replayThread->start();
+    }
+}
+
+quint64 DataManager::requestReplay()
+{
+    if (!m_spool) {
+        return 0;
+    }
+    quint64 target = m_spool->writeSequence();
+    if (m_replayThread->isRunning() && !isReplayedUpTo(target)) {
+        QMetaObject::invokeMethod(m_replayer, &SpoolReplayer::replayNow, Qt::QueuedConnection);
+    }
+    return target;
+}
+
+bool DataManager::isReplayedUpTo(quint64 sequence) const
+{
+    return !m_spool || m_spool->replayedSequence() >= sequence;
+}
+
+quint64 DataManager::pendingSamples() const
+{
+    return m_spool ? m_spool->pendingCount() : 0;
+}
+
+// 持久化的库级标记（storage_meta 表），不存在时返回 defaultValue
+static qint64 metaValue(QSqlQuery &query, const QString &key, qint64 defaultValue)
+{
+    query.prepare("SELECT value FROM storage_meta WHERE key = ?");
+    query.addBindValue(key);
+    return query.exec() && query.next() ? query.value(0).toLongLong() : defaultValue;
+}
+
+static bool setMetaValue(QSqlQuery &query, const QString &key, qint64 value)
+{
+    query.prepare("INSERT INTO storage_meta (key, value) VALUES (?, ?) "
+                  "ON CONFLICT(key) DO UPDATE SET value = excluded.value");
+    query.addBindValue(key);
+    query.addBindValue(value);
+    return query.exec();
+}
+
 bool DataManager::createTables()
 {
+    // 建表与迁移在一个写事务内：多个连接同时打开旧库时，只有先拿到写锁的一个执行迁移，
+    // 其余连接等它提交后看到的已是新结构
     QSqlQuery query(m_database);
+    if (!query.exec("BEGIN IMMEDIATE")) {
+        QString error = QString("Schema transaction failed: %1").arg(query.lastError().text());
+        emit errorOccurred(error);
+        qDebug() << error;
+        return false;
+    }
+    if (!createSchema(query)) {
+        query.exec("ROLLBACK");
+        return false;
+    }
+    if (!query.exec("COMMIT")) {
+        QString error = QString("Schema commit failed: %1").arg(query.lastError().text());
+        emit errorOccurred(error);
+        qDebug() << error;
+        query.exec("ROLLBACK");
+        return false;
+    }
+    return true;
+}
 
+bool DataManager::createSchema(QSqlQuery &query)
+{
     QString createTableSQL = R"(
         CREATE TABLE IF NOT EXISTS distance_records (
             id INTEGER PRIMARY KEY AUTOINCREMENT,
@@ -57,14 +390,259 @@ bool DataManager::createTables()
     }
 
     query.exec("CREATE INDEX IF NOT EXISTS idx_timestamp ON distance_records(timestamp)");
+
+    QString createEventsSQL = R"(
+        CREATE TABLE IF NOT EXISTS detection_events (
+            id INTEGER PRIMARY KEY AUTOINCREMENT,
+            timestamp DATETIME NOT NULL,
+            timestamp_us INTEGER NOT NULL,
+            rule_id INTEGER NOT NULL,
+            rule_name TEXT,
+            event_type TEXT NOT NULL,
+            value REAL
+        )
+    )";
+
+    if (!query.exec(createEventsSQL)) {
+        QString error = QString("Event table creation failed: %1").arg(query.lastError().text());
+        emit errorOccurred(error);
+        qDebug() << error;
+        return false;
+    }
+
+    query.exec("CREATE INDEX IF NOT EXISTS idx_event_timestamp ON detection_events(timestamp_us)");
+
+    // 采集中断区间（设备掉线到自动重连成功）
+    QString createGapsSQL = R"(
+        CREATE TABLE IF NOT EXISTS acquisition_gaps (
+            id INTEGER PRIMARY KEY AUTOINCREMENT,
+            start_time DATETIME NOT NULL,
+            end_time DATETIME NOT NULL,
+            start_us INTEGER NOT NULL,
+            end_us INTEGER NOT NULL,
+            reason TEXT
+        )
+    )";
+
+    if (!query.exec(createGapsSQL)) {
+        QString error = QString("Gap table creation failed: %1").arg(query.lastError().text());
+        emit errorOccurred(error);
+        qDebug() << error;
+        return false;
+    }
+
+    // 多分辨率分块汇总（最小/最大值、计数、和、平方和），由触发器随插入维护；
+    // 历史视图用于降采样，统计面板用于任意区间聚合
+    QString createRollupSQL = R"(
+        CREATE TABLE IF NOT EXISTS history_rollup (
+            level INTEGER NOT NULL,
+            bucket_start INTEGER NOT NULL,
+            min_distance REAL NOT NULL,
+            max_distance REAL NOT NULL,
+            count INTEGER NOT NULL,
+            sum_distance REAL NOT NULL DEFAULT 0,
+            sumsq_distance REAL NOT NULL DEFAULT 0,
+            PRIMARY KEY (level, bucket_start)
+        ) WITHOUT ROWID
+    )";
+
+    if (!query.exec(createRollupSQL)
+        || !query.exec("CREATE TABLE IF NOT EXISTS rollup_levels (level INTEGER PRIMARY KEY, width INTEGER NOT NULL)")) {
+        QString error = QString("Rollup table creation failed: %1").arg(query.lastError().text());
+        emit errorOccurred(error);
+        qDebug() << error;
+        return false;
+    }
+
+    for (const auto &level : kRollupLevels) {
+        query.prepare("INSERT OR IGNORE INTO rollup_levels (level, width) VALUES (?, ?)");
+        query.addBindValue(level.level);
+        query.addBindValue(level.widthMs);
+        query.exec();
+    }
+
+    if (!query.exec("CREATE TABLE IF NOT EXISTS storage_meta (key TEXT PRIMARY KEY, value INTEGER NOT NULL)")) {
+        QString error = QString("Meta table creation failed: %1").arg(query.lastError().text());
+        emit errorOccurred(error);
+        qDebug() << error;
+        return false;
+    }
+
+    // 汇总是否完整由 rollup_backfilled 标记决定，而不是看汇总表是否为空：
+    // 没有标记的旧库（汇总缺失或不完整）与下面迁移过的库都记为 0，由 ensureRollups() 全量补建
+    qint64 backfilled = metaValue(query, "rollup_backfilled", -1);
+    if (backfilled < 0) {
+        query.exec("SELECT EXISTS(SELECT 1 FROM distance_records)");
+        backfilled = query.next() && query.value(0).toBool() ? 0 : 1;
+    }
+
+    // 旧版汇总表没有和/平方和：补列并清空
+    bool hasSums = false;
+    query.exec("PRAGMA table_info(history_rollup)");
+    while (query.next()) {
+        hasSums = hasSums || query.value(1).toString() == "sum_distance";
+    }
+    if (!hasSums) {
+        if (!query.exec("ALTER TABLE history_rollup ADD COLUMN sum_distance REAL NOT NULL DEFAULT 0")
+            || !query.exec("ALTER TABLE history_rollup ADD COLUMN sumsq_distance REAL NOT NULL DEFAULT 0")
+            || !query.exec("DELETE FROM history_rollup")) {
+            QString error = QString("Rollup migration failed: %1").arg(query.lastError().text());
+            emit errorOccurred(error);
+            qDebug() << error;
+            return false;
+        }
+        backfilled = 0;
+    }
+
+    // 未补建时不安装触发器：补建与安装在 ensureRollups() 的同一事务内完成，
+    // 在此之前写入的记录由全量补建计入
+    if (!setMetaValue(query, "rollup_backfilled", backfilled)
+        || !query.exec(backfilled ? rollupTriggerSql() : QString("DROP TRIGGER IF EXISTS trg_history_rollup"))) {
+        QString error = QString("Rollup trigger creation failed: %1").arg(query.lastError().text());
+        emit errorOccurred(error);
+        qDebug() << error;
+        return false;
+    }
+
+    // 已导入的文件（指纹见 BulkImporter），同一文件再次导入时拒绝。
+    // 不能靠时间戳唯一约束去重：导出只精确到秒，同一块实时样本也共用时间戳。
+    // chunks 非空表示只提交了前若干块（导入被取消或出错），再次导入时从其后继续
+    QString createImportedSQL = R"(
+        CREATE TABLE IF NOT EXISTS imported_files (
+            fingerprint TEXT PRIMARY KEY,
+            path TEXT NOT NULL,
+            rows INTEGER NOT NULL,
+            imported_ms INTEGER NOT NULL,
+            chunks INTEGER
+        )
+    )";
+
+    if (!query.exec(createImportedSQL)) {
+        QString error = QString("Import table creation failed: %1").arg(query.lastError().text());
+        emit errorOccurred(error);
+        qDebug() << error;
+        return false;
+    }
+
+    // 旧版登记表只记录完整导入的文件：补列，已有的行均为完整导入
+    bool hasChunks = false;
+    query.exec("PRAGMA table_info(imported_files)");
+    while (query.next()) {
+        hasChunks = hasChunks || query.value(1).toString() == "chunks";
+    }
+    if (!hasChunks && !query.exec("ALTER TABLE imported_files ADD COLUMN chunks INTEGER")) {
+        QString error = QString("Import table migration failed: %1").arg(query.lastError().text());
+        emit errorOccurred(error);
+        qDebug() << error;
+        return false;
+    }
+
+    // 入库压缩开启的时间段：其中的记录是不等间隔的保存点，统计另算代表的样本数，导出时注明
+    QString createCompressionSQL = R"(
+        CREATE TABLE IF NOT EXISTS compression_spans (
+            id INTEGER PRIMARY KEY AUTOINCREMENT,
+            start_ms INTEGER NOT NULL,
+            end_ms INTEGER,
+            tolerance INTEGER NOT NULL,
+            sample_interval_us REAL
+        )
+    )";
+
+    if (!query.exec(createCompressionSQL)) {
+        QString error = QString("Compression table creation failed: %1").arg(query.lastError().text());
+        emit errorOccurred(error);
+        qDebug() << error;
+        return false;
+    }
+
+    // 暂存回放水位：每个暂存文件已入库到的序号，与回放批次在同一事务内更新，
+    // 批次提交后、暂存文件标记回放前崩溃时，重启后据此跳过已入库的记录
+    if (!query.exec("CREATE TABLE IF NOT EXISTS spool_replay (spool_id INTEGER PRIMARY KEY, sequence INTEGER NOT NULL)")) {
+        QString error = QString("Spool watermark table creation failed: %1").arg(query.lastError().text());
+        emit errorOccurred(error);
+        qDebug() << error;
+        return false;
+    }
+
+    // 删除记录的墓碑，供增量同步下发删除
+    QString createTombstonesSQL = R"(
+        CREATE TABLE IF NOT EXISTS record_tombstones (
+            sequence INTEGER PRIMARY KEY,
+            record_id INTEGER NOT NULL,
+            scope INTEGER NOT NULL DEFAULT 0
+        )
+    )";
+
+    if (!query.exec(createTombstonesSQL) || !query.exec(tombstoneTriggerSql())) {
+        QString error = QString("Tombstone table creation failed: %1").arg(query.lastError().text());
+        emit errorOccurred(error);
+        qDebug() << error;
+        return false;
+    }
+
+    // 录制会话目录：时间为存储毫秒，统计在会话内的样本全部入库后写入（summarized 置 1）
+    QString createSessionsSQL = R"(
+        CREATE TABLE IF NOT EXISTS recording_sessions (
+            id INTEGER PRIMARY KEY AUTOINCREMENT,
+            name TEXT NOT NULL,
+            notes TEXT,
+            channels TEXT NOT NULL,
+            start_ms INTEGER NOT NULL,
+            end_ms INTEGER,
+            summarized INTEGER NOT NULL DEFAULT 0,
+            count INTEGER NOT NULL DEFAULT 0,
+            sum_distance REAL NOT NULL DEFAULT 0,
+            sumsq_distance REAL NOT NULL DEFAULT 0,
+            min_distance REAL,
+            max_distance REAL
+        )
+    )";
+
+    if (!query.exec(createSessionsSQL)) {
+        QString error = QString("Session table creation failed: %1").arg(query.lastError().text());
+        emit errorOccurred(error);
+        qDebug() << error;
+        return false;
+    }
+
+    // 旧版目录（按 id 区间记录会话）：已结束的会话在结束时即已计算统计；不再使用的 id 列保留
+    bool hasSummarized = false;
+    query.exec("PRAGMA table_info(recording_sessions)");
+    while (query.next()) {
+        hasSummarized = hasSummarized || query.value(1).toString() == "summarized";
+    }
+    if (!hasSummarized
+        && (!query.exec("ALTER TABLE recording_sessions ADD COLUMN summarized INTEGER NOT NULL DEFAULT 0")
+            || !query.exec("UPDATE recording_sessions SET summarized = 1 WHERE end_ms IS NOT NULL"))) {
+        QString error = QString("Session table migration failed: %1").arg(query.lastError().text());
+        emit errorOccurred(error);
+        qDebug() << error;
+        return false;
+    }
     return true;
 }
 
 bool DataManager::saveData(double distance)
 {
+    return saveData(distance, QDateTime::currentMSecsSinceEpoch() * 1000);
+}
+
+bool DataManager::saveData(double distance, qint64 timestampUs)
+{
+    // 采集路径只写暂存文件，不等待数据库
+    if (m_spool) {
+        if (!m_spool->append(timestampUs, SampleFixed::fromDouble(distance))) {
+            emit errorOccurred("Spool full, sample dropped");
+            return false;
+        }
+        m_replayer->notifyAppended();
+        return true;
+    }
+
+    QDateTime timestamp = QDateTime::fromMSecsSinceEpoch(timestampUs / 1000);
     QSqlQuery query(m_database);
     query.prepare("INSERT INTO distance_records (timestamp, distance) VALUES (?, ?)");
-    query.addBindValue(QDateTime::currentDateTime());
+    query.addBindValue(timestamp);
     query.addBindValue(distance);
 
     if (!query.exec()) {
@@ -75,97 +653,1003 @@ bool DataManager::saveData(double distance)
     }
 
     int id = query.lastInsertId().toInt();
-    DistanceRecord record(id, QDateTime::currentDateTime(), distance);
-    emit dataAdded(record);
+    emit dataAdded({DistanceRecord(id, timestamp, distance)});
+    emit recordsChanged();
     return true;
 }
 
-QVector<DistanceRecord> DataManager::queryAll()
+bool DataManager::saveSamples(const SampleBlock &block)
 {
-    QVector<DistanceRecord> records;
-    QSqlQuery query(m_database);
+    if (block.isEmpty()) {
+        return true;
+    }
 
-    if (!query.exec("SELECT id, timestamp, distance FROM distance_records ORDER BY timestamp DESC")) {
-        emit errorOccurred(QString("Query failed: %1").arg(query.lastError().text()));
-        return records;
+    m_compressionSamples.fetch_add(block.size(), std::memory_order_relaxed);
+
+    // 名义采样间隔：同一次读取的样本共用时间戳，按总间隔除以样本数计算
+    qint64 inputUs = 0;
+    for (qint64 timestampUs : block.timestampsUs) {
+        qint64 interval = timestampUs - m_lastInputUs;
+        if (m_lastInputUs >= 0 && interval > 0 && interval <= SampleCompressor::kMaxIntervalUs) {
+            inputUs += interval;
+        }
+        m_lastInputUs = timestampUs;
     }
+    m_compressionInputUs.fetch_add(inputUs, std::memory_order_relaxed);
 
-    while (query.next()) {
-        DistanceRecord record;
-        record.id = query.value(0).toInt();
-        record.timestamp = query.value(1).toDateTime();
-        record.distance = query.value(2).toDouble();
-        records.append(record);
+    // 容差改变：先写出按旧容差暂存的样本，新容差从下一个样本重新开始
+    SampleBlock stored;
+    qint32 tolerance = m_compressionTolerance.load(std::memory_order_relaxed);
+    if (tolerance != m_compressor.tolerance()) {
+        m_compressor.flush(stored);
+        m_compressor.reset();
+        m_compressor.setTolerance(tolerance);
     }
-    return records;
+    if (tolerance <= 0 && stored.isEmpty()) {
+        m_compressionStored.fetch_add(block.size(), std::memory_order_relaxed);
+        return writeSamples(block);
+    }
+
+    // 共用时间戳的样本由压缩器在两次读取之间展开，保存点使用展开后的时间
+    m_compressor.push(block, stored);
+    m_compressionStored.fetch_add(stored.size(), std::memory_order_relaxed);
+    return writeSamples(stored);
 }
 
-QVector<DistanceRecord> DataManager::queryByDateRange(const QDateTime &start, const QDateTime &end)
+void DataManager::setCompressionTolerance(double toleranceCm)
 {
-    QVector<DistanceRecord> records;
-    QSqlQuery query(m_database);
-
-    query.prepare("SELECT id, timestamp, distance FROM distance_records WHERE timestamp BETWEEN ? AND ? ORDER BY timestamp DESC");
-    query.addBindValue(start);
-    query.addBindValue(end);
-
-    if (!query.exec()) {
-        emit errorOccurred(QString("Range query failed: %1").arg(query.lastError().text()));
-        return records;
+    qint32 tolerance = qMax(0, SampleFixed::fromDouble(toleranceCm));
+    qint32 previous = m_compressionTolerance.exchange(tolerance);
+    // 时间段由持有连接的线程记录；库尚未打开时由 finishOpen 补记
+    if (tolerance != previous && m_database.isOpen() && QThread::currentThread() == thread()) {
+        updateCompressionSpan(tolerance);
     }
-
-    while (query.next()) {
-        records.append(DistanceRecord(query.value(0).toInt(), query.value(1).toDateTime(), query.value(2).toDouble()));
-    }
-    return records;
 }
 
-QVector<DistanceRecord> DataManager::queryRecent(int count)
+void DataManager::updateCompressionSpan(qint32 tolerance)
 {
-    QVector<DistanceRecord> records;
+    qint64 nowMs = toStorageMs(QDateTime::currentDateTime());
+    qint64 samples = m_compressionSamples.load(std::memory_order_relaxed);
+    qint64 inputUs = m_compressionInputUs.load(std::memory_order_relaxed);
     QSqlQuery query(m_database);
-    query.prepare("SELECT id, timestamp, distance FROM distance_records ORDER BY timestamp DESC LIMIT ?");
-    query.addBindValue(count);
 
-    if (query.exec()) {
-        while (query.next()) {
-            records.append(DistanceRecord(query.value(0).toInt(), query.value(1).toDateTime(), query.value(2).toDouble()));
+    if (m_compressionSpanId >= 0) {
+        qint64 spanSamples = samples - m_spanSamples;
+        query.prepare("UPDATE compression_spans SET end_ms = ?, sample_interval_us = ? WHERE id = ?");
+        query.addBindValue(nowMs);
+        query.addBindValue(spanSamples > 0 ? QVariant(double(inputUs - m_spanInputUs) / spanSamples) : QVariant());
+        query.addBindValue(m_compressionSpanId);
+        if (!query.exec()) {
+            emit errorOccurred(QString("Compression span update failed: %1").arg(query.lastError().text()));
         }
+        m_compressionSpanId = -1;
     }
-    return records;
-}
 
-bool DataManager::deleteRecord(int id)
-{
-    QSqlQuery query(m_database);
-    query.prepare("DELETE FROM distance_records WHERE id = ?");
-    query.addBindValue(id);
-    return query.exec();
+    if (tolerance > 0) {
+        query.prepare("INSERT INTO compression_spans (start_ms, tolerance) VALUES (?, ?)");
+        query.addBindValue(nowMs);
+        query.addBindValue(tolerance);
+        if (!query.exec()) {
+            emit errorOccurred(QString("Compression span update failed: %1").arg(query.lastError().text()));
+            return;
+        }
+        m_compressionSpanId = query.lastInsertId().toLongLong();
+        m_spanSamples = samples;
+        m_spanInputUs = inputUs;
+    }
 }
 
-bool DataManager::clearAll()
+bool DataManager::queryCompressionSpans(qint64 startMs, qint64 endMs, QVector<CompressionSpan> &spans)
 {
+    spans.clear();
+    // 只读打开的旧库没有该表
+    if (!m_database.tables().contains("compression_spans")) {
+        return true;
+    }
+
     QSqlQuery query(m_database);
-    if (!query.exec("DELETE FROM distance_records")) {
+    query.setForwardOnly(true);
+    query.prepare("SELECT start_ms, end_ms, tolerance, sample_interval_us FROM compression_spans "
+                  "WHERE start_ms < ? AND (end_ms IS NULL OR end_ms > ?) ORDER BY start_ms");
+    query.addBindValue(endMs);
+    query.addBindValue(startMs);
+    if (!query.exec()) {
+        emit errorOccurred(QString("Compression span query failed: %1").arg(query.lastError().text()));
         return false;
     }
-    query.exec("DELETE FROM sqlite_sequence WHERE name='distance_records'");
+    while (query.next()) {
+        CompressionSpan span;
+        span.startMs = query.value(0).toLongLong();
+        span.endMs = query.value(1).isNull() ? -1 : query.value(1).toLongLong();
+        span.tolerance = query.value(2).toInt();
+        span.sampleIntervalUs = query.value(3).toDouble();
+        spans.append(span);
+    }
     return true;
 }
 
-bool DataManager::exportToCSV(const QString &filePath)
+QString DataManager::compressionNote(qint64 startMs, qint64 endMs)
 {
-    QFile file(filePath);
-    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
-        return false;
+    QVector<CompressionSpan> spans;
+    if (!queryCompressionSpans(startMs, endMs, spans) || spans.isEmpty()) {
+        return QString();
+    }
+    qint32 tolerance = 0;
+    for (const CompressionSpan &span : spans) {
+        tolerance = qMax(tolerance, span.tolerance);
     }
+    const char *format = "yyyy-MM-dd hh:mm:ss";
+    qint64 lastEndMs = spans.last().endMs;
+    return QString("Compressed at ingest from %1 to %2 (swinging door, tolerance up to %3 cm): "
+                   "rows there are stored points at irregular times, reconstruct by linear interpolation "
+                   "between rows at most %4 s apart")
+        .arg(fromStorageMs(spans.first().startMs).toString(format),
+             lastEndMs < 0 ? QString("now") : fromStorageMs(lastEndMs).toString(format),
+             SampleFixed::toString(tolerance))
+        .arg(SampleCompressor::kMaxIntervalUs / 1000000);
+}
 
-    QTextStream out(&file);
+double DataManager::compressionTolerance() const
+{
+    return SampleFixed::toDouble(m_compressionTolerance.load());
+}
+
+bool DataManager::flushCompression()
+{
+    // 之后的样本不与之前的保存点连线，停止保存期间不会被插值
+    SampleBlock stored;
+    m_compressor.flush(stored);
+    m_compressor.reset();
+    m_compressionStored.fetch_add(stored.size(), std::memory_order_relaxed);
+    return writeSamples(stored);
+}
+
+void DataManager::compressionCounts(qint64 &samples, qint64 &stored) const
+{
+    samples = m_compressionSamples.load(std::memory_order_relaxed);
+    stored = m_compressionStored.load(std::memory_order_relaxed);
+}
+
+bool DataManager::writeSamples(const SampleBlock &block)
+{
+    if (block.isEmpty()) {
+        return true;
+    }
+
+    // 整块一次加锁写入暂存文件
+    if (m_spool) {
+        int appended = m_spool->append(block);
+        if (appended > 0) {
+            m_replayer->notifyAppended();
+        }
+        if (appended < block.size()) {
+            emit errorOccurred(QString("Spool full, %1 sample(s) dropped").arg(block.size() - appended));
+            return false;
+        }
+        return true;
+    }
+
+    QVector<SpoolRecord> records(block.size());
+    for (int i = 0; i < block.size(); ++i) {
+        records[i] = SpoolRecord{block.timestampsUs[i], block.values[i]};
+    }
+    DataManager *writer = directWriter();
+    return writer && writer->insertRecords(records);
+}
+
+DataManager *DataManager::directWriter()
+{
+    if (QThread::currentThread() == thread()) {
+        return this;
+    }
+
+    // 没有暂存文件时存储线程直接入库，连接不能跨线程使用：在调用线程上建立独立连接，
+    // 随该线程结束释放。后台打开完成前不建立，避免与迁移、汇总补建竞争
+    if (!m_directWriter) {
+        if (m_isOpening.load()) {
+            emit errorOccurred("Database not ready, samples dropped");
+            return nullptr;
+        }
+        DataManager *writer = new DataManager();
+        connect(writer, &DataManager::errorOccurred, this, &DataManager::errorOccurred);
+        if (!writer->initialize(m_databasePath, "direct_writer")) {
+            delete writer;
+            return nullptr;
+        }
+        connect(writer, &DataManager::dataAdded, this, &DataManager::dataAdded);
+        connect(writer, &DataManager::recordsChanged, this, &DataManager::recordsChanged);
+        connect(QThread::currentThread(), &QThread::finished, writer, &QObject::deleteLater);
+        m_directWriter = writer;
+    }
+    return m_directWriter;
+}
+
+bool DataManager::insertRecords(const QVector<SpoolRecord> &records, quint64 spoolId, quint64 endSequence)
+{
+    if (!m_database.transaction()) {
+        emit errorOccurred(QString("Transaction start failed: %1").arg(m_database.lastError().text()));
+        return false;
+    }
+
+    QVector<DistanceRecord> inserted;
+    inserted.reserve(records.size());
+
+    QSqlQuery query(m_database);
+    query.prepare("INSERT INTO distance_records (timestamp, distance) VALUES (?, ?)");
+    for (const SpoolRecord &record : records) {
+        QDateTime timestamp = QDateTime::fromMSecsSinceEpoch(record.timestampUs / 1000);
+        double distance = SampleFixed::toDouble(record.value);
+        query.bindValue(0, timestamp);
+        query.bindValue(1, distance);
+        if (!query.exec()) {
+            emit errorOccurred(QString("Data save failed: %1").arg(query.lastError().text()));
+            m_database.rollback();
+            return false;
+        }
+        inserted.append(DistanceRecord(query.lastInsertId().toInt(), timestamp, distance));
+    }
+
+    if (spoolId != 0) {
+        query.prepare("INSERT INTO spool_replay (spool_id, sequence) VALUES (?, ?) "
+                      "ON CONFLICT(spool_id) DO UPDATE SET sequence = excluded.sequence");
+        query.addBindValue(static_cast<qint64>(spoolId));
+        query.addBindValue(static_cast<qint64>(endSequence));
+        if (!query.exec()) {
+            emit errorOccurred(QString("Spool watermark update failed: %1").arg(query.lastError().text()));
+            m_database.rollback();
+            return false;
+        }
+    }
+
+    if (!m_database.commit()) {
+        emit errorOccurred(QString("Commit failed: %1").arg(m_database.lastError().text()));
+        m_database.rollback();
+        return false;
+    }
+
+    emit dataAdded(inserted);
+    emit recordsChanged();
+    return true;
+}
+
+bool DataManager::querySpoolWatermark(quint64 spoolId, quint64 &sequence)
+{
+    QSqlQuery query(m_database);
+    query.prepare("SELECT sequence FROM spool_replay WHERE spool_id = ?");
+    query.addBindValue(static_cast<qint64>(spoolId));
+    if (!query.exec()) {
+        emit errorOccurred(QString("Spool watermark query failed: %1").arg(query.lastError().text()));
+        return false;
+    }
+    sequence = query.next() ? static_cast<quint64>(query.value(0).toLongLong()) : 0;
+    return true;
+}
+
+bool DataManager::beginBulkImport()
+{
+    if (!m_database.transaction()) {
+        emit errorOccurred(QString("Transaction start failed: %1").arg(m_database.lastError().text()));
+        return false;
+    }
+
+    // 自增 id 不复用，之后插入的行 id 都大于当前最大值
+    QSqlQuery query(m_database);
+    if (!query.exec("SELECT COALESCE(MAX(id), 0) FROM distance_records") || !query.next()
+        || !query.exec("DROP TRIGGER IF EXISTS trg_history_rollup")) {
+        emit errorOccurred(QString("Bulk import start failed: %1").arg(query.lastError().text()));
+        m_database.rollback();
+        return false;
+    }
+    m_bulkFirstId = query.value(0).toLongLong();
+    return true;
+}
+
+bool DataManager::bulkInsert(const char *timestamps, const double *distances, int count)
+{
+    // 多行 VALUES 减少每行的语句执行开销；256 行 512 个参数，低于旧版 SQLite 的 999 上限
+    static const int kRowsPerStatement = 256;
+
+    QString sql = "INSERT INTO distance_records (timestamp, distance) VALUES (?, ?)";
+    QSqlQuery single(m_database);
+    single.prepare(sql);
+
+    QSqlQuery multi(m_database);
+    if (count >= kRowsPerStatement) {
+        sql.reserve(sql.size() + 8 * kRowsPerStatement);
+        for (int i = 1; i < kRowsPerStatement; ++i) {
+            sql += ", (?, ?)";
+        }
+        multi.prepare(sql);
+    }
+
+    int i = 0;
+    for (; i + kRowsPerStatement <= count; i += kRowsPerStatement) {
+        for (int k = 0; k < kRowsPerStatement; ++k) {
+            multi.bindValue(2 * k, QString::fromLatin1(timestamps + qint64(i + k) * kTimestampTextLength, kTimestampTextLength));
+            multi.bindValue(2 * k + 1, distances[i + k]);
+        }
+        if (!multi.exec()) {
+            emit errorOccurred(QString("Bulk insert failed: %1").arg(multi.lastError().text()));
+            return false;
+        }
+    }
+    for (; i < count; ++i) {
+        single.bindValue(0, QString::fromLatin1(timestamps + qint64(i) * kTimestampTextLength, kTimestampTextLength));
+        single.bindValue(1, distances[i]);
+        if (!single.exec()) {
+            emit errorOccurred(QString("Bulk insert failed: %1").arg(single.lastError().text()));
+            return false;
+        }
+    }
+    return true;
+}
+
+bool DataManager::commitBulkImport()
+{
+    // 按桶聚合本批新行后合并进汇总表，再恢复触发器
+    QString mergeSQL = R"(
+        INSERT INTO history_rollup (level, bucket_start, min_distance, max_distance, count,
+                                    sum_distance, sumsq_distance)
+        SELECT l.level, (r.ms / l.width) * l.width AS b, MIN(r.distance), MAX(r.distance), COUNT(*),
+               SUM(r.distance), SUM(r.distance * r.distance)
+        FROM (SELECT )" STORAGE_MS_SQL("timestamp") R"( AS ms, distance FROM distance_records WHERE id > ?) r,
+             rollup_levels l
+        WHERE 1
+        GROUP BY l.level, b
+        ON CONFLICT(level, bucket_start) DO UPDATE SET
+            min_distance = MIN(min_distance, excluded.min_distance),
+            max_distance = MAX(max_distance, excluded.max_distance),
+            count = count + excluded.count,
+            sum_distance = sum_distance + excluded.sum_distance,
+            sumsq_distance = sumsq_distance + excluded.sumsq_distance
+    )";
+
+    QSqlQuery query(m_database);
+    query.prepare(mergeSQL);
+    query.addBindValue(m_bulkFirstId);
+    if (!query.exec() || !query.exec(rollupTriggerSql())) {
+        emit errorOccurred(QString("Bulk import rollup merge failed: %1").arg(query.lastError().text()));
+        rollbackBulkImport();
+        return false;
+    }
+
+    if (!m_database.commit()) {
+        emit errorOccurred(QString("Commit failed: %1").arg(m_database.lastError().text()));
+        rollbackBulkImport();
+        return false;
+    }
+    m_bulkFirstId = -1;
+    return true;
+}
+
+void DataManager::rollbackBulkImport()
+{
+    // 触发器删除在同一事务内，回滚后自动恢复
+    m_database.rollback();
+    m_bulkFirstId = -1;
+}
+
+bool DataManager::isFileImported(const QString &fingerprint, QString &description, int &committedChunks,
+                                 qint64 &committedRows)
+{
+    committedChunks = 0;
+    committedRows = 0;
+    QSqlQuery query(m_database);
+    query.prepare("SELECT path, rows, imported_ms, chunks FROM imported_files WHERE fingerprint = ?");
+    query.addBindValue(fingerprint);
+    if (!query.exec()) {
+        emit errorOccurred(QString("Import history query failed: %1").arg(query.lastError().text()));
+        return false;
+    }
+    if (!query.next()) {
+        return false;
+    }
+    description = QString("%1 on %2 (%3 rows)")
+        .arg(query.value(0).toString(),
+             fromStorageMs(query.value(2).toLongLong()).toString("yyyy-MM-dd hh:mm:ss"))
+        .arg(query.value(1).toLongLong());
+    if (!query.value(3).isNull()) {
+        committedChunks = query.value(3).toInt();
+        committedRows = query.value(1).toLongLong();
+        return false;
+    }
+    return true;
+}
+
+bool DataManager::recordImportedFile(const QString &fingerprint, const QString &path, qint64 rows, int committedChunks)
+{
+    QSqlQuery query(m_database);
+    query.prepare("INSERT OR REPLACE INTO imported_files (fingerprint, path, rows, imported_ms, chunks) "
+                  "VALUES (?, ?, ?, ?, ?)");
+    query.addBindValue(fingerprint);
+    query.addBindValue(path);
+    query.addBindValue(rows);
+    query.addBindValue(toStorageMs(QDateTime::currentDateTime()));
+    query.addBindValue(committedChunks < 0 ? QVariant() : QVariant(committedChunks));
+    if (!query.exec()) {
+        emit errorOccurred(QString("Import history update failed: %1").arg(query.lastError().text()));
+        return false;
+    }
+    return true;
+}
+
+bool DataManager::saveEvent(const DetectionEvent &event)
+{
+    QSqlQuery query(m_database);
+    query.prepare("INSERT INTO detection_events (timestamp, timestamp_us, rule_id, rule_name, event_type, value) "
+                  "VALUES (?, ?, ?, ?, ?, ?)");
+    query.addBindValue(QDateTime::fromMSecsSinceEpoch(event.timestampUs / 1000));
+    query.addBindValue(event.timestampUs);
+    query.addBindValue(event.ruleId);
+    query.addBindValue(event.ruleName);
+    query.addBindValue(DetectionEvent::typeName(event.type));
+    query.addBindValue(event.value);
+
+    if (!query.exec()) {
+        QString error = QString("Event save failed: %1").arg(query.lastError().text());
+        emit errorOccurred(error);
+        qDebug() << error;
+        return false;
+    }
+    return true;
+}
+
+bool DataManager::saveGap(qint64 startUs, qint64 endUs, const QString &reason)
+{
+    QSqlQuery query(m_database);
+    query.prepare("INSERT INTO acquisition_gaps (start_time, end_time, start_us, end_us, reason) VALUES (?, ?, ?, ?, ?)");
+    query.addBindValue(QDateTime::fromMSecsSinceEpoch(startUs / 1000));
+    query.addBindValue(QDateTime::fromMSecsSinceEpoch(endUs / 1000));
+    query.addBindValue(startUs);
+    query.addBindValue(endUs);
+    query.addBindValue(reason);
+
+    if (!query.exec()) {
+        QString error = QString("Gap save failed: %1").arg(query.lastError().text());
+        emit errorOccurred(error);
+        qDebug() << error;
+        return false;
+    }
+    return true;
+}
+
+QDateTime RecordSet::timestampAt(int index) const
+{
+    return DataManager::fromStorageMs(m_timestampsMs[index]);
+}
+
+DistanceRecord RecordSet::at(int index) const
+{
+    return DistanceRecord(static_cast<int>(m_ids[index]), timestampAt(index), m_distances[index]);
+}
+
+// 时间在 SQL 中换算为整数毫秒，逐行只取三个数值列，不经过 QDateTime 解析
+bool DataManager::fillRecordSet(QSqlQuery &query, RecordSet &records)
+{
+    if (!query.exec()) {
+        return false;
+    }
+    while (query.next()) {
+        records.m_ids.append(query.value(0).toLongLong());
+        records.m_timestampsMs.append(query.value(1).toLongLong());
+        records.m_distances.append(query.value(2).toDouble());
+    }
+    return true;
+}
+
+RecordSet DataManager::queryAll()
+{
+    RecordSet records;
+    QSqlQuery query(m_database);
+    query.setForwardOnly(true);
+    query.prepare("SELECT id, " STORAGE_MS_SQL("timestamp") ", distance FROM distance_records ORDER BY timestamp DESC");
+
+    QSqlQuery count(m_database);
+    if (count.exec("SELECT COUNT(*) FROM distance_records") && count.next()) {
+        int rows = count.value(0).toInt();
+        records.m_ids.reserve(rows);
+        records.m_timestampsMs.reserve(rows);
+        records.m_distances.reserve(rows);
+    }
+
+    if (!fillRecordSet(query, records)) {
+        emit errorOccurred(QString("Query failed: %1").arg(query.lastError().text()));
+    }
+    return records;
+}
+
+RecordSet DataManager::queryByDateRange(const QDateTime &start, const QDateTime &end)
+{
+    RecordSet records;
+    QSqlQuery query(m_database);
+    query.setForwardOnly(true);
+    query.prepare("SELECT id, " STORAGE_MS_SQL("timestamp") ", distance FROM distance_records "
+                  "WHERE timestamp BETWEEN ? AND ? ORDER BY timestamp DESC");
+    query.addBindValue(start);
+    query.addBindValue(end);
+
+    if (!fillRecordSet(query, records)) {
+        emit errorOccurred(QString("Range query failed: %1").arg(query.lastError().text()));
+    }
+    return records;
+}
+
+RecordSet DataManager::queryRecent(int count)
+{
+    RecordSet records;
+    QSqlQuery query(m_database);
+    query.setForwardOnly(true);
+    query.prepare("SELECT id, " STORAGE_MS_SQL("timestamp") ", distance FROM distance_records "
+                  "ORDER BY timestamp DESC LIMIT ?");
+    query.addBindValue(count);
+    fillRecordSet(query, records);
+    return records;
+}
+
+bool DataManager::queryRange(qint64 startMs, qint64 endMs, RecordSet &records)
+{
+    QSqlQuery query(m_database);
+    query.setForwardOnly(true);
+    query.prepare("SELECT id, " STORAGE_MS_SQL("timestamp") ", distance FROM distance_records "
+                  "WHERE timestamp >= ? AND timestamp < ? ORDER BY timestamp");
+    query.addBindValue(storageString(startMs));
+    query.addBindValue(storageString(endMs));
+
+    if (!fillRecordSet(query, records)) {
+        emit errorOccurred(QString("Range query failed: %1").arg(query.lastError().text()));
+        return false;
+    }
+    return true;
+}
+
+QVector<HistoryBucket> DataManager::queryDownsampled(qint64 startMs, qint64 endMs, qint64 bucketMs)
+{
+    QVector<HistoryBucket> buckets;
+    if (bucketMs <= 0 || endMs <= startMs) {
+        return buckets;
+    }
+
+    // 选择桶宽不超过请求桶宽的最粗汇总层，否则回退到原始数据
+    int level = -1;
+    for (const auto &l : kRollupLevels) {
+        if (l.widthMs <= bucketMs && bucketMs % l.widthMs == 0) {
+            level = l.level;
+        }
+    }
+
+    QSqlQuery query(m_database);
+    query.setForwardOnly(true);
+    if (level >= 0) {
+        query.prepare("SELECT bucket_start / ? AS b, MIN(min_distance), MAX(max_distance) FROM history_rollup "
+                      "WHERE level = ? AND bucket_start >= ? AND bucket_start < ? GROUP BY b ORDER BY b");
+        query.addBindValue(bucketMs);
+        query.addBindValue(level);
+        query.addBindValue(startMs);
+        query.addBindValue(endMs);
+    } else {
+        query.prepare("SELECT " STORAGE_MS_SQL("timestamp") " / ? AS b, MIN(distance), MAX(distance) "
+                      "FROM distance_records WHERE timestamp >= ? AND timestamp < ? GROUP BY b ORDER BY b");
+        query.addBindValue(bucketMs);
+        query.addBindValue(storageString(startMs));
+        query.addBindValue(storageString(endMs));
+    }
+
+    if (!query.exec()) {
+        emit errorOccurred(QString("Downsample query failed: %1").arg(query.lastError().text()));
+        return buckets;
+    }
+
+    while (query.next()) {
+        HistoryBucket bucket;
+        bucket.startMs = query.value(0).toLongLong() * bucketMs;
+        bucket.minDistance = query.value(1).toFloat();
+        bucket.maxDistance = query.value(2).toFloat();
+        buckets.append(bucket);
+    }
+    return buckets;
+}
+
+bool DataManager::queryTimeBounds(qint64 &firstMs, qint64 &lastMs)
+{
+    QSqlQuery query(m_database);
+    if (!query.exec("SELECT MIN(timestamp), MAX(timestamp) FROM distance_records") || !query.next()
+        || query.value(0).isNull()) {
+        return false;
+    }
+    firstMs = toStorageMs(query.value(0).toDateTime());
+    lastMs = toStorageMs(query.value(1).toDateTime());
+    return true;
+}
+
+DataManager::SeriesCursor DataManager::seriesCursorAt(qint64 startMs)
+{
+    // id 均不小于 0，(起始时间, -1) 之后即起始时间及以后的全部记录
+    return SeriesCursor{storageString(startMs), -1};
+}
+
+int DataManager::scanSeries(SeriesCursor &cursor, qint64 endMs, int limit,
+                            QVector<qint64> &timesMs, QVector<float> &values)
+{
+    // 按 (timestamp, id) 键集分页，走时间索引（索引隐含 rowid）；结果追加到调用方缓冲区
+    QSqlQuery query(m_database);
+    query.setForwardOnly(true);
+    query.prepare("SELECT id, timestamp, " STORAGE_MS_SQL("timestamp") ", distance FROM distance_records "
+                  "WHERE (timestamp, id) > (?, ?) AND timestamp < ? ORDER BY timestamp, id LIMIT ?");
+    query.addBindValue(cursor.timestamp);
+    query.addBindValue(cursor.id);
+    query.addBindValue(storageString(endMs));
+    query.addBindValue(limit);
+    if (!query.exec()) {
+        emit errorOccurred(QString("Series scan failed: %1").arg(query.lastError().text()));
+        return -1;
+    }
+
+    int count = 0;
+    while (query.next()) {
+        cursor.id = query.value(0).toLongLong();
+        cursor.timestamp = query.value(1).toString();
+        timesMs.append(query.value(2).toLongLong());
+        values.append(query.value(3).toFloat());
+        ++count;
+    }
+    return count;
+}
+
+bool DataManager::ensureRollups()
+{
+    if (m_rollupsReady) {
+        return true;
+    }
+    QSqlQuery query(m_database);
+    if (metaValue(query, "rollup_backfilled", 0) == 1) {
+        m_rollupsReady = true;
+        return true;
+    }
+
+    // 旧库或迁移后的库：全量重建汇总并安装触发器，同一写事务内完成并记下标记。
+    // 期间其他连接的插入等待写锁，提交后的插入由触发器计入，不会漏计也不会重复
+    QString backfillSQL = R"(
+        INSERT INTO history_rollup (level, bucket_start, min_distance, max_distance, count,
+                                    sum_distance, sumsq_distance)
+        SELECT l.level, (r.ms / l.width) * l.width AS b, MIN(r.distance), MAX(r.distance), COUNT(*),
+               SUM(r.distance), SUM(r.distance * r.distance)
+        FROM (SELECT )" STORAGE_MS_SQL("timestamp") R"( AS ms, distance FROM distance_records) r, rollup_levels l
+        GROUP BY l.level, b
+    )";
+
+    if (!query.exec("BEGIN IMMEDIATE")) {
+        emit errorOccurred(QString("Rollup rebuild failed: %1").arg(query.lastError().text()));
+        return false;
+    }
+    bool ok = metaValue(query, "rollup_backfilled", 0) == 1
+        || (query.exec("DELETE FROM history_rollup")
+            && query.exec(backfillSQL)
+            && query.exec(rollupTriggerSql())
+            && setMetaValue(query, "rollup_backfilled", 1));
+    if (!ok || !query.exec("COMMIT")) {
+        emit errorOccurred(QString("Rollup rebuild failed: %1").arg(query.lastError().text()));
+        query.exec("ROLLBACK");
+        return false;
+    }
+    m_rollupsReady = true;
+    return true;
+}
+
+void RangeStatistics::merge(qint64 otherCount, double otherSum, double otherSumSq, double otherMin, double otherMax)
+{
+    if (otherCount <= 0) {
+        return;
+    }
+    min = count > 0 ? qMin(min, otherMin) : otherMin;
+    max = count > 0 ? qMax(max, otherMax) : otherMax;
+    count += otherCount;
+    represented += otherCount;
+    sum += otherSum;
+    sumSq += otherSumSq;
+}
+
+double RangeStatistics::standardDeviation() const
+{
+    if (count <= 0) {
+        return 0.0;
+    }
+    double m = mean();
+    return std::sqrt(qMax(0.0, sumSq / count - m * m));
+}
+
+bool DataManager::queryStatistics(qint64 startMs, qint64 endMs, RangeStatistics &stats)
+{
+    stats = RangeStatistics();
+    if (endMs <= startMs) {
+        return true;
+    }
+    if (!ensureRollups()) {
+        return false;
+    }
+
+    // 压缩时间段内的记录不等间隔，逐条扫描以折合代表的样本数；其余部分照常取汇总
+    QVector<CompressionSpan> spans;
+    if (!queryCompressionSpans(startMs, endMs, spans)) {
+        return false;
+    }
+    qint64 position = startMs;
+    for (const CompressionSpan &span : spans) {
+        qint64 spanStart = qMax(position, span.startMs);
+        qint64 spanEnd = span.endMs < 0 ? endMs : qMin(endMs, span.endMs);
+        if (spanStart >= spanEnd) {
+            continue;
+        }
+        if (!accumulateRange(kRollupLevelCount - 1, position, spanStart, stats)
+            || !accumulateCompressed(span, spanStart, spanEnd, stats)) {
+            return false;
+        }
+        position = spanEnd;
+    }
+    return accumulateRange(kRollupLevelCount - 1, position, endMs, stats);
+}
+
+bool DataManager::accumulateCompressed(const CompressionSpan &span, qint64 startMs, qint64 endMs,
+                                       RangeStatistics &stats)
+{
+    // 计数/均值/最值按保存的记录计算；代表的样本数：相邻保存点之间（间隔超过心跳视为中断，
+    // 与 SampleCompressor::interpolate 相同）的时长按名义采样间隔折合，
+    // 不与任何相邻点连线的孤立点各算一个样本；间隔未知时按保存点数计
+    QSqlQuery query(m_database);
+    query.setForwardOnly(true);
+    query.prepare("SELECT " STORAGE_MS_SQL("timestamp") ", distance FROM distance_records "
+                  "WHERE timestamp >= ? AND timestamp < ? ORDER BY timestamp, id");
+    query.addBindValue(storageString(startMs));
+    query.addBindValue(storageString(endMs));
+    if (!query.exec()) {
+        emit errorOccurred(QString("Statistics query failed: %1").arg(query.lastError().text()));
+        return false;
+    }
+
+    const qint64 maxGapMs = SampleCompressor::kMaxIntervalUs / 1000;
+    qint64 rows = 0;
+    qint64 isolated = 0;
+    double durationMs = 0.0;
+    double sum = 0.0;
+    double sumSq = 0.0;
+    double minValue = 0.0;
+    double maxValue = 0.0;
+    qint64 previousMs = 0;
+    bool previousJoined = false;
+    while (query.next()) {
+        qint64 ms = query.value(0).toLongLong();
+        double value = query.value(1).toDouble();
+        minValue = rows == 0 ? value : qMin(minValue, value);
+        maxValue = rows == 0 ? value : qMax(maxValue, value);
+        sum += value;
+        sumSq += value * value;
+
+        bool joined = rows > 0 && ms - previousMs <= maxGapMs;
+        if (joined) {
+            durationMs += double(ms - previousMs);
+        } else if (rows > 0 && !previousJoined) {
+            ++isolated;
+        }
+        previousJoined = joined;
+        previousMs = ms;
+        ++rows;
+    }
+    if (rows > 0 && !previousJoined) {
+        ++isolated;
+    }
+    if (rows == 0) {
+        return true;
+    }
+
+    stats.merge(rows, sum, sumSq, minValue, maxValue);
+    if (durationMs > 0.0 && span.sampleIntervalUs > 0.0) {
+        qint64 samples = std::llround(durationMs * 1000.0 / span.sampleIntervalUs) + isolated;
+        stats.represented += qMax(rows, samples) - rows;
+    }
+    return true;
+}
+
+bool DataManager::accumulateRange(int levelIndex, qint64 startMs, qint64 endMs, RangeStatistics &stats)
+{
+    if (startMs >= endMs) {
+        return true;
+    }
+
+    QSqlQuery query(m_database);
+    query.setForwardOnly(true);
+
+    // 比最细汇总层还短的两端：扫描原始记录（走时间戳索引）
+    if (levelIndex < 0) {
+        query.prepare("SELECT COUNT(*), SUM(distance), SUM(distance * distance), MIN(distance), MAX(distance) "
+                      "FROM distance_records WHERE timestamp >= ? AND timestamp < ?");
+        query.addBindValue(storageString(startMs));
+        query.addBindValue(storageString(endMs));
+    } else {
+        // 区间内完整的桶取汇总，两端余下部分交给更细一层
+        qint64 width = kRollupLevels[levelIndex].widthMs;
+        qint64 first = (startMs + width - 1) / width * width;
+        qint64 last = endMs / width * width;
+        if (first >= last) {
+            return accumulateRange(levelIndex - 1, startMs, endMs, stats);
+        }
+        if (!accumulateRange(levelIndex - 1, startMs, first, stats)
+            || !accumulateRange(levelIndex - 1, last, endMs, stats)) {
+            return false;
+        }
+        query.prepare("SELECT SUM(count), SUM(sum_distance), SUM(sumsq_distance), MIN(min_distance), MAX(max_distance) "
+                      "FROM history_rollup WHERE level = ? AND bucket_start >= ? AND bucket_start < ?");
+        query.addBindValue(kRollupLevels[levelIndex].level);
+        query.addBindValue(first);
+        query.addBindValue(last);
+    }
+
+    if (!query.exec() || !query.next()) {
+        emit errorOccurred(QString("Statistics query failed: %1").arg(query.lastError().text()));
+        return false;
+    }
+    stats.merge(query.value(0).toLongLong(), query.value(1).toDouble(), query.value(2).toDouble(),
+                query.value(3).toDouble(), query.value(4).toDouble());
+    return true;
+}
+
+bool DataManager::rebuildRollupsAt(const QDateTime &timestamp)
+{
+    qint64 ms = toStorageMs(timestamp);
+    QSqlQuery query(m_database);
+
+    for (const auto &l : kRollupLevels) {
+        qint64 bucketStart = (ms / l.widthMs) * l.widthMs;
+
+        query.prepare("DELETE FROM history_rollup WHERE level = ? AND bucket_start = ?");
+        query.addBindValue(l.level);
+        query.addBindValue(bucketStart);
+        if (!query.exec()) {
+            return false;
+        }
+
+        query.prepare("INSERT INTO history_rollup (level, bucket_start, min_distance, max_distance, count, "
+                      "sum_distance, sumsq_distance) "
+                      "SELECT ?, ?, mn, mx, c, s, sq FROM (SELECT MIN(distance) AS mn, MAX(distance) AS mx, "
+                      "COUNT(*) AS c, SUM(distance) AS s, SUM(distance * distance) AS sq "
+                      "FROM distance_records WHERE timestamp >= ? AND timestamp < ?) WHERE c > 0");
+        query.addBindValue(l.level);
+        query.addBindValue(bucketStart);
+        query.addBindValue(storageString(bucketStart));
+        query.addBindValue(storageString(bucketStart + l.widthMs));
+        if (!query.exec()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool DataManager::rebuildRollupsRange(qint64 startMs, qint64 endMs)
+{
+    // 最细一层从原始记录重建，更粗的层由上一层的块合并，代价与区间内的记录数成正比
+    QSqlQuery query(m_database);
+    for (int i = 0; i < kRollupLevelCount; ++i) {
+        qint64 width = kRollupLevels[i].widthMs;
+        qint64 first = (startMs / width) * width;
+        qint64 last = (endMs + width - 1) / width * width;
+
+        query.prepare("DELETE FROM history_rollup WHERE level = ? AND bucket_start >= ? AND bucket_start < ?");
+        query.addBindValue(kRollupLevels[i].level);
+        query.addBindValue(first);
+        query.addBindValue(last);
+        if (!query.exec()) {
+            return false;
+        }
+
+        if (i == 0) {
+            query.prepare("INSERT INTO history_rollup (level, bucket_start, min_distance, max_distance, count, "
+                          "sum_distance, sumsq_distance) "
+                          "SELECT ?, (ms / ?) * ? AS b, MIN(distance), MAX(distance), COUNT(*), SUM(distance), "
+                          "SUM(distance * distance) FROM (SELECT " STORAGE_MS_SQL("timestamp") " AS ms, distance "
+                          "FROM distance_records WHERE timestamp >= ? AND timestamp < ?) GROUP BY b");
+            query.addBindValue(kRollupLevels[i].level);
+            query.addBindValue(width);
+            query.addBindValue(width);
+            query.addBindValue(storageString(first));
+            query.addBindValue(storageString(last));
+        } else {
+            query.prepare("INSERT INTO history_rollup (level, bucket_start, min_distance, max_distance, count, "
+                          "sum_distance, sumsq_distance) "
+                          "SELECT ?, (bucket_start / ?) * ? AS b, MIN(min_distance), MAX(max_distance), SUM(count), "
+                          "SUM(sum_distance), SUM(sumsq_distance) FROM history_rollup "
+                          "WHERE level = ? AND bucket_start >= ? AND bucket_start < ? GROUP BY b");
+            query.addBindValue(kRollupLevels[i].level);
+            query.addBindValue(width);
+            query.addBindValue(width);
+            query.addBindValue(kRollupLevels[i - 1].level);
+            query.addBindValue(first);
+            query.addBindValue(last);
+        }
+        if (!query.exec()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+qint64 DataManager::toStorageMs(const QDateTime &dateTime)
+{
+    return QDateTime(dateTime.date(), dateTime.time(), Qt::UTC).toMSecsSinceEpoch();
+}
+
+QDateTime DataManager::fromStorageMs(qint64 ms)
+{
+    QDateTime utc = QDateTime::fromMSecsSinceEpoch(ms, Qt::UTC);
+    return QDateTime(utc.date(), utc.time());
+}
+
+bool DataManager::deleteRecord(int id)
+{
+    QSqlQuery query(m_database);
+    query.prepare("SELECT timestamp FROM distance_records WHERE id = ?");
+    query.addBindValue(id);
+    if (!query.exec() || !query.next()) {
+        return false;
+    }
+    QDateTime timestamp = query.value(0).toDateTime();
+
+    query.prepare("DELETE FROM distance_records WHERE id = ?");
+    query.addBindValue(id);
+    if (!query.exec()) {
+        return false;
+    }
+    bool ok = rebuildRollupsAt(timestamp);
+    emit recordsChanged();
+    return ok;
+}
+
+bool DataManager::clearAll()
+{
+    // 清空只写一条范围墓碑，不逐行记录；自增序列不再重置，同步水位保持单调
+    if (!m_database.transaction()) {
+        return false;
+    }
+
+    QSqlQuery query(m_database);
+    if (!query.exec("DROP TRIGGER IF EXISTS trg_record_tombstone")
+        || !query.exec("DELETE FROM distance_records")
+        || !query.exec("UPDATE sqlite_sequence SET seq = seq + 1 WHERE name = 'distance_records'")
+        || !query.exec("INSERT INTO record_tombstones (sequence, record_id, scope) "
+                       "SELECT seq, seq - 1, 1 FROM sqlite_sequence WHERE name = 'distance_records'")
+        || !query.exec(tombstoneTriggerSql())
+        || !query.exec("DELETE FROM history_rollup")
+        || !query.exec("DELETE FROM recording_sessions WHERE end_ms IS NOT NULL")
+        || !query.exec("DELETE FROM imported_files")
+        || !query.exec("DELETE FROM compression_spans WHERE end_ms IS NOT NULL")) {
+        emit errorOccurred(QString("Clear failed: %1").arg(query.lastError().text()));
+        m_database.rollback();
+        return false;
+    }
+    if (!m_database.commit()) {
+        return false;
+    }
+    emit recordsChanged();
+    emit sessionsChanged();
+    return true;
+}
+
+bool DataManager::exportToCSV(const QString &filePath)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        return false;
+    }
+
+    QTextStream out(&file);
     out.setEncoding(QStringConverter::Utf8);
+    QString note = compressionNote(0, std::numeric_limits<qint64>::max());
+    if (!note.isEmpty()) {
+        out << "# " << note << "\n";
+    }
     out << "ID,Timestamp,Distance(cm)\n";
 
-    for (const auto &record : queryAll()) {
-        out << record.id << "," << record.timestamp.toString("yyyy-MM-dd hh:mm:ss") << "," << QString::number(record.distance, 'f', 2) << "\n";
+    RecordSet records = queryAll();
+    for (int i = 0; i < records.size(); ++i) {
+        out << records.idAt(i) << "," << records.timestampAt(i).toString("yyyy-MM-dd hh:mm:ss") << ","
+            << QString::number(records.distanceAt(i), 'f', SampleFixed::kFractionDigits) << "\n";
     }
     file.close();
     return true;
@@ -183,17 +1667,464 @@ bool DataManager::exportToTXT(const QString &filePath)
     out << "Ultrasonic Distance Measurement Data Export\n";
     out << "==========================================\n\n";
 
-    QVector<DistanceRecord> records = queryAll();
+    RecordSet records = queryAll();
     out << QString("Total Records: %1\n").arg(records.size());
-    out << QString("Export Time: %1\n\n").arg(QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss"));
+    out << QString("Export Time: %1\n").arg(QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss"));
+    QString note = compressionNote(0, std::numeric_limits<qint64>::max());
+    if (!note.isEmpty()) {
+        out << "Note: " << note << "\n";
+    }
+    out << "\n";
+
+    for (int i = 0; i < records.size(); ++i) {
+        out << QString("[%1] %2 - %3 cm\n").arg(records.idAt(i), 5).arg(records.timestampAt(i).toString("yyyy-MM-dd hh:mm:ss"))
+               .arg(records.distanceAt(i), 6, 'f', SampleFixed::kFractionDigits);
+    }
+    file.close();
+    return true;
+}
+
+qint64 DataManager::currentWatermark()
+{
+    QSqlQuery query(m_database);
+    query.exec("SELECT seq FROM sqlite_sequence WHERE name = 'distance_records'");
+    return query.next() ? query.value(0).toLongLong() : 0;
+}
+
+bool DataManager::readChanges(qint64 sinceWatermark, int maxCount, QVector<RecordChange> &changes, qint64 &watermark)
+{
+    changes.clear();
+    watermark = sinceWatermark;
+
+    // 两个查询在同一读事务内，看到的是同一快照，合并后不会漏掉并发提交的变更
+    if (!m_database.transaction()) {
+        emit errorOccurred(QString("Transaction start failed: %1").arg(m_database.lastError().text()));
+        return false;
+    }
+
+    QSqlQuery inserts(m_database);
+    inserts.setForwardOnly(true);
+    inserts.prepare("SELECT id, " STORAGE_MS_SQL("timestamp") ", distance FROM distance_records "
+                    "WHERE id > ? ORDER BY id LIMIT ?");
+    inserts.addBindValue(sinceWatermark);
+    inserts.addBindValue(maxCount);
+
+    QSqlQuery deletes(m_database);
+    deletes.setForwardOnly(true);
+    deletes.prepare("SELECT sequence, record_id, scope FROM record_tombstones "
+                    "WHERE sequence > ? ORDER BY sequence LIMIT ?");
+    deletes.addBindValue(sinceWatermark);
+    deletes.addBindValue(maxCount);
+
+    if (!inserts.exec() || !deletes.exec()) {
+        emit errorOccurred(QString("Change query failed: %1")
+                           .arg(inserts.lastError().isValid() ? inserts.lastError().text() : deletes.lastError().text()));
+        m_database.rollback();
+        return false;
+    }
+
+    // 两路均按序号递增，归并取前 maxCount 条
+    changes.reserve(maxCount);
+    bool hasInsert = inserts.next();
+    bool hasDelete = deletes.next();
+    while (changes.size() < maxCount && (hasInsert || hasDelete)) {
+        if (hasInsert && (!hasDelete || inserts.value(0).toLongLong() < deletes.value(0).toLongLong())) {
+            qint64 id = inserts.value(0).toLongLong();
+            changes.append(RecordChange{RecordChange::Insert, id, id,
+                                        inserts.value(1).toLongLong(), inserts.value(2).toDouble()});
+            hasInsert = inserts.next();
+        } else {
+            RecordChange::Type type = deletes.value(2).toInt() == 0 ? RecordChange::Delete : RecordChange::Clear;
+            changes.append(RecordChange{type, deletes.value(0).toLongLong(), deletes.value(1).toLongLong(), 0, 0.0});
+            hasDelete = deletes.next();
+        }
+    }
+    inserts.finish();
+    deletes.finish();
+    m_database.commit();
+
+    if (!changes.isEmpty()) {
+        watermark = changes.last().sequence;
+    }
+    return true;
+}
+
+bool DataManager::exportChanges(const QString &filePath, qint64 sinceWatermark, ChangeFormat format, qint64 &watermark)
+{
+    static const int kBatchSize = 8192;
+    static const char *kTypeNames[] = {"insert", "delete", "clear"};
+
+    watermark = sinceWatermark;
+    QFile file(filePath);
+    if (!file.open(format == ChangeCsv ? QIODevice::WriteOnly | QIODevice::Text : QIODevice::WriteOnly)) {
+        QString error = QString("Cannot write %1: %2").arg(filePath, file.errorString());
+        emit errorOccurred(error);
+        qDebug() << error;
+        return false;
+    }
+
+    // 失败时删除不完整的文件并保持原水位，调用方不会把截断的文件当作完整的增量
+    auto fail = [&](const QString &reason) {
+        QString error = QString("Change export to %1 failed: %2").arg(filePath, reason);
+        emit errorOccurred(error);
+        qDebug() << error;
+        file.close();
+        file.remove();
+        watermark = sinceWatermark;
+        return false;
+    };
+
+    QVector<RecordChange> changes;
+    if (format == ChangeCsv) {
+        QTextStream out(&file);
+        out.setEncoding(QStringConverter::Utf8);
+        out << "Sequence,Op,ID,Timestamp,Distance(cm)\n";
+        do {
+            if (!readChanges(watermark, kBatchSize, changes, watermark)) {
+                return fail("change query failed");
+            }
+            for (const RecordChange &change : changes) {
+                out << change.sequence << "," << kTypeNames[change.type] << "," << change.recordId << ",";
+                if (change.type == RecordChange::Insert) {
+                    out << storageString(change.timestampMs) << ","
+                        << QString::number(change.distance, 'f', SampleFixed::kFractionDigits);
+                } else {
+                    out << ",";
+                }
+                out << "\n";
+            }
+            if (out.status() != QTextStream::Ok) {
+                return fail(file.errorString());
+            }
+        } while (changes.size() == kBatchSize);
+        out.flush();
+        if (out.status() != QTextStream::Ok) {
+            return fail(file.errorString());
+        }
+    } else {
+        ChangeFileHeader header = {{'U', 'L', 'C', 'F'}, 1, SampleFixed::kFractionDigits, 0, sinceWatermark, sinceWatermark, 0};
+        if (file.write(reinterpret_cast<const char *>(&header), sizeof(header)) != qint64(sizeof(header))) {
+            return fail(file.errorString());
+        }
+
+        QVector<ChangeFileRecord> records;
+        do {
+            if (!readChanges(watermark, kBatchSize, changes, watermark)) {
+                return fail("change query failed");
+            }
+            records.resize(changes.size());
+            for (int i = 0; i < changes.size(); ++i) {
+                const RecordChange &change = changes[i];
+                records[i] = ChangeFileRecord{change.sequence, change.recordId, change.timestampMs,
+                                              SampleFixed::fromDouble(change.distance), quint32(change.type)};
+            }
+            qint64 bytes = qint64(records.size()) * sizeof(ChangeFileRecord);
+            if (file.write(reinterpret_cast<const char *>(records.constData()), bytes) != bytes) {
+                return fail(file.errorString());
+            }
+            header.count += changes.size();
+        } while (changes.size() == kBatchSize);
+
+        // 写完后补上记录数与新水位
+        header.watermark = watermark;
+        if (!file.seek(0)
+            || file.write(reinterpret_cast<const char *>(&header), sizeof(header)) != qint64(sizeof(header))) {
+            return fail(file.errorString());
+        }
+    }
+
+    if (!file.flush()) {
+        return fail(file.errorString());
+    }
+    file.close();
+    if (file.error() != QFileDevice::NoError) {
+        return fail(file.errorString());
+    }
+    return true;
+}
+
+// 会话目录的列，顺序与 readSession() 一致
+#define SESSION_COLUMNS "id, name, notes, channels, start_ms, end_ms, summarized, " \
+                        "count, sum_distance, sumsq_distance, min_distance, max_distance"
+// 会话记录：时间在会话范围内（走时间索引）
+#define SESSION_RECORDS_WHERE "timestamp >= ? AND timestamp < ?"
+
+static RecordingSession readSession(const QSqlQuery &query)
+{
+    RecordingSession session;
+    session.id = query.value(0).toLongLong();
+    session.name = query.value(1).toString();
+    session.notes = query.value(2).toString();
+    session.channels = query.value(3).toString().split(',', Qt::SkipEmptyParts);
+    session.startMs = query.value(4).toLongLong();
+    session.endMs = query.value(5).isNull() ? -1 : query.value(5).toLongLong();
+    session.summarized = query.value(6).toBool();
+    session.stats.merge(query.value(7).toLongLong(), query.value(8).toDouble(), query.value(9).toDouble(),
+                        query.value(10).toDouble(), query.value(11).toDouble());
+    return session;
+}
+
+static void bindSessionRecords(QSqlQuery &query, const RecordingSession &session)
+{
+    query.addBindValue(storageString(session.startMs));
+    query.addBindValue(storageString(session.endMs));
+}
+
+qint64 DataManager::startSession(const QString &name, const QString &notes, const QStringList &channels)
+{
+    QSqlQuery query(m_database);
+    query.prepare("INSERT INTO recording_sessions (name, notes, channels, start_ms) VALUES (?, ?, ?, ?)");
+    query.addBindValue(name);
+    query.addBindValue(notes);
+    query.addBindValue(channels.join(','));
+    query.addBindValue(toStorageMs(QDateTime::currentDateTime()));
+    if (!query.exec()) {
+        emit errorOccurred(QString("Session start failed: %1").arg(query.lastError().text()));
+        return -1;
+    }
+    emit sessionsChanged();
+    return query.lastInsertId().toLongLong();
+}
+
+bool DataManager::stopSession(qint64 id, qint64 endMs)
+{
+    if (endMs < 0) {
+        endMs = toStorageMs(QDateTime::currentDateTime()) + 1;
+    }
+    QSqlQuery query(m_database);
+    query.prepare("UPDATE recording_sessions SET end_ms = MAX(?, start_ms) WHERE id = ? AND end_ms IS NULL");
+    query.addBindValue(endMs);
+    query.addBindValue(id);
+    if (!query.exec()) {
+        emit errorOccurred(QString("Session stop failed: %1").arg(query.lastError().text()));
+        return false;
+    }
+    emit sessionsChanged();
+    return true;
+}
+
+bool DataManager::recoverSessions(qint64 runStartMs)
+{
+    // 上次运行未关闭的会话：结束于下一个会话开始（或本次运行开始）之前的最后一条记录，
+    // 之后的数据属于其他会话或本次运行，不计入
+    QSqlQuery query(m_database);
+    query.prepare("SELECT s.id, s.start_ms, "
+                  "(SELECT MIN(n.start_ms) FROM recording_sessions n WHERE n.start_ms > s.start_ms) "
+                  "FROM recording_sessions s WHERE s.end_ms IS NULL AND s.start_ms < ?");
+    query.addBindValue(runStartMs);
+    if (!query.exec()) {
+        emit errorOccurred(QString("Session query failed: %1").arg(query.lastError().text()));
+        return false;
+    }
+    struct OpenSession { qint64 id; qint64 startMs; qint64 boundMs; };
+    QVector<OpenSession> open;
+    while (query.next()) {
+        qint64 boundMs = runStartMs;
+        if (!query.value(2).isNull()) {
+            boundMs = qMin(boundMs, query.value(2).toLongLong());
+        }
+        open.append({query.value(0).toLongLong(), query.value(1).toLongLong(), boundMs});
+    }
+
+    bool ok = true;
+    for (const OpenSession &session : open) {
+        qint64 endMs = session.startMs;
+        query.prepare("SELECT " STORAGE_MS_SQL("MAX(timestamp)") " FROM distance_records "
+                      "WHERE timestamp >= ? AND timestamp < ?");
+        query.addBindValue(storageString(session.startMs));
+        query.addBindValue(storageString(session.boundMs));
+        if (query.exec() && query.next() && !query.value(0).isNull()) {
+            endMs = query.value(0).toLongLong() + 1;
+        }
+        ok = stopSession(session.id, endMs) && ok;
+    }
+
+    // 已结束但统计尚未计算（结束后未等到样本入库即退出）
+    QVector<qint64> pending;
+    if (!query.exec("SELECT id FROM recording_sessions WHERE end_ms IS NOT NULL AND summarized = 0")) {
+        emit errorOccurred(QString("Session query failed: %1").arg(query.lastError().text()));
+        return false;
+    }
+    while (query.next()) {
+        pending.append(query.value(0).toLongLong());
+    }
+    for (qint64 id : pending) {
+        ok = summarizeSession(id) && ok;
+    }
+    return ok;
+}
+
+bool DataManager::summarizeSession(qint64 id)
+{
+    RecordingSession session;
+    if (!querySession(id, session)) {
+        return false;
+    }
+    if (session.isActive()) {
+        return true;
+    }
+
+    // 与统计面板同一口径：整块取汇总，按保存的记录计算
+    RangeStatistics stats;
+    if (!queryStatistics(session.startMs, session.endMs, stats)) {
+        return false;
+    }
+
+    QSqlQuery query(m_database);
+    bool hasRecords = stats.count > 0;
+    query.prepare("UPDATE recording_sessions SET summarized = 1, count = ?, sum_distance = ?, sumsq_distance = ?, "
+                  "min_distance = ?, max_distance = ? WHERE id = ?");
+    query.addBindValue(stats.count);
+    query.addBindValue(stats.sum);
+    query.addBindValue(stats.sumSq);
+    query.addBindValue(hasRecords ? QVariant(stats.min) : QVariant());
+    query.addBindValue(hasRecords ? QVariant(stats.max) : QVariant());
+    query.addBindValue(id);
+    if (!query.exec()) {
+        emit errorOccurred(QString("Session summary failed: %1").arg(query.lastError().text()));
+        return false;
+    }
+    emit sessionsChanged();
+    return true;
+}
+
+bool DataManager::updateSessionInfo(qint64 id, const QString &name, const QString &notes)
+{
+    QSqlQuery query(m_database);
+    query.prepare("UPDATE recording_sessions SET name = ?, notes = ? WHERE id = ?");
+    query.addBindValue(name);
+    query.addBindValue(notes);
+    query.addBindValue(id);
+    if (!query.exec()) {
+        emit errorOccurred(QString("Session update failed: %1").arg(query.lastError().text()));
+        return false;
+    }
+    emit sessionsChanged();
+    return true;
+}
+
+bool DataManager::querySessions(QVector<RecordingSession> &sessions)
+{
+    sessions.clear();
+    QSqlQuery query(m_database);
+    query.setForwardOnly(true);
+    if (!query.exec("SELECT " SESSION_COLUMNS " FROM recording_sessions ORDER BY id DESC")) {
+        emit errorOccurred(QString("Session query failed: %1").arg(query.lastError().text()));
+        return false;
+    }
+    while (query.next()) {
+        sessions.append(readSession(query));
+    }
+    return true;
+}
+
+bool DataManager::querySession(qint64 id, RecordingSession &session)
+{
+    QSqlQuery query(m_database);
+    query.prepare("SELECT " SESSION_COLUMNS " FROM recording_sessions WHERE id = ?");
+    query.addBindValue(id);
+    if (!query.exec()) {
+        emit errorOccurred(QString("Session query failed: %1").arg(query.lastError().text()));
+        return false;
+    }
+    if (!query.next()) {
+        emit errorOccurred(QString("Session %1 not found").arg(id));
+        return false;
+    }
+    session = readSession(query);
+    return true;
+}
+
+bool DataManager::querySessionRecords(const RecordingSession &session, RecordSet &records)
+{
+    if (session.isActive()) {
+        return queryRange(session.startMs, toStorageMs(QDateTime::currentDateTime()) + 1, records);
+    }
+
+    QSqlQuery query(m_database);
+    query.setForwardOnly(true);
+    query.prepare("SELECT id, " STORAGE_MS_SQL("timestamp") ", distance FROM distance_records "
+                  "WHERE " SESSION_RECORDS_WHERE " ORDER BY timestamp, id");
+    bindSessionRecords(query, session);
+    records.m_ids.reserve(records.size() + int(session.stats.count));
+    records.m_timestampsMs.reserve(records.size() + int(session.stats.count));
+    records.m_distances.reserve(records.size() + int(session.stats.count));
+    if (!fillRecordSet(query, records)) {
+        emit errorOccurred(QString("Session records query failed: %1").arg(query.lastError().text()));
+        return false;
+    }
+    return true;
+}
+
+bool DataManager::exportSession(const RecordingSession &session, const QString &filePath)
+{
+    RecordSet records;
+    if (!querySessionRecords(session, records)) {
+        return false;
+    }
+
+    QFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        emit errorOccurred(QString("Cannot write %1: %2").arg(filePath, file.errorString()));
+        return false;
+    }
 
-    for (const auto &record : records) {
-        out << QString("[%1] %2 - %3 cm\n").arg(record.id, 5).arg(record.timestamp.toString("yyyy-MM-dd hh:mm:ss")).arg(record.distance, 6, 'f', 2);
+    // 与 exportToCSV 列相同（毫秒精度），可直接导入；压缩说明行导入时作为无法解析的行跳过
+    QTextStream out(&file);
+    out.setEncoding(QStringConverter::Utf8);
+    qint64 endMs = session.isActive() ? std::numeric_limits<qint64>::max() : session.endMs;
+    QString note = compressionNote(session.startMs, endMs);
+    if (!note.isEmpty()) {
+        out << "# " << note << "\n";
+    }
+    out << "ID,Timestamp,Distance(cm)\n";
+    for (int i = 0; i < records.size(); ++i) {
+        out << records.idAt(i) << "," << records.timestampAt(i).toString("yyyy-MM-dd hh:mm:ss.zzz") << ","
+            << QString::number(records.distanceAt(i), 'f', SampleFixed::kFractionDigits) << "\n";
     }
     file.close();
     return true;
 }
 
+bool DataManager::deleteSession(qint64 id)
+{
+    RecordingSession session;
+    if (!querySession(id, session)) {
+        return false;
+    }
+    if (session.isActive()) {
+        emit errorOccurred("Stop the session before deleting it");
+        return false;
+    }
+    if (!m_database.transaction()) {
+        emit errorOccurred(QString("Transaction start failed: %1").arg(m_database.lastError().text()));
+        return false;
+    }
+
+    QSqlQuery query(m_database);
+    query.prepare("DELETE FROM distance_records WHERE " SESSION_RECORDS_WHERE);
+    bindSessionRecords(query, session);
+    bool ok = query.exec();
+    bool deletedRecords = ok && query.numRowsAffected() > 0;
+    ok = ok && (!deletedRecords || rebuildRollupsRange(session.startMs, session.endMs));
+    if (ok) {
+        query.prepare("DELETE FROM recording_sessions WHERE id = ?");
+        query.addBindValue(id);
+        ok = query.exec();
+    }
+    if (!ok || !m_database.commit()) {
+        emit errorOccurred(QString("Session delete failed: %1").arg(query.lastError().text()));
+        m_database.rollback();
+        return false;
+    }
+
+    if (deletedRecords) {
+        emit recordsChanged();
+    }
+    emit sessionsChanged();
+    return true;
+}
+
 int DataManager::getTotalRecords()
 {
     QSqlQuery query(m_database);
@@ -4,7 +4,18 @@
 #include <QObject>
 #include <QSqlDatabase>
 #include <QDateTime>
+#include <QElapsedTimer>
 #include <QVector>
+#include <QStringList>
+#include <atomic>
+
+#include "eventdetector.h"
+#include "samplecompressor.h"
+#include "samplespool.h"
+
+class QThread;
+class QSqlQuery;
+class SpoolReplayer;
 
 /**
  * @brief 数据记录结构
@@ -19,6 +30,136 @@ struct DistanceRecord {
         : id(i), timestamp(dt), distance(d) {}
 };
 
+/**
+ * @brief 列式查询结果：id、时间（存储毫秒）与距离各自连续存放
+ *
+ * 各列为隐式共享的 QVector，图表、表格与导出之间传递只增加引用计数。
+ * 需要旧接口的调用方可用 at()/operator[] 或范围 for 按需生成 DistanceRecord 行视图。
+ */
+class RecordSet {
+public:
+    class const_iterator {
+    public:
+        const_iterator(const RecordSet *set, int index) : m_set(set), m_index(index) {}
+        DistanceRecord operator*() const { return m_set->at(m_index); }
+        const_iterator &operator++() { ++m_index; return *this; }
+        bool operator!=(const const_iterator &other) const { return m_index != other.m_index; }
+
+    private:
+        const RecordSet *m_set;
+        int m_index;
+    };
+
+    int size() const { return m_ids.size(); }
+    bool isEmpty() const { return m_ids.isEmpty(); }
+
+    qint64 idAt(int index) const { return m_ids[index]; }
+    qint64 timestampMsAt(int index) const { return m_timestampsMs[index]; }
+    double distanceAt(int index) const { return m_distances[index]; }
+    QDateTime timestampAt(int index) const;
+
+    // 整列访问
+    const QVector<qint64> &ids() const { return m_ids; }
+    const QVector<qint64> &timestampsMs() const { return m_timestampsMs; }
+    const QVector<double> &distances() const { return m_distances; }
+
+    // 行视图
+    DistanceRecord at(int index) const;
+    DistanceRecord operator[](int index) const { return at(index); }
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, size()); }
+
+private:
+    friend class DataManager;
+
+    QVector<qint64> m_ids;
+    QVector<qint64> m_timestampsMs;   // 存储毫秒，见 DataManager::toStorageMs
+    QVector<double> m_distances;
+};
+
+/**
+ * @brief 降采样桶，保留桶内最小/最大值
+ */
+struct HistoryBucket {
+    qint64 startMs;      // 桶起始时间（存储毫秒，见 DataManager::toStorageMs）
+    float minDistance;
+    float maxDistance;
+};
+
+Q_DECLARE_METATYPE(HistoryBucket)
+
+/**
+ * @brief 区间统计量，各分块的结果可直接合并
+ *
+ * 计数、均值与最值均按库中实际保存的记录计算（与 ultrasonic-query aggregate 一致）；
+ * represented 为这些记录代表的样本数：压缩时间段内按名义采样间隔折合，其余部分等于记录数。
+ */
+struct RangeStatistics {
+    qint64 count = 0;
+    double sum = 0.0;
+    double sumSq = 0.0;
+    double min = 0.0;
+    double max = 0.0;
+    qint64 represented = 0;
+
+    void merge(qint64 otherCount, double otherSum, double otherSumSq, double otherMin, double otherMax);
+    double mean() const { return count > 0 ? sum / count : 0.0; }
+    double standardDeviation() const;
+};
+
+/**
+ * @brief 入库压缩开启的一段时间（存储毫秒）
+ *
+ * 其中的记录是旋转门压缩的保存点，时间不等间隔，统计与导出不能把它们当作等间隔样本。
+ */
+struct CompressionSpan {
+    qint64 startMs = 0;
+    qint64 endMs = -1;               // -1 表示仍在压缩
+    qint32 tolerance = 0;            // SampleFixed 定点值
+    double sampleIntervalUs = 0.0;   // 送入压缩器的样本的平均间隔，0 为未知（异常退出时未记录）
+};
+
+/**
+ * @brief 增量同步的一条变更
+ *
+ * sequence 与记录 id 取自同一自增序列：新增记录的 sequence 即其 id，
+ * 删除记录的墓碑在删除时分配新序号，因此按 sequence 排序即为提交顺序。
+ */
+struct RecordChange {
+    enum Type {
+        Insert,
+        Delete,       // 删除 recordId 一条记录
+        Clear         // 删除 id 不大于 recordId 的全部记录
+    };
+
+    Type type;
+    qint64 sequence;
+    qint64 recordId;
+    qint64 timestampMs;   // 存储毫秒，仅 Insert 有效
+    double distance;      // 仅 Insert 有效
+};
+
+/**
+ * @brief 录制会话（目录中的一行）
+ *
+ * 会话的记录即时间在 [startMs, endMs) 内的记录，按时间索引访问：记录 id 与时间并不同序
+ * （导入与暂存回放都会写入较早的时间）。结束时先写入结束时间，会话内的样本全部入库后再计算统计，
+ * 之后对比与列表直接读取预先算好的统计。
+ */
+struct RecordingSession {
+    qint64 id = -1;
+    QString name;
+    QString notes;
+    QStringList channels;
+    qint64 startMs = 0;          // 存储毫秒
+    qint64 endMs = -1;           // 不含；进行中为 -1
+    bool summarized = false;     // 统计已计算
+    RangeStatistics stats;       // summarized 之后有效
+
+    bool isActive() const { return endMs < 0; }
+    qint64 durationMs() const { return isActive() ? 0 : endMs - startMs; }
+};
+
 /**
  * @brief 数据管理类，负责数据的保存、查询和导出
  */
@@ -29,16 +170,93 @@ public:
     explicit DataManager(QObject *parent = nullptr);
     ~DataManager();
 
-    // 初始化数据库
-    bool initialize(const QString &dbPath = "ultrasonic_data.db");
+    // 初始化数据库（connectionName 为空时使用默认连接，工作线程需使用独立连接名）
+    bool initialize(const QString &dbPath = "ultrasonic_data.db",
+                    const QString &connectionName = QString());
+    // 后台打开：建表、迁移、补建汇总及全表统计在工作线程上完成，
+    // 之后本对象在当前线程打开数据库并发出 storageReady()。期间 databasePath() 已可用。
+    // 打开失败时发出 storageReady(false) 并在后台退避重试，成功后再发出 storageReady(true)
+    void initializeAsync(const QString &dbPath = "ultrasonic_data.db");
+    // 只读打开已有数据库，不建表、不迁移（命令行查询等外部读取方使用）
+    bool openReadOnly(const QString &dbPath, const QString &connectionName = QString());
+    bool isOpen() const { return m_database.isOpen(); }
+    QString databasePath() const;
 
-    // 保存数据
+    // 预写暂存：打开后 saveData 只写暂存文件，由后台线程批量入库
+    bool openSpool(const QString &filePath = QString());
+    bool isSpooling() const { return m_spool != nullptr; }
+    quint64 pendingSamples() const;
+    // 请回放线程尽快写完当前积压（不等待），返回已写入暂存的序号；
+    // isReplayedUpTo() 为真或 spoolReplayed() 报告的序号不小于它时，此前的样本均已入库
+    quint64 requestReplay();
+    bool isReplayedUpTo(quint64 sequence) const;
+
+    // 保存数据：saveSamples 可在存储线程调用，没有暂存文件时在该线程使用独立连接入库
     bool saveData(double distance);
+    bool saveData(double distance, qint64 timestampUs);
+    bool saveSamples(const SampleBlock &block);
+
+    // 入库压缩（见 SampleCompressor）：只对 saveSamples 生效，容差为 0 时关闭；可在任意线程设置，
+    // 下一块样本生效。flushCompression 写出压缩器暂存的最后一个样本并重新开始，须在写入线程调用
+    void setCompressionTolerance(double toleranceCm);
+    double compressionTolerance() const;
+    bool flushCompression();
+    // 累计送入与实际写入的样本数
+    void compressionCounts(qint64 &samples, qint64 &stored) const;
+    // 与 [startMs, endMs) 相交的压缩时间段，按开始时间排序；没有压缩记录的旧库为空
+    bool queryCompressionSpans(qint64 startMs, qint64 endMs, QVector<CompressionSpan> &spans);
+    // 导出文件中的压缩说明，区间内未压缩时为空
+    QString compressionNote(qint64 startMs, qint64 endMs);
+    // spoolId 非 0 时在同一事务内把该暂存文件的回放水位更新为 endSequence
+    bool insertRecords(const QVector<SpoolRecord> &records, quint64 spoolId = 0, quint64 endSequence = 0);
+    bool querySpoolWatermark(quint64 spoolId, quint64 &sequence);
+    bool saveEvent(const DetectionEvent &event);
+    bool saveGap(qint64 startUs, qint64 endUs, const QString &reason);
+
+    // 批量导入：begin 与 commit 之间为一个事务，汇总触发器暂停，提交前按批合并汇总
+    // timestamps 为连续存放的定长存储时间文本（yyyy-MM-ddThh:mm:ss.zzz）
+    static const int kTimestampTextLength = 23;
+    bool beginBulkImport();
+    bool bulkInsert(const char *timestamps, const double *distances, int count);
+    bool commitBulkImport();
+    void rollbackBulkImport();
+    // 导入登记：已完整导入过同一指纹的文件时返回 true 并给出说明；只提交了一部分（取消或出错）时返回 false，
+    // committedChunks/committedRows 给出已提交的块数（按写入顺序）与行数，否则为 0。
+    // recordImportedFile 在该文件的每个导入事务内调用：committedChunks 为 -1 表示整个文件已写完
+    bool isFileImported(const QString &fingerprint, QString &description, int &committedChunks, qint64 &committedRows);
+    bool recordImportedFile(const QString &fingerprint, const QString &path, qint64 rows, int committedChunks = -1);
 
     // 查询数据
-    QVector<DistanceRecord> queryAll();
-    QVector<DistanceRecord> queryByDateRange(const QDateTime &start, const QDateTime &end);
-    QVector<DistanceRecord> queryRecent(int count = 100);
+    RecordSet queryAll();
+    RecordSet queryByDateRange(const QDateTime &start, const QDateTime &end);
+    RecordSet queryRecent(int count = 100);
+    // [startMs, endMs)（存储毫秒）内的记录按时间升序追加到 records
+    bool queryRange(qint64 startMs, qint64 endMs, RecordSet &records);
+
+    // 历史视图：按桶宽降采样（最小/最大值保留），优先使用汇总表
+    QVector<HistoryBucket> queryDownsampled(qint64 startMs, qint64 endMs, qint64 bucketMs);
+    bool queryTimeBounds(qint64 &firstMs, qint64 &lastMs);
+    // 汇总未补建（rollup_backfilled 标记不为 1）时全量补建并安装触发器
+    bool ensureRollups();
+
+    // 任意区间 [startMs, endMs)（存储毫秒）的计数/均值/最值：整块部分取汇总表，
+    // 只有两端不足一秒的部分扫描原始记录。压缩时间段内另外按名义采样间隔
+    // 折合出代表的样本数（见 accumulateCompressed）
+    bool queryStatistics(qint64 startMs, qint64 endMs, RangeStatistics &stats);
+
+    // 顺序扫描（全量扫描类分析）：按时间升序分块读取 [cursor, endMs) 内最多 limit 条，
+    // 游标为上一块最后一条的 (时间文本, id)，起点由 seriesCursorAt() 给出。
+    // 按时间索引而不是 id 分页：导入与暂存补写的记录 id 与时间并不同序
+    struct SeriesCursor {
+        QString timestamp;
+        qint64 id;
+    };
+    static SeriesCursor seriesCursorAt(qint64 startMs);
+    int scanSeries(SeriesCursor &cursor, qint64 endMs, int limit, QVector<qint64> &timesMs, QVector<float> &values);
+
+    // 存储时间戳为本地时间文本，此处换算为可直接比较的毫秒值
+    static qint64 toStorageMs(const QDateTime &dateTime);
+    static QDateTime fromStorageMs(qint64 ms);
 
     // 删除数据
     bool deleteRecord(int id);
@@ -48,6 +266,34 @@ public:
     bool exportToCSV(const QString &filePath);
     bool exportToTXT(const QString &filePath);
 
+    // 增量同步：水位为已取得的最大变更序号（持久、单调递增），从 0 开始即为全量。
+    // readChanges 返回水位之后按序号排列的最多 maxCount 条变更及新水位，代价与变更数成正比
+    enum ChangeFormat {
+        ChangeCsv,
+        ChangeBinary
+    };
+    qint64 currentWatermark();
+    bool readChanges(qint64 sinceWatermark, int maxCount, QVector<RecordChange> &changes, qint64 &watermark);
+    // 失败时删除不完整的文件，watermark 保持 sinceWatermark
+    bool exportChanges(const QString &filePath, qint64 sinceWatermark, ChangeFormat format, qint64 &watermark);
+
+    // 录制会话：startSession 返回会话 id（失败为 -1）；stopSession 只写入结束时间 endMs（不含，默认为当前时刻），
+    // 会话内的样本全部入库后再调用 summarizeSession 计算统计。
+    // recoverSessions 在暂存补写完成后调用：结束 runStartMs 之前开始、未关闭的会话（以下一个会话开始
+    // 或本次运行开始之前的最后一条记录为结束），并补算尚未计算统计的会话
+    qint64 startSession(const QString &name, const QString &notes, const QStringList &channels);
+    bool stopSession(qint64 id, qint64 endMs = -1);
+    bool summarizeSession(qint64 id);
+    bool recoverSessions(qint64 runStartMs);
+    bool updateSessionInfo(qint64 id, const QString &name, const QString &notes);
+    bool querySessions(QVector<RecordingSession> &sessions);
+    bool querySession(qint64 id, RecordingSession &session);
+    // 会话记录按时间升序；进行中的会话读取到当前
+    bool querySessionRecords(const RecordingSession &session, RecordSet &records);
+    bool exportSession(const RecordingSession &session, const QString &filePath);
+    // 删除会话及其时间范围内的全部记录，受影响的汇总块由细到粗逐层重建
+    bool deleteSession(qint64 id);
+
     // 统计信息
     int getTotalRecords();
     double getAverageDistance();
@@ -55,12 +301,54 @@ public:
     double getMinDistance();
 
 signals:
-    void dataAdded(const DistanceRecord &record);
+    // 每次写入（单条保存或一个批次）发出一次
+    void dataAdded(const QVector<DistanceRecord> &records);
+    // 库中记录有增删（含暂存回放写入），统计等派生数据需要刷新
+    void recordsChanged();
     void errorOccurred(const QString &error);
+    void storageAvailabilityChanged(bool available);
+    // initializeAsync() 完成；stats 为打开时的全表统计
+    void storageReady(bool available, const RangeStatistics &stats, qint64 elapsedMs);
+    // 暂存回放进度：sequence 之前的样本均已入库
+    void spoolReplayed(quint64 sequence);
+    // 会话目录有变化（开始、结束、修改或删除）
+    void sessionsChanged();
 
 private:
     QSqlDatabase m_database;
+    QString m_databasePath;
+    QThread *m_openThread;
+    std::atomic<bool> m_isOpening;
+    int m_openRetryDelayMs;
+    QElapsedTimer m_openClock;
+    SampleSpool *m_spool;
+    QThread *m_replayThread;
+    SpoolReplayer *m_replayer;
+    DataManager *m_directWriter;     // 没有暂存文件时存储线程上的写入连接
+    qint64 m_bulkFirstId;
+    bool m_rollupsReady;
+    SampleCompressor m_compressor;
+    std::atomic<qint32> m_compressionTolerance;
+    std::atomic<qint64> m_compressionSamples;
+    std::atomic<qint64> m_compressionStored;
+    std::atomic<qint64> m_compressionInputUs;   // 相邻送入样本的间隔之和（不含中断）
+    qint64 m_lastInputUs;
+    qint64 m_compressionSpanId;      // 本实例开启、尚未结束的压缩时间段，-1 表示无
+    qint64 m_spanSamples;            // 该时间段开始时的计数
+    qint64 m_spanInputUs;
+    void updateCompressionSpan(qint32 tolerance);
+    void startOpen();
+    void finishOpen(bool ok, const RangeStatistics &stats);
+    void startReplay();
+    DataManager *directWriter();
+    bool writeSamples(const SampleBlock &block);
     bool createTables();
+    bool createSchema(QSqlQuery &query);
+    bool fillRecordSet(QSqlQuery &query, RecordSet &records);
+    bool rebuildRollupsAt(const QDateTime &timestamp);
+    bool rebuildRollupsRange(qint64 startMs, qint64 endMs);
+    bool accumulateRange(int levelIndex, qint64 startMs, qint64 endMs, RangeStatistics &stats);
+    bool accumulateCompressed(const CompressionSpan &span, qint64 startMs, qint64 endMs, RangeStatistics &stats);
 };
 
 #endif // DATAMANAGER_H
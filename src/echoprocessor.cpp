@@ -0,0 +1,356 @@
+#include "echoprocessor.h"
+#include <QFile>
+#include <QTextStream>
+#include <QThread>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define ECHOPROCESSOR_SSE2
+#endif
+
+// 默认参考脉冲宽度（40 kHz 换能器 8 个周期）
+static const double kDefaultPulseUs = 200.0;
+// 第一个达到最大相关值该比例的峰视为直达回波
+static const float kFirstEchoRatio = 0.5f;
+// 相关峰须高于相关序列均方根的倍数，否则视为无回波
+static const float kMinPeakToRms = 3.0f;
+// 帧数少于该值时在调用线程上直接处理，不唤醒工作线程
+static const int kMinParallelFrames = 4;
+static const int kMaxWorkerThreads = 8;
+static const double kPi = 3.14159265358979323846;
+
+struct EchoProcessor::Worker {
+    QVector<float> envelope;
+    QVector<float> correlation;
+};
+
+static quint16 crc16(const quint8 *data, int size)
+{
+    quint16 crc = 0xFFFF;
+    for (int i = 0; i < size; ++i) {
+        crc ^= quint16(data[i]) << 8;
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc & 0x8000) ? quint16((crc << 1) ^ 0x1021) : quint16(crc << 1);
+        }
+    }
+    return crc;
+}
+
+static inline quint32 readLe32(const quint8 *p)
+{
+    return quint32(p[0]) | quint32(p[1]) << 8 | quint32(p[2]) << 16 | quint32(p[3]) << 24;
+}
+
+static float dot(const float *x, const float *y, int m)
+{
+    int i = 0;
+    float sum = 0.0f;
+#ifdef ECHOPROCESSOR_SSE2
+    __m128 acc0 = _mm_setzero_ps();
+    __m128 acc1 = _mm_setzero_ps();
+    for (; i + 8 <= m; i += 8) {
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(x + i), _mm_loadu_ps(y + i)));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(x + i + 4), _mm_loadu_ps(y + i + 4)));
+    }
+    __m128 acc = _mm_add_ps(acc0, acc1);
+    __m128 high = _mm_movehl_ps(acc, acc);
+    acc = _mm_add_ps(acc, high);
+    acc = _mm_add_ss(acc, _mm_shuffle_ps(acc, acc, 1));
+    sum = _mm_cvtss_f32(acc);
+#endif
+    for (; i < m; ++i) {
+        sum += x[i] * y[i];
+    }
+    return sum;
+}
+
+EchoProcessor::EchoProcessor()
+    : m_referenceRateHz(0.0)
+    , m_referenceForRateHz(0)
+    , m_speedOfSound(343.0)
+    , m_callerWorker(new Worker)
+    , m_generation(0)
+    , m_running(0)
+    , m_stopping(false)
+    , m_frames(nullptr)
+    , m_distances(nullptr)
+    , m_frameCount(0)
+    , m_nextFrame(0)
+{
+    m_callerWorker->envelope.resize(kMaxSamples);
+    m_callerWorker->correlation.resize(kMaxSamples);
+
+    int threads = qBound(0, QThread::idealThreadCount() - 1, kMaxWorkerThreads);
+    for (int t = 0; t < threads; ++t) {
+        Worker *worker = new Worker;
+        worker->envelope.resize(kMaxSamples);
+        worker->correlation.resize(kMaxSamples);
+        m_workers.append(worker);
+
+        QThread *thread = QThread::create([this, worker]() { workerLoop(worker); });
+        thread->start();
+        m_threads.append(thread);
+    }
+}
+
+EchoProcessor::~EchoProcessor()
+{
+    m_mutex.lock();
+    m_stopping = true;
+    m_startCondition.wakeAll();
+    m_mutex.unlock();
+
+    for (QThread *thread : m_threads) {
+        thread->wait();
+        delete thread;
+    }
+    qDeleteAll(m_workers);
+    delete m_callerWorker;
+}
+
+bool EchoProcessor::loadReference(const QString &filePath, QString *error)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        if (error) {
+            *error = file.errorString();
+        }
+        return false;
+    }
+
+    QTextStream in(&file);
+    QString header = in.readLine().trimmed();
+    bool ok = header.startsWith("rate=");
+    double rate = ok ? header.mid(5).toDouble(&ok) : 0.0;
+    if (!ok || rate <= 0.0) {
+        if (error) {
+            *error = "First line must be rate=<Hz>";
+        }
+        return false;
+    }
+
+    QVector<float> values;
+    while (!in.atEnd()) {
+        QString line = in.readLine().trimmed();
+        if (line.isEmpty()) {
+            continue;
+        }
+        float value = line.toFloat(&ok);
+        if (!ok) {
+            if (error) {
+                *error = QString("Invalid value: %1").arg(line);
+            }
+            return false;
+        }
+        values.append(value);
+    }
+    if (values.size() < 3) {
+        if (error) {
+            *error = "Reference needs at least 3 samples";
+        }
+        return false;
+    }
+
+    m_referenceSource = values;
+    m_referenceRateHz = rate;
+    m_referenceForRateHz = 0;
+    return true;
+}
+
+int EchoProcessor::parseFrame(const char *data, int size, EchoFrame &frame)
+{
+    if (size < kHeaderSize) {
+        return 0;
+    }
+    const quint8 *p = reinterpret_cast<const quint8 *>(data);
+    if (p[0] != 0xA5 || p[1] != 0x5A || p[2] != 1) {
+        return -1;
+    }
+
+    int count = p[4] | p[5] << 8;
+    quint32 sampleRateHz = readLe32(p + 6);
+    if (count == 0 || count > kMaxSamples || sampleRateHz == 0) {
+        return -1;
+    }
+    int total = kHeaderSize + count + kTrailerSize;
+    if (size < total) {
+        return 0;
+    }
+
+    quint16 stored = quint16(p[total - 2] | p[total - 1] << 8);
+    if (crc16(p + 2, kHeaderSize - 2 + count) != stored) {
+        return -1;
+    }
+
+    frame.samples = p + kHeaderSize;
+    frame.count = count;
+    frame.sampleRateHz = sampleRateHz;
+    frame.delayUs = readLe32(p + 10);
+    return total;
+}
+
+void EchoProcessor::prepareReference(quint32 sampleRateHz)
+{
+    if (sampleRateHz == m_referenceForRateHz) {
+        return;
+    }
+
+    m_reference.clear();
+    if (!m_referenceSource.isEmpty()) {
+        // 线性插值重采样到帧采样率
+        double step = m_referenceRateHz / sampleRateHz;
+        for (double position = 0.0; position <= m_referenceSource.size() - 1; position += step) {
+            int index = int(position);
+            double fraction = position - index;
+            float next = index + 1 < m_referenceSource.size() ? m_referenceSource[index + 1] : m_referenceSource[index];
+            m_reference.append(float(m_referenceSource[index] * (1.0 - fraction) + next * fraction));
+        }
+    }
+    if (m_reference.size() < 3) {
+        int length = qMax(3, int(std::lround(kDefaultPulseUs * 1e-6 * sampleRateHz)));
+        m_reference.resize(length);
+        for (int i = 0; i < length; ++i) {
+            m_reference[i] = float(0.5 - 0.5 * std::cos(2.0 * kPi * (i + 0.5) / length));
+        }
+    }
+
+    double mean = 0.0;
+    for (float value : m_reference) {
+        mean += value;
+    }
+    mean /= m_reference.size();
+    for (float &value : m_reference) {
+        value -= float(mean);
+    }
+    m_referenceForRateHz = sampleRateHz;
+}
+
+void EchoProcessor::process(const QVector<EchoFrame> &frames, QVector<double> &distances)
+{
+    distances.resize(frames.size());
+
+    // 参考脉冲取决于采样率，采样率相同的相邻帧为一轮
+    int begin = 0;
+    while (begin < frames.size()) {
+        int end = begin + 1;
+        while (end < frames.size() && frames[end].sampleRateHz == frames[begin].sampleRateHz) {
+            ++end;
+        }
+        prepareReference(frames[begin].sampleRateHz);
+
+        m_frames = frames.constData() + begin;
+        m_distances = distances.data() + begin;
+        m_frameCount = end - begin;
+        m_nextFrame.store(0);
+
+        if (m_frameCount < kMinParallelFrames || m_workers.isEmpty()) {
+            runShare(m_callerWorker);
+        } else {
+            m_mutex.lock();
+            m_running = m_workers.size();
+            ++m_generation;
+            m_startCondition.wakeAll();
+            m_mutex.unlock();
+
+            runShare(m_callerWorker);
+
+            m_mutex.lock();
+            while (m_running > 0) {
+                m_doneCondition.wait(&m_mutex);
+            }
+            m_mutex.unlock();
+        }
+        begin = end;
+    }
+}
+
+void EchoProcessor::runShare(Worker *worker)
+{
+    // 按帧动态领取，帧长度不一时各线程负载仍然均衡
+    while (true) {
+        int index = m_nextFrame.fetch_add(1);
+        if (index >= m_frameCount) {
+            break;
+        }
+        m_distances[index] = computeDistance(m_frames[index], worker);
+    }
+}
+
+void EchoProcessor::workerLoop(Worker *worker)
+{
+    quint64 seen = 0;
+    while (true) {
+        m_mutex.lock();
+        while (!m_stopping && m_generation == seen) {
+            m_startCondition.wait(&m_mutex);
+        }
+        if (m_stopping) {
+            m_mutex.unlock();
+            return;
+        }
+        seen = m_generation;
+        m_mutex.unlock();
+
+        runShare(worker);
+
+        m_mutex.lock();
+        if (--m_running == 0) {
+            m_doneCondition.wakeAll();
+        }
+        m_mutex.unlock();
+    }
+}
+
+double EchoProcessor::computeDistance(const EchoFrame &frame, Worker *worker) const
+{
+    const int n = frame.count;
+    const int m = m_reference.size();
+    if (n < m + 2) {
+        return -1.0;
+    }
+
+    float *x = worker->envelope.data();
+    for (int i = 0; i < n; ++i) {
+        x[i] = frame.samples[i];
+    }
+
+    const int lags = n - m + 1;
+    float *c = worker->correlation.data();
+    const float *reference = m_reference.constData();
+    float maxValue = 0.0f;
+    double sumSq = 0.0;
+    for (int i = 0; i < lags; ++i) {
+        c[i] = dot(x + i, reference, m);
+        maxValue = qMax(maxValue, c[i]);
+        sumSq += double(c[i]) * c[i];
+    }
+    if (maxValue <= 0.0f || maxValue < kMinPeakToRms * std::sqrt(sumSq / lags)) {
+        return -1.0;
+    }
+
+    // 最早的强回波：首个越过阈值处向后爬升到局部峰
+    const float threshold = kFirstEchoRatio * maxValue;
+    int peak = 0;
+    while (c[peak] < threshold) {
+        ++peak;
+    }
+    while (peak + 1 < lags && c[peak + 1] > c[peak]) {
+        ++peak;
+    }
+
+    double delta = 0.0;
+    if (peak > 0 && peak + 1 < lags) {
+        double a = c[peak - 1];
+        double b = c[peak];
+        double d = c[peak + 1];
+        double denominator = a - 2.0 * b + d;
+        if (denominator < 0.0) {
+            delta = qBound(-0.5, 0.5 * (a - d) / denominator, 0.5);
+        }
+    }
+
+    double flightUs = frame.delayUs + (peak + delta) * 1e6 / frame.sampleRateHz;
+    // 往返距离的一半，声速 m/s 换算为 cm/µs
+    return flightUs * m_speedOfSound * 1e-4 / 2.0;
+}
@@ -0,0 +1,90 @@
+#ifndef ECHOPROCESSOR_H
+#define ECHOPROCESSOR_H
+
+#include <QMutex>
+#include <QString>
+#include <QVector>
+#include <QWaitCondition>
+#include <atomic>
+
+class QThread;
+
+/**
+ * @brief 回波包络帧（指向接收缓冲区，不复制样本）
+ *
+ * 串口二进制帧格式（多字节字段均为小端）：
+ *   A5 5A | version u8 = 1 | flags u8 | count u16 | sampleRateHz u32 | delayUs u32 |
+ *   samples u8[count] | crc16 u16
+ * delayUs 为发射到第一个包络样本之间的时间（盲区），CRC-16/CCITT-FALSE 覆盖 version 到最后一个样本。
+ */
+struct EchoFrame {
+    const quint8 *samples;
+    int count;
+    quint32 sampleRateHz;
+    quint32 delayUs;
+};
+
+/**
+ * @brief 主机侧回波飞行时间计算
+ *
+ * 包络与参考脉冲做互相关（参考脉冲去均值，包络直流分量不影响结果），
+ * 取第一个达到最大相关值 kFirstEchoRatio 倍的局部峰作为直达回波——近距离障碍与多径时
+ * 后到的回波可能更强，但最早的才是最近目标。峰值位置经抛物线插值得到亚样本精度。
+ * 相关内层循环在 SSE2 可用时使用向量指令。
+ *
+ * 一次 process() 的多个帧由常驻工作线程与调用线程一起按帧动态分配处理，
+ * 调用返回时全部完成，结果顺序与输入一致。
+ */
+class EchoProcessor {
+public:
+    static const int kHeaderSize = 14;
+    static const int kTrailerSize = 2;
+    static const int kMaxSamples = 4096;
+
+    EchoProcessor();
+    ~EchoProcessor();
+
+    // 参考脉冲：文本文件首行 "rate=<Hz>"，其后每行一个样本值；未加载时使用 200 µs 的 Hann 脉冲
+    bool loadReference(const QString &filePath, QString *error = nullptr);
+    void setSpeedOfSound(double metersPerSecond) { m_speedOfSound = metersPerSecond; }
+
+    // 尝试从 data 解析一帧：返回帧总长度；数据不足返回 0；不是有效帧返回 -1
+    static int parseFrame(const char *data, int size, EchoFrame &frame);
+
+    // 计算各帧距离（cm），无法确定回波的帧为负值
+    void process(const QVector<EchoFrame> &frames, QVector<double> &distances);
+
+private:
+    struct Worker;
+
+    void prepareReference(quint32 sampleRateHz);
+    double computeDistance(const EchoFrame &frame, Worker *worker) const;
+    void runShare(Worker *worker);
+    void workerLoop(Worker *worker);
+
+    // 参考脉冲：原始样本与按当前帧采样率重采样、去均值后的版本
+    QVector<float> m_referenceSource;
+    double m_referenceRateHz;
+    QVector<float> m_reference;
+    quint32 m_referenceForRateHz;
+    double m_speedOfSound;
+
+    // 常驻工作线程，每轮由 m_generation 唤醒
+    QVector<QThread *> m_threads;
+    QVector<Worker *> m_workers;
+    Worker *m_callerWorker;
+    QMutex m_mutex;
+    QWaitCondition m_startCondition;
+    QWaitCondition m_doneCondition;
+    quint64 m_generation;
+    int m_running;
+    bool m_stopping;
+
+    // 当前一轮的任务
+    const EchoFrame *m_frames;
+    double *m_distances;
+    int m_frameCount;
+    std::atomic<int> m_nextFrame;
+};
+
+#endif // ECHOPROCESSOR_H
@@ -0,0 +1,305 @@
+#include "eventdetector.h"
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QMutexLocker>
+#include <chrono>
+#include <cmath>
+#include <utility>
+
+static qint64 wallClockUs()
+{
+    using namespace std::chrono;
+    return duration_cast<microseconds>(system_clock::now().time_since_epoch()).count();
+}
+
+QString DetectionEvent::typeName(DetectionEventType type)
+{
+    switch (type) {
+    case DetectionEventType::ThresholdEnter: return "threshold_enter";
+    case DetectionEventType::ThresholdExit:  return "threshold_exit";
+    case DetectionEventType::DwellReached:   return "dwell_reached";
+    case DetectionEventType::RateExceeded:   return "rate_exceeded";
+    case DetectionEventType::BandExited:     return "band_exited";
+    case DetectionEventType::BandReentered:  return "band_reentered";
+    }
+    return "unknown";
+}
+
+EventDetector::EventDetector(QObject *parent)
+    : QObject(parent)
+    , m_rulesPending(false)
+    , m_resetPending(false)
+    , m_lastTimestampUs(0)
+    , m_maxEvaluationNs(0)
+{
+    qRegisterMetaType<DetectionEvent>("DetectionEvent");
+}
+
+EventDetector::~EventDetector()
+{
+}
+
+void EventDetector::setRules(const QVector<DetectionRule> &rules)
+{
+    std::vector<CompiledRule> table;
+    table.reserve(rules.size());
+
+    for (int i = 0; i < rules.size(); ++i) {
+        const DetectionRule &r = rules[i];
+        CompiledRule c{};
+        c.type = r.type;
+        c.ruleIndex = i;
+        c.low = r.low;
+        c.high = r.high;
+        c.dwellUs = static_cast<qint64>(r.dwellMs) * 1000;
+
+        switch (r.type) {
+        case DetectionRuleType::Threshold:
+            // 统一换算为 "sign * value > enterLevel" 的形式，省去方向分支
+            c.sign = r.below ? -1.0 : 1.0;
+            c.enterLevel = c.sign * r.threshold;
+            c.exitLevel = c.enterLevel - std::abs(r.hysteresis);
+            break;
+        case DetectionRuleType::Dwell:
+        case DetectionRuleType::BandExit:
+            if (c.low > c.high) std::swap(c.low, c.high);
+            c.enterLevel = std::abs(r.hysteresis);
+            c.exitLevel = std::abs(r.hysteresis);
+            break;
+        case DetectionRuleType::RateOfChange:
+            c.enterLevel = std::abs(r.rateLimit);
+            c.exitLevel = std::abs(r.rateLimit) - std::abs(r.hysteresis);
+            break;
+        }
+        table.push_back(c);
+    }
+
+    // 在锁内挂起，由求值线程在下一次求值前换入
+    QMutexLocker locker(&m_mutex);
+    m_publishedRules = rules;
+    m_pendingRules = rules;
+    m_pendingTable = std::move(table);
+    m_rulesPending = true;
+}
+
+QVector<DetectionRule> EventDetector::rules() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_publishedRules;
+}
+
+int EventDetector::ruleCount() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_publishedRules.size();
+}
+
+bool EventDetector::loadRules(const QString &filePath)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QJsonParseError parseError;
+    QJsonDocument doc = QJsonDocument::fromJson(file.readAll(), &parseError);
+    if (doc.isNull()) {
+        emit errorOccurred(QString("Rule file parse failed: %1").arg(parseError.errorString()));
+        return false;
+    }
+
+    QVector<DetectionRule> rules;
+    const QJsonArray array = doc.object().value("rules").toArray();
+    for (const QJsonValue &value : array) {
+        QJsonObject obj = value.toObject();
+        DetectionRule rule;
+        rule.id = obj.value("id").toInt(rules.size() + 1);
+        rule.name = obj.value("name").toString(QString("Rule %1").arg(rule.id));
+        rule.hysteresis = obj.value("hysteresis").toDouble();
+
+        QString type = obj.value("type").toString();
+        if (type == "threshold") {
+            rule.type = DetectionRuleType::Threshold;
+            rule.threshold = obj.value("threshold").toDouble();
+            rule.below = obj.value("direction").toString("below") != "above";
+        } else if (type == "dwell") {
+            rule.type = DetectionRuleType::Dwell;
+            rule.low = obj.value("low").toDouble();
+            rule.high = obj.value("high").toDouble();
+            rule.dwellMs = obj.value("dwellMs").toInt();
+        } else if (type == "rate") {
+            rule.type = DetectionRuleType::RateOfChange;
+            rule.rateLimit = obj.value("rate").toDouble();
+        } else if (type == "band") {
+            rule.type = DetectionRuleType::BandExit;
+            rule.low = obj.value("low").toDouble();
+            rule.high = obj.value("high").toDouble();
+        } else {
+            emit errorOccurred(QString("Unknown rule type: %1").arg(type));
+            continue;
+        }
+        rules.append(rule);
+    }
+
+    setRules(rules);
+    return true;
+}
+
+void EventDetector::reset()
+{
+    m_resetPending = true;
+}
+
+void EventDetector::applyPending()
+{
+    if (m_rulesPending.exchange(false)) {
+        QMutexLocker locker(&m_mutex);
+        m_rules = std::move(m_pendingRules);
+        m_table = std::move(m_pendingTable);
+        m_pendingRules.clear();
+        m_pendingTable.clear();
+        m_resetPending = true;
+        m_maxEvaluationNs = 0;
+    }
+    if (m_resetPending.exchange(false)) {
+        m_state.assign(m_table.size(), RuleState{false, false, 0, 0.0, 0});
+        m_lastTimestampUs = 0;
+    }
+}
+
+void EventDetector::processBlock(const SampleBlock &block)
+{
+    applyPending();
+    if (m_table.empty()) {
+        return;
+    }
+
+    // 同一时间戳的一段样本在上一时间点与本时间点之间均匀分布，
+    // 第一段没有上一时间点时退化为共用时间戳
+    const int count = block.size();
+    int i = 0;
+    while (i < count) {
+        const qint64 timestampUs = block.timestampsUs[i];
+        int end = i + 1;
+        while (end < count && block.timestampsUs[end] == timestampUs) {
+            ++end;
+        }
+        const int run = end - i;
+        const qint64 previousUs = m_lastTimestampUs;
+        const qint64 spanUs = previousUs > 0 && previousUs < timestampUs ? timestampUs - previousUs : 0;
+        for (int j = 0; j < run; ++j) {
+            qint64 sampleUs = timestampUs - spanUs + spanUs * (j + 1) / run;
+            evaluate(block.distanceAt(i + j), timestampUs, sampleUs);
+        }
+        m_lastTimestampUs = timestampUs;
+        i = end;
+    }
+}
+
+void EventDetector::processSample(double distance, qint64 timestampUs)
+{
+    applyPending();
+    if (m_table.empty()) {
+        return;
+    }
+    evaluate(distance, timestampUs, timestampUs);
+    m_lastTimestampUs = timestampUs;
+}
+
+void EventDetector::evaluate(double distance, qint64 timestampUs, qint64 sampleUs)
+{
+    const auto start = std::chrono::steady_clock::now();
+    const size_t count = m_table.size();
+
+    for (size_t i = 0; i < count; ++i) {
+        const CompiledRule &rule = m_table[i];
+        RuleState &state = m_state[i];
+
+        switch (rule.type) {
+        case DetectionRuleType::Threshold: {
+            double x = rule.sign * distance;
+            if (!state.active && x > rule.enterLevel) {
+                state.active = true;
+                emitEvent(rule, DetectionEventType::ThresholdEnter, timestampUs, distance);
+            } else if (state.active && x < rule.exitLevel) {
+                state.active = false;
+                emitEvent(rule, DetectionEventType::ThresholdExit, timestampUs, distance);
+            }
+            break;
+        }
+        case DetectionRuleType::Dwell: {
+            // 已触发后区间按迟滞放宽，避免边界抖动反复计时
+            double margin = state.active ? rule.exitLevel : 0.0;
+            bool inside = distance >= rule.low - margin && distance <= rule.high + margin;
+            if (!inside) {
+                state.primed = false;
+                state.active = false;
+            } else if (!state.primed) {
+                state.primed = true;
+                state.sinceUs = timestampUs;
+            } else if (!state.active && timestampUs - state.sinceUs >= rule.dwellUs) {
+                state.active = true;
+                emitEvent(rule, DetectionEventType::DwellReached, timestampUs, distance);
+            }
+            break;
+        }
+        case DetectionRuleType::RateOfChange: {
+            if (!state.primed) {
+                state.primed = true;
+                state.lastValue = distance;
+                state.lastUs = sampleUs;
+                break;
+            }
+            qint64 dt = sampleUs - state.lastUs;
+            if (dt <= 0) {
+                break;  // 仅在还没有上一时间点可供插值时出现
+            }
+            double rate = std::abs(distance - state.lastValue) * 1e6 / static_cast<double>(dt);
+            state.lastValue = distance;
+            state.lastUs = sampleUs;
+            if (!state.active && rate > rule.enterLevel) {
+                state.active = true;
+                emitEvent(rule, DetectionEventType::RateExceeded, timestampUs, rate);
+            } else if (state.active && rate < rule.exitLevel) {
+                state.active = false;
+            }
+            break;
+        }
+        case DetectionRuleType::BandExit: {
+            if (!state.active) {
+                if (distance < rule.low || distance > rule.high) {
+                    state.active = true;
+                    emitEvent(rule, DetectionEventType::BandExited, timestampUs, distance);
+                }
+            } else if (distance >= rule.low + rule.exitLevel && distance <= rule.high - rule.exitLevel) {
+                state.active = false;
+                emitEvent(rule, DetectionEventType::BandReentered, timestampUs, distance);
+            }
+            break;
+        }
+        }
+    }
+
+    qint64 elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    if (elapsed > m_maxEvaluationNs.load(std::memory_order_relaxed)) {
+        m_maxEvaluationNs.store(elapsed, std::memory_order_relaxed);
+    }
+}
+
+void EventDetector::emitEvent(const CompiledRule &rule, DetectionEventType type,
+                              qint64 timestampUs, double value)
+{
+    const DetectionRule &source = m_rules[rule.ruleIndex];
+
+    DetectionEvent event;
+    event.ruleId = source.id;
+    event.ruleName = source.name;
+    event.type = type;
+    event.timestampUs = timestampUs;
+    event.value = value;
+    event.latencyUs = wallClockUs() - timestampUs;
+    emit eventDetected(event);
+}
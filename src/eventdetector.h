@@ -0,0 +1,153 @@
+#ifndef EVENTDETECTOR_H
+#define EVENTDETECTOR_H
+
+#include <QObject>
+#include <QString>
+#include <QVector>
+#include <QMetaType>
+#include <QMutex>
+#include <atomic>
+#include <vector>
+
+#include "samplefixed.h"
+
+/**
+ * @brief 检测规则类型
+ */
+enum class DetectionRuleType {
+    Threshold,     // 阈值（带迟滞）
+    Dwell,         // 驻留：在区间内持续超过指定时长
+    RateOfChange,  // 变化率超限
+    BandExit       // 离开区间
+};
+
+/**
+ * @brief 检测事件类型
+ */
+enum class DetectionEventType {
+    ThresholdEnter,  // 越过阈值（进入区域）
+    ThresholdExit,   // 回到阈值另一侧（离开区域）
+    DwellReached,    // 驻留时间达到
+    RateExceeded,    // 变化率超限
+    BandExited,      // 离开区间
+    BandReentered    // 回到区间
+};
+
+/**
+ * @brief 检测规则配置（用户可读形式，编译后用于求值）
+ */
+struct DetectionRule {
+    int id = 0;
+    QString name;
+    DetectionRuleType type = DetectionRuleType::Threshold;
+
+    double threshold = 0.0;   // Threshold: 阈值 (cm)
+    bool below = true;        // Threshold: true 表示小于阈值触发（物体靠近）
+    double low = 0.0;         // Dwell/BandExit: 区间下限 (cm)
+    double high = 0.0;        // Dwell/BandExit: 区间上限 (cm)
+    double rateLimit = 0.0;   // RateOfChange: 变化率上限 (cm/s)
+    double hysteresis = 0.0;  // 迟滞量（单位同对应参数）
+    int dwellMs = 0;          // Dwell: 驻留时长 (ms)
+};
+
+/**
+ * @brief 检测事件，时间戳精确到样本接收时刻
+ */
+struct DetectionEvent {
+    int ruleId = 0;
+    QString ruleName;
+    DetectionEventType type = DetectionEventType::ThresholdEnter;
+    qint64 timestampUs = 0;   // 触发样本的时间戳 (µs since epoch)
+    double value = 0.0;       // 触发时的距离值或变化率
+    qint64 latencyUs = 0;     // 样本接收到事件产生的延迟
+
+    static QString typeName(DetectionEventType type);
+};
+
+Q_DECLARE_METATYPE(DetectionEvent)
+
+/**
+ * @brief 事件检测引擎，在采集线程上对每个样本求值
+ *
+ * 规则在 setRules() 时编译为扁平的求值表，processSample() 只做一次顺序遍历，
+ * 不分配内存、不访问数据库。processBlock() 按块内顺序逐个求值。
+ *
+ * setRules()/loadRules()/reset() 可在任意线程调用：新规则表在锁内挂起，
+ * 采集线程在下一次求值前换入并清空运行状态，求值过程不持锁。
+ * 同一次读取的样本共用一个接收时间戳，变化率按上一时间点到本时间点之间
+ * 均匀插值的样本时刻计算；事件时间戳仍为接收时刻。
+ */
+class EventDetector : public QObject {
+    Q_OBJECT
+
+public:
+    explicit EventDetector(QObject *parent = nullptr);
+    ~EventDetector();
+
+    // 规则配置
+    void setRules(const QVector<DetectionRule> &rules);
+    bool loadRules(const QString &filePath);
+    QVector<DetectionRule> rules() const;
+    int ruleCount() const;
+
+    // 清除所有规则的运行状态（例如重新连接后）
+    void reset();
+
+    // 检测延迟统计 (ns)
+    qint64 maxEvaluationNs() const { return m_maxEvaluationNs.load(); }
+
+    void processSample(double distance, qint64 timestampUs);
+
+public slots:
+    void processBlock(const SampleBlock &block);
+
+signals:
+    void eventDetected(const DetectionEvent &event);
+    void errorOccurred(const QString &error);
+
+private:
+    // 编译后的规则：参数已换算为求值所需的形式
+    struct CompiledRule {
+        DetectionRuleType type;
+        double enterLevel;   // 触发边界
+        double exitLevel;    // 复位边界（含迟滞）
+        double low;
+        double high;
+        double sign;         // Threshold: below 为 -1，above 为 1
+        qint64 dwellUs;
+        int ruleIndex;
+    };
+
+    // 每条规则的运行状态，与 m_table 一一对应
+    struct RuleState {
+        bool active;
+        bool primed;
+        qint64 sinceUs;
+        double lastValue;
+        qint64 lastUs;
+    };
+
+    // 采集线程：换入挂起的规则表或执行挂起的复位
+    void applyPending();
+    // sampleUs 为插值后的样本时刻，仅用于变化率
+    void evaluate(double distance, qint64 timestampUs, qint64 sampleUs);
+    void emitEvent(const CompiledRule &rule, DetectionEventType type,
+                   qint64 timestampUs, double value);
+
+    // 由 m_mutex 保护，供任意线程发布和读取
+    mutable QMutex m_mutex;
+    QVector<DetectionRule> m_publishedRules;
+    QVector<DetectionRule> m_pendingRules;
+    std::vector<CompiledRule> m_pendingTable;
+    std::atomic<bool> m_rulesPending;
+    std::atomic<bool> m_resetPending;
+
+    // 仅在求值线程访问
+    QVector<DetectionRule> m_rules;
+    std::vector<CompiledRule> m_table;
+    std::vector<RuleState> m_state;
+    qint64 m_lastTimestampUs;  // 上一个不同的接收时间戳，用于块内插值
+    std::atomic<qint64> m_maxEvaluationNs;
+};
+
+#endif // EVENTDETECTOR_H
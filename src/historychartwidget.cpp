@@ -0,0 +1,366 @@
+#include "historychartwidget.h"
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QPushButton>
+#include <QWheelEvent>
+#include <QMouseEvent>
+#include <QResizeEvent>
+#include <QDateTime>
+#include <limits>
+
+// 每个分块包含的桶数
+static const int kTileBuckets = 256;
+// 缓存分块上限
+static const int kMaxCachedTiles = 512;
+
+// 桶宽阶梯：分钟/小时档均为汇总层宽度的整数倍，保证可以直接使用汇总表
+static const qint64 kBucketLadderMs[] = {
+    10, 20, 50, 100, 200, 500,
+    1000, 2000, 5000, 10000, 15000, 30000,
+    60000, 120000, 300000, 600000, 900000, 1800000,
+    3600000, 7200000, 10800000, 21600000, 43200000,
+    86400000, 172800000, 604800000, 1209600000, 2592000000LL
+};
+
+static const qint64 kMinSpanMs = 1000;
+static const qint64 kMaxSpanMs = 20LL * 365 * 86400000;
+
+HistoryChartWidget::HistoryChartWidget(const QString &dbPath, QWidget *parent)
+    : QWidget(parent)
+    , m_chartView(new QChartView(this))
+    , m_chart(new QChart())
+    , m_series(new QLineSeries())
+    , m_axisX(new QDateTimeAxis())
+    , m_axisY(new QValueAxis())
+    , m_loaderThread(new QThread(this))
+    , m_loader(new HistoryLoader(dbPath))
+    , m_refreshTimer(new QTimer(this))
+    , m_tileGeneration(0)
+    , m_viewStartMs(0)
+    , m_viewEndMs(0)
+    , m_firstMs(0)
+    , m_lastMs(0)
+    , m_isDragging(false)
+    , m_dragStartMs(0)
+{
+    qRegisterMetaType<QVector<HistoryBucket>>("QVector<HistoryBucket>");
+
+    setWindowTitle("History");
+    setupChart();
+
+    QPushButton *lastHourButton = new QPushButton("1 h");
+    QPushButton *lastDayButton = new QPushButton("1 d");
+    QPushButton *lastWeekButton = new QPushButton("7 d");
+    QPushButton *lastMonthButton = new QPushButton("30 d");
+    QPushButton *allButton = new QPushButton("All");
+    QPushButton *reloadButton = new QPushButton("Reload");
+
+    connect(lastHourButton, &QPushButton::clicked, this, [this]() { showLast(3600000LL); });
+    connect(lastDayButton, &QPushButton::clicked, this, [this]() { showLast(86400000LL); });
+    connect(lastWeekButton, &QPushButton::clicked, this, [this]() { showLast(7 * 86400000LL); });
+    connect(lastMonthButton, &QPushButton::clicked, this, [this]() { showLast(30 * 86400000LL); });
+    connect(allButton, &QPushButton::clicked, this, &HistoryChartWidget::showAll);
+    connect(reloadButton, &QPushButton::clicked, this, &HistoryChartWidget::reload);
+
+    QHBoxLayout *controlLayout = new QHBoxLayout();
+    controlLayout->addWidget(lastHourButton);
+    controlLayout->addWidget(lastDayButton);
+    controlLayout->addWidget(lastWeekButton);
+    controlLayout->addWidget(lastMonthButton);
+    controlLayout->addWidget(allButton);
+    controlLayout->addStretch();
+    controlLayout->addWidget(reloadButton);
+
+    QVBoxLayout *layout = new QVBoxLayout(this);
+    layout->addLayout(controlLayout);
+    layout->addWidget(m_chartView, 1);
+    setLayout(layout);
+    resize(1000, 500);
+
+    // 鼠标滚轮缩放、拖动平移
+    m_chartView->viewport()->installEventFilter(this);
+
+    m_refreshTimer->setSingleShot(true);
+    connect(m_refreshTimer, &QTimer::timeout, this, &HistoryChartWidget::refresh);
+
+    // 后台加载线程
+    m_loader->moveToThread(m_loaderThread);
+    connect(m_loaderThread, &QThread::started, m_loader, &HistoryLoader::open);
+    connect(m_loaderThread, &QThread::finished, m_loader, &QObject::deleteLater);
+    connect(this, &HistoryChartWidget::tileRequested, m_loader, &HistoryLoader::loadTile);
+    connect(this, &HistoryChartWidget::boundsRequested, m_loader, &HistoryLoader::loadBounds);
+    connect(m_loader, &HistoryLoader::tileLoaded, this, &HistoryChartWidget::onTileLoaded);
+    connect(m_loader, &HistoryLoader::boundsLoaded, this, &HistoryChartWidget::onBoundsLoaded);
+    connect(m_loader, &HistoryLoader::errorOccurred, this, &HistoryChartWidget::errorOccurred);
+    m_loaderThread->start();
+
+    qint64 nowMs = DataManager::toStorageMs(QDateTime::currentDateTime());
+    showRange(nowMs - 3600000LL, nowMs);
+    emit boundsRequested();
+}
+
+HistoryChartWidget::~HistoryChartWidget()
+{
+    m_loaderThread->quit();
+    m_loaderThread->wait();
+}
+
+void HistoryChartWidget::setupChart()
+{
+    QPen pen(QColor(0, 120, 215));
+    pen.setWidth(1);
+    m_series->setPen(pen);
+    m_series->setName("Distance (min/max)");
+
+    m_chart->addSeries(m_series);
+    m_chart->setTitle("Distance History");
+    m_chart->legend()->setVisible(false);
+
+    m_axisX->setTitleText("Time");
+    m_axisX->setFormat("MM-dd hh:mm:ss");
+    m_axisX->setTickCount(7);
+    m_chart->addAxis(m_axisX, Qt::AlignBottom);
+    m_series->attachAxis(m_axisX);
+
+    m_axisY->setTitleText("Distance (cm)");
+    m_axisY->setLabelFormat("%.1f");
+    m_axisY->setRange(0, 400);
+    m_chart->addAxis(m_axisY, Qt::AlignLeft);
+    m_series->attachAxis(m_axisY);
+
+    m_chartView->setChart(m_chart);
+    m_chartView->setRenderHint(QPainter::Antialiasing, false);
+}
+
+void HistoryChartWidget::showRange(qint64 startMs, qint64 endMs)
+{
+    qint64 span = qBound(kMinSpanMs, endMs - startMs, kMaxSpanMs);
+    m_viewStartMs = startMs;
+    m_viewEndMs = startMs + span;
+    scheduleRefresh();
+}
+
+void HistoryChartWidget::showLast(qint64 spanMs)
+{
+    qint64 nowMs = DataManager::toStorageMs(QDateTime::currentDateTime());
+    qint64 endMs = qMax(nowMs, m_lastMs);
+    showRange(endMs - spanMs, endMs);
+}
+
+void HistoryChartWidget::showAll()
+{
+    if (m_lastMs > m_firstMs) {
+        qint64 margin = (m_lastMs - m_firstMs) / 50;
+        showRange(m_firstMs - margin, m_lastMs + margin);
+    }
+}
+
+void HistoryChartWidget::reload()
+{
+    // 新数据只会落在末尾附近，但删除可能影响任意位置，因此整体失效
+    m_tileCache.clear();
+    m_tileOrder.clear();
+    m_pendingTiles.clear();
+    ++m_tileGeneration;
+    emit boundsRequested();
+    scheduleRefresh();
+}
+
+void HistoryChartWidget::onBoundsLoaded(qint64 firstMs, qint64 lastMs)
+{
+    m_firstMs = firstMs;
+    m_lastMs = lastMs;
+    scheduleRefresh();
+}
+
+void HistoryChartWidget::onTileLoaded(int generation, qint64 bucketMs, qint64 tileIndex,
+                                      const QVector<HistoryBucket> &buckets)
+{
+    // 失效前请求的分块按旧数据查询，不入缓存；同一分块已按新一代重新请求
+    if (generation != m_tileGeneration) {
+        return;
+    }
+    TileKey key(bucketMs, tileIndex);
+    m_pendingTiles.remove(key);
+    m_tileCache.insert(key, buckets);
+    touchTile(key);
+
+    while (m_tileOrder.size() > kMaxCachedTiles) {
+        m_tileCache.remove(m_tileOrder.takeFirst());
+    }
+
+    // 只有当前视图内的分块才需要重绘
+    qint64 tileSpan = bucketMs * kTileBuckets;
+    if (bucketMs == currentBucketMs()
+        && tileIndex * tileSpan < m_viewEndMs && (tileIndex + 1) * tileSpan > m_viewStartMs) {
+        scheduleRefresh();
+    }
+}
+
+void HistoryChartWidget::refresh()
+{
+    const qint64 bucketMs = currentBucketMs();
+    const qint64 tileSpan = bucketMs * kTileBuckets;
+    const qint64 firstTile = m_viewStartMs / tileSpan;
+    const qint64 lastTile = (m_viewEndMs - 1) / tileSpan;
+
+    // QDateTimeAxis 使用 UTC 毫秒，视图内统一使用起点的本地时区偏移
+    const qint64 offset = DataManager::fromStorageMs(m_viewStartMs).toMSecsSinceEpoch() - m_viewStartMs;
+
+    QVector<QPointF> points;
+    points.reserve(static_cast<int>((lastTile - firstTile + 1) * kTileBuckets * 2));
+    double yMin = std::numeric_limits<double>::max();
+    double yMax = std::numeric_limits<double>::lowest();
+
+    for (qint64 tile = firstTile; tile <= lastTile; ++tile) {
+        TileKey key(bucketMs, tile);
+        auto it = m_tileCache.constFind(key);
+        if (it == m_tileCache.constEnd()) {
+            requestTile(key);
+            continue;
+        }
+        touchTile(key);
+
+        for (const HistoryBucket &bucket : it.value()) {
+            if (bucket.startMs + bucketMs <= m_viewStartMs || bucket.startMs >= m_viewEndMs) {
+                continue;
+            }
+            // 每桶画一条竖线，保留桶内极值
+            qreal x = static_cast<qreal>(bucket.startMs + offset + bucketMs / 2);
+            points.append(QPointF(x, bucket.minDistance));
+            points.append(QPointF(x, bucket.maxDistance));
+            yMin = qMin(yMin, static_cast<double>(bucket.minDistance));
+            yMax = qMax(yMax, static_cast<double>(bucket.maxDistance));
+        }
+    }
+
+    // 预取左右各一屏的相邻分块
+    const qint64 visibleTiles = lastTile - firstTile + 1;
+    for (qint64 i = 1; i <= visibleTiles; ++i) {
+        if (m_lastMs == 0 || (firstTile - i + 1) * tileSpan > m_firstMs) {
+            requestTile(TileKey(bucketMs, firstTile - i));
+        }
+        if (m_lastMs == 0 || (lastTile + i) * tileSpan <= m_lastMs) {
+            requestTile(TileKey(bucketMs, lastTile + i));
+        }
+    }
+
+    m_series->replace(points);
+
+    qint64 span = m_viewEndMs - m_viewStartMs;
+    if (span > 2 * 86400000LL) {
+        m_axisX->setFormat("yyyy-MM-dd hh:mm");
+    } else if (span > 60000) {
+        m_axisX->setFormat("MM-dd hh:mm:ss");
+    } else {
+        m_axisX->setFormat("hh:mm:ss.zzz");
+    }
+    m_axisX->setRange(QDateTime::fromMSecsSinceEpoch(m_viewStartMs + offset),
+                      QDateTime::fromMSecsSinceEpoch(m_viewEndMs + offset));
+
+    if (yMin <= yMax) {
+        double margin = qMax(1.0, (yMax - yMin) * 0.05);
+        m_axisY->setRange(qMax(0.0, yMin - margin), yMax + margin);
+    }
+}
+
+qint64 HistoryChartWidget::currentBucketMs() const
+{
+    qreal plotWidth = m_chart->plotArea().width();
+    if (plotWidth < 1.0) {
+        plotWidth = qMax(1, width());
+    }
+
+    // 每个像素列一个桶
+    qint64 desired = static_cast<qint64>((m_viewEndMs - m_viewStartMs) / plotWidth);
+    for (qint64 bucketMs : kBucketLadderMs) {
+        if (bucketMs >= desired) {
+            return bucketMs;
+        }
+    }
+    return kBucketLadderMs[sizeof(kBucketLadderMs) / sizeof(kBucketLadderMs[0]) - 1];
+}
+
+void HistoryChartWidget::requestTile(const TileKey &key)
+{
+    if (key.second < 0 || m_tileCache.contains(key) || m_pendingTiles.contains(key)) {
+        return;
+    }
+    m_pendingTiles.insert(key);
+    emit tileRequested(m_tileGeneration, key.first, key.second, kTileBuckets);
+}
+
+void HistoryChartWidget::touchTile(const TileKey &key)
+{
+    m_tileOrder.removeOne(key);
+    m_tileOrder.append(key);
+}
+
+void HistoryChartWidget::scheduleRefresh()
+{
+    if (!m_refreshTimer->isActive()) {
+        m_refreshTimer->start(0);
+    }
+}
+
+bool HistoryChartWidget::eventFilter(QObject *watched, QEvent *event)
+{
+    if (watched != m_chartView->viewport()) {
+        return QWidget::eventFilter(watched, event);
+    }
+
+    const QRectF plot = m_chart->plotArea();
+    const qint64 span = m_viewEndMs - m_viewStartMs;
+
+    switch (event->type()) {
+    case QEvent::Wheel: {
+        QWheelEvent *wheelEvent = static_cast<QWheelEvent *>(event);
+        if (plot.width() < 1.0 || wheelEvent->angleDelta().y() == 0) {
+            return true;
+        }
+        // 以鼠标所在时刻为中心缩放
+        double fraction = qBound(0.0, (wheelEvent->position().x() - plot.left()) / plot.width(), 1.0);
+        double factor = wheelEvent->angleDelta().y() > 0 ? 0.8 : 1.25;
+        qint64 center = m_viewStartMs + static_cast<qint64>(fraction * span);
+        qint64 newSpan = qBound(kMinSpanMs, static_cast<qint64>(span * factor), kMaxSpanMs);
+        qint64 newStart = center - static_cast<qint64>(fraction * newSpan);
+        showRange(newStart, newStart + newSpan);
+        return true;
+    }
+    case QEvent::MouseButtonPress: {
+        QMouseEvent *mouseEvent = static_cast<QMouseEvent *>(event);
+        if (mouseEvent->button() == Qt::LeftButton) {
+            m_isDragging = true;
+            m_dragOrigin = mouseEvent->position().toPoint();
+            m_dragStartMs = m_viewStartMs;
+            return true;
+        }
+        break;
+    }
+    case QEvent::MouseMove: {
+        QMouseEvent *mouseEvent = static_cast<QMouseEvent *>(event);
+        if (m_isDragging && plot.width() >= 1.0) {
+            int dx = mouseEvent->position().toPoint().x() - m_dragOrigin.x();
+            qint64 shift = static_cast<qint64>(-dx / plot.width() * span);
+            showRange(m_dragStartMs + shift, m_dragStartMs + shift + span);
+            return true;
+        }
+        break;
+    }
+    case QEvent::MouseButtonRelease:
+        m_isDragging = false;
+        break;
+    case QEvent::MouseButtonDblClick:
+        showAll();
+        return true;
+    default:
+        break;
+    }
+    return QWidget::eventFilter(watched, event);
+}
+
+void HistoryChartWidget::resizeEvent(QResizeEvent *event)
+{
+    QWidget::resizeEvent(event);
+    scheduleRefresh();
+}
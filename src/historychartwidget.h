@@ -0,0 +1,89 @@
+#ifndef HISTORYCHARTWIDGET_H
+#define HISTORYCHARTWIDGET_H
+
+#include <QWidget>
+#include <QtCharts/QChartView>
+#include <QtCharts/QChart>
+#include <QtCharts/QLineSeries>
+#include <QtCharts/QValueAxis>
+#include <QtCharts/QDateTimeAxis>
+#include <QHash>
+#include <QSet>
+#include <QList>
+#include <QPair>
+#include <QPoint>
+#include <QThread>
+#include <QTimer>
+
+#include "historyloader.h"
+
+/**
+ * @brief 历史波形视图，实时间轴，支持缩放/平移整个数据库
+ *
+ * 视图按像素宽度选择桶宽，数据以固定桶数的分块（tile）从后台线程加载并缓存，
+ * 同时预取相邻分块，平移时大多直接命中缓存。
+ */
+class HistoryChartWidget : public QWidget {
+    Q_OBJECT
+
+public:
+    explicit HistoryChartWidget(const QString &dbPath, QWidget *parent = nullptr);
+    ~HistoryChartWidget();
+
+    // 显示指定时间范围（存储毫秒，见 DataManager::toStorageMs）
+    void showRange(qint64 startMs, qint64 endMs);
+
+public slots:
+    void showLast(qint64 spanMs);
+    void showAll();
+    void reload();
+
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+
+private slots:
+    void onBoundsLoaded(qint64 firstMs, qint64 lastMs);
+    void onTileLoaded(int generation, qint64 bucketMs, qint64 tileIndex, const QVector<HistoryBucket> &buckets);
+    void refresh();
+
+signals:
+    void tileRequested(int generation, qint64 bucketMs, qint64 tileIndex, int tileBuckets);
+    void boundsRequested();
+    void errorOccurred(const QString &error);
+
+private:
+    typedef QPair<qint64, qint64> TileKey;  // (桶宽, 分块序号)
+
+    QChartView *m_chartView;
+    QChart *m_chart;
+    QLineSeries *m_series;
+    QDateTimeAxis *m_axisX;
+    QValueAxis *m_axisY;
+
+    QThread *m_loaderThread;
+    HistoryLoader *m_loader;
+    QTimer *m_refreshTimer;
+
+    QHash<TileKey, QVector<HistoryBucket>> m_tileCache;
+    QList<TileKey> m_tileOrder;   // LRU 顺序，最近使用的在末尾
+    QSet<TileKey> m_pendingTiles;
+    int m_tileGeneration;         // reload() 时递增，之前请求的分块到达后丢弃
+
+    qint64 m_viewStartMs;
+    qint64 m_viewEndMs;
+    qint64 m_firstMs;
+    qint64 m_lastMs;
+
+    bool m_isDragging;
+    QPoint m_dragOrigin;
+    qint64 m_dragStartMs;
+
+    void setupChart();
+    qint64 currentBucketMs() const;
+    void requestTile(const TileKey &key);
+    void touchTile(const TileKey &key);
+    void scheduleRefresh();
+};
+
+#endif // HISTORYCHARTWIDGET_H
@@ -0,0 +1,52 @@
+#include "historyloader.h"
+
+HistoryLoader::HistoryLoader(const QString &dbPath, QObject *parent)
+    : QObject(parent)
+    , m_dbPath(dbPath)
+    , m_dataManager(nullptr)
+{
+}
+
+HistoryLoader::~HistoryLoader()
+{
+}
+
+void HistoryLoader::open()
+{
+    if (m_dataManager) {
+        return;
+    }
+
+    // 数据库连接必须在使用它的线程中创建
+    m_dataManager = new DataManager(this);
+    connect(m_dataManager, &DataManager::errorOccurred, this, &HistoryLoader::errorOccurred);
+    if (!m_dataManager->initialize(m_dbPath, "history_loader")) {
+        delete m_dataManager;
+        m_dataManager = nullptr;
+        return;
+    }
+    m_dataManager->ensureRollups();
+}
+
+void HistoryLoader::loadBounds()
+{
+    // 打开失败后在下一次读取范围（打开视图或 Reload）时重试
+    open();
+    qint64 firstMs = 0;
+    qint64 lastMs = 0;
+    if (m_dataManager && m_dataManager->queryTimeBounds(firstMs, lastMs)) {
+        emit boundsLoaded(firstMs, lastMs);
+    }
+}
+
+void HistoryLoader::loadTile(int generation, qint64 bucketMs, qint64 tileIndex, int tileBuckets)
+{
+    if (!m_dataManager) {
+        return;
+    }
+
+    qint64 tileSpan = bucketMs * tileBuckets;
+    qint64 startMs = tileIndex * tileSpan;
+    emit tileLoaded(generation, bucketMs, tileIndex,
+                    m_dataManager->queryDownsampled(startMs, startMs + tileSpan, bucketMs));
+}
@@ -0,0 +1,35 @@
+#ifndef HISTORYLOADER_H
+#define HISTORYLOADER_H
+
+#include <QObject>
+#include <QVector>
+
+#include "datamanager.h"
+
+/**
+ * @brief 历史数据加载器，运行在工作线程上，使用独立的数据库连接
+ */
+class HistoryLoader : public QObject {
+    Q_OBJECT
+
+public:
+    explicit HistoryLoader(const QString &dbPath, QObject *parent = nullptr);
+    ~HistoryLoader();
+
+public slots:
+    void open();
+    void loadBounds();
+    // generation 原样带回 tileLoaded，请求方据此丢弃失效前发出的请求的结果
+    void loadTile(int generation, qint64 bucketMs, qint64 tileIndex, int tileBuckets);
+
+signals:
+    void boundsLoaded(qint64 firstMs, qint64 lastMs);
+    void tileLoaded(int generation, qint64 bucketMs, qint64 tileIndex, const QVector<HistoryBucket> &buckets);
+    void errorOccurred(const QString &error);
+
+private:
+    QString m_dbPath;
+    DataManager *m_dataManager;
+};
+
+#endif // HISTORYLOADER_H
@@ -0,0 +1,245 @@
+#ifndef LIVESEGMENT_H
+#define LIVESEGMENT_H
+
+/*
+ * 实时样本共享内存段：布局定义与只读访问库（C/C++ 通用，仅头文件，POSIX）
+ *
+ * 上位机把采集到的样本写入一个命名 POSIX 共享内存段（默认 /ultrasonic_live），
+ * 同机的其他进程（PLC 网桥、记录程序等）映射后直接读取，热路径上没有系统调用和锁。
+ *
+ * 段由一个头部和 capacity 个定长槽位组成，样本序号从 0 开始，序号 s 存放在槽位 s & (capacity - 1)。
+ * 头部的 claimed/published 两个计数构成序列锁：
+ * - 写入方先把 claimed 推进到本批末尾，再写槽位，最后把 published 推进到同一位置；
+ * - 读取方先读 published，复制槽位，再读 claimed；序号小于 claimed - capacity 的槽位可能在复制期间被覆盖，丢弃。
+ * 读取方保留自己的游标，返回值中的 lost 表示游标与最早有效样本之间被覆盖的样本数，用于发现缺口。
+ *
+ * 写入方正常退出时置 closed；崩溃时来不及置位，读取方应定期（如空闲一秒）调用 live_segment_stale()，
+ * 它检查写入进程是否还在、同名段是否已被新实例替换。同一段名同时只允许一个写入方（见 live_segment_lock_path）。
+ *
+ * 用法：
+ *     live_segment_reader reader;
+ *     if (live_segment_open(&reader, LIVE_SEGMENT_DEFAULT_NAME) == 0) {
+ *         uint64_t cursor = live_segment_published(&reader);
+ *         live_segment_slot samples[256];
+ *         uint64_t lost;
+ *         size_t n = live_segment_read(&reader, &cursor, samples, 256, &lost);
+ *         ...
+ *         live_segment_close(&reader);
+ *     }
+ *
+ * 数值为定点整数，单位 10^-fraction_digits cm（见 samplefixed.h）。
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define LIVE_SEGMENT_SUPPORTED 1
+#else
+#define LIVE_SEGMENT_SUPPORTED 0
+#endif
+
+#define LIVE_SEGMENT_DEFAULT_NAME "/ultrasonic_live"
+#define LIVE_SEGMENT_MAGIC 0x45534C55u   /* "ULSE" */
+#define LIVE_SEGMENT_VERSION 1u
+
+/* 头部各计数分占独立缓存行，写入方推进计数时不会使只读字段所在行失效 */
+typedef struct live_segment_header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t capacity;          /* 槽位数，2 的幂 */
+    int32_t fraction_digits;    /* 定点小数位数 */
+    int64_t writer_pid;
+    int64_t created_us;         /* 创建时间，写入方重启后改变 */
+    uint32_t closed;            /* 写入方正常退出时置 1 */
+    uint8_t reserved0[28];
+
+    uint64_t claimed;           /* 写入方即将写到的序号（含正在写入的部分） */
+    uint8_t reserved1[56];
+
+    uint64_t published;         /* 已完整写入的序号 */
+    uint8_t reserved2[56];
+} live_segment_header;
+
+typedef struct live_segment_slot {
+    int64_t timestamp_us;       /* 主机时间（UTC 微秒） */
+    int32_t value;              /* 定点距离值 */
+    uint32_t reserved;
+} live_segment_slot;
+
+#ifdef __cplusplus
+static_assert(sizeof(live_segment_header) == 192, "live_segment_header layout changed");
+static_assert(sizeof(live_segment_slot) == 16, "live_segment_slot layout changed");
+#endif
+
+static inline size_t live_segment_size(uint32_t capacity)
+{
+    return sizeof(live_segment_header) + (size_t)capacity * sizeof(live_segment_slot);
+}
+
+/* 写入方互斥用的锁文件路径：/tmp 下以段名（去掉开头的 '/'）命名，写入方对其持有 flock */
+static inline void live_segment_lock_path(const char *name, char *path, size_t size)
+{
+    snprintf(path, size, "/tmp/%s.lock", name[0] == '/' ? name + 1 : name);
+}
+
+#if LIVE_SEGMENT_SUPPORTED
+
+typedef struct live_segment_reader {
+    const live_segment_header *header;
+    const live_segment_slot *slots;
+    size_t size;
+    uint64_t mask;
+} live_segment_reader;
+
+/* 映射共享内存段（只读），成功返回 0；段不存在或格式不符返回 -1 */
+static inline int live_segment_open(live_segment_reader *reader, const char *name)
+{
+    memset(reader, 0, sizeof(*reader));
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0) {
+        return -1;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(live_segment_header)) {
+        close(fd);
+        return -1;
+    }
+
+    void *base = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        return -1;
+    }
+
+    const live_segment_header *header = (const live_segment_header *)base;
+    uint32_t capacity = header->capacity;
+    if (header->magic != LIVE_SEGMENT_MAGIC || header->version != LIVE_SEGMENT_VERSION
+        || capacity == 0 || (capacity & (capacity - 1)) != 0
+        || live_segment_size(capacity) > (size_t)info.st_size) {
+        munmap(base, (size_t)info.st_size);
+        return -1;
+    }
+
+    reader->header = header;
+    reader->slots = (const live_segment_slot *)(header + 1);
+    reader->size = (size_t)info.st_size;
+    reader->mask = capacity - 1;
+    return 0;
+}
+
+static inline void live_segment_close(live_segment_reader *reader)
+{
+    if (reader->header) {
+        munmap((void *)reader->header, reader->size);
+    }
+    memset(reader, 0, sizeof(*reader));
+}
+
+/*
+ * 写入方是否已不再更新本段：正常关闭、写入进程已不存在，或 name 已指向另一个段（写入方重启，
+ * 旧段已删除）。调用 kill 与 shm_open，不适合放在热路径上，读取方空闲时定期调用即可。
+ */
+static inline int live_segment_stale(const live_segment_reader *reader, const char *name)
+{
+    if (__atomic_load_n(&reader->header->closed, __ATOMIC_ACQUIRE) != 0) {
+        return 1;
+    }
+    if (kill((pid_t)reader->header->writer_pid, 0) != 0 && errno == ESRCH) {
+        return 1;
+    }
+
+    /* 进程号可能已被复用：再比较当前同名段的创建时间 */
+    live_segment_reader current;
+    if (live_segment_open(&current, name) != 0) {
+        return 1;
+    }
+    int replaced = current.header->created_us != reader->header->created_us
+                   || current.header->writer_pid != reader->header->writer_pid;
+    munmap((void *)current.header, current.size);
+    return replaced;
+}
+
+/* 已发布的样本总数，即下一个样本的序号 */
+static inline uint64_t live_segment_published(const live_segment_reader *reader)
+{
+    return __atomic_load_n(&reader->header->published, __ATOMIC_ACQUIRE);
+}
+
+/* 写入方已退出：不会再有新样本，需要重新打开以连接新的写入方 */
+static inline int live_segment_closed(const live_segment_reader *reader)
+{
+    return __atomic_load_n(&reader->header->closed, __ATOMIC_ACQUIRE) != 0;
+}
+
+/*
+ * 从 *cursor 开始读取最多 max 个样本到 out，返回读到的个数并推进 *cursor。
+ * 游标之后已被覆盖的样本跳过，个数写入 *lost（可为 NULL）。不等待、不调用系统调用。
+ */
+static inline size_t live_segment_read(const live_segment_reader *reader, uint64_t *cursor,
+                                       live_segment_slot *out, size_t max, uint64_t *lost)
+{
+    const uint64_t capacity = reader->mask + 1;
+    uint64_t start = *cursor;
+    uint64_t skipped = 0;
+
+    uint64_t published = __atomic_load_n(&reader->header->published, __ATOMIC_ACQUIRE);
+    if (published > capacity && start < published - capacity) {
+        skipped = published - capacity - start;
+        start = published - capacity;
+    }
+
+    size_t count = 0;
+    if (published > start) {
+        count = (size_t)(published - start < max ? published - start : max);
+    }
+    for (size_t i = 0; i < count; ++i) {
+        out[i] = reader->slots[(start + i) & reader->mask];
+    }
+
+    /* 复制期间写入方可能已覆盖前段，丢弃这部分 */
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    uint64_t claimed = __atomic_load_n(&reader->header->claimed, __ATOMIC_RELAXED);
+    if (claimed > capacity && claimed - capacity > start) {
+        uint64_t overwritten = claimed - capacity - start;
+        if (overwritten > count) {
+            overwritten = count;
+        }
+        memmove(out, out + overwritten, (size_t)(count - overwritten) * sizeof(live_segment_slot));
+        count -= (size_t)overwritten;
+        start += overwritten;
+        skipped += overwritten;
+    }
+
+    *cursor = start + count;
+    if (lost) {
+        *lost = skipped;
+    }
+    return count;
+}
+
+/* 读取最近 n 个样本（按时间顺序），*end 返回最后一个样本之后的序号，可作为后续 live_segment_read 的游标 */
+static inline size_t live_segment_latest(const live_segment_reader *reader, live_segment_slot *out,
+                                         size_t n, uint64_t *end)
+{
+    uint64_t published = live_segment_published(reader);
+    uint64_t cursor = published > n ? published - n : 0;
+    size_t count = live_segment_read(reader, &cursor, out, n, NULL);
+    if (end) {
+        *end = cursor;
+    }
+    return count;
+}
+
+#endif /* LIVE_SEGMENT_SUPPORTED */
+
+#endif /* LIVESEGMENT_H */
@@ -0,0 +1,154 @@
+#include "livesegmentwriter.h"
+#include <QCoreApplication>
+#include <QDateTime>
+#include <cerrno>
+#include <cstring>
+#if LIVE_SEGMENT_SUPPORTED
+#include <sys/file.h>
+#endif
+
+LiveSegmentWriter::LiveSegmentWriter()
+    : m_header(nullptr)
+    , m_slots(nullptr)
+    , m_size(0)
+    , m_mask(0)
+    , m_lockFd(-1)
+{
+}
+
+LiveSegmentWriter::~LiveSegmentWriter()
+{
+    close();
+}
+
+bool LiveSegmentWriter::open(const QString &name, int capacity)
+{
+    close();
+    m_name = name;
+
+#if LIVE_SEGMENT_SUPPORTED
+    quint32 slots = 1024;
+    while (slots < static_cast<quint32>(capacity)) {
+        slots <<= 1;
+    }
+    size_t size = live_segment_size(slots);
+    QByteArray path = name.toLocal8Bit();
+
+    // 锁文件的 flock 在进程退出（含崩溃）时由内核释放，持有期间其他实例不能替换本段
+    char lockPath[256];
+    live_segment_lock_path(path.constData(), lockPath, sizeof(lockPath));
+    m_lockFd = ::open(lockPath, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (m_lockFd < 0) {
+        m_error = QString("open %1: %2").arg(QString::fromLocal8Bit(lockPath),
+                                             QString::fromLocal8Bit(std::strerror(errno)));
+        return false;
+    }
+    if (flock(m_lockFd, LOCK_EX | LOCK_NB) != 0) {
+        m_error = errno == EWOULDBLOCK
+                      ? QString("%1 is in use by another instance").arg(name)
+                      : QString("flock %1: %2").arg(QString::fromLocal8Bit(lockPath),
+                                                    QString::fromLocal8Bit(std::strerror(errno)));
+        ::close(m_lockFd);
+        m_lockFd = -1;
+        return false;
+    }
+
+    // 先删除旧段再新建：仍映射旧段的读取方不受影响，看到 closed 或 live_segment_stale() 后重新打开即可
+    shm_unlink(path.constData());
+    int fd = shm_open(path.constData(), O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (fd < 0) {
+        m_error = QString("shm_open %1: %2").arg(name, QString::fromLocal8Bit(std::strerror(errno)));
+        close();
+        return false;
+    }
+    if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        m_error = QString("ftruncate %1: %2").arg(name, QString::fromLocal8Bit(std::strerror(errno)));
+        ::close(fd);
+        shm_unlink(path.constData());
+        close();
+        return false;
+    }
+
+    void *base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (base == MAP_FAILED) {
+        m_error = QString("mmap %1: %2").arg(name, QString::fromLocal8Bit(std::strerror(errno)));
+        shm_unlink(path.constData());
+        close();
+        return false;
+    }
+
+    // 新段内容为零，只需填写头部；magic 最后写入，读取方据此判断段已就绪
+    m_header = static_cast<live_segment_header *>(base);
+    m_slots = reinterpret_cast<live_segment_slot *>(m_header + 1);
+    m_size = size;
+    m_mask = slots - 1;
+    m_header->version = LIVE_SEGMENT_VERSION;
+    m_header->capacity = slots;
+    m_header->fraction_digits = SampleFixed::kFractionDigits;
+    m_header->writer_pid = QCoreApplication::applicationPid();
+    m_header->created_us = QDateTime::currentMSecsSinceEpoch() * 1000;
+    __atomic_store_n(&m_header->magic, LIVE_SEGMENT_MAGIC, __ATOMIC_RELEASE);
+    m_error.clear();
+    return true;
+#else
+    Q_UNUSED(capacity);
+    m_error = "Shared memory segments are not supported on this platform";
+    return false;
+#endif
+}
+
+void LiveSegmentWriter::close()
+{
+#if LIVE_SEGMENT_SUPPORTED
+    if (m_header) {
+        __atomic_store_n(&m_header->closed, 1u, __ATOMIC_RELEASE);
+        munmap(m_header, m_size);
+        shm_unlink(m_name.toLocal8Bit().constData());
+    }
+    // 段删除之后再释放锁，下一个实例不会删掉仍在使用的段
+    if (m_lockFd >= 0) {
+        ::close(m_lockFd);
+        m_lockFd = -1;
+    }
+#endif
+    m_header = nullptr;
+    m_slots = nullptr;
+    m_size = 0;
+}
+
+void LiveSegmentWriter::publish(const SampleBlock &block)
+{
+#if LIVE_SEGMENT_SUPPORTED
+    if (!m_header) {
+        return;
+    }
+
+    const qint64 *timestamps = block.timestampsUs.constData();
+    const qint32 *values = block.values.constData();
+    const int count = block.size();
+    const quint64 capacity = m_mask + 1;
+
+    quint64 sequence = __atomic_load_n(&m_header->published, __ATOMIC_RELAXED);
+    int offset = 0;
+    while (offset < count) {
+        // 每段最多半个环，读取方最多只会因一段写入而丢弃样本
+        int n = static_cast<int>(qMin<quint64>(count - offset, capacity / 2));
+        quint64 end = sequence + n;
+
+        __atomic_store_n(&m_header->claimed, end, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+        for (int i = 0; i < n; ++i) {
+            live_segment_slot &slot = m_slots[(sequence + i) & m_mask];
+            slot.timestamp_us = timestamps[offset + i];
+            slot.value = values[offset + i];
+        }
+        __atomic_store_n(&m_header->published, end, __ATOMIC_RELEASE);
+
+        sequence = end;
+        offset += n;
+    }
+#else
+    Q_UNUSED(block);
+#endif
+}
@@ -0,0 +1,43 @@
+#ifndef LIVESEGMENTWRITER_H
+#define LIVESEGMENTWRITER_H
+
+#include <QString>
+
+#include "livesegment.h"
+#include "samplefixed.h"
+
+/**
+ * @brief 实时样本共享内存段的写入方
+ *
+ * 以同步消费者身份挂在 SampleBus 上，在采集线程把每批样本直接写入共享内存，
+ * 同机进程通过 livesegment.h 中的读取函数访问，布局与序列锁协议见该头文件。
+ * 同名段只允许一个写入方：open() 对锁文件加 flock，另一实例已持有时失败，不会删除对方的段。
+ * 仅在 POSIX 系统上可用，其余平台 open() 返回 false。
+ */
+class LiveSegmentWriter {
+public:
+    LiveSegmentWriter();
+    ~LiveSegmentWriter();
+
+    // capacity 向上取整为 2 的幂；同名段由已退出（含崩溃）的实例遗留时替换，
+    // 旧读取方通过 closed 标志或 live_segment_stale() 发现；另一实例正在写入时返回 false
+    bool open(const QString &name = QString(LIVE_SEGMENT_DEFAULT_NAME), int capacity = 1 << 16);
+    void close();
+    bool isOpen() const { return m_header != nullptr; }
+    QString name() const { return m_name; }
+    QString errorString() const { return m_error; }
+
+    // 仅由生产者线程调用
+    void publish(const SampleBlock &block);
+
+private:
+    QString m_name;
+    QString m_error;
+    live_segment_header *m_header;
+    live_segment_slot *m_slots;
+    size_t m_size;
+    quint64 m_mask;
+    int m_lockFd;               // 持有 flock 的锁文件，-1 表示未持有
+};
+
+#endif // LIVESEGMENTWRITER_H
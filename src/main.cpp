@@ -1,8 +1,12 @@
 #include "mainwindow.h"
 #include <QApplication>
+#include <QElapsedTimer>
 
 int main(int argc, char *argv[])
 {
+    QElapsedTimer startupClock;
+    startupClock.start();
+
     QApplication app(argc, argv);
 
     // 设置应用程序信息
@@ -10,7 +14,7 @@ int main(int argc, char *argv[])
     QApplication::setApplicationVersion("1.0.0");
     QApplication::setOrganizationName("Embedded Systems Lab");
 
-    MainWindow window;
+    MainWindow window(startupClock);
     window.show();
 
     return app.exec();
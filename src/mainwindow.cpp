@@ -8,42 +8,347 @@
 #include <QHeaderView>
 #include <QSplitter>
 #include <QStatusBar>
+#include <QTextDocument>
+#include <QShowEvent>
+#include <QHideEvent>
 
-MainWindow::MainWindow(QWidget *parent)
+MainWindow::MainWindow(const QElapsedTimer &startupClock, QWidget *parent)
     : QMainWindow(parent)
-    , m_serialPort(new SerialPortHandler(this))
+    , m_acquisitionThread(new QThread(this))
+    , m_serialPort(new SerialPortHandler())
+    , m_portSupervisor(new PortSupervisor(m_serialPort))
+    , m_rateController(new RateController(m_serialPort))
+    , m_isConnected(false)
+    , m_isReconnecting(false)
+    , m_isReceiving(false)
+    , m_serialReplay(new SerialReplay(this))
     , m_dataManager(new DataManager(this))
     , m_chartWidget(new ChartWidget(this))
+    , m_historyWidget(nullptr)
+    , m_shapeSearchWidget(nullptr)
+    , m_uiScheduler(new UiUpdateScheduler(this))
+    , m_eventDetector(new EventDetector(this))
+    , m_sessionCatalog(nullptr)
+    , m_activeSessionId(-1)
+    , m_runStartMs(DataManager::toStorageMs(QDateTime::currentDateTime()))
+    , m_importThread(nullptr)
+    , m_importer(nullptr)
+    , m_isImporting(false)
     , m_isChartPaused(false)
     , m_statisticsTimer(new QTimer(this))
+    , m_statisticsDirty(false)
+    , m_isRendering(true)
+    , m_sampleBus(new SampleBus())
+    , m_storageThread(new QThread(this))
+    , m_storageContext(nullptr)
+    , m_storageConsumerId(0)
+    , m_autoSave(true)
+    , m_liveSegment(new LiveSegmentWriter())
+    , m_spectrumThread(new QThread(this))
+    , m_spectrumAnalyzer(new SpectrumAnalyzer())
+    , m_spectrumWidget(new SpectrumWidget(this))
+    , m_catchUpTimer(new QTimer(this))
+    , m_startupClock(startupClock)
+    , m_firstFrameMs(-1)
+    , m_firstSampleMs(-1)
 {
     setupUI();
 
-    // 初始化数据库
-    if (!m_dataManager->initialize()) {
-        QMessageBox::critical(this, "Error", "Failed to initialize database!");
+    connect(m_dataManager, &DataManager::errorOccurred,
+            this, &MainWindow::onErrorOccurred);
+    connect(m_dataManager, &DataManager::storageAvailabilityChanged,
+            this, &MainWindow::onStorageAvailabilityChanged);
+    connect(m_dataManager, &DataManager::storageReady,
+            this, &MainWindow::onStorageReady);
+
+    // 分阶段启动：窗口先显示，数据库在后台打开和检查；
+    // 暂存文件立即可用，就绪前到达的样本先写入暂存，库就绪后回放线程才启动并补写
+    m_dataManager->initializeAsync();
+    m_dataManager->openSpool();
+    setStorageControlsEnabled(false);
+    centralWidget()->installEventFilter(this);
+
+    // 加载检测规则
+    if (m_eventDetector->loadRules("detection_rules.json")) {
+        logMessage(QString("Loaded %1 detection rule(s)").arg(m_eventDetector->ruleCount()));
     }
 
     // 连接信号槽
-    connect(m_serialPort, &SerialPortHandler::distanceReceived,
-            this, &MainWindow::onDistanceReceived);
+    // 采集线程把样本发布到广播环，检测、存储和界面各自订阅，互不拖慢
+    SampleBus *bus = m_sampleBus;
+    connect(m_serialPort, &SerialPortHandler::samplesReceived, m_serialPort,
+            [bus](const SampleBlock &block) { bus->publish(block); }, Qt::DirectConnection);
+
+    // 检测引擎在采集线程上同步求值，先于其他消费者
+    EventDetector *detector = m_eventDetector;
+    m_sampleBus->subscribe("detector", SampleBus::Block, nullptr,
+                           [detector](const SampleBlock &block) { detector->processBlock(block); });
+    connect(m_eventDetector, &EventDetector::eventDetected,
+            this, &MainWindow::onDetectionEvent);
+    connect(m_eventDetector, &EventDetector::errorOccurred,
+            this, &MainWindow::onErrorOccurred);
+
+    // 存储不丢样本，在独立线程写入暂存文件；没有暂存文件时在该线程用独立连接直接入库，
+    // 界面线程繁忙不会经 Block 策略拖慢采集
+    m_storageContext = new QObject();
+    m_storageContext->moveToThread(m_storageThread);
+    connect(m_storageThread, &QThread::finished, m_storageContext, &QObject::deleteLater);
+    m_storageThread->start();
+    DataManager *dataManager = m_dataManager;
+    std::atomic<bool> *autoSave = &m_autoSave;
+    m_storageConsumerId = m_sampleBus->subscribe("storage", SampleBus::Block, m_storageContext,
+        [dataManager, autoSave](const SampleBlock &block) {
+            if (autoSave->load()) {
+                dataManager->saveSamples(block);
+            } else {
+                dataManager->flushCompression();
+            }
+        });
+    connect(m_autoSaveCheckBox, &QCheckBox::toggled, this, [this](bool checked) { m_autoSave.store(checked); });
+    connect(m_compressionSpinBox, &QDoubleSpinBox::valueChanged, m_dataManager, &DataManager::setCompressionTolerance);
+
+    // 同机进程通过共享内存读取实时样本，写入在采集线程上同步完成
+    if (m_liveSegment->open()) {
+        LiveSegmentWriter *liveSegment = m_liveSegment;
+        m_sampleBus->subscribe("live", SampleBus::Drop, nullptr,
+                               [liveSegment](const SampleBlock &block) { liveSegment->publish(block); });
+        logMessage(QString("Live samples shared at %1").arg(m_liveSegment->name()));
+    } else {
+        logMessage(QString("Live sample segment unavailable: %1").arg(m_liveSegment->errorString()));
+    }
+
+    // 频谱分析需要连续样本，落后时丢弃并由分析对象按时间戳中断重新分段
+    m_spectrumAnalyzer->moveToThread(m_spectrumThread);
+    m_spectrumThread->start();
+    SpectrumAnalyzer *analyzer = m_spectrumAnalyzer;
+    m_sampleBus->subscribe("spectrum", SampleBus::Drop, m_spectrumAnalyzer,
+                           [analyzer](const SampleBlock &block) { analyzer->processBlock(block); });
+    connect(m_spectrumAnalyzer, &SpectrumAnalyzer::spectrumReady,
+            m_spectrumWidget, &SpectrumWidget::setFrame);
+
+    // 界面只需趋势，落后时抽样追赶
+    m_sampleBus->subscribe("ui", SampleBus::Sample, this,
+                           [this](const SampleBlock &block) { onSamplesReceived(block); });
+    connect(m_uiScheduler, &UiUpdateScheduler::frameReady,
+            this, &MainWindow::onUiFrame);
+
+    // 捕获回放走与串口读取相同的处理管线
+    connect(m_serialReplay, &SerialReplay::chunkReady,
+            m_serialPort, &SerialPortHandler::injectData);
+    connect(m_serialReplay, &SerialReplay::finished,
+            this, &MainWindow::onReplayFinished);
     connect(m_serialPort, &SerialPortHandler::connectionStatusChanged,
             this, &MainWindow::onConnectionStatusChanged);
     connect(m_serialPort, &SerialPortHandler::errorOccurred,
             this, &MainWindow::onErrorOccurred);
-
-    // 统计信息定时器
+    connect(m_serialPort, &SerialPortHandler::acquisitionStatsUpdated,
+            this, &MainWindow::onAcquisitionStats);
+
+    // 热插拔与掉线重连由监管对象处理，无需界面介入
+    connect(m_portSupervisor, &PortSupervisor::portsChanged,
+            this, &MainWindow::onPortsChanged);
+    connect(m_portSupervisor, &PortSupervisor::reconnectingChanged,
+            this, &MainWindow::onReconnectingChanged);
+    connect(m_portSupervisor, &PortSupervisor::gapRecorded,
+            this, &MainWindow::onGapRecorded);
+    connect(m_portSupervisor, &PortSupervisor::errorOccurred,
+            this, &MainWindow::onErrorOccurred);
+    connect(m_rateController, &RateController::rateChanged,
+            this, &MainWindow::onRateChanged);
+    connect(m_rateController, &RateController::commandFailed, this, [this](const QString &command) {
+        logMessage(QString("Device did not acknowledge %1").arg(command));
+    });
+
+    // 串口读取与解析在独立的采集线程上进行，界面卡顿不影响读取时机
+    m_serialPort->moveToThread(m_acquisitionThread);
+    m_portSupervisor->moveToThread(m_acquisitionThread);
+    m_rateController->moveToThread(m_acquisitionThread);
+    connect(m_acquisitionThread, &QThread::started, m_portSupervisor, &PortSupervisor::start);
+    connect(m_acquisitionThread, &QThread::finished, m_portSupervisor, &QObject::deleteLater);
+    connect(m_acquisitionThread, &QThread::finished, m_rateController, &QObject::deleteLater);
+    connect(m_acquisitionThread, &QThread::finished, m_serialPort, &QObject::deleteLater);
+    m_acquisitionThread->start(QThread::HighPriority);
+
+    // 统计只在库中数据变化后刷新，连续写入时合并为每秒一次；串口列表由监管对象在采集线程上枚举
+    m_statisticsTimer->setSingleShot(true);
+    m_statisticsTimer->setInterval(1000);
     connect(m_statisticsTimer, &QTimer::timeout, this, &MainWindow::updateStatistics);
-    m_statisticsTimer->start(1000);
+    connect(m_dataManager, &DataManager::recordsChanged, this, &MainWindow::scheduleStatistics);
 
-    // 刷新可用串口
-    onRefreshPortsClicked();
+    // 等待存储追平的操作随回放进度检查，另有定时器处理超时
+    m_catchUpTimer->setInterval(200);
+    connect(m_catchUpTimer, &QTimer::timeout, this, &MainWindow::checkCatchUp);
+    connect(m_dataManager, &DataManager::spoolReplayed, this, &MainWindow::checkCatchUp);
 
     logMessage("Application started successfully");
 }
 
+bool MainWindow::eventFilter(QObject *watched, QEvent *event)
+{
+    // 首次绘制即首帧
+    if (watched == centralWidget() && event->type() == QEvent::Paint && m_firstFrameMs < 0) {
+        m_firstFrameMs = m_startupClock.elapsed();
+        centralWidget()->removeEventFilter(this);
+        logMessage(QString("Startup: first frame after %1 ms").arg(m_firstFrameMs));
+    }
+    return QMainWindow::eventFilter(watched, event);
+}
+
+void MainWindow::changeEvent(QEvent *event)
+{
+    QMainWindow::changeEvent(event);
+    if (event->type() == QEvent::WindowStateChange) {
+        updateRenderingState();
+    }
+}
+
+void MainWindow::showEvent(QShowEvent *event)
+{
+    QMainWindow::showEvent(event);
+    updateRenderingState();
+}
+
+void MainWindow::hideEvent(QHideEvent *event)
+{
+    QMainWindow::hideEvent(event);
+    updateRenderingState();
+}
+
+void MainWindow::updateRenderingState()
+{
+    bool rendering = isVisible() && !isMinimized();
+    if (rendering == m_isRendering) {
+        return;
+    }
+    m_isRendering = rendering;
+
+    // 样本照常入库与检测；界面只保留一屏样本，恢复后一次画出
+    m_uiScheduler->setSuspended(!rendering, m_chartWidget->maxDataPoints());
+    m_spectrumAnalyzer->setEnabled(rendering && m_spectrumButton->isChecked());
+    PortSupervisor *supervisor = m_portSupervisor;
+    QMetaObject::invokeMethod(supervisor, [supervisor, rendering]() { supervisor->setPolling(rendering); });
+    if (rendering && m_statisticsDirty) {
+        updateStatistics();
+    }
+}
+
+void MainWindow::onStorageReady(bool available, const RangeStatistics &stats, qint64 elapsedMs)
+{
+    if (!available) {
+        logMessage("Database unavailable, samples will be spooled until it recovers");
+        return;
+    }
+
+    setStorageControlsEnabled(true);
+    // 上次运行的暂存样本补写完成后，收尾未结束的会话并补算统计
+    qint64 runStartMs = m_runStartMs;
+    afterStorageCatchUp([this, runStartMs]() { m_dataManager->recoverSessions(runStartMs); }, 0);
+    showStatistics(stats);
+    loadRecentData();
+    logMessage(QString("Startup: storage ready after %1 ms (%2 ms in background)")
+               .arg(m_startupClock.elapsed()).arg(elapsedMs));
+}
+
+void MainWindow::setStorageControlsEnabled(bool enabled)
+{
+    for (QPushButton *button : {m_queryDataButton, m_exportCSVButton, m_exportTXTButton,
+                                m_clearDataButton, m_importButton, m_historyButton, m_shapeSearchButton,
+                                m_sessionButton, m_sessionsButton}) {
+        button->setEnabled(enabled);
+    }
+}
+
 MainWindow::~MainWindow()
 {
+    SerialPortHandler *handler = m_serialPort;
+    PortSupervisor *supervisor = m_portSupervisor;
+    QMetaObject::invokeMethod(handler, [handler, supervisor]() {
+        supervisor->disconnectFrom();
+        handler->stopCapture();
+    }, Qt::BlockingQueuedConnection);
+    m_acquisitionThread->quit();
+    m_acquisitionThread->wait();
+
+    // 采集已停止：写完存储消费者的积压再退出
+    flushStorageConsumer();
+    m_storageThread->quit();
+    m_storageThread->wait();
+    if (m_activeSessionId >= 0) {
+        // 只写入结束时间；未入库的样本留在暂存文件，下次启动补写后由 recoverSessions 计算统计
+        m_dataManager->stopSession(m_activeSessionId);
+    }
+    // 分析对象可能还有广播环投递的唤醒，先于广播环删除
+    m_spectrumThread->quit();
+    m_spectrumThread->wait();
+    delete m_spectrumAnalyzer;
+    delete m_sampleBus;
+    delete m_liveSegment;
+
+    if (m_importThread) {
+        m_importer->cancel();
+        m_importThread->quit();
+        m_importThread->wait();
+    }
+}
+
+void MainWindow::flushStorageConsumer()
+{
+    SampleBus *bus = m_sampleBus;
+    int storageId = m_storageConsumerId;
+    DataManager *dataManager = m_dataManager;
+    QMetaObject::invokeMethod(m_storageContext, [bus, storageId, dataManager]() {
+        bus->drain(storageId);
+        dataManager->flushCompression();
+    }, Qt::BlockingQueuedConnection);
+}
+
+void MainWindow::afterStorageCatchUp(std::function<void()> action, int timeoutMs)
+{
+    qint64 deadlineMs = timeoutMs > 0 ? m_startupClock.elapsed() + timeoutMs : -1;
+    auto enqueue = [this, action, deadlineMs](quint64 sequence) {
+        m_catchUpWaiters.append({sequence, deadlineMs, action});
+        checkCatchUp();
+    };
+
+    SampleBus *bus = m_sampleBus;
+    int storageId = m_storageConsumerId;
+    DataManager *dataManager = m_dataManager;
+    // 目标序号在广播环积压写入存储之后取得，之前到达的样本都在其内
+    QMetaObject::invokeMethod(m_storageContext, [this, bus, storageId, dataManager, enqueue]() {
+        bus->drain(storageId);
+        dataManager->flushCompression();
+        quint64 sequence = dataManager->requestReplay();
+        QMetaObject::invokeMethod(this, [enqueue, sequence]() { enqueue(sequence); });
+    });
+}
+
+void MainWindow::checkCatchUp()
+{
+    // 先取出已追平或超时的操作再执行，操作中可能再次登记
+    QVector<CatchUpWaiter> ready;
+    qint64 nowMs = m_startupClock.elapsed();
+    for (int i = 0; i < m_catchUpWaiters.size();) {
+        const CatchUpWaiter &waiter = m_catchUpWaiters[i];
+        bool caughtUp = m_dataManager->isReplayedUpTo(waiter.sequence);
+        if (caughtUp || (waiter.deadlineMs >= 0 && nowMs >= waiter.deadlineMs)) {
+            if (!caughtUp) {
+                logMessage(QString("Storage is still catching up (%1 sample(s) pending), results may be incomplete")
+                           .arg(m_dataManager->pendingSamples()));
+            }
+            ready.append(m_catchUpWaiters.takeAt(i));
+        } else {
+            ++i;
+        }
+    }
+
+    if (m_catchUpWaiters.isEmpty()) {
+        m_catchUpTimer->stop();
+    } else if (!m_catchUpTimer->isActive()) {
+        m_catchUpTimer->start();
+    }
+    for (const CatchUpWaiter &waiter : ready) {
+        waiter.action();
+    }
 }
 
 void MainWindow::setupUI()
@@ -65,6 +370,7 @@ void MainWindow::setupUI()
     // 创建日志组件
     m_logTextEdit = new QTextEdit();
     m_logTextEdit->setReadOnly(true);
+    m_logTextEdit->document()->setMaximumBlockCount(1000);
     m_logTextEdit->setMaximumHeight(120);
 
     // 顶部控制区域
@@ -86,6 +392,25 @@ void MainWindow::setupUI()
     serialLayout->addLayout(baudLayout);
     serialLayout->addWidget(m_connectButton);
     serialLayout->addWidget(m_connectionStatusLabel);
+
+    QHBoxLayout *readModeLayout = new QHBoxLayout();
+    readModeLayout->addWidget(new QLabel("Read Mode:"));
+    readModeLayout->addWidget(m_readModeComboBox);
+    readModeLayout->addWidget(m_busyPollCheckBox);
+    serialLayout->addLayout(readModeLayout);
+
+    QHBoxLayout *rateLayout = new QHBoxLayout();
+    rateLayout->addWidget(m_adaptiveRateCheckBox);
+    rateLayout->addWidget(m_reportRateLabel);
+    rateLayout->addStretch();
+    serialLayout->addLayout(rateLayout);
+    serialLayout->addWidget(m_acquisitionStatsLabel);
+
+    QHBoxLayout *captureLayout = new QHBoxLayout();
+    captureLayout->addWidget(m_captureCheckBox);
+    captureLayout->addWidget(m_replaySpeedComboBox);
+    captureLayout->addWidget(m_replayButton);
+    serialLayout->addLayout(captureLayout);
     serialGroup->setLayout(serialLayout);
 
     QGroupBox *displayGroup = new QGroupBox("Real-time Display");
@@ -109,11 +434,18 @@ void MainWindow::setupUI()
     // 左侧 - 图表
     QWidget *chartContainer = new QWidget();
     QVBoxLayout *chartContainerLayout = new QVBoxLayout(chartContainer);
-    chartContainerLayout->addWidget(m_chartWidget);
+    QHBoxLayout *chartRowLayout = new QHBoxLayout();
+    chartRowLayout->addWidget(m_chartWidget, 3);
+    chartRowLayout->addWidget(m_spectrumWidget, 2);
+    m_spectrumWidget->hide();
+    chartContainerLayout->addLayout(chartRowLayout);
 
     QHBoxLayout *chartControlLayout = new QHBoxLayout();
     chartControlLayout->addWidget(m_pauseChartButton);
     chartControlLayout->addWidget(m_clearChartButton);
+    chartControlLayout->addWidget(m_historyButton);
+    chartControlLayout->addWidget(m_shapeSearchButton);
+    chartControlLayout->addWidget(m_spectrumButton);
     chartControlLayout->addStretch();
     chartContainerLayout->addLayout(chartControlLayout);
 
@@ -123,6 +455,13 @@ void MainWindow::setupUI()
 
     dataGroupLayout->addWidget(m_autoSaveCheckBox);
 
+    QHBoxLayout *compressionLayout = new QHBoxLayout();
+    compressionLayout->addWidget(new QLabel("Compression:"));
+    compressionLayout->addWidget(m_compressionSpinBox);
+    compressionLayout->addWidget(m_compressionLabel);
+    compressionLayout->addStretch();
+    dataGroupLayout->addLayout(compressionLayout);
+
     QHBoxLayout *buttonLayout1 = new QHBoxLayout();
     buttonLayout1->addWidget(m_saveDataButton);
     buttonLayout1->addWidget(m_queryDataButton);
@@ -133,11 +472,26 @@ void MainWindow::setupUI()
 
     dataGroupLayout->addLayout(buttonLayout1);
     dataGroupLayout->addLayout(buttonLayout2);
-    dataGroupLayout->addWidget(m_clearDataButton);
+    QHBoxLayout *buttonLayout3 = new QHBoxLayout();
+    buttonLayout3->addWidget(m_importButton);
+    buttonLayout3->addWidget(m_clearDataButton);
+    dataGroupLayout->addLayout(buttonLayout3);
+
+    QHBoxLayout *sessionLayout = new QHBoxLayout();
+    sessionLayout->addWidget(m_sessionNameEdit, 1);
+    sessionLayout->addWidget(m_sessionButton);
+    sessionLayout->addWidget(m_sessionsButton);
+    dataGroupLayout->addLayout(sessionLayout);
 
     // 统计信息
     QGroupBox *statsGroup = new QGroupBox("Statistics");
     QVBoxLayout *statsLayout = new QVBoxLayout();
+    QHBoxLayout *statsRangeLayout = new QHBoxLayout();
+    statsRangeLayout->addWidget(m_statsRangeCheckBox);
+    statsRangeLayout->addWidget(m_statsFromEdit);
+    statsRangeLayout->addWidget(new QLabel("-"));
+    statsRangeLayout->addWidget(m_statsToEdit);
+    statsLayout->addLayout(statsRangeLayout);
     statsLayout->addWidget(m_totalRecordsLabel);
     statsLayout->addWidget(m_avgDistanceLabel);
     statsLayout->addWidget(m_minDistanceLabel);
@@ -182,8 +536,34 @@ void MainWindow::createSerialPortGroup()
     m_connectionStatusLabel = new QLabel("Disconnected");
     m_connectionStatusLabel->setStyleSheet("QLabel { color: red; font-weight: bold; }");
 
+    m_readModeComboBox = new QComboBox();
+    m_readModeComboBox->addItem("Standard", SerialPortHandler::Standard);
+    m_readModeComboBox->addItem("Low Latency", SerialPortHandler::LowLatency);
+    m_readModeComboBox->addItem("Throughput", SerialPortHandler::Throughput);
+    m_readModeComboBox->setToolTip("Low Latency: immediate small reads (ASYNC_LOW_LATENCY on Linux)\n"
+                                   "Throughput: coalesced reads, fewer wakeups");
+    m_busyPollCheckBox = new QCheckBox("Busy Poll");
+    m_busyPollCheckBox->setToolTip("Poll the port continuously on the acquisition thread (uses one CPU core)");
+    m_busyPollCheckBox->setEnabled(false);
+    m_acquisitionStatsLabel = new QLabel("Wakeups: -- /s  Latency: --");
+    m_adaptiveRateCheckBox = new QCheckBox("Adaptive Rate");
+    m_adaptiveRateCheckBox->setToolTip("Lower the device report rate while the distance is steady\n"
+                                       "(requires firmware that answers !PING)");
+    m_reportRateLabel = new QLabel("Report: --");
+
+    m_captureCheckBox = new QCheckBox("Capture Raw");
+    m_replaySpeedComboBox = new QComboBox();
+    m_replaySpeedComboBox->addItem("1x", SerialReplay::RealTime);
+    m_replaySpeedComboBox->addItem("Max", SerialReplay::AsFastAsPossible);
+    m_replayButton = new QPushButton("Replay...");
+
     connect(m_connectButton, &QPushButton::clicked, this, &MainWindow::onConnectButtonClicked);
     connect(m_refreshPortsButton, &QPushButton::clicked, this, &MainWindow::onRefreshPortsClicked);
+    connect(m_readModeComboBox, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &MainWindow::onReadModeChanged);
+    connect(m_busyPollCheckBox, &QCheckBox::toggled, this, &MainWindow::onReadModeChanged);
+    connect(m_adaptiveRateCheckBox, &QCheckBox::toggled, this, &MainWindow::onAdaptiveRateToggled);
+    connect(m_captureCheckBox, &QCheckBox::toggled, this, &MainWindow::onCaptureToggled);
+    connect(m_replayButton, &QPushButton::clicked, this, &MainWindow::onReplayClicked);
 }
 
 void MainWindow::createDisplayGroup()
@@ -199,11 +579,29 @@ void MainWindow::createDataManagementGroup()
     m_autoSaveCheckBox = new QCheckBox("Auto Save Data");
     m_autoSaveCheckBox->setChecked(true);
 
+    // 压缩容差：保存点之间线性插值与原样本的最大偏差，0 为不压缩
+    m_compressionSpinBox = new QDoubleSpinBox();
+    m_compressionSpinBox->setRange(0.0, 10.0);
+    m_compressionSpinBox->setSingleStep(0.05);
+    m_compressionSpinBox->setDecimals(2);
+    m_compressionSpinBox->setSuffix(" cm");
+    m_compressionSpinBox->setSpecialValueText("Off");
+    m_compressionSpinBox->setToolTip("Store only the points needed to reconstruct every sample "
+                                     "within this tolerance by linear interpolation");
+    m_compressionLabel = new QLabel();
+
     m_saveDataButton = new QPushButton("Save Current");
     m_queryDataButton = new QPushButton("Query All");
     m_exportCSVButton = new QPushButton("Export CSV");
     m_exportTXTButton = new QPushButton("Export TXT");
     m_clearDataButton = new QPushButton("Clear All Data");
+    m_importButton = new QPushButton("Import...");
+
+    m_sessionNameEdit = new QLineEdit();
+    m_sessionNameEdit->setPlaceholderText("Session name");
+    m_sessionButton = new QPushButton("Start Session");
+    m_sessionButton->setToolTip("Record the following samples as a named session");
+    m_sessionsButton = new QPushButton("Sessions...");
 
     m_dataTableWidget = new QTableWidget();
     m_dataTableWidget->setColumnCount(3);
@@ -212,7 +610,22 @@ void MainWindow::createDataManagementGroup()
     m_dataTableWidget->setEditTriggers(QAbstractItemView::NoEditTriggers);
     m_dataTableWidget->setSelectionBehavior(QAbstractItemView::SelectRows);
 
-    m_totalRecordsLabel = new QLabel("Total: 0");
+    m_statsRangeCheckBox = new QCheckBox("Range");
+    m_statsFromEdit = new QDateTimeEdit(QDateTime::currentDateTime().addDays(-1));
+    m_statsToEdit = new QDateTimeEdit(QDateTime::currentDateTime());
+    for (QDateTimeEdit *edit : {m_statsFromEdit, m_statsToEdit}) {
+        edit->setDisplayFormat("yyyy-MM-dd hh:mm:ss");
+        edit->setCalendarPopup(true);
+        edit->setEnabled(false);
+        connect(edit, &QDateTimeEdit::dateTimeChanged, this, &MainWindow::updateStatistics);
+    }
+    connect(m_statsRangeCheckBox, &QCheckBox::toggled, this, [this](bool checked) {
+        m_statsFromEdit->setEnabled(checked);
+        m_statsToEdit->setEnabled(checked);
+        updateStatistics();
+    });
+
+    m_totalRecordsLabel = new QLabel("Records: 0");
     m_avgDistanceLabel = new QLabel("Average: -- cm");
     m_minDistanceLabel = new QLabel("Min: -- cm");
     m_maxDistanceLabel = new QLabel("Max: -- cm");
@@ -222,15 +635,26 @@ void MainWindow::createDataManagementGroup()
     connect(m_exportCSVButton, &QPushButton::clicked, this, &MainWindow::onExportCSVClicked);
     connect(m_exportTXTButton, &QPushButton::clicked, this, &MainWindow::onExportTXTClicked);
     connect(m_clearDataButton, &QPushButton::clicked, this, &MainWindow::onClearDataClicked);
+    connect(m_importButton, &QPushButton::clicked, this, &MainWindow::onImportClicked);
+    connect(m_sessionButton, &QPushButton::clicked, this, &MainWindow::onSessionButtonClicked);
+    connect(m_sessionsButton, &QPushButton::clicked, this, &MainWindow::onSessionsClicked);
 }
 
 void MainWindow::createChartGroup()
 {
     m_clearChartButton = new QPushButton("Clear Chart");
     m_pauseChartButton = new QPushButton("Pause");
+    m_historyButton = new QPushButton("History");
+    m_shapeSearchButton = new QPushButton("Shape Search");
+    m_spectrumButton = new QPushButton("Spectrum");
+    m_spectrumButton->setCheckable(true);
+    m_spectrumButton->setToolTip("Show the spectrum and spectrogram of the live signal");
 
     connect(m_clearChartButton, &QPushButton::clicked, this, &MainWindow::onClearChartClicked);
     connect(m_pauseChartButton, &QPushButton::clicked, this, &MainWindow::onPauseChartClicked);
+    connect(m_historyButton, &QPushButton::clicked, this, &MainWindow::onHistoryClicked);
+    connect(m_shapeSearchButton, &QPushButton::clicked, this, &MainWindow::onShapeSearchClicked);
+    connect(m_spectrumButton, &QPushButton::toggled, this, &MainWindow::onSpectrumToggled);
 }
 
 void MainWindow::createStatusBar()
@@ -240,8 +664,9 @@ void MainWindow::createStatusBar()
 
 void MainWindow::onConnectButtonClicked()
 {
-    if (m_serialPort->isOpen()) {
-        m_serialPort->closePort();
+    PortSupervisor *supervisor = m_portSupervisor;
+    if (m_isConnected || m_isReconnecting) {
+        QMetaObject::invokeMethod(supervisor, [supervisor]() { supervisor->disconnectFrom(); });
     } else {
         QString portName = m_portComboBox->currentText();
         int baudRate = m_baudRateSpinBox->value();
@@ -251,16 +676,18 @@ void MainWindow::onConnectButtonClicked()
             return;
         }
 
-        if (m_serialPort->openPort(portName, baudRate)) {
-            logMessage(QString("Connected to %1 at %2 baud").arg(portName).arg(baudRate));
-        }
+        // 结果通过 connectionStatusChanged / errorOccurred 返回
+        QMetaObject::invokeMethod(supervisor, [supervisor, portName, baudRate]() {
+            supervisor->connectTo(portName, baudRate);
+        });
+        logMessage(QString("Connecting to %1 at %2 baud").arg(portName).arg(baudRate));
     }
 }
 
 void MainWindow::onRefreshPortsClicked()
 {
     m_portComboBox->clear();
-    QStringList ports = m_serialPort->getAvailablePorts();
+    QStringList ports = SerialPortHandler::getAvailablePorts();
 
     if (ports.isEmpty()) {
         logMessage("No serial ports found");
@@ -271,21 +698,191 @@ void MainWindow::onRefreshPortsClicked()
     }
 }
 
-void MainWindow::onDistanceReceived(double distance)
+void MainWindow::onPortsChanged(const QStringList &ports)
+{
+    if (ports.isEmpty()) {
+        statusBar()->showMessage("No serial ports detected");
+    }
+    logMessage(QString("Found %1 serial port(s)").arg(ports.size()));
+
+    // 热插拔后更新列表，保留当前选择
+    QString current = m_portComboBox->currentText();
+    m_portComboBox->clear();
+    m_portComboBox->addItems(ports);
+    int index = m_portComboBox->findText(current);
+    if (index >= 0) {
+        m_portComboBox->setCurrentIndex(index);
+    }
+}
+
+void MainWindow::onReconnectingChanged(bool reconnecting)
+{
+    m_isReconnecting = reconnecting;
+    if (reconnecting) {
+        updateConnectionButton(true);
+        m_connectionStatusLabel->setText("Reconnecting...");
+        m_connectionStatusLabel->setStyleSheet("QLabel { color: orange; font-weight: bold; }");
+        statusBar()->showMessage("Serial device lost, waiting for it to reappear");
+        logMessage("Serial device lost, reconnecting automatically");
+    } else if (!m_isConnected) {
+        // 用户取消重连
+        onConnectionStatusChanged(false);
+    }
+}
+
+void MainWindow::onGapRecorded(qint64 startUs, qint64 endUs, const QString &reason)
+{
+    m_dataManager->saveGap(startUs, endUs, reason);
+    logMessage(QString("Reconnected after %1 s gap (%2)").arg((endUs - startUs) / 1e6, 0, 'f', 3).arg(reason));
+}
+
+void MainWindow::onReadModeChanged()
+{
+    int mode = m_readModeComboBox->currentData().toInt();
+    m_busyPollCheckBox->setEnabled(mode == SerialPortHandler::LowLatency);
+    bool busyPoll = m_busyPollCheckBox->isEnabled() && m_busyPollCheckBox->isChecked();
+
+    SerialPortHandler *handler = m_serialPort;
+    QMetaObject::invokeMethod(handler, [handler, mode, busyPoll]() { handler->setReadMode(mode, busyPoll); });
+    logMessage(QString("Read mode: %1%2").arg(m_readModeComboBox->currentText(), busyPoll ? " (busy poll)" : ""));
+}
+
+void MainWindow::onAdaptiveRateToggled(bool checked)
+{
+    RateController *controller = m_rateController;
+    QMetaObject::invokeMethod(controller, [controller, checked]() { controller->setEnabled(checked); });
+    if (!checked) {
+        m_reportRateLabel->setText("Report: --");
+    }
+    logMessage(QString("Adaptive report rate %1").arg(checked ? "enabled" : "disabled"));
+}
+
+void MainWindow::onRateChanged(int intervalMs, bool supported)
+{
+    if (!supported) {
+        m_reportRateLabel->setText("Report: fixed");
+        logMessage("Device does not answer rate commands, keeping its fixed report rate");
+        return;
+    }
+    m_reportRateLabel->setText(QString("Report: %1 ms").arg(intervalMs));
+}
+
+void MainWindow::onAcquisitionStats(const AcquisitionStats &stats)
+{
+    m_acquisitionStatsLabel->setText(QString("Wakeups: %1/s  Reads: %2/s (%3 B)  Latency: avg %4 ms, max %5 ms")
+        .arg(stats.wakeupsPerSecond, 0, 'f', 0)
+        .arg(stats.readsPerSecond, 0, 'f', 0)
+        .arg(stats.averageReadBytes, 0, 'f', 0)
+        .arg(stats.averageLatencyUs / 1000.0, 0, 'f', 2)
+        .arg(stats.maxLatencyUs / 1000.0, 0, 'f', 2));
+    if (stats.pingsPerSecond > 0.0) {
+        m_acquisitionStatsLabel->setText(m_acquisitionStatsLabel->text()
+            + QString("  Pings: %1/s (%2 rejected)").arg(stats.pingsPerSecond, 0, 'f', 0).arg(stats.rejectedPings));
+    }
+
+    // 各消费者的落后情况
+    QStringList lags;
+    for (const SampleBus::ConsumerStats &consumer : m_sampleBus->stats()) {
+        QString text = QString("%1 %2/%3").arg(consumer.name).arg(consumer.lag).arg(consumer.maxLag);
+        if (consumer.dropped > 0) {
+            text += QString(" (dropped %1)").arg(consumer.dropped);
+        }
+        lags.append(text);
+    }
+    m_acquisitionStatsLabel->setToolTip("Consumer lag (now/max): " + lags.join(", "));
+}
+
+void MainWindow::onCaptureToggled(bool checked)
+{
+    // 捕获文件在采集线程上打开/关闭，避免与读取路径并发
+    SerialPortHandler *handler = m_serialPort;
+    if (!checked) {
+        if (handler->isCapturing()) {
+            QMetaObject::invokeMethod(handler, [handler]() { handler->stopCapture(); }, Qt::BlockingQueuedConnection);
+            logMessage(QString("Raw capture stopped (%1 bytes)").arg(handler->capturedBytes()));
+        }
+        return;
+    }
+
+    QString fileName = QString("capture_%1.uhcap").arg(QDateTime::currentDateTime().toString("yyyyMMdd_hhmmss"));
+    bool started = false;
+    QMetaObject::invokeMethod(handler, [handler, fileName]() { return handler->startCapture(fileName); },
+                              Qt::BlockingQueuedConnection, &started);
+    if (started) {
+        logMessage("Raw capture started: " + fileName);
+    } else {
+        m_captureCheckBox->setChecked(false);
+    }
+}
+
+void MainWindow::onReplayClicked()
+{
+    if (m_serialReplay->isRunning()) {
+        m_serialReplay->stop();
+        return;
+    }
+
+    QString fileName = QFileDialog::getOpenFileName(this, "Replay Capture", QString(), "Serial Captures (*.uhcap)");
+    if (fileName.isEmpty()) {
+        return;
+    }
+
+    auto speed = static_cast<SerialReplay::Speed>(m_replaySpeedComboBox->currentData().toInt());
+    if (m_serialReplay->start(fileName, speed)) {
+        m_replayButton->setText("Stop Replay");
+        logMessage(QString("Replaying %1 (%2)").arg(fileName, m_replaySpeedComboBox->currentText()));
+    } else {
+        onErrorOccurred("Replay failed: " + m_serialReplay->errorString());
+    }
+}
+
+void MainWindow::onReplayFinished(qint64 chunks, qint64 bytes, qint64 elapsedMs)
+{
+    m_replayButton->setText("Replay...");
+    double seconds = qMax<qint64>(1, elapsedMs) / 1000.0;
+    logMessage(QString("Replay finished: %1 chunks, %2 bytes in %3 s (%4 KB/s)")
+               .arg(chunks).arg(bytes).arg(seconds, 0, 'f', 2).arg(bytes / 1024.0 / seconds, 0, 'f', 1));
+}
+
+void MainWindow::onSamplesReceived(const SampleBlock &block)
+{
+    if (m_firstSampleMs < 0) {
+        m_firstSampleMs = m_startupClock.elapsed();
+        logMessage(QString("Startup: first sample after %1 ms").arg(m_firstSampleMs));
+    }
+
+    // 界面更新合并到下一帧
+    m_uiScheduler->addSamples(block);
+}
+
+void MainWindow::onUiFrame(const UiFrame &frame)
 {
     // 更新显示
-    m_currentDistanceValue->setText(QString("%1 cm").arg(distance, 0, 'f', 2));
-    m_lastUpdateLabel->setText(QString("Last Update: %1").arg(QDateTime::currentDateTime().toString("hh:mm:ss")));
+    m_currentDistanceValue->setText(QString("%1 cm").arg(frame.lastDistance, 0, 'f', 2));
+    m_lastUpdateLabel->setText(QString("Last Update: %1").arg(
+        QDateTime::fromMSecsSinceEpoch(frame.lastTimestampUs / 1000).toString("hh:mm:ss")));
 
     // 更新图表
-    m_chartWidget->addDataPoint(distance);
+    m_chartWidget->addDataPoints(frame.distances);
 
-    // 自动保存
-    if (m_autoSaveCheckBox->isChecked()) {
-        m_dataManager->saveData(distance);
+    // 当前值与更新时间已在标签上显示；日志只记录开始接收，逐帧记录会冲掉错误与导入结果
+    if (!m_isReceiving) {
+        m_isReceiving = true;
+        logMessage(QString("Receiving samples, first: %1 cm").arg(frame.lastDistance, 0, 'f', 2));
     }
+}
 
-    logMessage(QString("Received: %1 cm").arg(distance, 0, 'f', 2));
+void MainWindow::onDetectionEvent(const DetectionEvent &event)
+{
+    m_dataManager->saveEvent(event);
+
+    // 事件前后的细节用突发采样补齐：50 个样本，20 ms 间隔
+    RateController *controller = m_rateController;
+    QMetaObject::invokeMethod(controller, [controller]() { controller->requestBurst(50, 20); });
+    logMessage(QString("EVENT [%1] %2: %3 (latency %4 us)")
+               .arg(event.ruleName, DetectionEvent::typeName(event.type))
+               .arg(event.value, 0, 'f', 2)
+               .arg(event.latencyUs));
 }
 
 void MainWindow::onSaveDataClicked()
@@ -297,7 +894,7 @@ void MainWindow::onSaveDataClicked()
     if (ok && distance >= 0) {
         if (m_dataManager->saveData(distance)) {
             logMessage("Data saved manually");
-            loadRecentData();
+            afterStorageCatchUp([this]() { loadRecentData(); });
         }
     } else {
         QMessageBox::warning(this, "Warning", "No valid distance data to save!");
@@ -306,8 +903,10 @@ void MainWindow::onSaveDataClicked()
 
 void MainWindow::onQueryDataClicked()
 {
-    loadRecentData();
-    logMessage("Data queried");
+    afterStorageCatchUp([this]() {
+        loadRecentData();
+        logMessage("Data queried");
+    });
 }
 
 void MainWindow::onExportCSVClicked()
@@ -315,12 +914,14 @@ void MainWindow::onExportCSVClicked()
     QString fileName = QFileDialog::getSaveFileName(this, "Export to CSV", "ultrasonic_data.csv", "CSV Files (*.csv)");
 
     if (!fileName.isEmpty()) {
-        if (m_dataManager->exportToCSV(fileName)) {
-            QMessageBox::information(this, "Success", "Data exported successfully!");
-            logMessage("Data exported to CSV: " + fileName);
-        } else {
-            QMessageBox::critical(this, "Error", "Failed to export data!");
-        }
+        afterStorageCatchUp([this, fileName]() {
+            if (m_dataManager->exportToCSV(fileName)) {
+                QMessageBox::information(this, "Success", "Data exported successfully!");
+                logMessage("Data exported to CSV: " + fileName);
+            } else {
+                QMessageBox::critical(this, "Error", "Failed to export data!");
+            }
+        });
     }
 }
 
@@ -329,12 +930,14 @@ void MainWindow::onExportTXTClicked()
     QString fileName = QFileDialog::getSaveFileName(this, "Export to TXT", "ultrasonic_data.txt", "Text Files (*.txt)");
 
     if (!fileName.isEmpty()) {
-        if (m_dataManager->exportToTXT(fileName)) {
-            QMessageBox::information(this, "Success", "Data exported successfully!");
-            logMessage("Data exported to TXT: " + fileName);
-        } else {
-            QMessageBox::critical(this, "Error", "Failed to export data!");
-        }
+        afterStorageCatchUp([this, fileName]() {
+            if (m_dataManager->exportToTXT(fileName)) {
+                QMessageBox::information(this, "Success", "Data exported successfully!");
+                logMessage("Data exported to TXT: " + fileName);
+            } else {
+                QMessageBox::critical(this, "Error", "Failed to export data!");
+            }
+        });
     }
 }
 
@@ -345,11 +948,72 @@ void MainWindow::onClearDataClicked()
         QMessageBox::Yes | QMessageBox::No);
 
     if (reply == QMessageBox::Yes) {
-        if (m_dataManager->clearAll()) {
-            m_dataTableWidget->setRowCount(0);
-            logMessage("All data cleared");
-            updateStatistics();
-        }
+        // 确认前到达的样本必须先入库，否则清空后才回放的样本会留在库中
+        afterStorageCatchUp([this]() {
+            if (m_dataManager->clearAll()) {
+                m_dataTableWidget->setRowCount(0);
+                logMessage("All data cleared");
+                updateStatistics();
+            }
+        }, 0);
+    }
+}
+
+void MainWindow::onImportClicked()
+{
+    if (m_isImporting) {
+        m_importer->cancel();
+        logMessage("Import cancel requested");
+        return;
+    }
+
+    QStringList fileNames = QFileDialog::getOpenFileNames(this, "Import Data", QString(),
+                                                          "Exported Data (*.csv *.txt);;All Files (*)");
+    if (fileNames.isEmpty()) {
+        return;
+    }
+
+    if (!m_importThread) {
+        m_importThread = new QThread(this);
+        m_importer = new BulkImporter(m_dataManager->databasePath());
+        m_importer->moveToThread(m_importThread);
+        connect(m_importThread, &QThread::started, m_importer, &BulkImporter::open);
+        connect(m_importThread, &QThread::finished, m_importer, &QObject::deleteLater);
+        connect(m_importer, &BulkImporter::progressChanged, this, &MainWindow::onImportProgress);
+        connect(m_importer, &BulkImporter::importFinished, this, &MainWindow::onImportFinished);
+        connect(m_importer, &BulkImporter::errorOccurred, this, &MainWindow::onErrorOccurred);
+        m_importThread->start();
+    }
+
+    m_isImporting = true;
+    m_importButton->setText("Cancel Import");
+    logMessage(QString("Importing %1 file(s)").arg(fileNames.size()));
+
+    BulkImporter *importer = m_importer;
+    QMetaObject::invokeMethod(importer, [importer, fileNames]() { importer->importFiles(fileNames); });
+}
+
+void MainWindow::onImportProgress(qint64 bytesDone, qint64 bytesTotal, qint64 rows)
+{
+    int percent = bytesTotal > 0 ? int(100 * bytesDone / bytesTotal) : 100;
+    statusBar()->showMessage(QString("Importing: %1% (%2 rows)").arg(percent).arg(rows));
+}
+
+void MainWindow::onImportFinished(qint64 rows, qint64 skippedLines, qint64 elapsedMs)
+{
+    m_isImporting = false;
+    m_importButton->setText("Import...");
+
+    double seconds = qMax<qint64>(1, elapsedMs) / 1000.0;
+    QString message = QString("Imported %1 rows in %2 s (%3 rows/s), %4 line(s) skipped")
+        .arg(rows).arg(seconds, 0, 'f', 1).arg(qint64(rows / seconds)).arg(skippedLines);
+    logMessage(message);
+    statusBar()->showMessage(message, 5000);
+
+    loadRecentData();
+    updateStatistics();
+    if (m_historyWidget) {
+        m_historyWidget->reload();
     }
 }
 
@@ -367,8 +1031,133 @@ void MainWindow::onPauseChartClicked()
     logMessage(m_isChartPaused ? "Chart paused" : "Chart resumed");
 }
 
+void MainWindow::onHistoryClicked()
+{
+    if (!m_historyWidget) {
+        m_historyWidget = new HistoryChartWidget(m_dataManager->databasePath(), this);
+        m_historyWidget->setWindowFlag(Qt::Window);
+        connect(m_historyWidget, &HistoryChartWidget::errorOccurred, this, [this](const QString &error) {
+            logMessage("History: " + error);
+        });
+    } else {
+        m_historyWidget->reload();
+    }
+    m_historyWidget->show();
+    m_historyWidget->raise();
+    m_historyWidget->activateWindow();
+}
+
+void MainWindow::onSpectrumToggled(bool checked)
+{
+    // 隐藏时不做计算；重新打开后从新样本开始分段
+    m_spectrumAnalyzer->setEnabled(checked);
+    m_spectrumWidget->setVisible(checked);
+    if (!checked) {
+        m_spectrumWidget->clear();
+    }
+}
+
+void MainWindow::onShapeSearchClicked()
+{
+    afterStorageCatchUp([this]() { showShapeSearch(); });
+}
+
+void MainWindow::showShapeSearch()
+{
+    if (!m_shapeSearchWidget) {
+        m_shapeSearchWidget = new ShapeSearchWidget(m_dataManager->databasePath(), this);
+        m_shapeSearchWidget->setWindowFlag(Qt::Window);
+        connect(m_shapeSearchWidget, &ShapeSearchWidget::errorOccurred, this, [this](const QString &error) {
+            logMessage("Shape search: " + error);
+        });
+        connect(m_shapeSearchWidget, &ShapeSearchWidget::matchActivated,
+                this, &MainWindow::onShapeMatchActivated);
+    }
+    m_shapeSearchWidget->show();
+    m_shapeSearchWidget->raise();
+    m_shapeSearchWidget->activateWindow();
+}
+
+void MainWindow::onShapeMatchActivated(qint64 startMs, qint64 endMs)
+{
+    // 在历史视图中显示匹配窗口，两侧各留出一个窗口长度
+    onHistoryClicked();
+    qint64 span = qMax<qint64>(endMs - startMs, 1000);
+    m_historyWidget->showRange(startMs - span, endMs + span);
+}
+
+void MainWindow::onSessionButtonClicked()
+{
+    if (m_activeSessionId < 0) {
+        // 会话按时间范围划分记录，无需等待此前的样本入库
+        QString name = m_sessionNameEdit->text().trimmed();
+        if (name.isEmpty()) {
+            name = QString("Session %1").arg(QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss"));
+        }
+        m_activeSessionId = m_dataManager->startSession(name, QString(), {"distance"});
+        if (m_activeSessionId < 0) {
+            return;
+        }
+        m_sessionNameEdit->setEnabled(false);
+        m_sessionButton->setText("Stop Session");
+        logMessage(QString("Session started: %1").arg(name));
+        return;
+    }
+
+    // 结束时间取点击时刻；会话内的样本全部写入数据库后再计算统计
+    qint64 id = m_activeSessionId;
+    m_activeSessionId = -1;
+    m_sessionNameEdit->setEnabled(true);
+    m_sessionNameEdit->clear();
+    m_sessionButton->setText("Start Session");
+    if (!m_dataManager->stopSession(id)) {
+        return;
+    }
+    afterStorageCatchUp([this, id]() {
+        RecordingSession session;
+        if (m_dataManager->summarizeSession(id) && m_dataManager->querySession(id, session)) {
+            logMessage(QString("Session stopped: %1, %2 record(s) in %3 s, mean %4 cm")
+                       .arg(session.name).arg(session.stats.count)
+                       .arg(session.durationMs() / 1000.0, 0, 'f', 1)
+                       .arg(session.stats.mean(), 0, 'f', 2));
+        }
+    }, 0);
+}
+
+void MainWindow::onSessionsClicked()
+{
+    if (!m_sessionCatalog) {
+        m_sessionCatalog = new SessionCatalogWidget(m_dataManager, this);
+        m_sessionCatalog->setWindowFlag(Qt::Window);
+        connect(m_sessionCatalog, &SessionCatalogWidget::sessionActivated,
+                this, &MainWindow::onSessionActivated);
+    } else {
+        m_sessionCatalog->refresh();
+    }
+    m_sessionCatalog->show();
+    m_sessionCatalog->raise();
+    m_sessionCatalog->activateWindow();
+}
+
+void MainWindow::onSessionActivated(qint64 startMs, qint64 endMs)
+{
+    afterStorageCatchUp([this, startMs, endMs]() {
+        onHistoryClicked();
+        m_historyWidget->showRange(startMs, endMs);
+    });
+}
+
 void MainWindow::onConnectionStatusChanged(bool connected)
 {
+    m_isConnected = connected;
+    m_isReceiving = false;
+    if (!connected && m_isReconnecting) {
+        // 重连期间保持"Reconnecting"状态显示
+        return;
+    }
+    if (!connected) {
+        m_acquisitionStatsLabel->setText("Wakeups: -- /s  Latency: --");
+    }
     updateConnectionButton(connected);
 
     if (connected) {
@@ -384,16 +1173,89 @@ void MainWindow::onConnectionStatusChanged(bool connected)
 
 void MainWindow::onErrorOccurred(const QString &error)
 {
-    logMessage("ERROR: " + error);
-    QMessageBox::warning(this, "Error", error);
+    // 相同错误在时间窗口内只记录一次，不弹出模态对话框
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    auto it = m_errorLastShownMs.constFind(error);
+    if (it != m_errorLastShownMs.constEnd() && now - it.value() < kErrorRepeatWindowMs) {
+        m_errorRepeatCount[error]++;
+        return;
+    }
+
+    int repeats = m_errorRepeatCount.take(error);
+    m_errorLastShownMs.insert(error, now);
+    if (repeats > 0) {
+        logMessage(QString("ERROR: %1 (repeated %2 more times)").arg(error).arg(repeats));
+    } else {
+        logMessage("ERROR: " + error);
+    }
+    statusBar()->showMessage("Error: " + error, 5000);
+}
+
+void MainWindow::onStorageAvailabilityChanged(bool available)
+{
+    if (available) {
+        logMessage("Database available, spooled samples written");
+    } else {
+        logMessage(QString("Database unavailable, spooling samples (%1 pending)").arg(m_dataManager->pendingSamples()));
+    }
+}
+
+void MainWindow::scheduleStatistics()
+{
+    m_statisticsDirty = true;
+    if (m_isRendering && !m_statisticsTimer->isActive()) {
+        m_statisticsTimer->start();
+    }
 }
 
 void MainWindow::updateStatistics()
 {
-    m_totalRecordsLabel->setText(QString("Total: %1").arg(m_dataManager->getTotalRecords()));
-    m_avgDistanceLabel->setText(QString("Average: %1 cm").arg(m_dataManager->getAverageDistance(), 0, 'f', 2));
-    m_minDistanceLabel->setText(QString("Min: %1 cm").arg(m_dataManager->getMinDistance(), 0, 'f', 2));
-    m_maxDistanceLabel->setText(QString("Max: %1 cm").arg(m_dataManager->getMaxDistance(), 0, 'f', 2));
+    if (!m_dataManager->isOpen()) {
+        return;
+    }
+    m_statisticsDirty = false;
+    m_statisticsTimer->stop();
+
+    // 默认统计全部数据，勾选 Range 后只统计所选时间段；均由分块汇总合并得出
+    qint64 startMs = 0;
+    qint64 endMs = 0;
+    if (m_statsRangeCheckBox->isChecked()) {
+        startMs = DataManager::toStorageMs(m_statsFromEdit->dateTime());
+        endMs = DataManager::toStorageMs(m_statsToEdit->dateTime());
+    } else if (m_dataManager->queryTimeBounds(startMs, endMs)) {
+        endMs += 1;
+    }
+
+    RangeStatistics stats;
+    if (m_dataManager->queryStatistics(startMs, endMs, stats)) {
+        showStatistics(stats);
+    }
+
+    qint64 samples = 0;
+    qint64 stored = 0;
+    m_dataManager->compressionCounts(samples, stored);
+    m_compressionLabel->setText(stored > 0 && stored < samples
+                                ? QString("%1x").arg(double(samples) / stored, 0, 'f', 1) : QString());
+}
+
+void MainWindow::showStatistics(const RangeStatistics &stats)
+{
+    // 统计按保存的记录计算；含压缩时间段时另注代表的样本数
+    QString total = QString("Records: %1").arg(stats.count);
+    if (stats.represented > stats.count) {
+        total += QString(" (~%1 samples before compression)").arg(stats.represented);
+    }
+    m_totalRecordsLabel->setText(total);
+    if (stats.count == 0) {
+        m_avgDistanceLabel->setText("Average: -- cm");
+        m_minDistanceLabel->setText("Min: -- cm");
+        m_maxDistanceLabel->setText("Max: -- cm");
+        return;
+    }
+    m_avgDistanceLabel->setText(QString("Average: %1 cm (SD %2)").arg(stats.mean(), 0, 'f', 2)
+                                .arg(stats.standardDeviation(), 0, 'f', 2));
+    m_minDistanceLabel->setText(QString("Min: %1 cm").arg(stats.min, 0, 'f', 2));
+    m_maxDistanceLabel->setText(QString("Max: %1 cm").arg(stats.max, 0, 'f', 2));
 }
 
 void MainWindow::logMessage(const QString &message)
@@ -417,13 +1279,14 @@ void MainWindow::updateConnectionButton(bool connected)
 
 void MainWindow::loadRecentData()
 {
-    QVector<DistanceRecord> records = m_dataManager->queryRecent(20);
+    // 只读库中已有记录，不等待暂存回放（启动时积压可能很大）
+    RecordSet records = m_dataManager->queryRecent(20);
 
     m_dataTableWidget->setRowCount(records.size());
 
     for (int i = 0; i < records.size(); ++i) {
-        m_dataTableWidget->setItem(i, 0, new QTableWidgetItem(QString::number(records[i].id)));
-        m_dataTableWidget->setItem(i, 1, new QTableWidgetItem(records[i].timestamp.toString("yyyy-MM-dd hh:mm:ss")));
-        m_dataTableWidget->setItem(i, 2, new QTableWidgetItem(QString::number(records[i].distance, 'f', 2)));
+        m_dataTableWidget->setItem(i, 0, new QTableWidgetItem(QString::number(records.idAt(i))));
+        m_dataTableWidget->setItem(i, 1, new QTableWidgetItem(records.timestampAt(i).toString("yyyy-MM-dd hh:mm:ss")));
+        m_dataTableWidget->setItem(i, 2, new QTableWidgetItem(QString::number(records.distanceAt(i), 'f', 2)));
     }
 }
@@ -6,15 +6,35 @@
 #include <QPushButton>
 #include <QComboBox>
 #include <QSpinBox>
+#include <QDoubleSpinBox>
 #include <QCheckBox>
 #include <QTableWidget>
 #include <QTextEdit>
 #include <QGroupBox>
 #include <QTimer>
+#include <QDateTimeEdit>
+#include <QLineEdit>
+#include <QHash>
+#include <QElapsedTimer>
 
 #include "serialport.h"
+#include "portsupervisor.h"
+#include "ratecontroller.h"
+#include "serialreplay.h"
 #include "datamanager.h"
 #include "chartwidget.h"
+#include "eventdetector.h"
+#include "historychartwidget.h"
+#include "shapesearchwidget.h"
+#include "sessioncatalogwidget.h"
+#include "bulkimporter.h"
+#include "uiupdatescheduler.h"
+#include "samplebus.h"
+#include "livesegmentwriter.h"
+#include "spectrumanalyzer.h"
+#include "spectrumwidget.h"
+#include <atomic>
+#include <functional>
 
 /**
  * @brief 主窗口类，整合所有功能模块
@@ -23,16 +43,37 @@ class MainWindow : public QMainWindow {
     Q_OBJECT
 
 public:
-    MainWindow(QWidget *parent = nullptr);
+    // startupClock 在进程入口处启动，用于统计首帧与首个样本的耗时
+    explicit MainWindow(const QElapsedTimer &startupClock, QWidget *parent = nullptr);
     ~MainWindow();
 
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override;
+    void changeEvent(QEvent *event) override;
+    void showEvent(QShowEvent *event) override;
+    void hideEvent(QHideEvent *event) override;
+
 private slots:
     // 串口控制
     void onConnectButtonClicked();
     void onRefreshPortsClicked();
+    void onPortsChanged(const QStringList &ports);
+    void onReconnectingChanged(bool reconnecting);
+    void onGapRecorded(qint64 startUs, qint64 endUs, const QString &reason);
+    void onReadModeChanged();
+    void onAdaptiveRateToggled(bool checked);
+    void onRateChanged(int intervalMs, bool supported);
+    void onAcquisitionStats(const AcquisitionStats &stats);
+    void onCaptureToggled(bool checked);
+    void onReplayClicked();
+    void onReplayFinished(qint64 chunks, qint64 bytes, qint64 elapsedMs);
 
     // 数据接收
-    void onDistanceReceived(double distance);
+    void onSamplesReceived(const SampleBlock &block);
+    void onUiFrame(const UiFrame &frame);
+
+    // 事件检测
+    void onDetectionEvent(const DetectionEvent &event);
 
     // 数据管理
     void onSaveDataClicked();
@@ -40,17 +81,34 @@ private slots:
     void onExportCSVClicked();
     void onExportTXTClicked();
     void onClearDataClicked();
+    void onImportClicked();
+    void onImportProgress(qint64 bytesDone, qint64 bytesTotal, qint64 rows);
+    void onImportFinished(qint64 rows, qint64 skippedLines, qint64 elapsedMs);
 
     // 图表控制
     void onClearChartClicked();
     void onPauseChartClicked();
+    void onHistoryClicked();
+    void onShapeSearchClicked();
+    void onSpectrumToggled(bool checked);
+    void onShapeMatchActivated(qint64 startMs, qint64 endMs);
+
+    // 录制会话
+    void onSessionButtonClicked();
+    void onSessionsClicked();
+    void onSessionActivated(qint64 startMs, qint64 endMs);
 
     // 状态更新
     void onConnectionStatusChanged(bool connected);
     void onErrorOccurred(const QString &error);
+    void onStorageAvailabilityChanged(bool available);
 
-    // 定时更新统计信息
+    // 统计信息：数据变化后合并刷新
     void updateStatistics();
+    void scheduleStatistics();
+
+    // 分阶段启动：数据库在后台就绪
+    void onStorageReady(bool available, const RangeStatistics &stats, qint64 elapsedMs);
 
 private:
     // UI组件
@@ -60,11 +118,24 @@ private:
     void createDataManagementGroup();
     void createChartGroup();
     void createStatusBar();
+    // 窗口最小化或隐藏时暂停界面刷新、频谱计算与端口轮询
+    void updateRenderingState();
 
     // 核心组件
+    QThread *m_acquisitionThread;
     SerialPortHandler *m_serialPort;
+    PortSupervisor *m_portSupervisor;
+    RateController *m_rateController;
+    bool m_isConnected;
+    bool m_isReconnecting;
+    bool m_isReceiving;   // 本次连接已收到样本，只在开始接收时记录日志
+    SerialReplay *m_serialReplay;
     DataManager *m_dataManager;
     ChartWidget *m_chartWidget;
+    HistoryChartWidget *m_historyWidget;
+    ShapeSearchWidget *m_shapeSearchWidget;
+    UiUpdateScheduler *m_uiScheduler;
+    EventDetector *m_eventDetector;
 
     // 串口控制组件
     QComboBox *m_portComboBox;
@@ -72,6 +143,14 @@ private:
     QPushButton *m_connectButton;
     QPushButton *m_refreshPortsButton;
     QLabel *m_connectionStatusLabel;
+    QComboBox *m_readModeComboBox;
+    QCheckBox *m_busyPollCheckBox;
+    QLabel *m_acquisitionStatsLabel;
+    QCheckBox *m_adaptiveRateCheckBox;
+    QLabel *m_reportRateLabel;
+    QCheckBox *m_captureCheckBox;
+    QPushButton *m_replayButton;
+    QComboBox *m_replaySpeedComboBox;
 
     // 实时显示组件
     QLabel *m_currentDistanceLabel;
@@ -80,19 +159,41 @@ private:
 
     // 数据管理组件
     QCheckBox *m_autoSaveCheckBox;
+    QDoubleSpinBox *m_compressionSpinBox;
+    QLabel *m_compressionLabel;
     QPushButton *m_saveDataButton;
     QPushButton *m_queryDataButton;
     QPushButton *m_exportCSVButton;
     QPushButton *m_exportTXTButton;
     QPushButton *m_clearDataButton;
+    QPushButton *m_importButton;
+
+    // 录制会话：当前会话 id（-1 为未录制），目录窗口首次使用时创建
+    QLineEdit *m_sessionNameEdit;
+    QPushButton *m_sessionButton;
+    QPushButton *m_sessionsButton;
+    SessionCatalogWidget *m_sessionCatalog;
+    qint64 m_activeSessionId;
+    qint64 m_runStartMs;   // 本次运行开始时刻（存储毫秒），此前未关闭的会话由 recoverSessions 收尾
     QTableWidget *m_dataTableWidget;
 
+    // 批量导入（后台线程，首次使用时创建）
+    QThread *m_importThread;
+    BulkImporter *m_importer;
+    bool m_isImporting;
+
     // 图表控制组件
     QPushButton *m_clearChartButton;
     QPushButton *m_pauseChartButton;
+    QPushButton *m_historyButton;
+    QPushButton *m_shapeSearchButton;
+    QPushButton *m_spectrumButton;
     bool m_isChartPaused;
 
     // 统计信息组件
+    QCheckBox *m_statsRangeCheckBox;
+    QDateTimeEdit *m_statsFromEdit;
+    QDateTimeEdit *m_statsToEdit;
     QLabel *m_totalRecordsLabel;
     QLabel *m_avgDistanceLabel;
     QLabel *m_minDistanceLabel;
@@ -101,13 +202,59 @@ private:
     // 日志显示
     QTextEdit *m_logTextEdit;
 
-    // 定时器
+    // 统计刷新：数据变化后最多每秒一次，不可见时只记下待刷新
     QTimer *m_statisticsTimer;
+    bool m_statisticsDirty;
+    bool m_isRendering;
+
+    // 样本广播环与存储消费者
+    SampleBus *m_sampleBus;
+    QThread *m_storageThread;
+    QObject *m_storageContext;
+    int m_storageConsumerId;
+    std::atomic<bool> m_autoSave;
+
+    // 同机进程读取的实时样本共享内存段
+    LiveSegmentWriter *m_liveSegment;
+
+    // 频谱分析（独立线程，显示时才计算）
+    QThread *m_spectrumThread;
+    SpectrumAnalyzer *m_spectrumAnalyzer;
+    SpectrumWidget *m_spectrumWidget;
+
+    // 等待存储追平的操作
+    static const int kCatchUpTimeoutMs = 3000;
+    struct CatchUpWaiter {
+        quint64 sequence;       // 暂存序号，见 DataManager::requestReplay()
+        qint64 deadlineMs;      // m_startupClock 时间，-1 表示一直等待
+        std::function<void()> action;
+    };
+    QVector<CatchUpWaiter> m_catchUpWaiters;
+    QTimer *m_catchUpTimer;
+
+    // 启动耗时（毫秒，-1 表示尚未发生）
+    QElapsedTimer m_startupClock;
+    qint64 m_firstFrameMs;
+    qint64 m_firstSampleMs;
+
+    // 错误去重
+    static const int kErrorRepeatWindowMs = 10000;
+    QHash<QString, qint64> m_errorLastShownMs;
+    QHash<QString, int> m_errorRepeatCount;
 
     // 辅助方法
     void logMessage(const QString &message);
     void updateConnectionButton(bool connected);
     void loadRecentData();
+    void setStorageControlsEnabled(bool enabled);
+    // 在存储消费者的线程中写完广播环积压并落盘压缩器中的点
+    void flushStorageConsumer();
+    // 存储追平后执行 action：广播环积压在存储线程写完，再请回放线程补写暂存，界面线程不等待。
+    // timeoutMs > 0 时最多等这么久，超时照常执行并在日志中注明尚未入库的样本数
+    void afterStorageCatchUp(std::function<void()> action, int timeoutMs = kCatchUpTimeoutMs);
+    void checkCatchUp();
+    void showShapeSearch();
+    void showStatistics(const RangeStatistics &stats);
 };
 
 #endif // MAINWINDOW_H
@@ -0,0 +1,288 @@
+#include "portsupervisor.h"
+#include "serialport.h"
+#include <QSerialPortInfo>
+#include <QSocketNotifier>
+#include <QDebug>
+
+#ifdef Q_OS_LINUX
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <unistd.h>
+#include <cstring>
+#endif
+
+// 重连退避：设备刚出现时 udev 可能尚未设置好权限，先快速重试
+static const int kInitialRetryMs = 10;
+static const int kMaxRetryMs = 5000;
+// 端口列表轮询间隔：有热插拔通知时仅用于兜底
+static const int kPollIntervalMs = 1000;
+static const int kHotplugPollIntervalMs = 10000;
+
+PortSupervisor::PortSupervisor(SerialPortHandler *handler, QObject *parent)
+    : QObject(parent)
+    , m_handler(handler)
+    , m_vendorId(0)
+    , m_productId(0)
+    , m_hasVidPid(false)
+    , m_baudRate(9600)
+    , m_active(false)
+    , m_reconnecting(false)
+    , m_gapStartUs(0)
+    , m_retryDelayMs(kInitialRetryMs)
+    , m_failedReopens(0)
+    , m_retryTimer(new QTimer(this))
+    , m_pollTimer(new QTimer(this))
+    , m_hotplugFd(-1)
+    , m_hotplugNotifier(nullptr)
+{
+    m_retryTimer->setSingleShot(true);
+    connect(m_retryTimer, &QTimer::timeout, this, &PortSupervisor::attemptReconnect);
+    connect(m_pollTimer, &QTimer::timeout, this, &PortSupervisor::onPollTimer);
+    connect(m_handler, &SerialPortHandler::connectionLost, this, &PortSupervisor::onConnectionLost);
+}
+
+PortSupervisor::~PortSupervisor()
+{
+    closeHotplugSocket();
+}
+
+void PortSupervisor::start()
+{
+    bool hotplug = openHotplugSocket();
+    m_pollTimer->start(hotplug ? kHotplugPollIntervalMs : kPollIntervalMs);
+
+    // 首次枚举总是通知界面，即使没有任何端口
+    m_knownPorts = SerialPortHandler::getAvailablePorts();
+    emit portsChanged(m_knownPorts);
+}
+
+void PortSupervisor::setPolling(bool enabled)
+{
+    if (!enabled) {
+        m_pollTimer->stop();
+        return;
+    }
+    if (!m_pollTimer->isActive()) {
+        m_pollTimer->start(m_hotplugFd >= 0 ? kHotplugPollIntervalMs : kPollIntervalMs);
+        scanPorts();
+    }
+}
+
+void PortSupervisor::connectTo(const QString &portName, qint32 baudRate)
+{
+    m_portName = portName;
+    m_baudRate = baudRate;
+    m_serialNumber.clear();
+    m_hasVidPid = false;
+
+    // 记下设备身份，重新枚举后按身份查找
+    for (const QSerialPortInfo &info : QSerialPortInfo::availablePorts()) {
+        if (info.portName() == portName) {
+            m_serialNumber = info.serialNumber();
+            m_hasVidPid = info.hasVendorIdentifier() && info.hasProductIdentifier();
+            m_vendorId = info.vendorIdentifier();
+            m_productId = info.productIdentifier();
+            break;
+        }
+    }
+
+    m_retryTimer->stop();
+    if (m_reconnecting) {
+        m_reconnecting = false;
+        emit reconnectingChanged(false);
+    }
+    m_active = m_handler->openPort(portName, baudRate);
+}
+
+void PortSupervisor::disconnectFrom()
+{
+    m_active = false;
+    m_retryTimer->stop();
+    if (m_reconnecting) {
+        m_reconnecting = false;
+        emit reconnectingChanged(false);
+    }
+    m_handler->closePort();
+}
+
+void PortSupervisor::onConnectionLost(const QString &reason)
+{
+    if (!m_active || m_reconnecting) {
+        return;
+    }
+
+    // 中断从最后一个样本之后开始
+    qint64 lastSampleUs = m_handler->lastSampleTimestampUs();
+    m_gapStartUs = lastSampleUs > 0 ? lastSampleUs : SerialPortHandler::currentTimestampUs();
+    m_gapReason = reason;
+    m_reconnecting = true;
+    m_retryDelayMs = kInitialRetryMs;
+    m_lastReopenError.clear();
+    m_failedReopens = 0;
+    emit reconnectingChanged(true);
+    qDebug() << "Port lost:" << m_portName << reason;
+
+    attemptReconnect();
+}
+
+void PortSupervisor::attemptReconnect()
+{
+    if (!m_reconnecting) {
+        return;
+    }
+
+    QString portName = findTargetPort();
+    if (!portName.isEmpty()) {
+        if (m_handler->openPort(portName, m_baudRate, false)) {
+            qint64 nowUs = SerialPortHandler::currentTimestampUs();
+            m_portName = portName;
+            m_reconnecting = false;
+            m_retryDelayMs = kInitialRetryMs;
+            emit reconnectingChanged(false);
+            emit gapRecorded(m_gapStartUs, nowUs, m_gapReason);
+            return;
+        }
+
+        // 设备已出现但打不开（常见为 udev 尚未设置权限），同一错误只报告一次
+        ++m_failedReopens;
+        QString error = m_handler->errorString();
+        if (error != m_lastReopenError) {
+            m_lastReopenError = error;
+            emit errorOccurred(QString("Reconnect to %1 failed (attempt %2): %3")
+                                   .arg(portName).arg(m_failedReopens).arg(error));
+        }
+    }
+
+    // 设备不在时也保持退避重试，防止漏掉热插拔通知
+    m_retryTimer->start(m_retryDelayMs);
+    m_retryDelayMs = qMin(m_retryDelayMs * 2, kMaxRetryMs);
+}
+
+QString PortSupervisor::findTargetPort() const
+{
+    const QList<QSerialPortInfo> ports = QSerialPortInfo::availablePorts();
+
+    // 优先序列号，其次 VID:PID（同名端口优先），最后端口名
+    if (!m_serialNumber.isEmpty()) {
+        for (const QSerialPortInfo &info : ports) {
+            if (info.serialNumber() == m_serialNumber) {
+                return info.portName();
+            }
+        }
+        return QString();
+    }
+
+    if (m_hasVidPid) {
+        QString candidate;
+        for (const QSerialPortInfo &info : ports) {
+            if (info.hasVendorIdentifier() && info.vendorIdentifier() == m_vendorId
+                && info.hasProductIdentifier() && info.productIdentifier() == m_productId) {
+                if (info.portName() == m_portName) {
+                    return info.portName();
+                }
+                if (candidate.isEmpty()) {
+                    candidate = info.portName();
+                }
+            }
+        }
+        return candidate;
+    }
+
+    for (const QSerialPortInfo &info : ports) {
+        if (info.portName() == m_portName) {
+            return info.portName();
+        }
+    }
+    return QString();
+}
+
+void PortSupervisor::onPollTimer()
+{
+    scanPorts();
+}
+
+void PortSupervisor::scanPorts()
+{
+    QStringList ports = SerialPortHandler::getAvailablePorts();
+    if (ports != m_knownPorts) {
+        bool added = false;
+        for (const QString &port : ports) {
+            added = added || !m_knownPorts.contains(port);
+        }
+        m_knownPorts = ports;
+        emit portsChanged(ports);
+
+        // 有设备出现：立即重试，不等退避定时器
+        if (added && m_reconnecting) {
+            m_retryTimer->stop();
+            m_retryDelayMs = kInitialRetryMs;
+            attemptReconnect();
+        }
+    }
+}
+
+bool PortSupervisor::openHotplugSocket()
+{
+#ifdef Q_OS_LINUX
+    // 内核 uevent 组播，不依赖 libudev，普通用户即可订阅
+    int fd = ::socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, NETLINK_KOBJECT_UEVENT);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct sockaddr_nl address;
+    std::memset(&address, 0, sizeof(address));
+    address.nl_family = AF_NETLINK;
+    address.nl_groups = 1;
+    if (::bind(fd, reinterpret_cast<struct sockaddr *>(&address), sizeof(address)) != 0) {
+        ::close(fd);
+        return false;
+    }
+
+    m_hotplugFd = fd;
+    m_hotplugNotifier = new QSocketNotifier(fd, QSocketNotifier::Read, this);
+    connect(m_hotplugNotifier, &QSocketNotifier::activated, this, &PortSupervisor::onHotplugActivated);
+    return true;
+#else
+    return false;
+#endif
+}
+
+void PortSupervisor::closeHotplugSocket()
+{
+    delete m_hotplugNotifier;
+    m_hotplugNotifier = nullptr;
+#ifdef Q_OS_LINUX
+    if (m_hotplugFd >= 0) {
+        ::close(m_hotplugFd);
+    }
+#endif
+    m_hotplugFd = -1;
+}
+
+void PortSupervisor::onHotplugActivated()
+{
+#ifdef Q_OS_LINUX
+    bool ttyChanged = false;
+    char buffer[8192];
+    while (true) {
+        ssize_t length = ::recv(m_hotplugFd, buffer, sizeof(buffer) - 1, 0);
+        if (length <= 0) {
+            break;
+        }
+        buffer[length] = '\0';
+
+        // 消息格式："action@devpath\0KEY=VALUE\0..."，只关心 tty 子系统
+        for (ssize_t offset = 0; offset < length; offset += std::strlen(buffer + offset) + 1) {
+            if (std::strcmp(buffer + offset, "SUBSYSTEM=tty") == 0) {
+                ttyChanged = true;
+                break;
+            }
+        }
+    }
+
+    if (ttyChanged) {
+        scanPorts();
+    }
+#endif
+}
@@ -0,0 +1,76 @@
+#ifndef PORTSUPERVISOR_H
+#define PORTSUPERVISOR_H
+
+#include <QObject>
+#include <QTimer>
+#include <QStringList>
+
+class QSocketNotifier;
+class SerialPortHandler;
+
+/**
+ * @brief 串口监管：热插拔发现与掉线自动重连，与 SerialPortHandler 同在采集线程
+ *
+ * 连接时记下设备的序列号和 VID:PID，掉线后按此在所有串口中查找（设备重新枚举后端口名可能变化），
+ * 以指数退避重试打开。Linux 下监听内核 uevent，设备出现后立即重试；其他平台轮询端口列表。
+ * 重连成功后报告中断区间，由调用方写入存储。重试中的打开失败不逐次报告，
+ * 只在错误描述变化时发出一次 errorOccurred。
+ */
+class PortSupervisor : public QObject {
+    Q_OBJECT
+
+public:
+    explicit PortSupervisor(SerialPortHandler *handler, QObject *parent = nullptr);
+    ~PortSupervisor();
+
+public slots:
+    void start();
+    void connectTo(const QString &portName, qint32 baudRate);
+    void disconnectFrom();
+    // 端口列表轮询（界面不可见时暂停）；恢复时立即枚举一次。热插拔通知与掉线重连不受影响
+    void setPolling(bool enabled);
+
+signals:
+    void portsChanged(const QStringList &ports);
+    void reconnectingChanged(bool reconnecting);
+    void gapRecorded(qint64 startUs, qint64 endUs, const QString &reason);
+    void errorOccurred(const QString &error);
+
+private slots:
+    void onConnectionLost(const QString &reason);
+    void onHotplugActivated();
+    void onPollTimer();
+    void attemptReconnect();
+
+private:
+    bool openHotplugSocket();
+    void closeHotplugSocket();
+    void scanPorts();
+    QString findTargetPort() const;
+
+    SerialPortHandler *m_handler;
+
+    // 目标设备
+    QString m_portName;
+    QString m_serialNumber;
+    quint16 m_vendorId;
+    quint16 m_productId;
+    bool m_hasVidPid;
+    qint32 m_baudRate;
+
+    bool m_active;           // 用户要求保持连接
+    bool m_reconnecting;
+    qint64 m_gapStartUs;
+    QString m_gapReason;
+    int m_retryDelayMs;
+    QString m_lastReopenError;   // 已报告的重试错误，相同错误不再重复
+    int m_failedReopens;
+
+    QTimer *m_retryTimer;
+    QTimer *m_pollTimer;
+    int m_hotplugFd;
+    QSocketNotifier *m_hotplugNotifier;
+    QStringList m_knownPorts;
+};
+
+#endif // PORTSUPERVISOR_H
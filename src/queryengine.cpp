@@ -0,0 +1,422 @@
+#include "queryengine.h"
+#include "samplefixed.h"
+#include <QMutex>
+#include <QThread>
+#include <QWaitCondition>
+#include <algorithm>
+#include <vector>
+
+// 每个分片的目标行数
+static const qint64 kSliceRows = 250000;
+// 每个工作线程最多领先调用方的分片数
+static const int kSlicesAheadPerThread = 2;
+// 增量变更每批读取的条数
+static const int kChangeBatch = 8192;
+
+// 稀疏直方图：出现过的定点值按升序排列及其个数，大小与不同值的个数成正比而不是与量程成正比
+struct ValueCount {
+    qint32 value;
+    qint64 count;
+};
+using Histogram = QVector<ValueCount>;
+
+struct QueryEngine::Partial {
+    qint64 startMs = 0;
+    qint64 count = 0;
+    double sum = 0.0;
+    double min = 0.0;
+    double max = 0.0;
+    bool complete = false;          // 桶完全落在本分片内
+    QVector<double> percentiles;    // complete 时已算出
+    Histogram histogram;            // 否则为定点值直方图，合并后再取百分位
+};
+
+struct QueryEngine::Slice {
+    qint64 startMs = 0;
+    qint64 endMs = 0;
+    bool done = false;
+    RecordSet records;
+    QVector<Partial> partials;
+};
+
+static qint64 floorTo(qint64 value, qint64 step)
+{
+    qint64 quotient = value / step;
+    if (value % step < 0) {
+        --quotient;
+    }
+    return quotient * step;
+}
+
+static double percentileSorted(const QVector<qint32> &sorted, double percentile)
+{
+    double position = percentile / 100.0 * (sorted.size() - 1);
+    int lower = int(position);
+    int upper = qMin(lower + 1, sorted.size() - 1);
+    double fraction = position - lower;
+    return SampleFixed::toDouble(sorted[lower]) * (1.0 - fraction) + SampleFixed::toDouble(sorted[upper]) * fraction;
+}
+
+static void buildHistogram(const QVector<qint32> &sorted, Histogram &histogram)
+{
+    histogram.clear();
+    for (qint32 value : sorted) {
+        if (!histogram.isEmpty() && histogram.last().value == value) {
+            ++histogram.last().count;
+        } else {
+            histogram.append({value, 1});
+        }
+    }
+}
+
+static void mergeHistogram(Histogram &histogram, const Histogram &other)
+{
+    Histogram merged;
+    merged.reserve(histogram.size() + other.size());
+    int i = 0;
+    int j = 0;
+    while (i < histogram.size() || j < other.size()) {
+        if (j >= other.size() || (i < histogram.size() && histogram[i].value < other[j].value)) {
+            merged.append(histogram[i++]);
+        } else if (i >= histogram.size() || other[j].value < histogram[i].value) {
+            merged.append(other[j++]);
+        } else {
+            merged.append({histogram[i].value, histogram[i].count + other[j].count});
+            ++i;
+            ++j;
+        }
+    }
+    histogram = std::move(merged);
+}
+
+static qint32 histogramValueAt(const Histogram &histogram, qint64 rank)
+{
+    qint64 seen = 0;
+    for (const ValueCount &entry : histogram) {
+        seen += entry.count;
+        if (seen > rank) {
+            return entry.value;
+        }
+    }
+    return histogram.last().value;
+}
+
+static double percentileHistogram(const Histogram &histogram, qint64 count, double percentile)
+{
+    double position = percentile / 100.0 * (count - 1);
+    qint64 lower = qint64(position);
+    double fraction = position - lower;
+    qint32 a = histogramValueAt(histogram, lower);
+    qint32 b = fraction > 0.0 ? histogramValueAt(histogram, lower + 1) : a;
+    return SampleFixed::toDouble(a) * (1.0 - fraction) + SampleFixed::toDouble(b) * fraction;
+}
+
+QueryEngine::QueryEngine(const QString &dbPath, int threads)
+    : m_dbPath(dbPath)
+    , m_threads(threads > 0 ? threads : qMax(1, QThread::idealThreadCount()))
+    , m_storage(nullptr)
+{
+}
+
+QueryEngine::~QueryEngine()
+{
+    delete m_storage;
+}
+
+bool QueryEngine::open()
+{
+    if (m_storage) {
+        return true;
+    }
+    m_storage = new DataManager();
+    QObject::connect(m_storage, &DataManager::errorOccurred, [this](const QString &error) { m_error = error; });
+    if (!m_storage->openReadOnly(m_dbPath, "query_main")) {
+        delete m_storage;
+        m_storage = nullptr;
+        return false;
+    }
+    return true;
+}
+
+bool QueryEngine::timeBounds(qint64 &firstMs, qint64 &lastMs)
+{
+    if (!m_storage->queryTimeBounds(firstMs, lastMs)) {
+        m_error = "Database has no records";
+        return false;
+    }
+    return true;
+}
+
+bool QueryEngine::changes(qint64 sinceWatermark, const ChangeSink &sink, qint64 &watermark)
+{
+    watermark = sinceWatermark;
+    QVector<RecordChange> batch;
+    do {
+        if (!m_storage->readChanges(watermark, kChangeBatch, batch, watermark)) {
+            return false;
+        }
+        if (!batch.isEmpty() && !sink(batch)) {
+            return false;
+        }
+    } while (batch.size() == kChangeBatch);
+    return true;
+}
+
+QVector<qint64> QueryEngine::sliceBounds(qint64 startMs, qint64 endMs, qint64 bucketMs)
+{
+    // 行数按汇总表估计（只读打开时旧库可能没有汇总，此时只按线程数切分）
+    RangeStatistics stats;
+    QString error = m_error;
+    qint64 rows = m_storage->queryStatistics(startMs, endMs, stats) ? stats.count : 0;
+    m_error = error;
+
+    qint64 slices = qMax<qint64>(m_threads * 4, rows / kSliceRows);
+    qint64 span = qMax<qint64>(1, (endMs - startMs + slices - 1) / slices);
+
+    // 分片不窄于桶时按桶边界切分，桶不会跨分片
+    qint64 origin = startMs;
+    if (bucketMs > 0 && span >= bucketMs) {
+        span = (span + bucketMs - 1) / bucketMs * bucketMs;
+        origin = floorTo(startMs, bucketMs);
+    }
+
+    QVector<qint64> bounds{startMs};
+    for (qint64 bound = origin + span; bound < endMs; bound += span) {
+        bounds.append(bound);
+    }
+    bounds.append(endMs);
+    return bounds;
+}
+
+bool QueryEngine::runSlices(const QVector<qint64> &bounds, const Producer &produce, const Consumer &consume)
+{
+    const int count = bounds.size() - 1;
+    std::vector<Slice> slices(static_cast<size_t>(count));
+    for (int i = 0; i < count; ++i) {
+        slices[i].startMs = bounds[i];
+        slices[i].endMs = bounds[i + 1];
+    }
+
+    QMutex mutex;
+    QWaitCondition ready;
+    QWaitCondition space;
+    int next = 0;
+    int consumed = 0;
+    bool stop = false;
+    QString error;
+    const int ahead = m_threads * kSlicesAheadPerThread;
+
+    // 每个工作线程一个只读连接，按序领取分片；领先调用方过多时等待
+    QVector<QThread *> threads;
+    for (int t = 0; t < qMin(m_threads, count); ++t) {
+        QThread *thread = QThread::create([&, t]() {
+            DataManager storage;
+            QString storageError;
+            QObject::connect(&storage, &DataManager::errorOccurred,
+                             [&storageError](const QString &message) { storageError = message; });
+            bool ok = storage.openReadOnly(m_dbPath, QString("query_%1").arg(t));
+            while (ok) {
+                mutex.lock();
+                while (!stop && next < count && next >= consumed + ahead) {
+                    space.wait(&mutex);
+                }
+                if (stop || next >= count) {
+                    mutex.unlock();
+                    break;
+                }
+                int index = next++;
+                mutex.unlock();
+
+                ok = produce(storage, slices[index]);
+
+                mutex.lock();
+                slices[index].done = true;
+                ready.wakeAll();
+                mutex.unlock();
+            }
+            if (!ok) {
+                mutex.lock();
+                if (error.isEmpty()) {
+                    error = storageError.isEmpty() ? QString("Query worker failed") : storageError;
+                }
+                stop = true;
+                ready.wakeAll();
+                space.wakeAll();
+                mutex.unlock();
+            }
+        });
+        thread->start();
+        threads.append(thread);
+    }
+
+    // 调用方线程按分片顺序输出，输出后立即释放该分片
+    bool ok = true;
+    for (int i = 0; i < count && ok; ++i) {
+        mutex.lock();
+        while (!slices[i].done && !stop) {
+            ready.wait(&mutex);
+        }
+        ok = !stop;
+        mutex.unlock();
+
+        if (ok) {
+            ok = consume(slices[i]);
+            slices[i] = Slice();
+        }
+
+        mutex.lock();
+        consumed = i + 1;
+        stop = stop || !ok;
+        space.wakeAll();
+        mutex.unlock();
+    }
+
+    mutex.lock();
+    stop = true;
+    space.wakeAll();
+    mutex.unlock();
+    for (QThread *thread : threads) {
+        thread->wait();
+        delete thread;
+    }
+
+    if (!error.isEmpty()) {
+        m_error = error;
+        return false;
+    }
+    return ok;
+}
+
+bool QueryEngine::select(qint64 startMs, qint64 endMs, const RecordSink &sink)
+{
+    if (endMs <= startMs) {
+        return true;
+    }
+    return runSlices(sliceBounds(startMs, endMs, 0),
+        [](DataManager &storage, Slice &slice) {
+            return storage.queryRange(slice.startMs, slice.endMs, slice.records);
+        },
+        [&sink](Slice &slice) {
+            return slice.records.isEmpty() || sink(slice.records);
+        });
+}
+
+bool QueryEngine::aggregate(qint64 startMs, qint64 endMs, qint64 bucketMs, const QVector<double> &percentiles,
+                            const BucketSink &sink)
+{
+    if (endMs <= startMs) {
+        return true;
+    }
+
+    auto produce = [startMs, endMs, bucketMs, &percentiles](DataManager &storage, Slice &slice) {
+        RecordSet records;
+        if (!storage.queryRange(slice.startMs, slice.endMs, records)) {
+            return false;
+        }
+
+        const QVector<qint64> &times = records.timestampsMs();
+        const QVector<double> &values = records.distances();
+        const int n = records.size();
+        QVector<qint32> sorted;
+        int begin = 0;
+        while (begin < n) {
+            qint64 key = bucketMs > 0 ? floorTo(times[begin], bucketMs) : startMs;
+            int end = begin + 1;
+            while (end < n && (bucketMs <= 0 || times[end] < key + bucketMs)) {
+                ++end;
+            }
+
+            Partial partial;
+            partial.startMs = key;
+            partial.count = end - begin;
+            partial.min = values[begin];
+            partial.max = values[begin];
+            for (int i = begin; i < end; ++i) {
+                partial.sum += values[i];
+                partial.min = qMin(partial.min, values[i]);
+                partial.max = qMax(partial.max, values[i]);
+            }
+
+            qint64 low = bucketMs > 0 ? qMax(key, startMs) : startMs;
+            qint64 high = bucketMs > 0 ? qMin(key + bucketMs, endMs) : endMs;
+            partial.complete = slice.startMs <= low && high <= slice.endMs;
+
+            if (!percentiles.isEmpty()) {
+                sorted.resize(end - begin);
+                for (int i = begin; i < end; ++i) {
+                    sorted[i - begin] = SampleFixed::fromDouble(values[i]);
+                }
+                std::sort(sorted.begin(), sorted.end());
+                if (partial.complete) {
+                    for (double percentile : percentiles) {
+                        partial.percentiles.append(percentileSorted(sorted, percentile));
+                    }
+                } else {
+                    buildHistogram(sorted, partial.histogram);
+                }
+            }
+            slice.partials.append(partial);
+            begin = end;
+        }
+        return true;
+    };
+
+    auto finish = [&percentiles](const Partial &partial) {
+        BucketAggregate bucket;
+        bucket.startMs = partial.startMs;
+        bucket.count = partial.count;
+        bucket.sum = partial.sum;
+        bucket.min = partial.min;
+        bucket.max = partial.max;
+        bucket.percentiles = partial.percentiles;
+        if (!partial.complete) {
+            for (double percentile : percentiles) {
+                bucket.percentiles.append(percentileHistogram(partial.histogram, partial.count, percentile));
+            }
+        }
+        return bucket;
+    };
+
+    // 跨分片的桶在此按顺序合并，遇到下一个桶时输出
+    Partial pending;
+    bool hasPending = false;
+    auto flush = [&]() {
+        if (!hasPending) {
+            return true;
+        }
+        hasPending = false;
+        return sink(finish(pending));
+    };
+
+    auto consume = [&](Slice &slice) {
+        for (Partial &partial : slice.partials) {
+            if (partial.complete) {
+                if (!flush() || !sink(finish(partial))) {
+                    return false;
+                }
+            } else if (hasPending && pending.startMs == partial.startMs) {
+                pending.count += partial.count;
+                pending.sum += partial.sum;
+                pending.min = qMin(pending.min, partial.min);
+                pending.max = qMax(pending.max, partial.max);
+                mergeHistogram(pending.histogram, partial.histogram);
+            } else {
+                if (!flush()) {
+                    return false;
+                }
+                pending = std::move(partial);
+                hasPending = true;
+            }
+        }
+        return true;
+    };
+
+    return runSlices(sliceBounds(startMs, endMs, bucketMs), produce, consume) && flush();
+}
+
+bool QueryEngine::downsample(qint64 startMs, qint64 endMs, qint64 bucketMs, QVector<HistoryBucket> &buckets)
+{
+    m_error.clear();
+    buckets = m_storage->queryDownsampled(startMs, endMs, bucketMs);
+    return m_error.isEmpty();
+}
@@ -0,0 +1,78 @@
+#ifndef QUERYENGINE_H
+#define QUERYENGINE_H
+
+#include <QString>
+#include <QVector>
+#include <functional>
+
+#include "datamanager.h"
+
+/**
+ * @brief 时间桶聚合结果
+ */
+struct BucketAggregate {
+    qint64 startMs;                // 桶起始（存储毫秒）；不分桶时为查询起点
+    qint64 count;
+    double sum;
+    double min;
+    double max;
+    QVector<double> percentiles;   // 与请求的百分位一一对应
+
+    double mean() const { return count > 0 ? sum / count : 0.0; }
+};
+
+/**
+ * @brief 并行只读查询，供命令行工具等批处理使用
+ *
+ * 查询区间按时间切成若干分片（按汇总表估计行数，每片约 kSliceRows 行），
+ * 每个工作线程持有自己的只读连接，按序领取分片扫描并在线程内完成聚合；
+ * 结果按分片顺序交给调用方的回调，同时在途的分片数有上限，内存占用与总行数无关。
+ *
+ * 百分位在定点值（见 samplefixed.h）上精确计算，相邻秩之间线性插值：
+ * 桶完全落在一个分片内时对桶内样本排序；跨分片的桶（桶宽大于分片或不分桶）
+ * 各分片生成稀疏的定点值直方图（只含出现过的值），按顺序合并后再取值。只输出有样本的桶。
+ */
+class QueryEngine {
+public:
+    using RecordSink = std::function<bool(const RecordSet &records)>;
+    using BucketSink = std::function<bool(const BucketAggregate &bucket)>;
+    using ChangeSink = std::function<bool(const QVector<RecordChange> &changes)>;
+
+    // threads <= 0 时使用全部核心
+    explicit QueryEngine(const QString &dbPath, int threads = 0);
+    ~QueryEngine();
+
+    bool open();
+    QString errorString() const { return m_error; }
+    int threadCount() const { return m_threads; }
+
+    // 库中第一条与最后一条记录的时间（存储毫秒）
+    bool timeBounds(qint64 &firstMs, qint64 &lastMs);
+
+    // [startMs, endMs) 内的原始记录，按时间升序分块交给 sink；sink 返回 false 时停止
+    bool select(qint64 startMs, qint64 endMs, const RecordSink &sink);
+    // 按 bucketMs（0 为整个区间一桶）聚合计数/均值/最值及百分位（0-100）
+    bool aggregate(qint64 startMs, qint64 endMs, qint64 bucketMs, const QVector<double> &percentiles,
+                   const BucketSink &sink);
+    // 每桶最小/最大值，优先使用汇总表
+    bool downsample(qint64 startMs, qint64 endMs, qint64 bucketMs, QVector<HistoryBucket> &buckets);
+    // 水位 sinceWatermark 之后的全部增量变更（见 DataManager::readChanges），按序号分批交给 sink；
+    // watermark 返回新水位，下次从它继续
+    bool changes(qint64 sinceWatermark, const ChangeSink &sink, qint64 &watermark);
+
+private:
+    struct Slice;
+    struct Partial;
+    using Producer = std::function<bool(DataManager &storage, Slice &slice)>;
+    using Consumer = std::function<bool(Slice &slice)>;
+
+    QVector<qint64> sliceBounds(qint64 startMs, qint64 endMs, qint64 bucketMs);
+    bool runSlices(const QVector<qint64> &bounds, const Producer &produce, const Consumer &consume);
+
+    QString m_dbPath;
+    int m_threads;
+    DataManager *m_storage;
+    QString m_error;
+};
+
+#endif // QUERYENGINE_H
@@ -0,0 +1,219 @@
+#include "ratecontroller.h"
+#include "serialport.h"
+#include <cstdlib>
+
+// 上报间隔档位，100 ms 为固件默认值
+static const int kIntervalsMs[] = {20, 50, 100, 200, 500, 1000};
+static const int kLevelCount = sizeof(kIntervalsMs) / sizeof(kIntervalsMs[0]);
+static const int kDefaultIntervalMs = 100;
+// 变化阈值（cm），高于传感器 ±0.05 cm 的抖动
+static const double kActivityThresholdCm = 0.5;
+// 平稳多久降一档
+static const int kIdleStepMs = 3000;
+// 命令应答超时与重发次数
+static const int kAckTimeoutMs = 300;
+static const int kMaxRetries = 3;
+
+// 命令名（"!RATE 100 0.50" -> "!RATE"），同名命令互相取代
+static QByteArray commandName(const QByteArray &command)
+{
+    int space = command.indexOf(' ');
+    return space < 0 ? command : command.left(space);
+}
+
+RateController::RateController(SerialPortHandler *handler, QObject *parent)
+    : QObject(parent)
+    , m_handler(handler)
+    , m_enabled(false)
+    , m_connected(false)
+    , m_supported(false)
+    , m_level(0)
+    , m_confirmedIntervalMs(kDefaultIntervalMs)
+    , m_reference(0)
+    , m_hasReference(false)
+    , m_retries(0)
+    , m_retryTimer(new QTimer(this))
+    , m_idleTimer(new QTimer(this))
+{
+    m_retryTimer->setSingleShot(true);
+    m_retryTimer->setInterval(kAckTimeoutMs);
+    connect(m_retryTimer, &QTimer::timeout, this, &RateController::onRetryTimer);
+    m_idleTimer->setInterval(kIdleStepMs / 4);
+    connect(m_idleTimer, &QTimer::timeout, this, &RateController::onIdleTimer);
+
+    connect(m_handler, &SerialPortHandler::connectionStatusChanged, this, &RateController::onConnectionStatusChanged);
+    connect(m_handler, &SerialPortHandler::samplesReceived, this, &RateController::onSamplesReceived);
+    connect(m_handler, &SerialPortHandler::commandAcknowledged, this, &RateController::onCommandAcknowledged);
+}
+
+void RateController::setEnabled(bool enabled)
+{
+    if (enabled == m_enabled) {
+        return;
+    }
+    m_enabled = enabled;
+
+    if (!m_connected) {
+        return;
+    }
+    if (enabled) {
+        sendCommand("!PING");
+    } else {
+        // 恢复固件默认：固定间隔、不按变化上报
+        m_idleTimer->stop();
+        if (m_supported) {
+            sendCommand(QByteArray("!RATE ") + QByteArray::number(kDefaultIntervalMs) + " 0");
+        }
+    }
+}
+
+void RateController::requestBurst(int count, int intervalMs)
+{
+    if (m_enabled && m_connected && m_supported) {
+        sendCommand(QByteArray("!BURST ") + QByteArray::number(count) + " " + QByteArray::number(intervalMs));
+    }
+}
+
+void RateController::onConnectionStatusChanged(bool connected)
+{
+    m_connected = connected;
+    m_supported = false;
+    m_pending.clear();
+    m_queue.clear();
+    m_retryTimer->stop();
+    m_idleTimer->stop();
+    m_hasReference = false;
+    m_confirmedIntervalMs = kDefaultIntervalMs;
+
+    // 每次连接（含自动重连）都重新探测，设备可能已更换
+    if (connected && m_enabled) {
+        sendCommand("!PING");
+    }
+}
+
+void RateController::onSamplesReceived(const SampleBlock &block)
+{
+    if (!m_enabled || !m_supported || block.isEmpty()) {
+        return;
+    }
+
+    static const qint32 threshold = SampleFixed::fromDouble(kActivityThresholdCm);
+    bool active = false;
+    for (qint32 value : block.values) {
+        if (!m_hasReference || std::abs(value - m_reference) >= threshold) {
+            active = active || m_hasReference;
+            m_reference = value;
+            m_hasReference = true;
+        }
+    }
+
+    if (active) {
+        m_sinceActivity.start();
+        if (m_level != 0) {
+            applyLevel(0);
+        }
+        if (!m_idleTimer->isActive()) {
+            m_idleTimer->start();
+        }
+    }
+}
+
+void RateController::onIdleTimer()
+{
+    if (m_sinceActivity.elapsed() >= kIdleStepMs && m_level + 1 < kLevelCount) {
+        applyLevel(m_level + 1);
+        m_sinceActivity.start();
+    }
+    // 已是最低档：停止检查，下一次变化时重新开始
+    if (m_level + 1 >= kLevelCount) {
+        m_idleTimer->stop();
+    }
+}
+
+void RateController::applyLevel(int level)
+{
+    m_level = level;
+    sendCommand(QByteArray("!RATE ") + QByteArray::number(kIntervalsMs[level]) + " "
+                + QByteArray::number(kActivityThresholdCm, 'f', 2));
+}
+
+void RateController::sendCommand(const QByteArray &command)
+{
+    // 同名命令取代尚未应答或仍在排队的旧命令；不同名的排队，BURST 不会挤掉尚未确认的 RATE
+    QByteArray name = commandName(command);
+    if (!m_pending.isEmpty() && commandName(m_pending) != name) {
+        for (QByteArray &queued : m_queue) {
+            if (commandName(queued) == name) {
+                queued = command;
+                return;
+            }
+        }
+        m_queue.append(command);
+        return;
+    }
+    transmit(command);
+}
+
+void RateController::transmit(const QByteArray &command)
+{
+    m_pending = command;
+    m_retries = 0;
+    m_handler->sendCommand(command);
+    m_retryTimer->start();
+}
+
+void RateController::sendNext()
+{
+    m_pending.clear();
+    if (!m_queue.isEmpty()) {
+        transmit(m_queue.takeFirst());
+    }
+}
+
+void RateController::onRetryTimer()
+{
+    if (m_pending.isEmpty()) {
+        return;
+    }
+    if (++m_retries <= kMaxRetries) {
+        m_handler->sendCommand(m_pending);
+        m_retryTimer->start();
+        return;
+    }
+
+    if (!m_supported) {
+        // 探测失败：设备不支持命令，排队的命令一并放弃
+        m_queue.clear();
+        m_pending.clear();
+        emit rateChanged(m_confirmedIntervalMs, false);
+        return;
+    }
+    emit commandFailed(QString::fromLatin1(m_pending));
+    sendNext();
+}
+
+void RateController::onCommandAcknowledged(const QString &reply)
+{
+    if (m_pending.isEmpty() || reply != QString::fromLatin1("ACK " + m_pending.mid(1))) {
+        return;
+    }
+    QByteArray command = m_pending;
+    m_pending.clear();
+    m_retryTimer->stop();
+
+    if (command == "!PING") {
+        m_supported = true;
+        m_sinceActivity.start();
+        m_idleTimer->start();
+        // 从最快档开始，平稳后逐级降低
+        applyLevel(0);
+    } else if (command.startsWith("!RATE ")) {
+        m_confirmedIntervalMs = command.split(' ').value(1).toInt();
+        emit rateChanged(m_confirmedIntervalMs, true);
+    }
+
+    // 上面可能已发出新命令
+    if (m_pending.isEmpty()) {
+        sendNext();
+    }
+}
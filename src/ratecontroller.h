@@ -0,0 +1,78 @@
+#ifndef RATECONTROLLER_H
+#define RATECONTROLLER_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QList>
+#include <QTimer>
+
+#include "samplefixed.h"
+
+class SerialPortHandler;
+
+/**
+ * @brief 自适应采样率控制，与 SerialPortHandler 同在采集线程
+ *
+ * 主机到设备的命令为以 '!' 开头的文本行，设备原样回复 "ACK <命令>"：
+ * - !PING                          探测设备是否支持命令
+ * - !RATE <interval_ms> <delta>    每 interval_ms 上报一次；与上次上报值相差 delta（cm，0 为关闭）时立即上报
+ * - !BURST <count> <interval_ms>   接下来 count 个样本按 interval_ms 上报，之后恢复 RATE 设置
+ *
+ * 信号有变化时立即切到最快档，持续平稳则每 kIdleStepMs 降一档，直到最慢档。
+ * 由于设备在变化超过 delta 时立即上报，降到慢档后也不会错过突变。
+ * 连接后先发送 !PING，未得到应答的设备（旧固件）不再发送任何命令。
+ * 同一时间只有一条命令等待应答，其余排队；同类命令只保留最新的一条。
+ */
+class RateController : public QObject {
+    Q_OBJECT
+
+public:
+    explicit RateController(SerialPortHandler *handler, QObject *parent = nullptr);
+
+public slots:
+    void setEnabled(bool enabled);
+    void requestBurst(int count, int intervalMs);
+
+signals:
+    // intervalMs 为设备确认的上报间隔；supported 为 false 表示设备不支持命令
+    void rateChanged(int intervalMs, bool supported);
+    // 设备支持命令，但重发后仍未应答
+    void commandFailed(const QString &command);
+
+private slots:
+    void onConnectionStatusChanged(bool connected);
+    void onSamplesReceived(const SampleBlock &block);
+    void onCommandAcknowledged(const QString &reply);
+    void onRetryTimer();
+    void onIdleTimer();
+
+private:
+    void sendCommand(const QByteArray &command);
+    void transmit(const QByteArray &command);
+    void sendNext();
+    void applyLevel(int level);
+
+    SerialPortHandler *m_handler;
+    bool m_enabled;
+    bool m_connected;
+    bool m_supported;
+
+    // 档位（kIntervalsMs 下标）与设备已确认的间隔
+    int m_level;
+    int m_confirmedIntervalMs;
+
+    // 活动检测：样本偏离参考值超过阈值即视为变化
+    qint32 m_reference;
+    bool m_hasReference;
+    QElapsedTimer m_sinceActivity;
+
+    // 等待应答的命令，超时重发；其后的命令排队
+    QByteArray m_pending;
+    QList<QByteArray> m_queue;
+    int m_retries;
+    QTimer *m_retryTimer;
+    QTimer *m_idleTimer;
+};
+
+#endif // RATECONTROLLER_H
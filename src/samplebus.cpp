@@ -0,0 +1,244 @@
+#include "samplebus.h"
+#include <QElapsedTimer>
+#include <QThread>
+
+// Block 策略下生产者最长等待时间，超时后该消费者按 Drop 处理，避免采集线程被卡死
+static const int kMaxBlockMs = 1000;
+// 消费者每次交给处理函数的最大样本数
+static const int kDeliverChunk = 4096;
+
+struct SampleBus::Consumer {
+    int id;
+    QString name;
+    OverflowPolicy policy;
+    QObject *context;
+    Handler handler;
+    std::atomic<qint64> cursor{0};        // 下一个要读取的序号
+    std::atomic<bool> wakePending{false};
+    std::atomic<bool> active{true};
+    std::atomic<qint64> maxLag{0};
+    std::atomic<qint64> delivered{0};
+    std::atomic<qint64> dropped{0};
+};
+
+SampleBus::SampleBus(int capacity)
+    : m_claimed(0)
+    , m_published(0)
+    , m_consumers(std::make_shared<const ConsumerList>())
+    , m_nextId(1)
+{
+    qint64 size = 1024;
+    while (size < capacity) {
+        size <<= 1;
+    }
+    m_timestamps.assign(static_cast<size_t>(size), 0);
+    m_values.assign(static_cast<size_t>(size), 0);
+    m_mask = size - 1;
+}
+
+SampleBus::~SampleBus()
+{
+    for (const auto &consumer : *std::atomic_load(&m_consumers)) {
+        consumer->active.store(false);
+    }
+}
+
+int SampleBus::subscribe(const QString &name, OverflowPolicy policy, QObject *context, Handler handler)
+{
+    auto consumer = std::make_shared<Consumer>();
+    consumer->id = m_nextId++;
+    consumer->name = name;
+    consumer->policy = policy;
+    consumer->context = context;
+    consumer->handler = std::move(handler);
+    consumer->cursor.store(m_published.load(std::memory_order_acquire));
+
+    // 订阅表写时复制，生产者读取时无需加锁
+    auto list = std::make_shared<ConsumerList>(*std::atomic_load(&m_consumers));
+    list->push_back(consumer);
+    std::atomic_store(&m_consumers, std::shared_ptr<const ConsumerList>(list));
+    return consumer->id;
+}
+
+void SampleBus::unsubscribe(int id)
+{
+    auto list = std::make_shared<ConsumerList>();
+    for (const auto &consumer : *std::atomic_load(&m_consumers)) {
+        if (consumer->id == id) {
+            consumer->active.store(false);
+        } else {
+            list->push_back(consumer);
+        }
+    }
+    std::atomic_store(&m_consumers, std::shared_ptr<const ConsumerList>(list));
+}
+
+void SampleBus::publish(const SampleBlock &block)
+{
+    const int count = block.size();
+    if (count == 0) {
+        return;
+    }
+
+    const auto consumers = std::atomic_load(&m_consumers);
+    const qint64 capacity = m_mask + 1;
+    const qint64 *timestamps = block.timestampsUs.constData();
+    const qint32 *values = block.values.constData();
+
+    qint64 sequence = m_published.load(std::memory_order_relaxed);
+    int offset = 0;
+    while (offset < count) {
+        // 每段最多半个环，Block 消费者可以分段腾出空间
+        int n = static_cast<int>(qMin<qint64>(count - offset, capacity / 2));
+        qint64 end = sequence + n;
+
+        for (const auto &consumer : *consumers) {
+            if (consumer->policy == Block && consumer->context
+                && end - consumer->cursor.load(std::memory_order_acquire) > capacity) {
+                // 超时后照常覆盖，被覆盖的样本在该消费者读取时计入 dropped（见 stats()）
+                notify(consumer);
+                waitForSpace(consumer.get(), end);
+            }
+        }
+
+        // 先声明将要覆盖的范围，消费者复制后据此判断数据是否仍然有效
+        m_claimed.store(end, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (int i = 0; i < n; ++i) {
+            size_t slot = static_cast<size_t>((sequence + i) & m_mask);
+            m_timestamps[slot] = timestamps[offset + i];
+            m_values[slot] = values[offset + i];
+        }
+        m_published.store(end, std::memory_order_release);
+
+        // 同步消费者每段处理一次，不会落后
+        for (const auto &consumer : *consumers) {
+            if (!consumer->context) {
+                drainConsumer(consumer.get());
+            }
+        }
+
+        sequence = end;
+        offset += n;
+    }
+
+    for (const auto &consumer : *consumers) {
+        if (consumer->context) {
+            notify(consumer);
+        }
+    }
+}
+
+void SampleBus::drain(int id)
+{
+    for (const auto &consumer : *std::atomic_load(&m_consumers)) {
+        if (consumer->id == id) {
+            drainConsumer(consumer.get());
+        }
+    }
+}
+
+void SampleBus::notify(const std::shared_ptr<Consumer> &consumer)
+{
+    // 已有未处理的唤醒时不再投递，积压多少都只排队一次
+    if (consumer->wakePending.exchange(true, std::memory_order_acq_rel)) {
+        return;
+    }
+    QMetaObject::invokeMethod(consumer->context, [this, consumer]() {
+        if (consumer->active.load()) {
+            drainConsumer(consumer.get());
+        }
+    }, Qt::QueuedConnection);
+}
+
+bool SampleBus::waitForSpace(Consumer *consumer, qint64 sequence)
+{
+    const qint64 capacity = m_mask + 1;
+    QElapsedTimer clock;
+    clock.start();
+    while (consumer->active.load() && sequence - consumer->cursor.load(std::memory_order_acquire) > capacity) {
+        if (clock.elapsed() > kMaxBlockMs) {
+            return false;
+        }
+        QThread::yieldCurrentThread();
+    }
+    return true;
+}
+
+void SampleBus::drainConsumer(Consumer *consumer)
+{
+    consumer->wakePending.store(false, std::memory_order_release);
+
+    const qint64 capacity = m_mask + 1;
+    qint64 cursor = consumer->cursor.load(std::memory_order_relaxed);
+    SampleBlock block;
+
+    while (true) {
+        qint64 published = m_published.load(std::memory_order_acquire);
+        qint64 lag = published - cursor;
+        if (lag <= 0) {
+            break;
+        }
+
+        qint64 previousMax = consumer->maxLag.load(std::memory_order_relaxed);
+        while (lag > previousMax && !consumer->maxLag.compare_exchange_weak(previousMax, lag)) {
+        }
+
+        // 已被覆盖的样本直接跳过
+        qint64 oldest = m_claimed.load(std::memory_order_acquire) - capacity;
+        if (cursor < oldest) {
+            consumer->dropped.fetch_add(oldest - cursor, std::memory_order_relaxed);
+            cursor = oldest;
+        }
+
+        // Sample 策略：积压超过半个环时按步长抽取，约四分之一环即可追上
+        qint64 stride = 1;
+        if (consumer->policy == Sample && published - cursor > capacity / 2) {
+            stride = (published - cursor + capacity / 4 - 1) / (capacity / 4);
+        }
+
+        qint64 span = qMin<qint64>(published - cursor, kDeliverChunk * stride);
+        block.clear();
+        block.reserve(static_cast<int>((span + stride - 1) / stride));
+        for (qint64 s = cursor; s < cursor + span; s += stride) {
+            size_t slot = static_cast<size_t>(s & m_mask);
+            block.append(m_timestamps[slot], m_values[slot]);
+        }
+
+        // 复制期间生产者可能已覆盖前段，丢弃这部分
+        std::atomic_thread_fence(std::memory_order_acquire);
+        qint64 valid = m_claimed.load(std::memory_order_relaxed) - capacity;
+        int skipped = 0;
+        if (valid > cursor) {
+            skipped = static_cast<int>(qMin<qint64>(block.size(), (valid - cursor + stride - 1) / stride));
+            block.timestampsUs.remove(0, skipped);
+            block.values.remove(0, skipped);
+        }
+
+        cursor += span;
+        consumer->cursor.store(cursor, std::memory_order_release);
+        consumer->delivered.fetch_add(block.size(), std::memory_order_relaxed);
+        consumer->dropped.fetch_add(span - block.size(), std::memory_order_relaxed);
+
+        if (!block.isEmpty()) {
+            consumer->handler(block);
+        }
+    }
+}
+
+QVector<SampleBus::ConsumerStats> SampleBus::stats() const
+{
+    QVector<ConsumerStats> result;
+    qint64 published = m_published.load(std::memory_order_acquire);
+    for (const auto &consumer : *std::atomic_load(&m_consumers)) {
+        ConsumerStats stats;
+        stats.name = consumer->name;
+        stats.policy = consumer->policy;
+        stats.lag = published - consumer->cursor.load(std::memory_order_acquire);
+        stats.maxLag = consumer->maxLag.exchange(0, std::memory_order_relaxed);
+        stats.delivered = consumer->delivered.load(std::memory_order_relaxed);
+        stats.dropped = consumer->dropped.load(std::memory_order_relaxed);
+        result.append(stats);
+    }
+    return result;
+}
@@ -0,0 +1,79 @@
+#ifndef SAMPLEBUS_H
+#define SAMPLEBUS_H
+
+#include <QObject>
+#include <QPointer>
+#include <QString>
+#include <QVector>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "samplefixed.h"
+
+/**
+ * @brief 样本广播环：单生产者、多消费者，每个消费者有独立的读取位置
+ *
+ * 生产者（采集线程）把样本写入定长环形区并推进发布序号，不加锁、不等待其他消费者；
+ * 各消费者按自己的节奏读取，互不影响。消费者落后时的处理由溢出策略决定：
+ * - Block：生产者等待该消费者腾出空间（最长 kMaxBlockMs，超时后按 Drop 处理），适合不能丢数据的存储
+ * - Drop：落后超过环容量时跳过被覆盖的样本并计数
+ * - Sample：落后超过半个环时按步长抽取样本追赶，适合只关心趋势的显示
+ *
+ * context 为 nullptr 的消费者在生产者线程上同步处理（不会落后）；
+ * 其余消费者在 context 所在线程处理，有新样本时只投递一次唤醒，处理时一次读完。
+ */
+class SampleBus {
+public:
+    enum OverflowPolicy {
+        Block,
+        Drop,
+        Sample
+    };
+
+    using Handler = std::function<void(const SampleBlock &block)>;
+
+    struct ConsumerStats {
+        QString name;
+        OverflowPolicy policy;
+        qint64 lag;           // 已发布但尚未读取的样本数
+        qint64 maxLag;        // 上次查询以来的最大落后
+        qint64 delivered;
+        qint64 dropped;       // 覆盖或抽样跳过的样本数
+    };
+
+    explicit SampleBus(int capacity = 1 << 20);
+    ~SampleBus();
+
+    // 在开始发布前订阅；返回消费者编号
+    int subscribe(const QString &name, OverflowPolicy policy, QObject *context, Handler handler);
+    void unsubscribe(int id);
+
+    // 仅由生产者线程调用
+    void publish(const SampleBlock &block);
+
+    // 立即读完该消费者的积压，须在其 context 所在线程调用（例如退出前）
+    void drain(int id);
+
+    qint64 publishedCount() const { return m_published.load(std::memory_order_acquire); }
+    QVector<ConsumerStats> stats() const;
+
+private:
+    struct Consumer;
+    using ConsumerList = std::vector<std::shared_ptr<Consumer>>;
+
+    void drainConsumer(Consumer *consumer);
+    void notify(const std::shared_ptr<Consumer> &consumer);
+    bool waitForSpace(Consumer *consumer, qint64 sequence);
+
+    std::vector<qint64> m_timestamps;
+    std::vector<qint32> m_values;
+    qint64 m_mask;
+    std::atomic<qint64> m_claimed;      // 生产者即将写到的序号（含正在写入的部分）
+    std::atomic<qint64> m_published;    // 已完整写入的序号
+    std::shared_ptr<const ConsumerList> m_consumers;
+    int m_nextId;
+};
+
+#endif // SAMPLEBUS_H
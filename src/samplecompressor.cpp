@@ -0,0 +1,129 @@
+#include "samplecompressor.h"
+#include <limits>
+
+SampleCompressor::SampleCompressor()
+    : m_tolerance(0)
+{
+    reset();
+}
+
+void SampleCompressor::setTolerance(qint32 tolerance)
+{
+    m_tolerance = qMax(0, tolerance);
+}
+
+void SampleCompressor::reset()
+{
+    m_hasAnchor = false;
+    m_anchorUs = 0;
+    m_anchorValue = 0;
+    m_hasHeld = false;
+    m_heldUs = 0;
+    m_heldValue = 0;
+    m_lastInputUs = -1;
+    resetDoors();
+}
+
+void SampleCompressor::resetDoors()
+{
+    m_minSlope = -std::numeric_limits<double>::infinity();
+    m_maxSlope = std::numeric_limits<double>::infinity();
+}
+
+void SampleCompressor::archive(qint64 timestampUs, qint32 value, SampleBlock &out)
+{
+    out.append(timestampUs, value);
+    m_hasAnchor = true;
+    m_anchorUs = timestampUs;
+    m_anchorValue = value;
+    m_hasHeld = false;
+    resetDoors();
+}
+
+void SampleCompressor::push(qint64 timestampUs, qint32 value, SampleBlock &out)
+{
+    m_lastInputUs = timestampUs;
+    if (m_tolerance <= 0) {
+        out.append(timestampUs, value);
+        return;
+    }
+    if (!m_hasAnchor) {
+        archive(timestampUs, value, out);
+        return;
+    }
+
+    // 中断或时间戳回退：保存中断前的最后一个样本，从当前样本重新开始
+    qint64 lastUs = m_hasHeld ? m_heldUs : m_anchorUs;
+    if (timestampUs <= lastUs || timestampUs - lastUs > kMaxIntervalUs) {
+        flush(out);
+        archive(timestampUs, value, out);
+        return;
+    }
+    // 心跳：距上个保存点将超过最大间隔时先保存暂存的样本
+    if (m_hasHeld && timestampUs - m_anchorUs > kMaxIntervalUs) {
+        archive(m_heldUs, m_heldValue, out);
+    }
+
+    if (m_hasHeld) {
+        // 以当前样本为终点时，暂存样本成为中间点，门随之收窄
+        double heldDt = double(m_heldUs - m_anchorUs);
+        double minSlope = qMax(m_minSlope, (m_heldValue - m_tolerance - double(m_anchorValue)) / heldDt);
+        double maxSlope = qMin(m_maxSlope, (m_heldValue + m_tolerance - double(m_anchorValue)) / heldDt);
+        double slope = (value - double(m_anchorValue)) / double(timestampUs - m_anchorUs);
+        if (slope < minSlope || slope > maxSlope) {
+            // 当前样本在门外：保存暂存样本作为新轴，门重新打开
+            archive(m_heldUs, m_heldValue, out);
+        } else {
+            m_minSlope = minSlope;
+            m_maxSlope = maxSlope;
+        }
+    }
+    m_hasHeld = true;
+    m_heldUs = timestampUs;
+    m_heldValue = value;
+}
+
+void SampleCompressor::push(const SampleBlock &block, SampleBlock &out)
+{
+    // 同一时间戳的一段样本在上一时间点与本时间点之间均匀分布，最后一个样本落在本时间点；
+    // 否则每个共用时间戳的样本都会被当作回退而原样保存
+    const int count = block.size();
+    int i = 0;
+    while (i < count) {
+        const qint64 timestampUs = block.timestampsUs[i];
+        int end = i + 1;
+        while (end < count && block.timestampsUs[end] == timestampUs) {
+            ++end;
+        }
+        const int run = end - i;
+        const qint64 previousUs = m_lastInputUs;
+        const qint64 spanUs = previousUs >= 0 && previousUs < timestampUs && timestampUs - previousUs <= kMaxIntervalUs
+            ? timestampUs - previousUs : 0;
+        for (int j = 0; j < run; ++j) {
+            push(timestampUs - spanUs + spanUs * (j + 1) / run, block.values[i + j], out);
+        }
+        i = end;
+    }
+}
+
+void SampleCompressor::flush(SampleBlock &out)
+{
+    if (m_hasHeld) {
+        archive(m_heldUs, m_heldValue, out);
+    }
+}
+
+bool SampleCompressor::interpolate(qint64 leftMs, double leftValue, qint64 rightMs, double rightValue,
+                                   qint64 timeMs, double &value)
+{
+    if (timeMs < leftMs || timeMs > rightMs || (rightMs - leftMs) * 1000 > kMaxIntervalUs) {
+        return false;
+    }
+    if (rightMs == leftMs) {
+        value = leftValue;
+        return true;
+    }
+    double fraction = double(timeMs - leftMs) / double(rightMs - leftMs);
+    value = leftValue + (rightValue - leftValue) * fraction;
+    return true;
+}
@@ -0,0 +1,66 @@
+#ifndef SAMPLECOMPRESSOR_H
+#define SAMPLECOMPRESSOR_H
+
+#include <QVector>
+
+#include "samplefixed.h"
+
+/**
+ * @brief 入库前的旋转门（swinging door）压缩，单通道、每样本 O(1)
+ *
+ * 保存的点之间按线性插值重建时，被丢弃的每个样本与重建值之差不超过容差。
+ * 两扇门以最近保存的点为轴，门之间是从轴出发、与其后每个中间样本相差不超过 E 的直线斜率范围；
+ * 每个样本只把门收窄一次，新样本落在门外时保存上一个样本并以它为新轴。
+ * 准静态信号只在开始、变化与心跳时保存，行数通常下降一到两个数量级。
+ *
+ * 连续采集时相邻保存点的间隔不超过 kMaxIntervalUs（平稳信号也按此心跳保存）；
+ * 样本间隔超过 kMaxIntervalUs 或时间戳回退时保存中断前后的两个样本，
+ * 因此读取方把间隔超过 kMaxIntervalUs 的相邻点视为中断、不做插值（见 interpolate()）。
+ * 最后一个样本在下一个样本到达或 flush() 前暂存在压缩器中。
+ *
+ * 同一次读取的样本共用时间戳（见 SerialPortHandler::processChunk）：按块送入时，
+ * 同一时间戳的一段样本在上一时间点与本时间点之间均匀分布后再压缩，保存点使用分布后的时间；
+ * 没有上一时间点（或间隔超过 kMaxIntervalUs）的一段退化为共用时间戳，按回退处理、原样保存。
+ */
+class SampleCompressor {
+public:
+    static const qint64 kMaxIntervalUs = 10 * 1000000LL;
+
+    SampleCompressor();
+
+    // 容差为定点值（见 samplefixed.h），0 为关闭（样本原样输出）
+    void setTolerance(qint32 tolerance);
+    qint32 tolerance() const { return m_tolerance; }
+    bool hasPending() const { return m_hasHeld; }
+
+    // 送入一个样本，需要保存的点追加到 out
+    void push(qint64 timestampUs, qint32 value, SampleBlock &out);
+    // 送入一块样本，共用时间戳的样本先在时间上展开
+    void push(const SampleBlock &block, SampleBlock &out);
+    // 输出暂存的最后一个样本，下一个样本从它继续
+    void flush(SampleBlock &out);
+    void reset();
+
+    // 读取方：按时间升序的保存点在 timeMs 处的线性插值；
+    // 不在两点之间或两点间隔超过 kMaxIntervalUs 时返回 false
+    static bool interpolate(qint64 leftMs, double leftValue, qint64 rightMs, double rightValue,
+                            qint64 timeMs, double &value);
+
+private:
+    void archive(qint64 timestampUs, qint32 value, SampleBlock &out);
+    void resetDoors();
+
+    qint32 m_tolerance;
+    bool m_hasAnchor;
+    qint64 m_anchorUs;
+    qint32 m_anchorValue;
+    bool m_hasHeld;
+    qint64 m_heldUs;
+    qint32 m_heldValue;
+    qint64 m_lastInputUs;   // 上一个送入样本的时间戳，-1 为无
+    // 门：允许的斜率范围（定点值/µs），不含暂存样本
+    double m_minSlope;
+    double m_maxSlope;
+};
+
+#endif // SAMPLECOMPRESSOR_H
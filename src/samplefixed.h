@@ -0,0 +1,205 @@
+#ifndef SAMPLEFIXED_H
+#define SAMPLEFIXED_H
+
+#include <QtGlobal>
+#include <QMetaType>
+#include <QString>
+#include <QVector>
+#include <climits>
+#include <cmath>
+
+// 定点样本的小数位数，由 CMake 变量 SAMPLE_FRACTION_DIGITS 配置
+#ifndef SAMPLE_FRACTION_DIGITS
+#define SAMPLE_FRACTION_DIGITS 2
+#endif
+
+/**
+ * @brief 定点距离值：32 位整数，单位为 10^-SAMPLE_FRACTION_DIGITS cm
+ *
+ * 默认为 0.01 cm，与传感器分辨率及导出文本的 'f', 2 格式一致。
+ * parse()/format() 直接在十进制文本与整数之间转换，不经过浮点数，因此往返完全精确；
+ * toDouble() 得到的是与相同文本经 toDouble() 解析结果相同的最近双精度值。
+ */
+namespace SampleFixed {
+
+constexpr int kFractionDigits = SAMPLE_FRACTION_DIGITS;
+
+constexpr qint32 pow10(int digits)
+{
+    return digits <= 0 ? 1 : 10 * pow10(digits - 1);
+}
+
+constexpr qint32 kScale = pow10(kFractionDigits);
+// 量程上限 500 cm（与串口解析的范围检查一致）
+constexpr qint32 kMaxDistance = 500 * kScale;
+
+static_assert(kFractionDigits >= 0 && kFractionDigits <= 6, "SAMPLE_FRACTION_DIGITS out of range");
+
+inline qint32 fromDouble(double value)
+{
+    return static_cast<qint32>(std::llround(value * kScale));
+}
+
+inline double toDouble(qint32 value)
+{
+    return static_cast<double>(value) / kScale;
+}
+
+// 解析 [+-]digits[.digits][e[+-]digits]，前后空白忽略；多出的小数位四舍五入。
+// 指数形式按十进制移位处理，同样不经过浮点数
+inline bool parse(const char *p, const char *end, qint32 &value)
+{
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) {
+        ++p;
+    }
+    while (end > p && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r')) {
+        --end;
+    }
+
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        ++p;
+    }
+
+    // 有效数字（去掉前导零）及小数点相对第一位有效数字的位置
+    const int kMaxSignificant = 24;
+    char significant[kMaxSignificant];
+    int count = 0;
+    int point = 0;
+    int digits = 0;
+    for (; p < end && unsigned(*p - '0') <= 9; ++p, ++digits) {
+        if (count == 0 && *p == '0') {
+            continue;
+        }
+        if (count < kMaxSignificant) {
+            significant[count++] = *p;
+        }
+        ++point;
+    }
+    if (p < end && *p == '.') {
+        for (++p; p < end && unsigned(*p - '0') <= 9; ++p, ++digits) {
+            if (count == 0 && *p == '0') {
+                --point;
+            } else if (count < kMaxSignificant) {
+                significant[count++] = *p;
+            }
+        }
+    }
+    if (digits == 0) {
+        return false;
+    }
+
+    int exponent = 0;
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        ++p;
+        bool negativeExponent = false;
+        if (p < end && (*p == '-' || *p == '+')) {
+            negativeExponent = *p == '-';
+            ++p;
+        }
+        int exponentDigits = 0;
+        for (; p < end && unsigned(*p - '0') <= 9; ++p, ++exponentDigits) {
+            exponent = qMin(exponent * 10 + (*p - '0'), 1000);
+        }
+        if (exponentDigits == 0) {
+            return false;
+        }
+        if (negativeExponent) {
+            exponent = -exponent;
+        }
+    }
+    if (p != end) {
+        return false;
+    }
+
+    // 定点值即前 shift 位有效数字，其后第一位决定舍入
+    const int shift = point + exponent + kFractionDigits;
+    if (count > 0 && shift > 10) {
+        return false;
+    }
+    qint64 result = 0;
+    for (int i = 0; i < shift; ++i) {
+        result = result * 10 + (i < count ? significant[i] - '0' : 0);
+    }
+    if (shift >= 0 && shift < count && significant[shift] >= '5') {
+        ++result;
+    }
+    if (result > INT_MAX) {
+        return false;
+    }
+    value = static_cast<qint32>(negative ? -result : result);
+    return true;
+}
+
+// 输出与 QString::number(toDouble(value), 'f', kFractionDigits) 相同的文本，返回长度
+inline int format(qint32 value, char *buffer)
+{
+    char digits[16];
+    int count = 0;
+    quint32 magnitude = value < 0 ? 0u - static_cast<quint32>(value) : static_cast<quint32>(value);
+    do {
+        digits[count++] = static_cast<char>('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude > 0 || count <= kFractionDigits);
+
+    int length = 0;
+    if (value < 0) {
+        buffer[length++] = '-';
+    }
+    while (count > 0) {
+        if (count == kFractionDigits) {
+            buffer[length++] = '.';
+        }
+        buffer[length++] = digits[--count];
+    }
+    return length;
+}
+
+inline QString toString(qint32 value)
+{
+    char buffer[16];
+    return QString::fromLatin1(buffer, format(value, buffer));
+}
+
+} // namespace SampleFixed
+
+/**
+ * @brief 定点样本块，结构数组（SoA）布局
+ *
+ * 时间戳与数值各自连续存放，按列扫描时不会把另一列读入缓存，
+ * 数值列可直接交给整数向量化循环处理。
+ * 两列均为隐式共享的 QVector，作为信号参数跨线程传递时只增加引用计数，
+ * 接收方按只读方式使用，不会触发复制。
+ */
+struct SampleBlock {
+    QVector<qint64> timestampsUs;
+    QVector<qint32> values;          // SampleFixed 定点值
+
+    int size() const { return values.size(); }
+    bool isEmpty() const { return values.isEmpty(); }
+
+    void reserve(int count)
+    {
+        timestampsUs.reserve(count);
+        values.reserve(count);
+    }
+
+    void clear()
+    {
+        timestampsUs.clear();
+        values.clear();
+    }
+
+    void append(qint64 timestampUs, qint32 value)
+    {
+        timestampsUs.append(timestampUs);
+        values.append(value);
+    }
+
+    double distanceAt(int index) const { return SampleFixed::toDouble(values[index]); }
+};
+
+Q_DECLARE_METATYPE(SampleBlock)
+
+#endif // SAMPLEFIXED_H
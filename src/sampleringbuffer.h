@@ -0,0 +1,79 @@
+#ifndef SAMPLERINGBUFFER_H
+#define SAMPLERINGBUFFER_H
+
+#include <QtGlobal>
+#include <vector>
+
+/**
+ * @brief 定长样本环形缓冲区，容量取 2 的幂
+ *
+ * 样本按写入顺序编号（绝对序号），只保留最近 capacity() 个。
+ * forRange() 以最多两段连续内存的形式访问指定序号区间，便于紧凑循环处理。
+ */
+template <typename T>
+class SampleRingBuffer {
+public:
+    explicit SampleRingBuffer(int capacity = 1024)
+    {
+        reset(capacity);
+    }
+
+    void reset(int capacity)
+    {
+        int size = 1;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        m_data.assign(size, T());
+        m_mask = size - 1;
+        m_total = 0;
+    }
+
+    void clear() { m_total = 0; }
+
+    void push(const T &value)
+    {
+        m_data[static_cast<size_t>(m_total & m_mask)] = value;
+        ++m_total;
+    }
+
+    void push(const T *values, int count)
+    {
+        for (int i = 0; i < count; ++i) {
+            push(values[i]);
+        }
+    }
+
+    int capacity() const { return m_mask + 1; }
+    int size() const { return static_cast<int>(qMin<qint64>(m_total, m_mask + 1)); }
+    bool isEmpty() const { return m_total == 0; }
+
+    // 已写入样本总数，即下一个样本的绝对序号
+    qint64 totalCount() const { return m_total; }
+    // 仍在缓冲区内的最早样本序号
+    qint64 firstIndex() const { return m_total - size(); }
+
+    const T &at(qint64 index) const { return m_data[static_cast<size_t>(index & m_mask)]; }
+    const T &last() const { return at(m_total - 1); }
+
+    // 以连续片段遍历 [from, to)，fn(const T *data, int count)
+    template <typename Fn>
+    void forRange(qint64 from, qint64 to, Fn fn) const
+    {
+        from = qMax(from, firstIndex());
+        to = qMin(to, m_total);
+        while (from < to) {
+            qint64 offset = from & m_mask;
+            qint64 count = qMin<qint64>(to - from, static_cast<qint64>(m_mask) + 1 - offset);
+            fn(m_data.data() + offset, static_cast<int>(count));
+            from += count;
+        }
+    }
+
+private:
+    std::vector<T> m_data;
+    int m_mask;
+    qint64 m_total;
+};
+
+#endif // SAMPLERINGBUFFER_H
@@ -0,0 +1,423 @@
+#include "samplespool.h"
+#include <QMutexLocker>
+#include <QRandomGenerator>
+#include <QDebug>
+#include <cstddef>
+#include <cstring>
+
+#ifdef Q_OS_UNIX
+#include <sys/mman.h>
+#elif defined(Q_OS_WIN)
+#include <windows.h>
+#endif
+
+static const char kSpoolMagic[8] = {'U', 'H', 'S', 'P', 'O', 'O', 'L', '1'};
+static const quint32 kSpoolVersion = 2;
+// 最大容量（记录数），约 256 MB
+static const quint64 kMaxCapacity = 16ULL << 20;
+
+struct SampleSpool::Header {
+    char magic[8];
+    quint32 version;
+    quint32 recordSize;
+    quint64 capacity;
+    quint64 baseSequence;    // 序号基数，文件每次从头复用时增加
+    quint64 replayedIndex;   // 已写入数据库的记录数
+    quint64 writeIndexHint;  // 仅供参考，恢复时以扫描结果为准
+    quint32 fractionDigits;  // 记录中定点值的小数位数
+    quint32 reserved;
+    quint64 instanceId;      // 文件实例号，重建文件后与库中的回放水位不再对应；旧文件为 0，打开时补上
+};
+
+// 序号不单独存放，而是计入 CRC：旧一轮的记录因序号不同而校验失败
+struct SampleSpool::Record {
+    qint64 timestampUs;
+    qint32 value;            // SampleFixed 定点值
+    quint32 crc;             // 覆盖前面 12 字节与序号
+};
+
+// 版本 1 的记录格式，仅用于升级时迁移未回放的数据
+struct LegacyRecord {
+    qint64 timestampUs;
+    double distance;
+    quint32 sequence;
+    quint32 crc;
+};
+
+static quint32 spoolCrc32(const uchar *data, size_t length)
+{
+    static quint32 table[256];
+    static bool tableReady = false;
+    if (!tableReady) {
+        for (quint32 i = 0; i < 256; ++i) {
+            quint32 c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            table[i] = c;
+        }
+        tableReady = true;
+    }
+
+    quint32 crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < length; ++i) {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+static quint64 newInstanceId()
+{
+    quint64 id = 0;
+    while (id == 0) {
+        id = QRandomGenerator::global()->generate64() >> 1;  // 入库时作为 SQLite 有符号整数
+    }
+    return id;
+}
+
+static quint32 recordCrc(qint64 timestampUs, qint32 value, quint32 sequence)
+{
+    uchar buffer[16];
+    std::memcpy(buffer, &timestampUs, 8);
+    std::memcpy(buffer + 8, &value, 4);
+    std::memcpy(buffer + 12, &sequence, 4);
+    return spoolCrc32(buffer, sizeof(buffer));
+}
+
+SampleSpool::SampleSpool(const QString &filePath)
+    : m_file(filePath)
+    , m_data(nullptr)
+    , m_header(nullptr)
+    , m_records(nullptr)
+    , m_capacity(0)
+    , m_writeIndex(0)
+    , m_dropped(0)
+{
+    static_assert(sizeof(Header) == 64, "spool header layout");
+    static_assert(sizeof(Record) == 16, "spool record layout");
+    spoolCrc32(nullptr, 0);  // 预先建表，避免采集线程与回放线程竞争初始化
+}
+
+SampleSpool::~SampleSpool()
+{
+    close();
+}
+
+bool SampleSpool::open(quint64 initialCapacity)
+{
+    QMutexLocker locker(&m_mutex);
+
+    if (!m_file.open(QIODevice::ReadWrite)) {
+        m_error = m_file.errorString();
+        return false;
+    }
+
+    Header existing = {};
+    bool valid = m_file.size() >= static_cast<qint64>(sizeof(Header))
+        && m_file.read(reinterpret_cast<char *>(&existing), sizeof(Header)) == static_cast<qint64>(sizeof(Header))
+        && std::memcmp(existing.magic, kSpoolMagic, sizeof(kSpoolMagic)) == 0
+        && existing.version == kSpoolVersion
+        && existing.recordSize == sizeof(Record)
+        && existing.fractionDigits == static_cast<quint32>(SampleFixed::kFractionDigits)
+        && existing.capacity > 0 && existing.capacity <= kMaxCapacity
+        && m_file.size() >= static_cast<qint64>(sizeof(Header) + existing.capacity * sizeof(Record));
+
+    if (valid) {
+        if (!map(existing.capacity)) {
+            return false;
+        }
+        recover();
+        if (m_header->instanceId == 0) {
+            m_header->instanceId = newInstanceId();
+        }
+        qDebug() << "Spool recovered:" << m_file.fileName() << "pending" << (m_writeIndex - m_header->replayedIndex);
+        return true;
+    }
+
+    // 版本 1 或小数位数不同的文件：取出未回放的记录，重新初始化后按当前格式写回
+    QVector<SpoolRecord> legacy = readLegacy(existing);
+
+    // 新建或格式不符：重新初始化
+    m_file.resize(0);
+    if (!map(qBound<quint64>(1024, initialCapacity, kMaxCapacity))) {
+        return false;
+    }
+    std::memcpy(m_header->magic, kSpoolMagic, sizeof(kSpoolMagic));
+    m_header->version = kSpoolVersion;
+    m_header->recordSize = sizeof(Record);
+    m_header->fractionDigits = SampleFixed::kFractionDigits;
+    m_header->baseSequence = 0;
+    m_header->replayedIndex = 0;
+    m_header->writeIndexHint = 0;
+    m_header->instanceId = newInstanceId();
+    m_writeIndex = 0;
+
+    if (!legacy.isEmpty()) {
+        while (m_capacity < static_cast<quint64>(legacy.size()) && grow()) {
+        }
+        for (const SpoolRecord &record : legacy) {
+            if (m_writeIndex >= m_capacity) {
+                m_dropped += legacy.size() - m_writeIndex;
+                break;
+            }
+            writeRecord(record.timestampUs, record.value);
+        }
+        qDebug() << "Spool migrated:" << m_file.fileName() << "pending" << m_writeIndex;
+    }
+    return true;
+}
+
+QVector<SpoolRecord> SampleSpool::readLegacy(const Header &existing)
+{
+    QVector<SpoolRecord> records;
+    qint64 size = m_file.size();
+    bool version1 = existing.version == 1 && existing.recordSize == sizeof(LegacyRecord);
+    bool rescaled = existing.version == kSpoolVersion && existing.recordSize == sizeof(Record)
+        && existing.fractionDigits <= 6;
+    if (size < static_cast<qint64>(sizeof(Header))
+        || std::memcmp(existing.magic, kSpoolMagic, sizeof(kSpoolMagic)) != 0
+        || !(version1 || rescaled)) {
+        return records;
+    }
+
+    quint64 capacity = qMin<quint64>(existing.capacity, (size - sizeof(Header)) / existing.recordSize);
+    uchar *data = m_file.map(0, size);
+    if (!data) {
+        return records;
+    }
+    const uchar *base = data + sizeof(Header);
+    double scale = SampleFixed::pow10(existing.fractionDigits);
+    for (quint64 index = existing.replayedIndex; index < capacity; ++index) {
+        quint32 sequence = static_cast<quint32>(existing.baseSequence + index);
+        if (version1) {
+            const LegacyRecord &record = reinterpret_cast<const LegacyRecord *>(base)[index];
+            if (record.sequence != sequence
+                || record.crc != spoolCrc32(reinterpret_cast<const uchar *>(&record), offsetof(LegacyRecord, crc))) {
+                break;
+            }
+            records.append({record.timestampUs, SampleFixed::fromDouble(record.distance)});
+        } else {
+            const Record &record = reinterpret_cast<const Record *>(base)[index];
+            if (record.crc != recordCrc(record.timestampUs, record.value, sequence)) {
+                break;
+            }
+            records.append({record.timestampUs, SampleFixed::fromDouble(record.value / scale)});
+        }
+    }
+    m_file.unmap(data);
+    return records;
+}
+
+void SampleSpool::close()
+{
+    QMutexLocker locker(&m_mutex);
+    unmap();
+    if (m_file.isOpen()) {
+        m_file.close();
+    }
+}
+
+bool SampleSpool::isOpen() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_data != nullptr;
+}
+
+QString SampleSpool::errorString() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_error;
+}
+
+bool SampleSpool::append(qint64 timestampUs, qint32 value)
+{
+    QMutexLocker locker(&m_mutex);
+    if (!m_data) {
+        ++m_dropped;
+        return false;
+    }
+
+    if (m_writeIndex >= m_capacity && !grow()) {
+        ++m_dropped;
+        return false;
+    }
+
+    writeRecord(timestampUs, value);
+    return true;
+}
+
+int SampleSpool::append(const SampleBlock &block)
+{
+    QMutexLocker locker(&m_mutex);
+    const int count = block.size();
+    if (!m_data) {
+        m_dropped += count;
+        return 0;
+    }
+
+    for (int i = 0; i < count; ++i) {
+        if (m_writeIndex >= m_capacity && !grow()) {
+            m_dropped += count - i;
+            return i;
+        }
+        writeRecord(block.timestampsUs[i], block.values[i]);
+    }
+    return count;
+}
+
+void SampleSpool::writeRecord(qint64 timestampUs, qint32 value)
+{
+    Record &record = m_records[m_writeIndex];
+    record.timestampUs = timestampUs;
+    record.value = value;
+    record.crc = recordCrc(timestampUs, value, static_cast<quint32>(m_header->baseSequence + m_writeIndex));
+
+    ++m_writeIndex;
+    m_header->writeIndexHint = m_writeIndex;
+}
+
+int SampleSpool::read(QVector<SpoolRecord> &records, int maxCount) const
+{
+    QMutexLocker locker(&m_mutex);
+    records.clear();
+    if (!m_data) {
+        return 0;
+    }
+
+    quint64 start = m_header->replayedIndex;
+    int count = static_cast<int>(qMin<quint64>(static_cast<quint64>(maxCount), m_writeIndex - start));
+    records.resize(count);
+    for (int i = 0; i < count; ++i) {
+        const Record &record = m_records[start + i];
+        records[i].timestampUs = record.timestampUs;
+        records[i].value = record.value;
+    }
+    return count;
+}
+
+void SampleSpool::markReplayed(int count)
+{
+    QMutexLocker locker(&m_mutex);
+    if (!m_data || count <= 0) {
+        return;
+    }
+
+    m_header->replayedIndex = qMin(m_header->replayedIndex + count, m_writeIndex);
+
+    // 全部回放完毕：更新序号基数后从头复用，旧记录因序号不符而失效
+    if (m_header->replayedIndex == m_writeIndex) {
+        m_header->baseSequence += m_writeIndex;
+        m_header->replayedIndex = 0;
+        m_header->writeIndexHint = 0;
+        m_writeIndex = 0;
+    }
+}
+
+quint64 SampleSpool::pendingCount() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_data ? m_writeIndex - m_header->replayedIndex : 0;
+}
+
+quint64 SampleSpool::droppedCount() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_dropped;
+}
+
+quint64 SampleSpool::instanceId() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_data ? m_header->instanceId : 0;
+}
+
+quint64 SampleSpool::replayedSequence() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_data ? m_header->baseSequence + m_header->replayedIndex : 0;
+}
+
+quint64 SampleSpool::writeSequence() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_data ? m_header->baseSequence + m_writeIndex : 0;
+}
+
+void SampleSpool::sync()
+{
+    QMutexLocker locker(&m_mutex);
+    if (!m_data) {
+        return;
+    }
+    size_t length = sizeof(Header) + m_capacity * sizeof(Record);
+#ifdef Q_OS_UNIX
+    ::msync(m_data, length, MS_ASYNC);
+#elif defined(Q_OS_WIN)
+    ::FlushViewOfFile(m_data, length);
+#endif
+}
+
+bool SampleSpool::map(quint64 capacity)
+{
+    unmap();
+
+    qint64 size = static_cast<qint64>(sizeof(Header) + capacity * sizeof(Record));
+    if (m_file.size() < size && !m_file.resize(size)) {
+        m_error = m_file.errorString();
+        return false;
+    }
+
+    m_data = m_file.map(0, size);
+    if (!m_data) {
+        m_error = m_file.errorString();
+        return false;
+    }
+
+    m_header = reinterpret_cast<Header *>(m_data);
+    m_records = reinterpret_cast<Record *>(m_data + sizeof(Header));
+    m_capacity = capacity;
+    m_header->capacity = capacity;
+    return true;
+}
+
+void SampleSpool::unmap()
+{
+    if (m_data) {
+        m_file.unmap(m_data);
+    }
+    m_data = nullptr;
+    m_header = nullptr;
+    m_records = nullptr;
+}
+
+bool SampleSpool::grow()
+{
+    if (m_capacity >= kMaxCapacity) {
+        return false;
+    }
+    quint64 previous = m_capacity;
+    quint64 capacity = qMin(m_capacity * 2, kMaxCapacity);
+    if (!map(capacity)) {
+        qDebug() << "Spool grow failed:" << m_error;
+        map(previous);
+        return false;
+    }
+    return true;
+}
+
+void SampleSpool::recover()
+{
+    quint64 index = qMin(m_header->replayedIndex, m_capacity);
+    m_header->replayedIndex = index;
+
+    while (index < m_capacity) {
+        const Record &record = m_records[index];
+        if (record.crc != recordCrc(record.timestampUs, record.value,
+                                    static_cast<quint32>(m_header->baseSequence + index))) {
+            break;
+        }
+        ++index;
+    }
+    m_writeIndex = index;
+    m_header->writeIndexHint = index;
+}
@@ -0,0 +1,84 @@
+#ifndef SAMPLESPOOL_H
+#define SAMPLESPOOL_H
+
+#include <QFile>
+#include <QMutex>
+#include <QString>
+#include <QVector>
+
+#include "samplefixed.h"
+
+/**
+ * @brief 暂存的样本
+ */
+struct SpoolRecord {
+    qint64 timestampUs;
+    qint32 value;        // SampleFixed 定点值
+};
+
+/**
+ * @brief 样本预写暂存文件（内存映射、只追加、逐条校验）
+ *
+ * 采集路径先写入暂存文件，再由 SpoolReplayer 在后台批量写入数据库。
+ * 每条记录 16 字节（时间戳 + 定点值 + CRC32），CRC 同时覆盖记录序号。
+ * 进程崩溃后重新打开时从已回放位置向后扫描，直到遇到校验失败的记录为止。
+ * 全部回放后文件从头复用。记录序号（baseSequence + 索引）跨复用单调递增，
+ * 与文件的实例号一起可作为入库进度的持久水位（见 SpoolReplayer）。
+ *
+ * append() 与 read()/markReplayed() 可以在不同线程调用，锁只保护索引与映射，持有时间很短。
+ */
+class SampleSpool {
+public:
+    explicit SampleSpool(const QString &filePath);
+    ~SampleSpool();
+
+    bool open(quint64 initialCapacity = 1 << 20);
+    void close();
+    bool isOpen() const;
+    QString filePath() const { return m_file.fileName(); }
+    QString errorString() const;
+
+    // 追加一条样本；文件已达上限时丢弃并计数
+    bool append(qint64 timestampUs, qint32 value);
+    // 追加整块样本，返回实际写入的条数
+    int append(const SampleBlock &block);
+
+    // 从回放位置复制最多 maxCount 条待回放记录，不移动回放位置
+    int read(QVector<SpoolRecord> &records, int maxCount) const;
+    // 确认前 count 条记录已写入数据库
+    void markReplayed(int count);
+
+    quint64 pendingCount() const;
+    quint64 droppedCount() const;
+
+    // 文件实例号（新建文件时随机生成，非 0）与序号：已回放到 replayedSequence()，已写入到 writeSequence()
+    quint64 instanceId() const;
+    quint64 replayedSequence() const;
+    quint64 writeSequence() const;
+
+    // 将映射页写回磁盘
+    void sync();
+
+private:
+    struct Header;
+    struct Record;
+
+    bool map(quint64 capacity);
+    void unmap();
+    bool grow();
+    void recover();
+    void writeRecord(qint64 timestampUs, qint32 value);
+    QVector<SpoolRecord> readLegacy(const Header &existing);
+
+    QFile m_file;
+    QString m_error;
+    uchar *m_data;
+    Header *m_header;
+    Record *m_records;
+    quint64 m_capacity;
+    quint64 m_writeIndex;
+    quint64 m_dropped;
+    mutable QMutex m_mutex;
+};
+
+#endif // SAMPLESPOOL_H
@@ -0,0 +1,132 @@
+#include "serialcapture.h"
+#include <QMutexLocker>
+#include <QThread>
+#include <QtEndian>
+#include <QDebug>
+
+const char SerialCapture::kMagic[8] = {'U', 'H', 'C', 'A', 'P', '1', '\0', '\0'};
+
+// 缓冲区达到该大小时唤醒写盘线程
+static const int kFlushThreshold = 64 * 1024;
+// 写盘跟不上时缓冲区上限，超出部分丢弃并计数
+static const int kMaxBufferSize = 16 * 1024 * 1024;
+static const int kFlushIntervalMs = 200;
+
+SerialCapture::SerialCapture()
+    : m_writerThread(nullptr)
+    , m_stopRequested(false)
+    , m_bytesCaptured(0)
+    , m_bytesDropped(0)
+{
+}
+
+SerialCapture::~SerialCapture()
+{
+    close();
+}
+
+bool SerialCapture::open(const QString &filePath)
+{
+    close();
+
+    m_file.setFileName(filePath);
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        m_error = m_file.errorString();
+        return false;
+    }
+    m_file.write(kMagic, sizeof(kMagic));
+
+    m_frontBuffer.clear();
+    m_frontBuffer.reserve(kFlushThreshold * 2);
+    m_stopRequested = false;
+    m_bytesCaptured = 0;
+    m_bytesDropped = 0;
+
+    m_writerThread = QThread::create([this]() { writerLoop(); });
+    m_writerThread->start(QThread::LowPriority);
+    return true;
+}
+
+void SerialCapture::close()
+{
+    if (!m_writerThread) {
+        return;
+    }
+
+    {
+        QMutexLocker locker(&m_mutex);
+        m_stopRequested = true;
+        m_dataReady.wakeOne();
+    }
+    m_writerThread->wait();
+    delete m_writerThread;
+    m_writerThread = nullptr;
+    m_file.close();
+}
+
+void SerialCapture::write(qint64 timestampUs, const QByteArray &data)
+{
+    if (!m_writerThread || data.isEmpty()) {
+        return;
+    }
+
+    uchar header[12];
+    qToLittleEndian<qint64>(timestampUs, header);
+    qToLittleEndian<quint32>(static_cast<quint32>(data.size()), header + 8);
+
+    QMutexLocker locker(&m_mutex);
+    if (m_frontBuffer.size() + data.size() + 12 > kMaxBufferSize) {
+        m_bytesDropped += data.size();
+        return;
+    }
+    m_frontBuffer.append(reinterpret_cast<const char *>(header), sizeof(header));
+    m_frontBuffer.append(data);
+    m_bytesCaptured += data.size();
+
+    if (m_frontBuffer.size() >= kFlushThreshold) {
+        m_dataReady.wakeOne();
+    }
+}
+
+qint64 SerialCapture::bytesCaptured() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_bytesCaptured;
+}
+
+qint64 SerialCapture::bytesDropped() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_bytesDropped;
+}
+
+void SerialCapture::writerLoop()
+{
+    QByteArray backBuffer;
+    backBuffer.reserve(kFlushThreshold * 2);
+
+    while (true) {
+        bool stopping;
+        {
+            QMutexLocker locker(&m_mutex);
+            if (!m_stopRequested && m_frontBuffer.size() < kFlushThreshold) {
+                m_dataReady.wait(&m_mutex, kFlushIntervalMs);
+            }
+            // 交换前后缓冲区，写盘时不持有锁
+            m_frontBuffer.swap(backBuffer);
+            stopping = m_stopRequested;
+        }
+
+        if (!backBuffer.isEmpty()) {
+            if (m_file.write(backBuffer) != backBuffer.size()) {
+                qDebug() << "Capture write failed:" << m_file.errorString();
+            }
+            backBuffer.resize(0);  // 保留容量，避免反复分配
+        }
+
+        if (stopping) {
+            break;
+        }
+    }
+    m_file.flush();
+}
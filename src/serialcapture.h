@@ -0,0 +1,52 @@
+#ifndef SERIALCAPTURE_H
+#define SERIALCAPTURE_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QMutex>
+#include <QString>
+#include <QWaitCondition>
+
+class QThread;
+
+/**
+ * @brief 串口原始字节捕获，双缓冲异步写入紧凑二进制文件
+ *
+ * 文件格式：8 字节文件头 "UHCAP1\0\0"，之后每条记录为
+ * [int64 读取时间戳 µs][uint32 长度][原始字节]，均为小端。
+ * write() 只把数据追加到内存缓冲区，写盘在独立线程完成。
+ */
+class SerialCapture {
+public:
+    SerialCapture();
+    ~SerialCapture();
+
+    bool open(const QString &filePath);
+    void close();
+    bool isOpen() const { return m_writerThread != nullptr; }
+    QString filePath() const { return m_file.fileName(); }
+    QString errorString() const { return m_error; }
+
+    void write(qint64 timestampUs, const QByteArray &data);
+
+    qint64 bytesCaptured() const;
+    qint64 bytesDropped() const;
+
+    static const char kMagic[8];
+
+private:
+    void writerLoop();
+
+    QFile m_file;
+    QString m_error;
+    QThread *m_writerThread;
+
+    mutable QMutex m_mutex;
+    QWaitCondition m_dataReady;
+    QByteArray m_frontBuffer;   // 采集线程写入
+    bool m_stopRequested;
+    qint64 m_bytesCaptured;
+    qint64 m_bytesDropped;
+};
+
+#endif // SERIALCAPTURE_H
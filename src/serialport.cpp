@@ -1,19 +1,71 @@
 #include "serialport.h"
+#include "samplefixed.h"
+#include <QFile>
 #include <QDebug>
+#include <chrono>
+
+#ifdef Q_OS_LINUX
+#include <sys/ioctl.h>
+#include <linux/serial.h>
+#include <termios.h>
+#endif
+
+// 吞吐模式：缓冲达到该字节数立即读取，否则等待合并定时器
+static const qint64 kThroughputReadBytes = 4096;
+static const int kThroughputFlushMs = 20;
+// 吞吐模式下内核攒够该字节数才唤醒（termios VMIN，上限 255）
+static const int kThroughputWakeBytes = 128;
+static const int kStatsIntervalMs = 1000;
+// 回波参考脉冲文件（工作目录），不存在时使用默认脉冲
+static const char *kEchoReferenceFile = "echo_reference.txt";
 
 SerialPortHandler::SerialPortHandler(QObject *parent)
     : QObject(parent)
     , m_serialPort(new QSerialPort(this))
+    , m_capturing(false)
+    , m_capturedBytes(0)
+    , m_echoProcessor(nullptr)
+    , m_resync(InSync)
+    , m_closePending(false)
+    , m_readMode(Standard)
+    , m_busyPoll(false)
+    , m_polling(false)
+    , m_pollTimer(new QTimer(this))
+    , m_flushTimer(new QTimer(this))
+    , m_statsTimer(new QTimer(this))
+    , m_firstSeenUs(-1)
+    , m_savedVmin(-1)
+    , m_savedVtime(-1)
+    , m_lastSampleUs(0)
+    , m_wakeups(0)
+    , m_reads(0)
+    , m_readBytes(0)
+    , m_samples(0)
+    , m_pings(0)
+    , m_rejectedPings(0)
+    , m_latencySumUs(0)
+    , m_latencyMaxUs(0)
 {
+    qRegisterMetaType<AcquisitionStats>("AcquisitionStats");
+    qRegisterMetaType<SampleBlock>("SampleBlock");
+
     connect(m_serialPort, &QSerialPort::readyRead,
             this, &SerialPortHandler::handleReadyRead);
     connect(m_serialPort, &QSerialPort::errorOccurred,
             this, &SerialPortHandler::handleError);
+
+    m_pollTimer->setInterval(0);
+    connect(m_pollTimer, &QTimer::timeout, this, &SerialPortHandler::onPollTimer);
+    m_flushTimer->setInterval(kThroughputFlushMs);
+    connect(m_flushTimer, &QTimer::timeout, this, &SerialPortHandler::onFlushTimer);
+    m_statsTimer->setInterval(kStatsIntervalMs);
+    connect(m_statsTimer, &QTimer::timeout, this, &SerialPortHandler::onStatsTimer);
 }
 
 SerialPortHandler::~SerialPortHandler()
 {
     closePort();
+    delete m_echoProcessor;
 }
 
 QStringList SerialPortHandler::getAvailablePorts()
@@ -24,7 +76,7 @@ QStringList SerialPortHandler::getAvailablePorts()
     return list;
 }
 
-bool SerialPortHandler::openPort(const QString &portName, qint32 baudRate)
+bool SerialPortHandler::openPort(const QString &portName, qint32 baudRate, bool reportErrors)
 {
     if (m_serialPort->isOpen()) closePort();
 
@@ -36,21 +88,97 @@ bool SerialPortHandler::openPort(const QString &portName, qint32 baudRate)
     m_serialPort->setFlowControl(QSerialPort::NoFlowControl);
 
     if (m_serialPort->open(QIODevice::ReadWrite)) {
+#ifdef Q_OS_LINUX
+        struct termios tio;
+        if (::tcgetattr(int(m_serialPort->handle()), &tio) == 0) {
+            m_savedVmin = tio.c_cc[VMIN];
+            m_savedVtime = tio.c_cc[VTIME];
+        }
+#endif
+        applyReadMode();
+
+        m_statsClock.start();
+        m_wakeups = m_reads = m_readBytes = m_samples = m_latencySumUs = m_latencyMaxUs = 0;
+        m_pings = m_rejectedPings = 0;
+        m_statsTimer->start();
         emit connectionStatusChanged(true);
         return true;
     } else {
-        emit errorOccurred("Failed to open port: " + m_serialPort->errorString());
+        if (reportErrors) {
+            emit errorOccurred("Failed to open port: " + m_serialPort->errorString());
+        }
         return false;
     }
 }
 
 void SerialPortHandler::closePort()
 {
+    m_pollTimer->stop();
+    m_flushTimer->stop();
+    m_statsTimer->stop();
     if (m_serialPort->isOpen()) {
         m_serialPort->close();
         emit connectionStatusChanged(false);
     }
     m_receiveBuffer.clear();
+    m_resync = InSync;
+    m_closePending = false;
+    m_firstSeenUs = -1;
+}
+
+void SerialPortHandler::setReadMode(int mode, bool busyPoll)
+{
+    m_readMode = static_cast<ReadMode>(qBound(int(Standard), mode, int(Throughput)));
+    m_busyPoll = busyPoll && m_readMode == LowLatency;
+    if (m_serialPort->isOpen()) {
+        applyReadMode();
+    }
+}
+
+void SerialPortHandler::applyReadMode()
+{
+#ifdef Q_OS_LINUX
+    int fd = int(m_serialPort->handle());
+
+    // 部分 USB 转串口驱动不支持该 ioctl，失败时忽略
+    struct serial_struct serial;
+    if (::ioctl(fd, TIOCGSERIAL, &serial) == 0) {
+        bool lowLatency = m_readMode == LowLatency;
+        if (bool(serial.flags & ASYNC_LOW_LATENCY) != lowLatency) {
+            if (lowLatency) {
+                serial.flags |= ASYNC_LOW_LATENCY;
+            } else {
+                serial.flags &= ~ASYNC_LOW_LATENCY;
+            }
+            if (::ioctl(fd, TIOCSSERIAL, &serial) != 0) {
+                qDebug() << "ASYNC_LOW_LATENCY not supported on" << m_serialPort->portName();
+            }
+        }
+    }
+
+    // VTIME 为 0 时 poll 也遵循 VMIN，内核攒够字节才唤醒采集线程
+    struct termios tio;
+    if (::tcgetattr(fd, &tio) == 0 && m_savedVmin >= 0) {
+        tio.c_cc[VMIN] = m_readMode == Throughput ? kThroughputWakeBytes : m_savedVmin;
+        tio.c_cc[VTIME] = m_readMode == Throughput ? 0 : m_savedVtime;
+        ::tcsetattr(fd, TCSANOW, &tio);
+    }
+#endif
+
+    if (m_busyPoll) {
+        m_pollTimer->start();
+    } else {
+        m_pollTimer->stop();
+    }
+    if (m_readMode == Throughput) {
+        // 内核未唤醒时由定时器周期读出剩余字节，延迟上限为定时器间隔
+        m_flushTimer->start();
+    } else {
+        m_flushTimer->stop();
+        if (m_serialPort->bytesAvailable() > 0) {
+            drain();
+        }
+    }
 }
 
 bool SerialPortHandler::isOpen() const
@@ -58,55 +186,312 @@ bool SerialPortHandler::isOpen() const
     return m_serialPort->isOpen();
 }
 
+qint64 SerialPortHandler::currentTimestampUs()
+{
+    using namespace std::chrono;
+    return duration_cast<microseconds>(system_clock::now().time_since_epoch()).count();
+}
+
+bool SerialPortHandler::startCapture(const QString &filePath)
+{
+    if (!m_capture.open(filePath)) {
+        emit errorOccurred("Capture open failed: " + m_capture.errorString());
+        return false;
+    }
+    m_capturedBytes = 0;
+    m_capturing = true;
+    return true;
+}
+
+void SerialPortHandler::stopCapture()
+{
+    if (m_capture.isOpen()) {
+        m_capturedBytes = m_capture.bytesCaptured();
+    }
+    m_capture.close();
+    m_capturing = false;
+}
+
+void SerialPortHandler::injectData(const QByteArray &data, qint64 timestampUs)
+{
+    processChunk(data, timestampUs);
+}
+
 void SerialPortHandler::handleReadyRead()
 {
-    m_receiveBuffer.append(m_serialPort->readAll());
+    // 空闲时统计定时器已停止，数据恢复时重新开始计时
+    if (!m_statsTimer->isActive()) {
+        m_statsClock.start();
+        m_statsTimer->start();
+    }
+    // 轮询/定时器内同步触发的 readyRead 不重复计入唤醒次数
+    if (!m_polling) {
+        ++m_wakeups;
+    }
+    if (m_firstSeenUs < 0) {
+        m_firstSeenUs = currentTimestampUs();
+    }
 
-    while (true) {
-        int idx = m_receiveBuffer.indexOf('\n');
-        if (idx < 0) break;
+    if (m_readMode != Throughput || m_serialPort->bytesAvailable() >= kThroughputReadBytes) {
+        drain();
+    }
+}
 
-        QByteArray line = m_receiveBuffer.left(idx);
-        m_receiveBuffer.remove(0, idx + 1);
-        parseLine(line);
+void SerialPortHandler::onPollTimer()
+{
+    // 忙轮询：非阻塞检查串口，有数据时同步触发 readyRead
+    ++m_wakeups;
+    m_polling = true;
+    m_serialPort->waitForReadyRead(0);
+    m_polling = false;
+}
+
+void SerialPortHandler::onFlushTimer()
+{
+    ++m_wakeups;
+    if (!m_serialPort->isOpen()) {
+        return;
+    }
+
+    // 直接读取内核缓冲中不足 VMIN 的剩余字节
+    m_polling = true;
+    m_serialPort->waitForReadyRead(0);
+    m_polling = false;
+    if (m_serialPort->bytesAvailable() > 0) {
+        drain();
     }
 }
 
-void SerialPortHandler::parseLine(const QByteArray &line)
+void SerialPortHandler::drain()
 {
-    QString text = QString::fromUtf8(line).trimmed();
-    if (text.isEmpty()) return;
+    // 以字节首次可见时刻作为本批样本的时间戳
+    qint64 timestampUs = m_firstSeenUs >= 0 ? m_firstSeenUs : currentTimestampUs();
+    m_firstSeenUs = -1;
+    QByteArray data = m_serialPort->readAll();
+    if (data.isEmpty()) {
+        return;
+    }
 
-    qDebug() << "RAW:" << text;
+    ++m_reads;
+    m_readBytes += data.size();
+    if (m_capture.isOpen()) {
+        m_capture.write(timestampUs, data);
+    }
 
-    double distance = -1.0;
+    int samples = processChunk(data, timestampUs);
+    if (samples > 0) {
+        qint64 latencyUs = currentTimestampUs() - timestampUs;
+        m_samples += samples;
+        m_lastSampleUs = timestampUs;
+        m_latencySumUs += latencyUs * samples;
+        m_latencyMaxUs = qMax(m_latencyMaxUs, latencyUs);
+    }
+}
+
+void SerialPortHandler::onStatsTimer()
+{
+    double seconds = qMax<qint64>(1, m_statsClock.restart()) / 1000.0;
+    if (m_capture.isOpen()) {
+        m_capturedBytes = m_capture.bytesCaptured();
+    }
+
+    AcquisitionStats stats;
+    stats.readMode = m_readMode;
+    stats.busyPoll = m_busyPoll;
+    stats.wakeupsPerSecond = m_wakeups / seconds;
+    stats.readsPerSecond = m_reads / seconds;
+    stats.samplesPerSecond = m_samples / seconds;
+    stats.pingsPerSecond = m_pings / seconds;
+    stats.rejectedPings = m_rejectedPings;
+    stats.averageReadBytes = m_reads > 0 ? double(m_readBytes) / m_reads : 0.0;
+    stats.averageLatencyUs = m_samples > 0 ? double(m_latencySumUs) / m_samples : 0.0;
+    stats.maxLatencyUs = m_latencyMaxUs;
+    emit acquisitionStatsUpdated(stats);
+
+    // 整个周期没有任何唤醒：报告一次零值后停止，直到下一次 readyRead
+    if (m_wakeups == 0) {
+        m_statsTimer->stop();
+    }
+    m_wakeups = m_reads = m_readBytes = m_samples = m_latencySumUs = m_latencyMaxUs = 0;
+    m_pings = m_rejectedPings = 0;
+}
 
-    if (text.contains(':')) {
-        auto parts = text.split(':');
-        if (parts.size() == 2) {
-            bool ok;
-            distance = parts[1].toDouble(&ok);
-            if (!ok) return;
+// 重新同步时用来判断一行是否为文本：帧负载是任意字节，恰好全为可打印字符的概率很低
+static bool isTextLine(const char *begin, const char *end)
+{
+    for (const char *p = begin; p < end; ++p) {
+        quint8 c = quint8(*p);
+        if ((c < 0x20 || c > 0x7E) && c != '\t' && c != '\r') {
+            return false;
         }
-    } else if (text.contains('=')) {  // 支持 Distance=65
-        auto parts = text.split('=');
-        if (parts.size() == 2) {
-            bool ok;
-            distance = parts[1].toDouble(&ok);
-            if (!ok) return;
+    }
+    return begin < end;
+}
+
+int SerialPortHandler::processChunk(const QByteArray &data, qint64 timestampUs)
+{
+    m_receiveBuffer.append(data);
+
+    SampleBlock block;
+    m_echoFrames.clear();
+    m_echoPositions.clear();
+    const char *buffer = m_receiveBuffer.constData();
+    const int size = m_receiveBuffer.size();
+    int start = 0;
+    while (start < size) {
+        // 文本行不含 0xA5，按先出现的换行或帧同步字节分派
+        int idx = start;
+        while (idx < size && buffer[idx] != '\n' && quint8(buffer[idx]) != 0xA5) {
+            ++idx;
         }
-    } else {
-        bool ok;
-        distance = text.toDouble(&ok);
-        if (!ok) return;
+        if (idx >= size) {
+            // 失步时缓冲中的字节不会成为文本行，直接丢弃
+            if (m_resync == SkipToNewline) {
+                start = size;
+            }
+            break;
+        }
+
+        if (buffer[idx] == '\n') {
+            if (m_resync == InSync) {
+                parseLine(QByteArray::fromRawData(buffer + start, idx - start), timestampUs, block);
+            } else if (m_resync == SkipToNewline) {
+                m_resync = VerifyLine;
+            } else if (isTextLine(buffer + start, buffer + idx)) {
+                m_resync = InSync;
+                parseLine(QByteArray::fromRawData(buffer + start, idx - start), timestampUs, block);
+            }
+            start = idx + 1;
+            continue;
+        }
+
+        // 帧前不完整的文本丢弃；帧不完整时等待后续数据；
+        // 校验失败时跳过同步字节并进入重新同步，不把帧内的字节当作文本
+        EchoFrame frame;
+        int length = EchoProcessor::parseFrame(buffer + idx, size - idx, frame);
+        if (length == 0) {
+            start = idx;
+            break;
+        }
+        if (length < 0) {
+            m_resync = SkipToNewline;
+            start = idx + 1;
+            continue;
+        }
+        m_resync = InSync;
+        m_echoFrames.append(frame);
+        m_echoPositions.append(block.size());
+        start = idx + length;
     }
 
-    if (distance >= 0 && distance <= 500)
-        emit distanceReceived(distance);
+    // 帧指向接收缓冲区，须在移除已处理字节之前计算
+    processEchoFrames(timestampUs, block);
+    m_receiveBuffer.remove(0, start);
+
+    if (!block.isEmpty()) {
+        emit samplesReceived(block);
+    }
+    return block.size();
+}
+
+void SerialPortHandler::processEchoFrames(qint64 timestampUs, SampleBlock &block)
+{
+    if (m_echoFrames.isEmpty()) {
+        return;
+    }
+    if (!m_echoProcessor) {
+        m_echoProcessor = new EchoProcessor();
+        QString error;
+        if (QFile::exists(kEchoReferenceFile) && !m_echoProcessor->loadReference(kEchoReferenceFile, &error)) {
+            emit errorOccurred(QString("Echo reference ignored: %1").arg(error));
+        }
+    }
+
+    m_echoProcessor->process(m_echoFrames, m_echoDistances);
+    m_pings += m_echoFrames.size();
+
+    // 按到达顺序把回波距离插回文本样本之间
+    SampleBlock merged;
+    merged.reserve(block.size() + m_echoDistances.size());
+    int text = 0;
+    for (int i = 0; i < m_echoDistances.size(); ++i) {
+        for (; text < m_echoPositions[i]; ++text) {
+            merged.append(block.timestampsUs[text], block.values[text]);
+        }
+        double distance = m_echoDistances[i];
+        qint32 value = SampleFixed::fromDouble(distance);
+        if (distance < 0.0 || value > SampleFixed::kMaxDistance) {
+            ++m_rejectedPings;
+            continue;
+        }
+        merged.append(timestampUs, value);
+    }
+    for (; text < block.size(); ++text) {
+        merged.append(block.timestampsUs[text], block.values[text]);
+    }
+    block = merged;
+    m_echoFrames.clear();
+}
+
+bool SerialPortHandler::parseLine(const QByteArray &line, qint64 timestampUs, SampleBlock &block)
+{
+    // 命令应答（见 RateController）
+    if (line.startsWith("ACK ")) {
+        emit commandAcknowledged(QString::fromLatin1(line.trimmed()));
+        return false;
+    }
+
+    // 支持 "65.00"、"Distance:65"、"Distance=65" 与 "1.2e2"，数值直接按定点解析；
+    // 以第一个 ':' 或 '=' 分隔标签，其后全部为数值
+    const char *begin = line.constData();
+    const char *end = begin + line.size();
+    for (const char *p = begin; p < end; ++p) {
+        if (*p == ':' || *p == '=') {
+            begin = p + 1;
+            break;
+        }
+    }
+
+    qint32 value;
+    if (!SampleFixed::parse(begin, end, value)) return false;
+    if (value < 0 || value > SampleFixed::kMaxDistance) return false;
+
+    block.append(timestampUs, value);
+    return true;
+}
+
+void SerialPortHandler::sendCommand(const QByteArray &command)
+{
+    if (!m_serialPort->isOpen()) {
+        return;
+    }
+    m_serialPort->write(command + '\n');
 }
 
 void SerialPortHandler::handleError(QSerialPort::SerialPortError error)
 {
-    if (error != QSerialPort::NoError && error != QSerialPort::TimeoutError)
-        emit errorOccurred("Serial error: " + m_serialPort->errorString());
+    if (error == QSerialPort::NoError || error == QSerialPort::TimeoutError)
+        return;
+    // 已排队关闭时，拔出过程中后续的同类错误不再重复报告
+    if (m_closePending)
+        return;
+
+    QString reason = m_serialPort->errorString();
+    emit errorOccurred("Serial error: " + reason);
+
+    // 设备拔出或驱动出错后端口不再可用，交给重连监管。
+    // 不在 QSerialPort 自身的错误通知里关闭它，排队到事件循环下一轮再关
+    if (m_serialPort->isOpen()
+        && (error == QSerialPort::ResourceError || error == QSerialPort::DeviceNotFoundError
+            || error == QSerialPort::PermissionError)) {
+        m_closePending = true;
+        QMetaObject::invokeMethod(this, [this, reason]() {
+            // 期间用户关闭或重新打开了端口时放弃
+            if (!m_closePending) {
+                return;
+            }
+            closePort();
+            emit connectionLost(reason);
+        }, Qt::QueuedConnection);
+    }
 }
@@ -4,33 +4,154 @@
 #include <QObject>
 #include <QSerialPort>
 #include <QSerialPortInfo>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <atomic>
 
+#include "serialcapture.h"
+#include "samplefixed.h"
+#include "echoprocessor.h"
+
+/**
+ * @brief 采集统计（每秒更新一次）
+ *
+ * 延迟指字节首次在主机侧可见到对应样本发出之间的时间，不含 USB 转串口芯片内部的缓冲。
+ */
+struct AcquisitionStats {
+    int readMode = 0;
+    bool busyPoll = false;
+    double wakeupsPerSecond = 0.0;
+    double readsPerSecond = 0.0;
+    double samplesPerSecond = 0.0;
+    double pingsPerSecond = 0.0;       // 回波包络帧
+    qint64 rejectedPings = 0;          // 无法确定回波或超出量程的帧
+    double averageReadBytes = 0.0;
+    double averageLatencyUs = 0.0;
+    qint64 maxLatencyUs = 0;
+};
+
+Q_DECLARE_METATYPE(AcquisitionStats)
+
+/**
+ * @brief 串口采集，运行在独立的采集线程上
+ *
+ * 读取策略：
+ * - Standard：readyRead 时读出全部数据
+ * - LowLatency：同上，并设置 ASYNC_LOW_LATENCY（Linux，FTDI 等驱动会把延迟定时器降到 1 ms），
+ *   可选忙轮询，采集线程持续轮询串口，占满一个核心
+ * - Throughput：数据攒到一定量或由周期定时器合并读取；Linux 下通过 VMIN 让内核攒够字节再唤醒
+ *
+ * 除文本距离行外还接受回波包络二进制帧（格式见 EchoProcessor），
+ * 同一次读取中的所有帧并行计算飞行时间，得到的距离按到达顺序与文本样本合并为同一块发出。
+ * 帧校验失败后进入重新同步：丢弃到下一个帧头或换行为止的字节，之后只接受全为可打印字符的文本行，
+ * 不会把帧内的负载字节当作文本解析。
+ * 以 "ACK " 开头的文本行是设备对主机命令的应答，不作为样本。
+ */
 class SerialPortHandler : public QObject
 {
     Q_OBJECT
 public:
+    enum ReadMode {
+        Standard,
+        LowLatency,
+        Throughput
+    };
+    Q_ENUM(ReadMode)
+
     explicit SerialPortHandler(QObject *parent = nullptr);
     ~SerialPortHandler();
 
-    QStringList getAvailablePorts();
-    bool openPort(const QString &portName, qint32 baudRate);
-    void closePort();
+    static QStringList getAvailablePorts();
     bool isOpen() const;
 
+    // 当前时间 (µs since epoch)，作为样本时间戳
+    static qint64 currentTimestampUs();
+
+    // 可在任意线程读取；字节数随统计定时器刷新，停止时取最终值并保留到下一次开始
+    bool isCapturing() const { return m_capturing.load(); }
+    qint64 capturedBytes() const { return m_capturedBytes.load(); }
+
+    // 最近一个样本的时间戳，0 表示尚无样本
+    qint64 lastSampleTimestampUs() const { return m_lastSampleUs; }
+
+    // 最近一次串口操作的错误描述
+    QString errorString() const { return m_serialPort->errorString(); }
+
+public slots:
+    // reportErrors 为 false 时打开失败不发 errorOccurred，由调用方汇总（自动重连）
+    bool openPort(const QString &portName, qint32 baudRate, bool reportErrors = true);
+    void closePort();
+    void setReadMode(int mode, bool busyPoll);
+
+    // 原始字节捕获
+    bool startCapture(const QString &filePath);
+    void stopCapture();
+
+    // 注入字节流（捕获回放），与串口读取走相同的解析路径
+    void injectData(const QByteArray &data, qint64 timestampUs);
+
+    // 向设备发送一行命令（自动追加换行）
+    void sendCommand(const QByteArray &command);
+
 signals:
-    void distanceReceived(double distance);
+    // 每次读取解析出的全部样本合为一块发出，而不是每个样本一次信号
+    void samplesReceived(const SampleBlock &block);
     void connectionStatusChanged(bool connected);
+    // 设备掉线等非用户发起的断开，端口已关闭
+    void connectionLost(const QString &reason);
+    void acquisitionStatsUpdated(const AcquisitionStats &stats);
     void errorOccurred(const QString &error);
+    // 设备对命令的应答行，如 "ACK RATE 100 0.50"
+    void commandAcknowledged(const QString &reply);
 
 private slots:
     void handleReadyRead();
     void handleError(QSerialPort::SerialPortError error);
+    void onPollTimer();
+    void onFlushTimer();
+    void onStatsTimer();
 
 private:
-    void parseLine(const QByteArray &line);
+    void applyReadMode();
+    void drain();
+    int processChunk(const QByteArray &data, qint64 timestampUs);
+    bool parseLine(const QByteArray &line, qint64 timestampUs, SampleBlock &block);
+    void processEchoFrames(qint64 timestampUs, SampleBlock &block);
 
     QSerialPort *m_serialPort;
     QByteArray m_receiveBuffer;
+    SerialCapture m_capture;
+    std::atomic<bool> m_capturing;      // 采集线程写，界面线程读
+    std::atomic<qint64> m_capturedBytes;
+    EchoProcessor *m_echoProcessor;     // 首次收到包络帧时创建
+    QVector<EchoFrame> m_echoFrames;
+    QVector<int> m_echoPositions;       // 各帧到达时块中已有的文本样本数
+    QVector<double> m_echoDistances;
+    // 帧校验失败后的重新同步状态：丢弃到下一个换行，然后只接受经验证的文本行
+    enum ResyncState { InSync, SkipToNewline, VerifyLine };
+    ResyncState m_resync;
+    bool m_closePending;                // 致命错误后已排队关闭端口
+
+    ReadMode m_readMode;
+    bool m_busyPoll;
+    bool m_polling;
+    QTimer *m_pollTimer;
+    QTimer *m_flushTimer;
+    QTimer *m_statsTimer;
+    qint64 m_firstSeenUs;       // 尚未读出的字节首次可见的时间，-1 表示无
+    int m_savedVmin;            // 打开时的 termios 设置，切回非吞吐模式时恢复
+    int m_savedVtime;
+    qint64 m_lastSampleUs;
+
+    QElapsedTimer m_statsClock;
+    qint64 m_wakeups;
+    qint64 m_reads;
+    qint64 m_readBytes;
+    qint64 m_samples;
+    qint64 m_pings;
+    qint64 m_rejectedPings;
+    qint64 m_latencySumUs;
+    qint64 m_latencyMaxUs;
 };
 
 #endif // SERIALPORT_H
@@ -0,0 +1,127 @@
+#include "serialreplay.h"
+#include "serialcapture.h"
+#include <QtEndian>
+#include <cstring>
+
+// 快速模式下每个事件循环周期处理的记录数
+static const int kFastBatchRecords = 2000;
+
+SerialReplay::SerialReplay(QObject *parent)
+    : QObject(parent)
+    , m_speed(RealTime)
+    , m_timer(new QTimer(this))
+    , m_hasPending(false)
+    , m_pendingTimestampUs(0)
+    , m_firstTimestampUs(0)
+    , m_chunks(0)
+    , m_bytes(0)
+{
+    m_timer->setSingleShot(true);
+    m_timer->setTimerType(Qt::PreciseTimer);
+    connect(m_timer, &QTimer::timeout, this, &SerialReplay::onTimer);
+}
+
+SerialReplay::~SerialReplay()
+{
+    m_timer->stop();
+}
+
+bool SerialReplay::start(const QString &filePath, Speed speed)
+{
+    stop();
+
+    m_file.setFileName(filePath);
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        m_error = m_file.errorString();
+        return false;
+    }
+
+    QByteArray magic = m_file.read(sizeof(SerialCapture::kMagic));
+    if (magic.size() != static_cast<qsizetype>(sizeof(SerialCapture::kMagic))
+        || std::memcmp(magic.constData(), SerialCapture::kMagic, sizeof(SerialCapture::kMagic)) != 0) {
+        m_error = "Not a serial capture file";
+        m_file.close();
+        return false;
+    }
+
+    m_speed = speed;
+    m_chunks = 0;
+    m_bytes = 0;
+    m_clock.start();
+
+    if (!readRecord()) {
+        finish();
+        return true;
+    }
+    m_firstTimestampUs = m_pendingTimestampUs;
+    m_timer->start(0);
+    return true;
+}
+
+void SerialReplay::stop()
+{
+    if (m_file.isOpen()) {
+        finish();
+    }
+}
+
+void SerialReplay::onTimer()
+{
+    if (m_speed == AsFastAsPossible) {
+        for (int i = 0; i < kFastBatchRecords && m_hasPending; ++i) {
+            emit chunkReady(m_pendingData, m_pendingTimestampUs);
+            readRecord();
+        }
+        if (!m_hasPending) {
+            finish();
+        } else {
+            m_timer->start(0);  // 让出事件循环，界面保持响应
+        }
+        return;
+    }
+
+    // 1x：发送所有已到期的记录，然后等待下一条
+    qint64 elapsedUs = m_clock.nsecsElapsed() / 1000;
+    while (m_hasPending && m_pendingTimestampUs - m_firstTimestampUs <= elapsedUs) {
+        emit chunkReady(m_pendingData, m_pendingTimestampUs);
+        readRecord();
+    }
+
+    if (!m_hasPending) {
+        finish();
+        return;
+    }
+    qint64 delayUs = (m_pendingTimestampUs - m_firstTimestampUs) - elapsedUs;
+    m_timer->start(static_cast<int>(qMax<qint64>(0, delayUs / 1000)));
+}
+
+bool SerialReplay::readRecord()
+{
+    m_hasPending = false;
+
+    uchar header[12];
+    if (m_file.read(reinterpret_cast<char *>(header), sizeof(header)) != static_cast<qint64>(sizeof(header))) {
+        return false;
+    }
+    qint64 timestampUs = qFromLittleEndian<qint64>(header);
+    quint32 length = qFromLittleEndian<quint32>(header + 8);
+
+    m_pendingData = m_file.read(length);
+    if (static_cast<quint32>(m_pendingData.size()) != length) {
+        return false;  // 捕获文件末尾被截断
+    }
+
+    m_pendingTimestampUs = timestampUs;
+    m_hasPending = true;
+    m_chunks++;
+    m_bytes += length;
+    return true;
+}
+
+void SerialReplay::finish()
+{
+    m_timer->stop();
+    m_hasPending = false;
+    m_file.close();
+    emit finished(m_chunks, m_bytes, m_clock.elapsed());
+}
@@ -0,0 +1,59 @@
+#ifndef SERIALREPLAY_H
+#define SERIALREPLAY_H
+
+#include <QObject>
+#include <QFile>
+#include <QTimer>
+#include <QElapsedTimer>
+
+/**
+ * @brief 串口捕获文件回放，按原始时间戳把字节流送回完整处理管线
+ *
+ * RealTime 模式按记录间隔 1x 回放；AsFastAsPossible 模式每个事件循环周期
+ * 处理一批记录，时间戳保持捕获时的值，因此两种模式结果一致、可重复。
+ */
+class SerialReplay : public QObject {
+    Q_OBJECT
+
+public:
+    enum Speed {
+        RealTime,
+        AsFastAsPossible
+    };
+
+    explicit SerialReplay(QObject *parent = nullptr);
+    ~SerialReplay();
+
+    bool start(const QString &filePath, Speed speed);
+    void stop();
+    bool isRunning() const { return m_file.isOpen(); }
+    QString errorString() const { return m_error; }
+
+signals:
+    void chunkReady(const QByteArray &data, qint64 timestampUs);
+    void finished(qint64 chunks, qint64 bytes, qint64 elapsedMs);
+
+private slots:
+    void onTimer();
+
+private:
+    bool readRecord();
+    void finish();
+
+    QFile m_file;
+    QString m_error;
+    Speed m_speed;
+    QTimer *m_timer;
+    QElapsedTimer m_clock;
+
+    // 已读出、尚未发送的记录
+    bool m_hasPending;
+    qint64 m_pendingTimestampUs;
+    QByteArray m_pendingData;
+
+    qint64 m_firstTimestampUs;
+    qint64 m_chunks;
+    qint64 m_bytes;
+};
+
+#endif // SERIALREPLAY_H
@@ -0,0 +1,239 @@
+#include "sessioncatalogwidget.h"
+#include "samplefixed.h"
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QPushButton>
+#include <QTableWidget>
+#include <QHeaderView>
+#include <QFileDialog>
+#include <QMessageBox>
+#include <QDateTime>
+#include <algorithm>
+
+static const char *kDateTimeFormat = "yyyy-MM-dd hh:mm:ss";
+
+enum SessionColumn {
+    IdColumn,
+    NameColumn,
+    StartColumn,
+    DurationColumn,
+    RecordsColumn,
+    MeanColumn,
+    SdColumn,
+    MinColumn,
+    MaxColumn,
+    ChannelsColumn,
+    NotesColumn,
+    ColumnCount
+};
+
+SessionCatalogWidget::SessionCatalogWidget(DataManager *dataManager, QWidget *parent)
+    : QWidget(parent)
+    , m_dataManager(dataManager)
+    , m_isRefreshing(false)
+{
+    setWindowTitle("Recording Sessions");
+
+    m_table = new QTableWidget(0, ColumnCount);
+    m_table->setHorizontalHeaderLabels({"ID", "Name", "Start", "Duration (s)", "Records", "Mean", "SD",
+                                        "Min", "Max", "Channels", "Notes"});
+    m_table->horizontalHeader()->setStretchLastSection(true);
+    m_table->setSelectionBehavior(QAbstractItemView::SelectRows);
+    m_table->setEditTriggers(QAbstractItemView::DoubleClicked | QAbstractItemView::EditKeyPressed);
+
+    m_openButton = new QPushButton("Open");
+    m_openButton->setToolTip("Show the session in the history view");
+    m_compareButton = new QPushButton("Compare");
+    m_compareButton->setToolTip("Compare the summaries of two selected sessions");
+    m_exportButton = new QPushButton("Export CSV...");
+    m_deleteButton = new QPushButton("Delete");
+    m_deleteButton->setToolTip("Delete the session and its records");
+
+    QHBoxLayout *buttonLayout = new QHBoxLayout();
+    buttonLayout->addWidget(m_openButton);
+    buttonLayout->addWidget(m_compareButton);
+    buttonLayout->addWidget(m_exportButton);
+    buttonLayout->addStretch();
+    buttonLayout->addWidget(m_deleteButton);
+
+    QVBoxLayout *layout = new QVBoxLayout(this);
+    layout->addWidget(m_table, 1);
+    layout->addLayout(buttonLayout);
+    setLayout(layout);
+    resize(900, 420);
+
+    connect(m_openButton, &QPushButton::clicked, this, &SessionCatalogWidget::onOpenClicked);
+    connect(m_compareButton, &QPushButton::clicked, this, &SessionCatalogWidget::onCompareClicked);
+    connect(m_exportButton, &QPushButton::clicked, this, &SessionCatalogWidget::onExportClicked);
+    connect(m_deleteButton, &QPushButton::clicked, this, &SessionCatalogWidget::onDeleteClicked);
+    connect(m_table, &QTableWidget::itemChanged, this, &SessionCatalogWidget::onItemChanged);
+    connect(m_table, &QTableWidget::itemSelectionChanged, this, &SessionCatalogWidget::updateButtons);
+    connect(m_table, &QTableWidget::cellDoubleClicked, this, [this](int, int column) {
+        if (column != NameColumn && column != NotesColumn) {
+            onOpenClicked();
+        }
+    });
+    connect(m_dataManager, &DataManager::sessionsChanged, this, &SessionCatalogWidget::refresh);
+
+    refresh();
+}
+
+void SessionCatalogWidget::refresh()
+{
+    // 只读目录，与会话大小无关
+    if (!m_dataManager->querySessions(m_sessions)) {
+        return;
+    }
+
+    m_isRefreshing = true;
+    m_table->setRowCount(m_sessions.size());
+    for (int row = 0; row < m_sessions.size(); ++row) {
+        const RecordingSession &session = m_sessions[row];
+        const RangeStatistics &stats = session.stats;
+        bool hasStats = session.summarized && stats.count > 0;
+        auto number = [hasStats](double value) {
+            return hasStats ? QString::number(value, 'f', SampleFixed::kFractionDigits) : QString("--");
+        };
+
+        QStringList cells(ColumnCount);
+        cells[IdColumn] = QString::number(session.id);
+        cells[NameColumn] = session.name;
+        cells[StartColumn] = DataManager::fromStorageMs(session.startMs).toString(kDateTimeFormat);
+        cells[DurationColumn] = session.isActive() ? QString("recording")
+                                                   : QString::number(session.durationMs() / 1000.0, 'f', 1);
+        cells[RecordsColumn] = session.summarized ? QString::number(stats.count)
+                                                  : QString(session.isActive() ? "--" : "pending");
+        cells[MeanColumn] = number(stats.mean());
+        cells[SdColumn] = number(stats.standardDeviation());
+        cells[MinColumn] = number(stats.min);
+        cells[MaxColumn] = number(stats.max);
+        cells[ChannelsColumn] = session.channels.join(", ");
+        cells[NotesColumn] = session.notes;
+
+        for (int column = 0; column < ColumnCount; ++column) {
+            QTableWidgetItem *item = new QTableWidgetItem(cells[column]);
+            if (column != NameColumn && column != NotesColumn) {
+                item->setFlags(item->flags() & ~Qt::ItemIsEditable);
+            }
+            m_table->setItem(row, column, item);
+        }
+    }
+    m_isRefreshing = false;
+    updateButtons();
+}
+
+QVector<int> SessionCatalogWidget::selectedRows() const
+{
+    QVector<int> rows;
+    for (const QModelIndex &index : m_table->selectionModel()->selectedRows()) {
+        if (index.row() < m_sessions.size()) {
+            rows.append(index.row());
+        }
+    }
+    std::sort(rows.begin(), rows.end());
+    return rows;
+}
+
+void SessionCatalogWidget::updateButtons()
+{
+    QVector<int> rows = selectedRows();
+    bool single = rows.size() == 1;
+    m_openButton->setEnabled(single);
+    m_exportButton->setEnabled(single);
+    m_deleteButton->setEnabled(single && !m_sessions[rows.first()].isActive());
+    m_compareButton->setEnabled(rows.size() == 2 && m_sessions[rows[0]].summarized
+                                && m_sessions[rows[1]].summarized);
+}
+
+void SessionCatalogWidget::onOpenClicked()
+{
+    QVector<int> rows = selectedRows();
+    if (rows.size() != 1) {
+        return;
+    }
+    const RecordingSession &session = m_sessions[rows.first()];
+    qint64 endMs = session.isActive() ? DataManager::toStorageMs(QDateTime::currentDateTime()) : session.endMs;
+    emit sessionActivated(session.startMs, qMax(endMs, session.startMs + 1000));
+}
+
+void SessionCatalogWidget::onCompareClicked()
+{
+    QVector<int> rows = selectedRows();
+    if (rows.size() != 2) {
+        return;
+    }
+
+    // 较早的会话为 A；统计取自目录，不读取记录
+    const RecordingSession &a = m_sessions[rows[1]];
+    const RecordingSession &b = m_sessions[rows[0]];
+    struct Metric { const char *name; double a; double b; int decimals; };
+    const Metric metrics[] = {
+        {"Duration (s)", a.durationMs() / 1000.0, b.durationMs() / 1000.0, 1},
+        {"Records", double(a.stats.count), double(b.stats.count), 0},
+        {"Mean (cm)", a.stats.mean(), b.stats.mean(), SampleFixed::kFractionDigits},
+        {"SD (cm)", a.stats.standardDeviation(), b.stats.standardDeviation(), SampleFixed::kFractionDigits},
+        {"Min (cm)", a.stats.min, b.stats.min, SampleFixed::kFractionDigits},
+        {"Max (cm)", a.stats.max, b.stats.max, SampleFixed::kFractionDigits},
+    };
+
+    QString text = QString("<table cellspacing='6'><tr><th></th><th>A: %1</th><th>B: %2</th><th>B - A</th></tr>")
+                       .arg(a.name.toHtmlEscaped(), b.name.toHtmlEscaped());
+    for (const Metric &metric : metrics) {
+        text += QString("<tr><td>%1</td><td align='right'>%2</td><td align='right'>%3</td>"
+                        "<td align='right'>%4</td></tr>")
+                    .arg(metric.name)
+                    .arg(metric.a, 0, 'f', metric.decimals)
+                    .arg(metric.b, 0, 'f', metric.decimals)
+                    .arg(metric.b - metric.a, 0, 'f', metric.decimals);
+    }
+    text += "</table>";
+    QMessageBox::information(this, "Compare Sessions", text);
+}
+
+void SessionCatalogWidget::onExportClicked()
+{
+    QVector<int> rows = selectedRows();
+    if (rows.size() != 1) {
+        return;
+    }
+    const RecordingSession &session = m_sessions[rows.first()];
+
+    QString suggested = QString("session_%1.csv").arg(session.id);
+    QString fileName = QFileDialog::getSaveFileName(this, "Export Session", suggested, "CSV Files (*.csv)");
+    if (fileName.isEmpty()) {
+        return;
+    }
+    if (m_dataManager->exportSession(session, fileName)) {
+        QMessageBox::information(this, "Export", QString("Session exported to %1").arg(fileName));
+    }
+}
+
+void SessionCatalogWidget::onDeleteClicked()
+{
+    QVector<int> rows = selectedRows();
+    if (rows.size() != 1) {
+        return;
+    }
+    const RecordingSession session = m_sessions[rows.first()];
+    QString question = QString("Delete session \"%1\" and its %2 record(s)?").arg(session.name).arg(session.stats.count);
+    if (QMessageBox::question(this, "Delete Session", question) == QMessageBox::Yes) {
+        m_dataManager->deleteSession(session.id);
+    }
+}
+
+void SessionCatalogWidget::onItemChanged(QTableWidgetItem *item)
+{
+    if (m_isRefreshing || item->row() >= m_sessions.size()
+        || (item->column() != NameColumn && item->column() != NotesColumn)) {
+        return;
+    }
+    RecordingSession &session = m_sessions[item->row()];
+    QString name = m_table->item(item->row(), NameColumn)->text().trimmed();
+    QString notes = m_table->item(item->row(), NotesColumn)->text();
+    if (name.isEmpty()) {
+        name = session.name;
+    }
+    if (name != session.name || notes != session.notes) {
+        m_dataManager->updateSessionInfo(session.id, name, notes);
+    }
+}
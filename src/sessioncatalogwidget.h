@@ -0,0 +1,52 @@
+#ifndef SESSIONCATALOGWIDGET_H
+#define SESSIONCATALOGWIDGET_H
+
+#include <QWidget>
+#include <QVector>
+
+#include "datamanager.h"
+
+class QPushButton;
+class QTableWidget;
+class QTableWidgetItem;
+
+/**
+ * @brief 录制会话目录：列出各会话及预先算好的统计，可打开、对比、导出或删除
+ *
+ * 列表与对比只读取会话目录；打开、导出与删除按会话的起止时间访问记录。名称与备注可直接编辑。
+ */
+class SessionCatalogWidget : public QWidget {
+    Q_OBJECT
+
+public:
+    explicit SessionCatalogWidget(DataManager *dataManager, QWidget *parent = nullptr);
+
+public slots:
+    void refresh();
+
+signals:
+    // 在历史视图中显示会话（存储毫秒）
+    void sessionActivated(qint64 startMs, qint64 endMs);
+
+private slots:
+    void onOpenClicked();
+    void onCompareClicked();
+    void onExportClicked();
+    void onDeleteClicked();
+    void onItemChanged(QTableWidgetItem *item);
+
+private:
+    QVector<int> selectedRows() const;
+    void updateButtons();
+
+    DataManager *m_dataManager;
+    QVector<RecordingSession> m_sessions;
+    QTableWidget *m_table;
+    QPushButton *m_openButton;
+    QPushButton *m_compareButton;
+    QPushButton *m_exportButton;
+    QPushButton *m_deleteButton;
+    bool m_isRefreshing;
+};
+
+#endif // SESSIONCATALOGWIDGET_H
@@ -0,0 +1,362 @@
+#include "shapesearch.h"
+#include <QThread>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SHAPESEARCH_SSE2
+#endif
+
+// 标准差低于传感器分辨率的窗口视为平坦段，不参与匹配
+static const double kMinStd = 0.01;
+// 滑动求和每隔若干窗口重新精确计算，抑制累积误差
+static const qint64 kResyncWindows = 1 << 16;
+static const double kInfinity = std::numeric_limits<double>::infinity();
+
+struct ShapeSearch::Partition {
+    const float *data;
+    qint64 from;         // 窗口起点范围 [from, to)
+    qint64 to;
+    qint64 baseOffset;
+    double initialBound;
+    QVector<ShapeMatch> local;
+    Stats stats;
+};
+
+#ifdef SHAPESEARCH_SSE2
+static inline double horizontalSum(__m128 v)
+{
+    __m128 high = _mm_movehl_ps(v, v);
+    __m128 sum = _mm_add_ps(v, high);
+    sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+    return _mm_cvtss_f32(sum);
+}
+#endif
+
+// z 归一化欧氏距离平方，超过 bound 时提前返回
+static double euclideanEarlyAbandon(const float *x, const float *q, int m, float mean, float invStd, double bound)
+{
+    double sum = 0.0;
+    int i = 0;
+#ifdef SHAPESEARCH_SSE2
+    const __m128 vMean = _mm_set1_ps(mean);
+    const __m128 vInv = _mm_set1_ps(invStd);
+    while (i + 16 <= m) {
+        __m128 acc = _mm_setzero_ps();
+        for (int j = 0; j < 16; j += 4) {
+            __m128 z = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(x + i + j), vMean), vInv);
+            __m128 d = _mm_sub_ps(z, _mm_loadu_ps(q + i + j));
+            acc = _mm_add_ps(acc, _mm_mul_ps(d, d));
+        }
+        sum += horizontalSum(acc);
+        i += 16;
+        if (sum >= bound) {
+            return sum;
+        }
+    }
+#endif
+    for (; i < m; ++i) {
+        float d = (x[i] - mean) * invStd - q[i];
+        sum += d * d;
+        if ((i & 15) == 15 && sum >= bound) {
+            return sum;
+        }
+    }
+    return sum;
+}
+
+// LB_Keogh：候选点落在模板包络之外的部分，逐点贡献写入 contrib 供 DTW 累积下界使用
+static double lbKeogh(const float *x, const float *upper, const float *lower, int m,
+                      float mean, float invStd, double bound, float *contrib)
+{
+    double sum = 0.0;
+    int i = 0;
+#ifdef SHAPESEARCH_SSE2
+    const __m128 vMean = _mm_set1_ps(mean);
+    const __m128 vInv = _mm_set1_ps(invStd);
+    const __m128 vZero = _mm_setzero_ps();
+    while (i + 16 <= m) {
+        __m128 acc = _mm_setzero_ps();
+        for (int j = 0; j < 16; j += 4) {
+            __m128 z = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(x + i + j), vMean), vInv);
+            // 上下越界至多一个非零，(a + b)^2 即为该点贡献
+            __m128 above = _mm_max_ps(_mm_sub_ps(z, _mm_loadu_ps(upper + i + j)), vZero);
+            __m128 below = _mm_max_ps(_mm_sub_ps(_mm_loadu_ps(lower + i + j), z), vZero);
+            __m128 d = _mm_add_ps(above, below);
+            d = _mm_mul_ps(d, d);
+            _mm_storeu_ps(contrib + i + j, d);
+            acc = _mm_add_ps(acc, d);
+        }
+        sum += horizontalSum(acc);
+        i += 16;
+        if (sum >= bound) {
+            return sum;
+        }
+    }
+#endif
+    for (; i < m; ++i) {
+        float z = (x[i] - mean) * invStd;
+        float d = z > upper[i] ? z - upper[i] : (z < lower[i] ? lower[i] - z : 0.0f);
+        contrib[i] = d * d;
+        sum += contrib[i];
+    }
+    return sum;
+}
+
+// 带约束的 DTW（距离平方和），cb[i] 为第 i 点之后的累积下界，用于提前放弃
+static double dtwBanded(const float *a, const float *b, const double *cb, int m, int r, double bound,
+                        double *cost, double *previous)
+{
+    int width = 2 * r + 1;
+    std::fill(cost, cost + width, kInfinity);
+    std::fill(previous, previous + width, kInfinity);
+
+    int k = 0;
+    for (int i = 0; i < m; ++i) {
+        k = qMax(0, r - i);
+        double rowMin = kInfinity;
+        for (int j = qMax(0, i - r); j <= qMin(m - 1, i + r); ++j, ++k) {
+            double d = a[i] - b[j];
+            d *= d;
+            if (i == 0 && j == 0) {
+                cost[k] = d;
+                rowMin = d;
+                continue;
+            }
+            double left = (j - 1 < 0 || k - 1 < 0) ? kInfinity : cost[k - 1];
+            double up = (i - 1 < 0 || k + 1 > 2 * r) ? kInfinity : previous[k + 1];
+            double diagonal = (i - 1 < 0 || j - 1 < 0) ? kInfinity : previous[k];
+            cost[k] = std::min(std::min(left, up), diagonal) + d;
+            rowMin = std::min(rowMin, cost[k]);
+        }
+        if (i + r < m - 1 && rowMin + cb[i + r + 1] >= bound) {
+            return rowMin + cb[i + r + 1];
+        }
+        std::swap(cost, previous);
+    }
+    return previous[k - 1];
+}
+
+ShapeSearch::ShapeSearch()
+    : m_band(0)
+    , m_topK(10)
+    , m_threadCount(qMax(1, QThread::idealThreadCount()))
+{
+}
+
+ShapeSearch::~ShapeSearch()
+{
+    wait();
+}
+
+bool ShapeSearch::setTemplate(const QVector<float> &values, double warpingWindow, QString *error)
+{
+    int m = values.size();
+    if (m < 4) {
+        if (error) {
+            *error = "Template needs at least 4 samples";
+        }
+        return false;
+    }
+
+    double sum = 0.0;
+    double sumSq = 0.0;
+    for (float v : values) {
+        sum += v;
+        sumSq += double(v) * v;
+    }
+    double mean = sum / m;
+    double std = std::sqrt(qMax(0.0, sumSq / m - mean * mean));
+    if (std < kMinStd) {
+        if (error) {
+            *error = "Template is flat";
+        }
+        return false;
+    }
+
+    m_query.resize(m);
+    for (int i = 0; i < m; ++i) {
+        m_query[i] = float((values[i] - mean) / std);
+    }
+
+    m_band = qBound(0, int(std::floor(warpingWindow * m)), m - 1);
+    m_upper.resize(m);
+    m_lower.resize(m);
+    for (int i = 0; i < m; ++i) {
+        float upper = m_query[i];
+        float lower = m_query[i];
+        for (int j = qMax(0, i - m_band); j <= qMin(m - 1, i + m_band); ++j) {
+            upper = std::max(upper, m_query[j]);
+            lower = std::min(lower, m_query[j]);
+        }
+        m_upper[i] = upper;
+        m_lower[i] = lower;
+    }
+
+    m_matches.clear();
+    m_stats = Stats();
+    return true;
+}
+
+void ShapeSearch::start(const float *data, qint64 count, qint64 baseOffset)
+{
+    wait();
+
+    int m = m_query.size();
+    qint64 windows = count - m + 1;
+    if (m == 0 || windows <= 0) {
+        return;
+    }
+
+    // 已有结果的第 K 名作为各线程的初始剪枝阈值
+    double bound = m_matches.size() >= m_topK ? m_matches.last().score : kInfinity;
+    int threads = int(qMin<qint64>(m_threadCount, qMax<qint64>(1, windows / 4096)));
+    qint64 step = (windows + threads - 1) / threads;
+
+    for (int t = 0; t < threads; ++t) {
+        Partition *partition = new Partition;
+        partition->data = data;
+        partition->from = t * step;
+        partition->to = qMin(windows, partition->from + step);
+        partition->baseOffset = baseOffset;
+        partition->initialBound = bound;
+        m_partitions.append(partition);
+
+        QThread *thread = QThread::create([this, partition]() { searchPartition(partition); });
+        thread->start();
+        m_threads.append(thread);
+    }
+}
+
+void ShapeSearch::wait()
+{
+    for (QThread *thread : m_threads) {
+        thread->wait();
+        delete thread;
+    }
+    m_threads.clear();
+
+    qint64 exclusion = qMax(1, m_query.size() / 2);
+    for (Partition *partition : m_partitions) {
+        for (const ShapeMatch &match : partition->local) {
+            offer(m_matches, m_topK, exclusion, match.offset, match.score);
+        }
+        m_stats.windows += partition->stats.windows;
+        m_stats.skippedFlat += partition->stats.skippedFlat;
+        m_stats.prunedKim += partition->stats.prunedKim;
+        m_stats.prunedKeogh += partition->stats.prunedKeogh;
+        m_stats.fullComputations += partition->stats.fullComputations;
+        delete partition;
+    }
+    m_partitions.clear();
+}
+
+void ShapeSearch::offer(QVector<ShapeMatch> &list, int topK, qint64 exclusion, qint64 offset, double score)
+{
+    if (list.size() >= topK && score >= list.last().score) {
+        return;
+    }
+
+    // 与已有结果重叠：保留更优者
+    for (int i = list.size() - 1; i >= 0; --i) {
+        if (std::llabs(list[i].offset - offset) < exclusion) {
+            if (list[i].score <= score) {
+                return;
+            }
+            list.remove(i);
+        }
+    }
+
+    ShapeMatch match{offset, score, -1, -1};
+    auto it = std::upper_bound(list.begin(), list.end(), score,
+                               [](double value, const ShapeMatch &item) { return value < item.score; });
+    list.insert(it, match);
+    if (list.size() > topK) {
+        list.removeLast();
+    }
+}
+
+void ShapeSearch::searchPartition(Partition *partition) const
+{
+    const int m = m_query.size();
+    const int r = m_band;
+    const float *x = partition->data;
+    const float *q = m_query.constData();
+    const qint64 exclusion = qMax(1, m / 2);
+
+    QVector<float> contrib(m);
+    QVector<double> cumulative(m + 1);
+    QVector<float> normalized(m);
+    QVector<double> cost(2 * r + 1);
+    QVector<double> previous(2 * r + 1);
+
+    double sum = 0.0;
+    double sumSq = 0.0;
+    for (qint64 i = partition->from; i < partition->to; ++i) {
+        if ((i - partition->from) % kResyncWindows == 0) {
+            sum = 0.0;
+            sumSq = 0.0;
+            for (int j = 0; j < m; ++j) {
+                sum += x[i + j];
+                sumSq += double(x[i + j]) * x[i + j];
+            }
+        } else {
+            double in = x[i + m - 1];
+            double out = x[i - 1];
+            sum += in - out;
+            sumSq += in * in - out * out;
+        }
+        ++partition->stats.windows;
+
+        double mean = sum / m;
+        double variance = sumSq / m - mean * mean;
+        if (variance < kMinStd * kMinStd) {
+            ++partition->stats.skippedFlat;
+            continue;
+        }
+        float invStd = float(1.0 / std::sqrt(variance));
+        const float *window = x + i;
+
+        double bound = partition->initialBound;
+        if (partition->local.size() >= m_topK) {
+            bound = std::min(bound, partition->local.last().score);
+        }
+
+        double score;
+        if (r == 0) {
+            score = euclideanEarlyAbandon(window, q, m, float(mean), invStd, bound);
+            ++partition->stats.fullComputations;
+        } else {
+            // LB_Kim：DTW 首尾点必然对齐
+            float first = (window[0] - float(mean)) * invStd - q[0];
+            float last = (window[m - 1] - float(mean)) * invStd - q[m - 1];
+            if (double(first) * first + double(last) * last >= bound) {
+                ++partition->stats.prunedKim;
+                continue;
+            }
+
+            if (lbKeogh(window, m_upper.constData(), m_lower.constData(), m,
+                        float(mean), invStd, bound, contrib.data()) >= bound) {
+                ++partition->stats.prunedKeogh;
+                continue;
+            }
+
+            cumulative[m] = 0.0;
+            for (int j = m - 1; j >= 0; --j) {
+                cumulative[j] = cumulative[j + 1] + contrib[j];
+            }
+            for (int j = 0; j < m; ++j) {
+                normalized[j] = (window[j] - float(mean)) * invStd;
+            }
+            score = dtwBanded(normalized.constData(), q, cumulative.constData(), m, r, bound,
+                              cost.data(), previous.data());
+            ++partition->stats.fullComputations;
+        }
+
+        if (score < bound) {
+            offer(partition->local, m_topK, exclusion, partition->baseOffset + i, score);
+        }
+    }
+}
@@ -0,0 +1,75 @@
+#ifndef SHAPESEARCH_H
+#define SHAPESEARCH_H
+
+#include <QVector>
+#include <QString>
+
+class QThread;
+
+/**
+ * @brief 形状匹配结果（score 为 z 归一化距离的平方）
+ */
+struct ShapeMatch {
+    qint64 offset;       // 窗口起点在整个序列中的下标
+    double score;
+    qint64 startMs;      // 存储毫秒，-1 表示尚未回填
+    qint64 endMs;
+};
+
+/**
+ * @brief 按模板波形查找最相似的 K 个窗口
+ *
+ * 模板与候选窗口均做 z 归一化。warpingWindow 为 0 时使用欧氏距离并提前放弃；
+ * 大于 0 时使用带 Sakoe-Chiba 约束的 DTW，依次用 LB_Kim、LB_Keogh 下界剪枝，
+ * 只有通过剪枝的候选才计算完整 DTW。内层循环在 SSE2 可用时使用向量指令。
+ *
+ * 数据按块送入：start() 把当前块切分给多个线程并立即返回，调用方可在此期间
+ * 读取下一块；wait() 汇合并合并各线程结果。相互重叠超过半个模板长度的匹配只保留最优者。
+ */
+class ShapeSearch {
+public:
+    struct Stats {
+        qint64 windows = 0;
+        qint64 skippedFlat = 0;      // 方差过小，无形状可言
+        qint64 prunedKim = 0;
+        qint64 prunedKeogh = 0;
+        qint64 fullComputations = 0;
+    };
+
+    ShapeSearch();
+    ~ShapeSearch();
+
+    bool setTemplate(const QVector<float> &values, double warpingWindow, QString *error = nullptr);
+    void setTopK(int k) { m_topK = qMax(1, k); }
+    void setThreadCount(int count) { m_threadCount = qMax(1, count); }
+    int templateLength() const { return m_query.size(); }
+    int warpingBand() const { return m_band; }
+
+    // data 在 wait() 返回前必须保持有效
+    void start(const float *data, qint64 count, qint64 baseOffset);
+    void wait();
+
+    QVector<ShapeMatch> matches() const { return m_matches; }
+    QVector<ShapeMatch> &mutableMatches() { return m_matches; }
+    Stats stats() const { return m_stats; }
+
+private:
+    struct Partition;
+
+    void searchPartition(Partition *partition) const;
+    static void offer(QVector<ShapeMatch> &list, int topK, qint64 exclusion, qint64 offset, double score);
+
+    QVector<float> m_query;      // z 归一化模板
+    QVector<float> m_upper;      // 模板包络（DTW 用）
+    QVector<float> m_lower;
+    int m_band;
+    int m_topK;
+    int m_threadCount;
+
+    QVector<ShapeMatch> m_matches;
+    Stats m_stats;
+    QVector<Partition *> m_partitions;
+    QVector<QThread *> m_threads;
+};
+
+#endif // SHAPESEARCH_H
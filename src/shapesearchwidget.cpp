@@ -0,0 +1,224 @@
+#include "shapesearchwidget.h"
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QGridLayout>
+#include <QGroupBox>
+#include <QDateTimeEdit>
+#include <QSpinBox>
+#include <QDoubleSpinBox>
+#include <QPushButton>
+#include <QProgressBar>
+#include <QLabel>
+#include <QTableWidget>
+#include <QHeaderView>
+#include <QFileDialog>
+#include <QFile>
+#include <QFileInfo>
+#include <QTextStream>
+#include <QDateTime>
+
+static const char *kDateTimeFormat = "yyyy-MM-dd hh:mm:ss";
+
+ShapeSearchWidget::ShapeSearchWidget(const QString &dbPath, QWidget *parent)
+    : QWidget(parent)
+    , m_workerThread(new QThread(this))
+    , m_worker(new ShapeSearchWorker(dbPath))
+    , m_isSearching(false)
+{
+    qRegisterMetaType<ShapeSearchRequest>("ShapeSearchRequest");
+    qRegisterMetaType<QVector<ShapeSearchResult>>("QVector<ShapeSearchResult>");
+
+    setWindowTitle("Shape Search");
+
+    QDateTime now = QDateTime::currentDateTime();
+
+    // 模板
+    QGroupBox *templateGroup = new QGroupBox("Template");
+    m_templateStartEdit = new QDateTimeEdit(now.addSecs(-60));
+    m_templateEndEdit = new QDateTimeEdit(now);
+    m_templateStartEdit->setDisplayFormat(kDateTimeFormat);
+    m_templateEndEdit->setDisplayFormat(kDateTimeFormat);
+    m_templateLabel = new QLabel("Source: time range");
+    QPushButton *loadTemplateButton = new QPushButton("From File...");
+
+    QGridLayout *templateLayout = new QGridLayout(templateGroup);
+    templateLayout->addWidget(new QLabel("From:"), 0, 0);
+    templateLayout->addWidget(m_templateStartEdit, 0, 1);
+    templateLayout->addWidget(new QLabel("To:"), 0, 2);
+    templateLayout->addWidget(m_templateEndEdit, 0, 3);
+    templateLayout->addWidget(m_templateLabel, 1, 0, 1, 3);
+    templateLayout->addWidget(loadTemplateButton, 1, 3);
+
+    // 查询范围与参数
+    QGroupBox *searchGroup = new QGroupBox("Search");
+    m_searchStartEdit = new QDateTimeEdit(now.addDays(-30));
+    m_searchEndEdit = new QDateTimeEdit(now);
+    m_searchStartEdit->setDisplayFormat(kDateTimeFormat);
+    m_searchEndEdit->setDisplayFormat(kDateTimeFormat);
+    m_topKSpinBox = new QSpinBox();
+    m_topKSpinBox->setRange(1, 100);
+    m_topKSpinBox->setValue(10);
+    m_warpingSpinBox = new QDoubleSpinBox();
+    m_warpingSpinBox->setRange(0.0, 50.0);
+    m_warpingSpinBox->setSingleStep(1.0);
+    m_warpingSpinBox->setValue(5.0);
+    m_warpingSpinBox->setSuffix(" %");
+    m_warpingSpinBox->setToolTip("DTW warping window as a share of the template length; 0 uses Euclidean distance");
+    m_searchButton = new QPushButton("Search");
+
+    QGridLayout *searchLayout = new QGridLayout(searchGroup);
+    searchLayout->addWidget(new QLabel("From:"), 0, 0);
+    searchLayout->addWidget(m_searchStartEdit, 0, 1);
+    searchLayout->addWidget(new QLabel("To:"), 0, 2);
+    searchLayout->addWidget(m_searchEndEdit, 0, 3);
+    searchLayout->addWidget(new QLabel("Top K:"), 1, 0);
+    searchLayout->addWidget(m_topKSpinBox, 1, 1);
+    searchLayout->addWidget(new QLabel("Warping:"), 1, 2);
+    searchLayout->addWidget(m_warpingSpinBox, 1, 3);
+    searchLayout->addWidget(m_searchButton, 2, 3);
+
+    m_progressBar = new QProgressBar();
+    m_progressBar->setRange(0, 100);
+    m_summaryLabel = new QLabel();
+    m_summaryLabel->setWordWrap(true);
+
+    m_resultTable = new QTableWidget(0, 4);
+    m_resultTable->setHorizontalHeaderLabels({"Start", "End", "Duration (s)", "Distance"});
+    m_resultTable->horizontalHeader()->setStretchLastSection(true);
+    m_resultTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    m_resultTable->setSelectionBehavior(QAbstractItemView::SelectRows);
+
+    QVBoxLayout *layout = new QVBoxLayout(this);
+    layout->addWidget(templateGroup);
+    layout->addWidget(searchGroup);
+    layout->addWidget(m_progressBar);
+    layout->addWidget(m_summaryLabel);
+    layout->addWidget(m_resultTable, 1);
+    setLayout(layout);
+    resize(640, 600);
+
+    connect(loadTemplateButton, &QPushButton::clicked, this, &ShapeSearchWidget::onLoadTemplateClicked);
+    connect(m_searchButton, &QPushButton::clicked, this, &ShapeSearchWidget::onSearchClicked);
+    connect(m_resultTable, &QTableWidget::cellDoubleClicked, this, &ShapeSearchWidget::onResultDoubleClicked);
+    auto useRange = [this]() {
+        m_fileTemplate.clear();
+        m_templateLabel->setText("Source: time range");
+    };
+    connect(m_templateStartEdit, &QDateTimeEdit::dateTimeChanged, this, useRange);
+    connect(m_templateEndEdit, &QDateTimeEdit::dateTimeChanged, this, useRange);
+
+    // 后台查询线程
+    m_worker->moveToThread(m_workerThread);
+    connect(m_workerThread, &QThread::started, m_worker, &ShapeSearchWorker::open);
+    connect(m_workerThread, &QThread::finished, m_worker, &QObject::deleteLater);
+    connect(this, &ShapeSearchWidget::searchRequested, m_worker, &ShapeSearchWorker::search);
+    connect(m_worker, &ShapeSearchWorker::progressChanged, this, &ShapeSearchWidget::onProgressChanged);
+    connect(m_worker, &ShapeSearchWorker::searchFinished, this, &ShapeSearchWidget::onSearchFinished);
+    connect(m_worker, &ShapeSearchWorker::errorOccurred, this, &ShapeSearchWidget::errorOccurred);
+    m_workerThread->start();
+}
+
+ShapeSearchWidget::~ShapeSearchWidget()
+{
+    m_worker->cancel();
+    m_workerThread->quit();
+    m_workerThread->wait();
+}
+
+void ShapeSearchWidget::setTemplateRange(qint64 startMs, qint64 endMs)
+{
+    m_templateStartEdit->setDateTime(DataManager::fromStorageMs(startMs));
+    m_templateEndEdit->setDateTime(DataManager::fromStorageMs(endMs));
+}
+
+void ShapeSearchWidget::onSearchClicked()
+{
+    if (m_isSearching) {
+        m_worker->cancel();
+        return;
+    }
+
+    ShapeSearchRequest request;
+    request.templateValues = m_fileTemplate;
+    request.templateStartMs = DataManager::toStorageMs(m_templateStartEdit->dateTime());
+    request.templateEndMs = DataManager::toStorageMs(m_templateEndEdit->dateTime());
+    request.startMs = DataManager::toStorageMs(m_searchStartEdit->dateTime());
+    request.endMs = DataManager::toStorageMs(m_searchEndEdit->dateTime());
+    request.topK = m_topKSpinBox->value();
+    request.warpingWindow = m_warpingSpinBox->value() / 100.0;
+
+    setSearching(true);
+    m_progressBar->setValue(0);
+    m_summaryLabel->clear();
+    emit searchRequested(request);
+}
+
+void ShapeSearchWidget::onLoadTemplateClicked()
+{
+    QString fileName = QFileDialog::getOpenFileName(this, "Load Template", QString(),
+                                                    "Text Files (*.csv *.txt);;All Files (*)");
+    if (fileName.isEmpty()) {
+        return;
+    }
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        emit errorOccurred("Cannot open template: " + file.errorString());
+        return;
+    }
+
+    // 每行一个值；CSV 取最后一列，无法解析的行（表头等）跳过
+    QVector<float> values;
+    QTextStream in(&file);
+    while (!in.atEnd()) {
+        QString line = in.readLine().trimmed();
+        bool ok = false;
+        float value = line.section(',', -1).trimmed().toFloat(&ok);
+        if (ok) {
+            values.append(value);
+        }
+    }
+
+    if (values.size() < 4) {
+        emit errorOccurred("Template file has too few values");
+        return;
+    }
+    m_fileTemplate = values;
+    m_templateLabel->setText(QString("Source: %1 (%2 samples)").arg(QFileInfo(fileName).fileName()).arg(values.size()));
+}
+
+void ShapeSearchWidget::onProgressChanged(int percent)
+{
+    m_progressBar->setValue(percent);
+}
+
+void ShapeSearchWidget::onSearchFinished(const QVector<ShapeSearchResult> &results, const QString &summary)
+{
+    setSearching(false);
+    m_progressBar->setValue(100);
+    m_summaryLabel->setText(summary);
+    m_results = results;
+
+    m_resultTable->setRowCount(results.size());
+    for (int i = 0; i < results.size(); ++i) {
+        const ShapeSearchResult &result = results[i];
+        m_resultTable->setItem(i, 0, new QTableWidgetItem(DataManager::fromStorageMs(result.startMs).toString("yyyy-MM-dd hh:mm:ss.zzz")));
+        m_resultTable->setItem(i, 1, new QTableWidgetItem(DataManager::fromStorageMs(result.endMs).toString("yyyy-MM-dd hh:mm:ss.zzz")));
+        m_resultTable->setItem(i, 2, new QTableWidgetItem(QString::number((result.endMs - result.startMs) / 1000.0, 'f', 2)));
+        m_resultTable->setItem(i, 3, new QTableWidgetItem(QString::number(result.distance, 'f', 3)));
+    }
+}
+
+void ShapeSearchWidget::onResultDoubleClicked(int row, int column)
+{
+    Q_UNUSED(column);
+    if (row >= 0 && row < m_results.size()) {
+        emit matchActivated(m_results[row].startMs, m_results[row].endMs);
+    }
+}
+
+void ShapeSearchWidget::setSearching(bool searching)
+{
+    m_isSearching = searching;
+    m_searchButton->setText(searching ? "Cancel" : "Search");
+}
@@ -0,0 +1,66 @@
+#ifndef SHAPESEARCHWIDGET_H
+#define SHAPESEARCHWIDGET_H
+
+#include <QWidget>
+#include <QThread>
+#include <QVector>
+
+#include "shapesearchworker.h"
+
+class QDateTimeEdit;
+class QSpinBox;
+class QDoubleSpinBox;
+class QPushButton;
+class QProgressBar;
+class QLabel;
+class QTableWidget;
+
+/**
+ * @brief 按形状查询历史数据：模板取自一段历史或文件，返回最相似的 K 个窗口
+ */
+class ShapeSearchWidget : public QWidget {
+    Q_OBJECT
+
+public:
+    explicit ShapeSearchWidget(const QString &dbPath, QWidget *parent = nullptr);
+    ~ShapeSearchWidget();
+
+    // 用一段历史作为模板（存储毫秒）
+    void setTemplateRange(qint64 startMs, qint64 endMs);
+
+signals:
+    void searchRequested(const ShapeSearchRequest &request);
+    void matchActivated(qint64 startMs, qint64 endMs);
+    void errorOccurred(const QString &error);
+
+private slots:
+    void onSearchClicked();
+    void onLoadTemplateClicked();
+    void onProgressChanged(int percent);
+    void onSearchFinished(const QVector<ShapeSearchResult> &results, const QString &summary);
+    void onResultDoubleClicked(int row, int column);
+
+private:
+    void setSearching(bool searching);
+
+    QThread *m_workerThread;
+    ShapeSearchWorker *m_worker;
+
+    QDateTimeEdit *m_templateStartEdit;
+    QDateTimeEdit *m_templateEndEdit;
+    QLabel *m_templateLabel;
+    QDateTimeEdit *m_searchStartEdit;
+    QDateTimeEdit *m_searchEndEdit;
+    QSpinBox *m_topKSpinBox;
+    QDoubleSpinBox *m_warpingSpinBox;
+    QPushButton *m_searchButton;
+    QProgressBar *m_progressBar;
+    QLabel *m_summaryLabel;
+    QTableWidget *m_resultTable;
+
+    QVector<float> m_fileTemplate;   // 非空时优先于模板时间范围
+    QVector<ShapeSearchResult> m_results;
+    bool m_isSearching;
+};
+
+#endif // SHAPESEARCHWIDGET_H
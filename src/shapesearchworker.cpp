@@ -0,0 +1,262 @@
+#include "shapesearchworker.h"
+#include "shapesearch.h"
+#include <QElapsedTimer>
+#include <cmath>
+
+// 每块读取的样本数；读取下一块与匹配当前块并行进行
+static const int kChunkSamples = 4 * 1024 * 1024;
+static const int kMaxTemplateSamples = 20000;
+// 重采样时每次从库中读取的保存点数
+static const int kResampleReadRows = 65536;
+// 压缩时间段没有记录名义采样间隔时的重采样步长
+static const qint64 kDefaultResampleStepMs = 100;
+
+namespace {
+struct SeriesChunk {
+    QVector<qint64> timesMs;
+    QVector<float> values;
+    qint64 baseOffset = 0;
+};
+
+/**
+ * 顺序读取 [startMs, endMs) 的序列。ShapeSearch 按样本下标匹配，压缩保存的时间段内记录不等间隔，
+ * 此时按 stepMs 等间隔重采样（与 SampleCompressor::interpolate 相同的线性插值与中断规则，中断处不输出）；
+ * stepMs 为 0 时原样读取
+ */
+class SeriesReader {
+public:
+    SeriesReader(DataManager *dataManager, qint64 startMs, qint64 endMs, qint64 stepMs)
+        : m_dataManager(dataManager)
+        , m_cursor(DataManager::seriesCursorAt(startMs))
+        , m_endMs(endMs)
+        , m_stepMs(stepMs)
+    {
+    }
+
+    // 追加最多 limit 个样本，返回追加的个数，0 表示已读完
+    int read(int limit, QVector<qint64> &timesMs, QVector<float> &values)
+    {
+        if (m_stepMs <= 0) {
+            return m_dataManager->scanSeries(m_cursor, m_endMs, limit, timesMs, values);
+        }
+
+        int produced = 0;
+        while (produced < limit) {
+            if (m_index >= m_rowTimes.size()) {
+                m_rowTimes.clear();
+                m_rowValues.clear();
+                m_index = 0;
+                if (m_dataManager->scanSeries(m_cursor, m_endMs, kResampleReadRows, m_rowTimes, m_rowValues) <= 0) {
+                    break;
+                }
+            }
+
+            qint64 timeMs = m_rowTimes[m_index];
+            double value = m_rowValues[m_index];
+            if (!m_hasPrevious || timeMs - m_previousMs > SampleCompressor::kMaxIntervalUs / 1000) {
+                // 起点或中断之后：网格从此点重新对齐
+                m_hasPrevious = true;
+                m_previousMs = timeMs;
+                m_previousValue = value;
+                m_gridMs = (timeMs + m_stepMs - 1) / m_stepMs * m_stepMs;
+                ++m_index;
+                continue;
+            }
+
+            double gridValue;
+            while (m_gridMs <= timeMs && produced < limit
+                   && SampleCompressor::interpolate(m_previousMs, m_previousValue, timeMs, value, m_gridMs, gridValue)) {
+                timesMs.append(m_gridMs);
+                values.append(float(gridValue));
+                m_gridMs += m_stepMs;
+                ++produced;
+            }
+            if (m_gridMs > timeMs) {
+                m_previousMs = timeMs;
+                m_previousValue = value;
+                ++m_index;
+            }
+        }
+        return produced;
+    }
+
+private:
+    DataManager *m_dataManager;
+    DataManager::SeriesCursor m_cursor;
+    qint64 m_endMs;
+    qint64 m_stepMs;
+    QVector<qint64> m_rowTimes;
+    QVector<float> m_rowValues;
+    int m_index = 0;
+    bool m_hasPrevious = false;
+    qint64 m_previousMs = 0;
+    double m_previousValue = 0.0;
+    qint64 m_gridMs = 0;
+};
+}
+
+ShapeSearchWorker::ShapeSearchWorker(const QString &dbPath, QObject *parent)
+    : QObject(parent)
+    , m_dbPath(dbPath)
+    , m_dataManager(nullptr)
+    , m_cancelled(false)
+{
+}
+
+ShapeSearchWorker::~ShapeSearchWorker()
+{
+}
+
+void ShapeSearchWorker::open()
+{
+    if (m_dataManager) {
+        return;
+    }
+
+    m_dataManager = new DataManager(this);
+    connect(m_dataManager, &DataManager::errorOccurred, this, &ShapeSearchWorker::errorOccurred);
+    if (!m_dataManager->initialize(m_dbPath, "shape_search")) {
+        delete m_dataManager;
+        m_dataManager = nullptr;
+    }
+}
+
+qint64 ShapeSearchWorker::resampleStep(const ShapeSearchRequest &request)
+{
+    // 模板或查询范围内有压缩时间段时统一按最细的名义采样间隔重采样，未压缩部分重采样后基本不变
+    qint64 startMs = request.startMs;
+    qint64 endMs = request.endMs;
+    if (request.templateValues.isEmpty()) {
+        startMs = qMin(startMs, request.templateStartMs);
+        endMs = qMax(endMs, request.templateEndMs);
+    }
+    QVector<CompressionSpan> spans;
+    if (!m_dataManager->queryCompressionSpans(startMs, endMs, spans) || spans.isEmpty()) {
+        return 0;
+    }
+    double intervalUs = 0.0;
+    for (const CompressionSpan &span : spans) {
+        if (span.sampleIntervalUs > 0.0 && (intervalUs <= 0.0 || span.sampleIntervalUs < intervalUs)) {
+            intervalUs = span.sampleIntervalUs;
+        }
+    }
+    return intervalUs > 0.0 ? qMax<qint64>(1, std::llround(intervalUs / 1000.0)) : kDefaultResampleStepMs;
+}
+
+bool ShapeSearchWorker::loadTemplate(const ShapeSearchRequest &request, qint64 stepMs, QVector<float> &values)
+{
+    if (!request.templateValues.isEmpty()) {
+        values = request.templateValues;
+        return true;
+    }
+
+    // 多读一条以判断是否超长
+    QVector<qint64> timesMs;
+    SeriesReader reader(m_dataManager, request.templateStartMs, request.templateEndMs, stepMs);
+    int count = reader.read(kMaxTemplateSamples + 1, timesMs, values);
+    if (count == 0) {
+        emit errorOccurred("No samples in template range");
+        return false;
+    }
+    if (count > kMaxTemplateSamples) {
+        emit errorOccurred(QString("Template range too long (max %1 samples)").arg(kMaxTemplateSamples));
+        return false;
+    }
+    return true;
+}
+
+void ShapeSearchWorker::search(const ShapeSearchRequest &request)
+{
+    m_cancelled = false;
+    if (!m_dataManager) {
+        emit errorOccurred("Database not available");
+        emit searchFinished(QVector<ShapeSearchResult>(), QString());
+        return;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    const qint64 stepMs = resampleStep(request);
+    QVector<float> templateValues;
+    ShapeSearch engine;
+    QString error;
+    if (!loadTemplate(request, stepMs, templateValues) || !engine.setTemplate(templateValues, request.warpingWindow, &error)) {
+        if (!error.isEmpty()) {
+            emit errorOccurred(error);
+        }
+        emit searchFinished(QVector<ShapeSearchResult>(), QString());
+        return;
+    }
+    engine.setTopK(request.topK);
+
+    QVector<ShapeSearchResult> results;
+    const int m = engine.templateLength();
+    SeriesChunk current;
+    SeriesChunk next;
+    SeriesReader reader(m_dataManager, request.startMs, request.endMs, stepMs);
+    qint64 loadMs = 0;
+
+    QElapsedTimer loadTimer;
+    loadTimer.start();
+    int loaded = reader.read(kChunkSamples, current.timesMs, current.values);
+    loadMs += loadTimer.elapsed();
+    if (loaded <= 0) {
+        emit searchFinished(results, "No samples in search range");
+        return;
+    }
+
+    while (!current.values.isEmpty() && !m_cancelled) {
+        engine.start(current.values.constData(), current.values.size(), current.baseOffset);
+
+        // 匹配进行时读取下一块；保留末尾 m-1 个样本，使跨块窗口不被遗漏
+        next.timesMs.clear();
+        next.values.clear();
+        int keep = qMin(m - 1, current.values.size());
+        next.baseOffset = current.baseOffset + current.values.size() - keep;
+        next.timesMs.append(current.timesMs.mid(current.timesMs.size() - keep));
+        next.values.append(current.values.mid(current.values.size() - keep));
+
+        // 上一块不满说明已读到范围末尾
+        loadTimer.restart();
+        loaded = loaded == kChunkSamples ? reader.read(kChunkSamples, next.timesMs, next.values) : 0;
+        loadMs += loadTimer.elapsed();
+
+        engine.wait();
+
+        // 新进入结果的匹配在当前块内，趁时间戳还在时回填
+        for (ShapeMatch &match : engine.mutableMatches()) {
+            if (match.startMs < 0) {
+                qint64 index = match.offset - current.baseOffset;
+                match.startMs = current.timesMs[index];
+                match.endMs = current.timesMs[index + m - 1];
+            }
+        }
+
+        if (request.endMs > request.startMs) {
+            qint64 scannedMs = current.timesMs.last() - request.startMs;
+            emit progressChanged(int(qBound<qint64>(0, 100 * scannedMs / (request.endMs - request.startMs), 100)));
+        }
+
+        if (loaded <= 0) {
+            break;
+        }
+        std::swap(current, next);
+    }
+
+    for (const ShapeMatch &match : engine.matches()) {
+        results.append({match.startMs, match.endMs, std::sqrt(match.score)});
+    }
+
+    ShapeSearch::Stats stats = engine.stats();
+    QString summary = QString("%1 windows in %2 ms (read %3 ms), template %4 samples, band %5; "
+                              "pruned: flat %6, LB_Kim %7, LB_Keogh %8; full %9%10")
+        .arg(stats.windows).arg(timer.elapsed()).arg(loadMs)
+        .arg(m).arg(engine.warpingBand())
+        .arg(stats.skippedFlat).arg(stats.prunedKim).arg(stats.prunedKeogh).arg(stats.fullComputations)
+        .arg(m_cancelled ? " (cancelled)" : "");
+    if (stepMs > 0) {
+        summary += QString("; compressed data resampled every %1 ms").arg(stepMs);
+    }
+    emit searchFinished(results, summary);
+}
@@ -0,0 +1,66 @@
+#ifndef SHAPESEARCHWORKER_H
+#define SHAPESEARCHWORKER_H
+
+#include <QObject>
+#include <QVector>
+#include <atomic>
+
+#include "datamanager.h"
+
+/**
+ * @brief 形状查询参数（时间均为存储毫秒）
+ */
+struct ShapeSearchRequest {
+    QVector<float> templateValues;   // 为空时从 templateStartMs..templateEndMs 读取模板
+    qint64 templateStartMs = 0;
+    qint64 templateEndMs = 0;
+    qint64 startMs = 0;
+    qint64 endMs = 0;
+    int topK = 10;
+    double warpingWindow = 0.05;     // DTW 约束带宽占模板长度的比例，0 为欧氏距离
+};
+
+struct ShapeSearchResult {
+    qint64 startMs;
+    qint64 endMs;
+    double distance;
+};
+
+Q_DECLARE_METATYPE(ShapeSearchRequest)
+Q_DECLARE_METATYPE(ShapeSearchResult)
+
+/**
+ * @brief 形状查询工作对象，运行在后台线程，分块读取历史数据并交给 ShapeSearch 并行匹配
+ *
+ * 范围内有入库压缩的时间段时，模板与查询序列按时间等间隔重采样后再匹配。
+ */
+class ShapeSearchWorker : public QObject {
+    Q_OBJECT
+
+public:
+    explicit ShapeSearchWorker(const QString &dbPath, QObject *parent = nullptr);
+    ~ShapeSearchWorker();
+
+    // 可从任意线程调用
+    void cancel() { m_cancelled = true; }
+
+public slots:
+    void open();
+    void search(const ShapeSearchRequest &request);
+
+signals:
+    void progressChanged(int percent);
+    void searchFinished(const QVector<ShapeSearchResult> &results, const QString &summary);
+    void errorOccurred(const QString &error);
+
+private:
+    // 范围内有压缩保存的时间段时返回重采样步长（毫秒），否则为 0
+    qint64 resampleStep(const ShapeSearchRequest &request);
+    bool loadTemplate(const ShapeSearchRequest &request, qint64 stepMs, QVector<float> &values);
+
+    QString m_dbPath;
+    DataManager *m_dataManager;
+    std::atomic<bool> m_cancelled;
+};
+
+#endif // SHAPESEARCHWORKER_H
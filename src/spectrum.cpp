@@ -0,0 +1,283 @@
+#include "spectrum.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SPECTRUM_SSE2
+#endif
+
+static const double kPi = 3.14159265358979323846;
+// 功率下限，避免对 0 取对数
+static const float kMinPower = 1e-20f;
+
+RealFft::RealFft()
+    : m_size(0)
+{
+}
+
+void RealFft::setSize(int size)
+{
+    int n = 8;
+    while (n < size) {
+        n <<= 1;
+    }
+    m_size = n;
+    const int half = n / 2;
+
+    int bits = 0;
+    while ((1 << bits) < half) {
+        ++bits;
+    }
+    m_bitReverse.resize(half);
+    for (int i = 0; i < half; ++i) {
+        int reversed = 0;
+        for (int b = 0; b < bits; ++b) {
+            reversed |= ((i >> b) & 1) << (bits - 1 - b);
+        }
+        m_bitReverse[i] = reversed;
+    }
+
+    m_twiddleRe.resize(half);
+    m_twiddleIm.resize(half);
+    for (int h = 1; h < half; h <<= 1) {
+        for (int j = 0; j < h; ++j) {
+            double angle = -kPi * j / h;
+            m_twiddleRe[h + j] = static_cast<float>(std::cos(angle));
+            m_twiddleIm[h + j] = static_cast<float>(std::sin(angle));
+        }
+    }
+
+    m_splitRe.resize(half + 1);
+    m_splitIm.resize(half + 1);
+    for (int k = 0; k <= half; ++k) {
+        double angle = -2.0 * kPi * k / n;
+        m_splitRe[k] = static_cast<float>(std::cos(angle));
+        m_splitIm[k] = static_cast<float>(std::sin(angle));
+    }
+
+    m_workRe.resize(half);
+    m_workIm.resize(half);
+}
+
+void RealFft::transform(const float *input, float *re, float *im)
+{
+    const int half = m_size / 2;
+    float *zr = m_workRe.data();
+    float *zi = m_workIm.data();
+
+    // 偶数样本作实部、奇数样本作虚部，按位反转顺序放入
+    for (int k = 0; k < half; ++k) {
+        int r = m_bitReverse[k];
+        zr[r] = input[2 * k];
+        zi[r] = input[2 * k + 1];
+    }
+
+    for (int h = 1; h < half; h <<= 1) {
+        const float *wr = m_twiddleRe.constData() + h;
+        const float *wi = m_twiddleIm.constData() + h;
+        for (int b = 0; b < half; b += 2 * h) {
+            float *ar = zr + b;
+            float *ai = zi + b;
+            float *br = zr + b + h;
+            float *bi = zi + b + h;
+            int j = 0;
+#ifdef SPECTRUM_SSE2
+            for (; j + 4 <= h; j += 4) {
+                __m128 wRe = _mm_loadu_ps(wr + j);
+                __m128 wIm = _mm_loadu_ps(wi + j);
+                __m128 xRe = _mm_loadu_ps(br + j);
+                __m128 xIm = _mm_loadu_ps(bi + j);
+                __m128 tRe = _mm_sub_ps(_mm_mul_ps(wRe, xRe), _mm_mul_ps(wIm, xIm));
+                __m128 tIm = _mm_add_ps(_mm_mul_ps(wRe, xIm), _mm_mul_ps(wIm, xRe));
+                __m128 aRe = _mm_loadu_ps(ar + j);
+                __m128 aIm = _mm_loadu_ps(ai + j);
+                _mm_storeu_ps(br + j, _mm_sub_ps(aRe, tRe));
+                _mm_storeu_ps(bi + j, _mm_sub_ps(aIm, tIm));
+                _mm_storeu_ps(ar + j, _mm_add_ps(aRe, tRe));
+                _mm_storeu_ps(ai + j, _mm_add_ps(aIm, tIm));
+            }
+#endif
+            for (; j < h; ++j) {
+                float tRe = wr[j] * br[j] - wi[j] * bi[j];
+                float tIm = wr[j] * bi[j] + wi[j] * br[j];
+                br[j] = ar[j] - tRe;
+                bi[j] = ai[j] - tIm;
+                ar[j] += tRe;
+                ai[j] += tIm;
+            }
+        }
+    }
+
+    // 拆分：X[k] = E[k] + W^k·O[k]，E/O 分别为偶数/奇数样本序列的频谱
+    for (int k = 0; k <= half; ++k) {
+        int a = k == half ? 0 : k;
+        int c = k == 0 ? 0 : half - k;
+        float sumRe = 0.5f * (zr[a] + zr[c]);
+        float sumIm = 0.5f * (zi[a] - zi[c]);
+        float oddRe = 0.5f * (zi[a] + zi[c]);
+        float oddIm = -0.5f * (zr[a] - zr[c]);
+        re[k] = sumRe + m_splitRe[k] * oddRe - m_splitIm[k] * oddIm;
+        im[k] = sumIm + m_splitRe[k] * oddIm + m_splitIm[k] * oddRe;
+    }
+}
+
+WelchSpectrum::WelchSpectrum()
+    : m_averages(1)
+    , m_windowPower(1.0f)
+    , m_inputCount(0)
+    , m_next(0)
+    , m_filled(0)
+{
+}
+
+void WelchSpectrum::configure(int segmentLength, int averages)
+{
+    m_fft.setSize(segmentLength);
+    m_averages = qMax(1, averages);
+
+    const int n = m_fft.size();
+    const int bins = binCount();
+    m_window.resize(n);
+    m_windowPower = 0.0f;
+    for (int i = 0; i < n; ++i) {
+        float w = static_cast<float>(0.5 - 0.5 * std::cos(2.0 * kPi * i / n));
+        m_window[i] = w;
+        m_windowPower += w * w;
+    }
+
+    m_input.resize(n);
+    m_frame.resize(n);
+    m_re.resize(bins);
+    m_im.resize(bins);
+    m_periodograms.resize(m_averages * bins);
+    m_scratch.resize(bins);
+    reset();
+}
+
+void WelchSpectrum::reset()
+{
+    m_inputCount = 0;
+    m_next = 0;
+    m_filled = 0;
+}
+
+int WelchSpectrum::push(const float *values, int count)
+{
+    const int n = m_fft.size();
+    const int hop = n / 2;
+    int segments = 0;
+
+    while (count > 0) {
+        int take = qMin(count, n - m_inputCount);
+        std::memcpy(m_input.data() + m_inputCount, values, sizeof(float) * take);
+        m_inputCount += take;
+        values += take;
+        count -= take;
+
+        if (m_inputCount == n) {
+            processSegment();
+            ++segments;
+            // 保留后半段作为下一段的前半段
+            std::memmove(m_input.data(), m_input.constData() + hop, sizeof(float) * (n - hop));
+            m_inputCount = n - hop;
+        }
+    }
+    return segments;
+}
+
+void WelchSpectrum::processSegment()
+{
+    const int n = m_fft.size();
+    const int bins = binCount();
+    const float *input = m_input.constData();
+
+    // 距离信号直流分量远大于振动分量，先去均值避免其经窗函数泄漏到低频
+    double sum = 0.0;
+    for (int i = 0; i < n; ++i) {
+        sum += input[i];
+    }
+    const float mean = static_cast<float>(sum / n);
+
+    float *frame = m_frame.data();
+    const float *window = m_window.constData();
+    for (int i = 0; i < n; ++i) {
+        frame[i] = (input[i] - mean) * window[i];
+    }
+
+    m_fft.transform(frame, m_re.data(), m_im.data());
+
+    float *periodogram = m_periodograms.data() + m_next * bins;
+    const float *re = m_re.constData();
+    const float *im = m_im.constData();
+    for (int k = 0; k < bins; ++k) {
+        periodogram[k] = re[k] * re[k] + im[k] * im[k];
+    }
+    m_next = (m_next + 1) % m_averages;
+    m_filled = qMin(m_filled + 1, m_averages);
+}
+
+void WelchSpectrum::spectrum(double sampleRateHz, QVector<float> &powerDb) const
+{
+    const int bins = binCount();
+    powerDb.resize(bins);
+    if (m_filled == 0 || sampleRateHz <= 0.0) {
+        powerDb.fill(10.0f * std::log10(kMinPower));
+        return;
+    }
+
+    // 单边谱：除直流与奈奎斯特频点外乘 2
+    const float scale = static_cast<float>(1.0 / (sampleRateHz * m_windowPower * m_filled));
+    float *out = powerDb.data();
+    const float *first = m_periodograms.constData();
+    for (int k = 0; k < bins; ++k) {
+        out[k] = first[k];
+    }
+    for (int s = 1; s < m_filled; ++s) {
+        const float *periodogram = first + s * bins;
+        for (int k = 0; k < bins; ++k) {
+            out[k] += periodogram[k];
+        }
+    }
+    for (int k = 0; k < bins; ++k) {
+        float factor = (k == 0 || k == bins - 1) ? scale : 2.0f * scale;
+        out[k] = 10.0f * std::log10(qMax(out[k] * factor, kMinPower));
+    }
+}
+
+void WelchSpectrum::findPeaks(const QVector<float> &powerDb, double sampleRateHz, double minProminenceDb,
+                              int maxPeaks, QVector<SpectralPeak> &peaks) const
+{
+    peaks.clear();
+    const int bins = powerDb.size();
+    if (bins < 3) {
+        return;
+    }
+
+    // 中位数作为噪声基底
+    std::copy(powerDb.constBegin(), powerDb.constEnd(), m_scratch.begin());
+    std::nth_element(m_scratch.begin(), m_scratch.begin() + bins / 2, m_scratch.begin() + bins);
+    const float threshold = static_cast<float>(m_scratch[bins / 2] + minProminenceDb);
+
+    const float *p = powerDb.constData();
+    const double binHz = sampleRateHz / m_fft.size();
+    for (int k = 1; k < bins - 1; ++k) {
+        if (p[k] > threshold && p[k] > p[k - 1] && p[k] >= p[k + 1]) {
+            // 对数功率上的抛物线插值，得到亚频点精度
+            double a = p[k - 1];
+            double b = p[k];
+            double c = p[k + 1];
+            double denominator = a - 2.0 * b + c;
+            double delta = denominator != 0.0 ? 0.5 * (a - c) / denominator : 0.0;
+            peaks.append(SpectralPeak{(k + delta) * binHz, b - 0.25 * (a - c) * delta});
+        }
+    }
+
+    std::sort(peaks.begin(), peaks.end(), [](const SpectralPeak &x, const SpectralPeak &y) {
+        return x.powerDb > y.powerDb;
+    });
+    if (peaks.size() > maxPeaks) {
+        peaks.resize(maxPeaks);
+    }
+}
@@ -0,0 +1,91 @@
+#ifndef SPECTRUM_H
+#define SPECTRUM_H
+
+#include <QVector>
+
+/**
+ * @brief 实数 FFT（长度为 2 的幂）
+ *
+ * 把 N 个实数样本按奇偶打包为 N/2 点复数序列做基 2 FFT，再拆分为 N/2+1 个单边频点。
+ * 实部与虚部分开存放，蝶形运算在 SSE2 可用时每次处理 4 组。
+ * 旋转因子与位反转表在 setSize() 时预先计算，transform() 不分配内存。
+ */
+class RealFft {
+public:
+    RealFft();
+
+    void setSize(int size);
+    int size() const { return m_size; }
+
+    // input 长度为 size()，re/im 长度至少为 size()/2+1
+    void transform(const float *input, float *re, float *im);
+
+private:
+    int m_size;
+    QVector<int> m_bitReverse;
+    // 第 s 级（半跨度 h）的旋转因子存放在 [h, 2h)
+    QVector<float> m_twiddleRe;
+    QVector<float> m_twiddleIm;
+    // 拆分步骤的旋转因子 e^{-2πik/N}，k ∈ [0, N/2]
+    QVector<float> m_splitRe;
+    QVector<float> m_splitIm;
+    QVector<float> m_workRe;
+    QVector<float> m_workIm;
+};
+
+/**
+ * @brief 频谱峰值
+ */
+struct SpectralPeak {
+    double frequencyHz;
+    double powerDb;
+};
+
+/**
+ * @brief 流式 Welch 功率谱估计
+ *
+ * 样本逐段送入，每满 segmentLength 个样本取一段（段间重叠 50%），
+ * 去均值、加 Hann 窗后做实数 FFT，最近 averages 段的周期图取平均即为功率谱密度。
+ * 所有缓冲区在 configure() 时分配，之后处理样本不再分配内存。
+ */
+class WelchSpectrum {
+public:
+    WelchSpectrum();
+
+    void configure(int segmentLength, int averages);
+    void reset();
+
+    int segmentLength() const { return m_fft.size(); }
+    int binCount() const { return m_fft.size() / 2 + 1; }
+
+    // 送入等间隔采样的样本，返回本次完成的段数；大于 0 时可随即调用 spectrum()
+    int push(const float *values, int count);
+    bool ready() const { return m_filled > 0; }
+
+    // 平均后的功率谱密度（dB，单位 cm²/Hz），sampleRateHz 用于归一化
+    void spectrum(double sampleRateHz, QVector<float> &powerDb) const;
+    // 高出噪声基底（中位数）minProminenceDb 以上的局部极大值，按功率降序，频率经抛物线插值
+    void findPeaks(const QVector<float> &powerDb, double sampleRateHz, double minProminenceDb,
+                   int maxPeaks, QVector<SpectralPeak> &peaks) const;
+
+private:
+    void processSegment();
+
+    RealFft m_fft;
+    int m_averages;
+    QVector<float> m_window;
+    float m_windowPower;         // Σw²
+
+    QVector<float> m_input;      // 当前段的样本
+    int m_inputCount;
+    QVector<float> m_frame;      // 去均值加窗后的段
+    QVector<float> m_re;
+    QVector<float> m_im;
+
+    QVector<float> m_periodograms;   // averages 段周期图，环形存放
+    int m_next;
+    int m_filled;
+    mutable QVector<float> m_scratch;
+};
+
+#endif // SPECTRUM_H
@@ -0,0 +1,118 @@
+#include "spectrumanalyzer.h"
+
+// 默认 1024 点分段、8 段平均
+static const int kDefaultSegmentLength = 1024;
+static const int kDefaultAverages = 8;
+// 峰值须高出噪声基底的幅度，以及最多报告的峰值个数
+static const double kPeakProminenceDb = 12.0;
+static const int kMaxPeaks = 5;
+// 结果发出的最小间隔，界面每秒最多刷新 10 次
+static const int kMinEmitIntervalMs = 100;
+// 相邻样本时间差超过此值且超过平均间隔的 kGapFactor 倍时视为中断
+static const qint64 kMinGapUs = 200000;
+static const double kGapFactor = 20.0;
+// 采样率估计至少需要的时间跨度
+static const qint64 kMinRateSpanUs = 100000;
+
+SpectrumAnalyzer::SpectrumAnalyzer(QObject *parent)
+    : QObject(parent)
+    , m_enabled(false)
+    , m_restartPending(true)
+    , m_anchorUs(0)
+    , m_anchorSamples(0)
+    , m_lastTimestampUs(0)
+    , m_sampleRateHz(0.0)
+{
+    qRegisterMetaType<SpectrumFrame>("SpectrumFrame");
+    configure(kDefaultSegmentLength, kDefaultAverages);
+}
+
+void SpectrumAnalyzer::setEnabled(bool enabled)
+{
+    if (enabled && !m_enabled.load()) {
+        m_restartPending.store(true);
+    }
+    m_enabled.store(enabled);
+}
+
+void SpectrumAnalyzer::configure(int segmentLength, int averages)
+{
+    m_welch.configure(segmentLength, averages);
+    m_frame.powerDb.reserve(m_welch.binCount());
+    m_frame.peaks.reserve(kMaxPeaks * 4);
+    m_restartPending.store(true);
+}
+
+void SpectrumAnalyzer::restart(qint64 timestampUs)
+{
+    m_welch.reset();
+    m_anchorUs = timestampUs;
+    m_anchorSamples = 0;
+    m_lastTimestampUs = timestampUs;
+    m_sampleRateHz = 0.0;
+}
+
+void SpectrumAnalyzer::processBlock(const SampleBlock &block)
+{
+    if (!m_enabled.load() || block.isEmpty()) {
+        return;
+    }
+    if (m_restartPending.exchange(false)) {
+        restart(block.timestampsUs[0]);
+    }
+
+    const qint64 *timestamps = block.timestampsUs.constData();
+    const qint32 *values = block.values.constData();
+    const int count = block.size();
+
+    // 按中断切分为连续的若干段分别送入
+    int runStart = 0;
+    for (int i = 0; i < count; ++i) {
+        qint64 deltaUs = timestamps[i] - m_lastTimestampUs;
+        double averageUs = m_sampleRateHz > 0.0 ? 1e6 / m_sampleRateHz : 0.0;
+        if (deltaUs < 0 || (deltaUs > kMinGapUs && deltaUs > kGapFactor * averageUs)) {
+            pushRun(values + runStart, i - runStart, m_lastTimestampUs);
+            restart(timestamps[i]);
+            runStart = i;
+        }
+        m_lastTimestampUs = timestamps[i];
+    }
+    pushRun(values + runStart, count - runStart, m_lastTimestampUs);
+}
+
+void SpectrumAnalyzer::pushRun(const qint32 *values, int count, qint64 lastTimestampUs)
+{
+    if (count <= 0) {
+        return;
+    }
+
+    if (m_values.size() < count) {
+        m_values.resize(count);
+    }
+    float *converted = m_values.data();
+    for (int i = 0; i < count; ++i) {
+        converted[i] = static_cast<float>(SampleFixed::toDouble(values[i]));
+    }
+
+    m_anchorSamples += count;
+    qint64 spanUs = lastTimestampUs - m_anchorUs;
+    if (spanUs >= kMinRateSpanUs && m_anchorSamples > 1) {
+        m_sampleRateHz = (m_anchorSamples - 1) * 1e6 / spanUs;
+    }
+
+    int segments = m_welch.push(converted, count);
+    if (segments == 0 || m_sampleRateHz <= 0.0) {
+        return;
+    }
+    if (m_emitClock.isValid() && m_emitClock.elapsed() < kMinEmitIntervalMs) {
+        return;
+    }
+    m_emitClock.start();
+
+    m_frame.timestampUs = lastTimestampUs;
+    m_frame.sampleRateHz = m_sampleRateHz;
+    m_frame.resolutionHz = m_sampleRateHz / m_welch.segmentLength();
+    m_welch.spectrum(m_sampleRateHz, m_frame.powerDb);
+    m_welch.findPeaks(m_frame.powerDb, m_sampleRateHz, kPeakProminenceDb, kMaxPeaks, m_frame.peaks);
+    emit spectrumReady(m_frame);
+}
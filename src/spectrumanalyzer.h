@@ -0,0 +1,70 @@
+#ifndef SPECTRUMANALYZER_H
+#define SPECTRUMANALYZER_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QVector>
+#include <atomic>
+
+#include "samplefixed.h"
+#include "spectrum.h"
+
+/**
+ * @brief 一帧频谱分析结果
+ */
+struct SpectrumFrame {
+    qint64 timestampUs = 0;          // 最后一个样本的时间
+    double sampleRateHz = 0.0;       // 由时间戳估计的采样率
+    double resolutionHz = 0.0;       // 频点间隔
+    QVector<float> powerDb;          // 功率谱密度（dB，cm²/Hz），0 Hz 到奈奎斯特频率
+    QVector<SpectralPeak> peaks;     // 主要频率，按功率降序
+};
+
+Q_DECLARE_METATYPE(SpectrumFrame)
+
+/**
+ * @brief 流式频谱分析工作对象，运行在独立线程
+ *
+ * 从样本广播环接收样本块，用 WelchSpectrum 做重叠分段、加窗 FFT 与平均，
+ * 每完成一段更新一次功率谱并提取峰值，按 kMinEmitIntervalMs 节流后发出 spectrumReady()。
+ * 串口时间戳按读取批次打点，采样率由较长时间跨度内的样本数估计；
+ * 时间戳倒退或出现明显中断（如设备重连、广播环丢样）时重新开始分段，避免把不连续的数据拼进同一段。
+ * 每个通道对应一个分析对象。
+ */
+class SpectrumAnalyzer : public QObject {
+    Q_OBJECT
+
+public:
+    explicit SpectrumAnalyzer(QObject *parent = nullptr);
+
+    // 可从任意线程调用；关闭时丢弃到达的样本并在重新打开时重新开始
+    void setEnabled(bool enabled);
+    bool isEnabled() const { return m_enabled.load(); }
+
+public slots:
+    void configure(int segmentLength, int averages);
+    void processBlock(const SampleBlock &block);
+
+signals:
+    void spectrumReady(const SpectrumFrame &frame);
+
+private:
+    void restart(qint64 timestampUs);
+    void pushRun(const qint32 *values, int count, qint64 lastTimestampUs);
+
+    std::atomic<bool> m_enabled;
+    std::atomic<bool> m_restartPending;
+    WelchSpectrum m_welch;
+    QVector<float> m_values;
+
+    // 采样率估计：自 m_anchorUs 以来收到 m_anchorSamples 个样本
+    qint64 m_anchorUs;
+    qint64 m_anchorSamples;
+    qint64 m_lastTimestampUs;
+    double m_sampleRateHz;
+
+    SpectrumFrame m_frame;
+    QElapsedTimer m_emitClock;
+};
+
+#endif // SPECTRUMANALYZER_H
@@ -0,0 +1,184 @@
+#include "spectrumwidget.h"
+#include <QPainter>
+#include <QPaintEvent>
+#include <QPolygonF>
+#include <algorithm>
+#include <cmath>
+
+// 时频图保留的帧数
+static const int kHistoryColumns = 300;
+// 显示的动态范围
+static const float kDynamicRangeDb = 60.0f;
+
+static const int kMarginLeft = 50;
+static const int kMarginRight = 10;
+static const int kMarginTop = 24;
+static const int kMarginBottom = 20;
+static const int kGridY = 4;
+
+SpectrumWidget::SpectrumWidget(QWidget *parent)
+    : QWidget(parent)
+    , m_nextColumn(0)
+    , m_columns(0)
+    , m_floorDb(-80.0f)
+    , m_ceilingDb(-20.0f)
+{
+    setAttribute(Qt::WA_OpaquePaintEvent);
+    setMinimumSize(240, 200);
+}
+
+void SpectrumWidget::clear()
+{
+    m_frame = SpectrumFrame();
+    m_spectrogram = QImage();
+    m_nextColumn = 0;
+    m_columns = 0;
+    update();
+}
+
+void SpectrumWidget::setFrame(const SpectrumFrame &frame)
+{
+    const int bins = frame.powerDb.size();
+    if (bins == 0) {
+        return;
+    }
+    if (m_spectrogram.height() != bins) {
+        m_spectrogram = QImage(kHistoryColumns, bins, QImage::Format_RGB32);
+        m_spectrogram.fill(Qt::black);
+        m_nextColumn = 0;
+        m_columns = 0;
+    }
+    m_frame = frame;
+
+    // 量程跟随最高峰，下降时缓慢回落，避免颜色随每帧跳动
+    float peakDb = *std::max_element(frame.powerDb.constBegin() + 1, frame.powerDb.constEnd());
+    float ceiling = std::ceil(peakDb / 10.0f) * 10.0f;
+    m_ceilingDb = ceiling > m_ceilingDb ? ceiling : qMax(ceiling, m_ceilingDb - 1.0f);
+    m_floorDb = m_ceilingDb - kDynamicRangeDb;
+
+    for (int k = 0; k < bins; ++k) {
+        QRgb *line = reinterpret_cast<QRgb *>(m_spectrogram.scanLine(bins - 1 - k));
+        line[m_nextColumn] = colorFor(frame.powerDb[k]);
+    }
+    m_nextColumn = (m_nextColumn + 1) % kHistoryColumns;
+    m_columns = qMin(m_columns + 1, kHistoryColumns);
+    update();
+}
+
+QRgb SpectrumWidget::colorFor(float powerDb) const
+{
+    // 黑 -> 蓝 -> 紫红 -> 黄
+    float t = qBound(0.0f, (powerDb - m_floorDb) / (m_ceilingDb - m_floorDb), 1.0f);
+    int r = qBound(0, static_cast<int>(255 * (2.0f * t - 0.5f)), 255);
+    int g = qBound(0, static_cast<int>(255 * (2.0f * t - 1.0f)), 255);
+    int b = qBound(0, static_cast<int>(255 * (t < 0.5f ? 2.0f * t : 2.0f - 3.0f * t + 0.5f)), 255);
+    return qRgb(r, g, b);
+}
+
+void SpectrumWidget::paintEvent(QPaintEvent *)
+{
+    QPainter painter(this);
+    painter.fillRect(rect(), Qt::white);
+    painter.setRenderHint(QPainter::TextAntialiasing);
+
+    QFont titleFont = font();
+    titleFont.setBold(true);
+    painter.setFont(titleFont);
+    painter.setPen(Qt::black);
+    QString title = "Spectrum";
+    if (m_frame.sampleRateHz > 0.0) {
+        title += QString(" (%1 Hz, %2 Hz/bin)").arg(m_frame.sampleRateHz, 0, 'f', 1).arg(m_frame.resolutionHz, 0, 'f', 2);
+    }
+    painter.drawText(QRect(0, 0, width(), kMarginTop), Qt::AlignCenter, title);
+    painter.setFont(font());
+
+    int plotHeight = qMax(2, height() - kMarginTop - 2 * kMarginBottom);
+    QRect spectrumRect(kMarginLeft, kMarginTop, qMax(1, width() - kMarginLeft - kMarginRight), plotHeight / 2);
+    QRect spectrogramRect(kMarginLeft, spectrumRect.bottom() + kMarginBottom, spectrumRect.width(),
+                          plotHeight - spectrumRect.height());
+
+    drawSpectrum(painter, spectrumRect);
+    drawSpectrogram(painter, spectrogramRect);
+}
+
+void SpectrumWidget::drawSpectrum(QPainter &painter, const QRect &rect)
+{
+    const QFontMetrics metrics = painter.fontMetrics();
+    QPen gridPen(QColor(220, 220, 220));
+    QPen labelPen(QColor(80, 80, 80));
+
+    for (int i = 0; i <= kGridY; ++i) {
+        int y = rect.bottom() - i * rect.height() / kGridY;
+        painter.setPen(gridPen);
+        painter.drawLine(rect.left(), y, rect.right(), y);
+        painter.setPen(labelPen);
+        double value = m_floorDb + kDynamicRangeDb * i / kGridY;
+        painter.drawText(QRect(0, y - metrics.height() / 2, kMarginLeft - 6, metrics.height()),
+                         Qt::AlignRight | Qt::AlignVCenter, QString::number(value, 'f', 0));
+    }
+    painter.setPen(QPen(Qt::gray));
+    painter.drawRect(rect);
+
+    const int bins = m_frame.powerDb.size();
+    if (bins < 2) {
+        painter.setPen(labelPen);
+        painter.drawText(rect, Qt::AlignCenter, "No data");
+        return;
+    }
+
+    double nyquist = m_frame.sampleRateHz / 2.0;
+    painter.setPen(labelPen);
+    painter.drawText(QRect(rect.left(), rect.bottom() + 2, rect.width(), metrics.height()),
+                     Qt::AlignLeft | Qt::AlignTop, "0 Hz");
+    painter.drawText(QRect(rect.left(), rect.bottom() + 2, rect.width(), metrics.height()),
+                     Qt::AlignRight | Qt::AlignTop, QString("%1 Hz").arg(nyquist, 0, 'f', 1));
+
+    // 频点多于像素时每列取最大值
+    QPolygonF polyline;
+    const int columns = qMin(bins, rect.width());
+    polyline.reserve(columns);
+    const float range = m_ceilingDb - m_floorDb;
+    for (int x = 0; x < columns; ++x) {
+        int from = static_cast<int>(static_cast<qint64>(x) * bins / columns);
+        int to = qMax(from + 1, static_cast<int>(static_cast<qint64>(x + 1) * bins / columns));
+        float value = *std::max_element(m_frame.powerDb.constBegin() + from, m_frame.powerDb.constBegin() + to);
+        float t = qBound(0.0f, (value - m_floorDb) / range, 1.0f);
+        polyline.append(QPointF(rect.left() + (x + 0.5) * rect.width() / columns, rect.bottom() - t * rect.height()));
+    }
+    painter.setClipRect(rect);
+    painter.setPen(QPen(QColor(0, 102, 204), 1));
+    painter.drawPolyline(polyline);
+
+    painter.setPen(QPen(QColor(204, 0, 0)));
+    for (const SpectralPeak &peak : m_frame.peaks) {
+        double x = rect.left() + peak.frequencyHz / nyquist * rect.width();
+        double y = rect.bottom() - qBound(0.0, (peak.powerDb - m_floorDb) / range, 1.0) * rect.height();
+        painter.drawLine(QPointF(x, y), QPointF(x, y - 6));
+        painter.drawText(QPointF(x + 3, y - 6), QString("%1 Hz").arg(peak.frequencyHz, 0, 'f', 1));
+    }
+    painter.setClipping(false);
+}
+
+void SpectrumWidget::drawSpectrogram(QPainter &painter, const QRect &rect)
+{
+    painter.fillRect(rect, Qt::black);
+    if (m_columns > 0) {
+        // 环形列缓冲：较早的部分在 [m_nextColumn, end)，较新的部分在 [0, m_nextColumn)
+        const int height = m_spectrogram.height();
+        const int older = m_columns == kHistoryColumns ? kHistoryColumns - m_nextColumn : 0;
+        const int newer = m_nextColumn;
+        const double columnWidth = static_cast<double>(rect.width()) / kHistoryColumns;
+        double x = rect.right() + 1 - m_columns * columnWidth;
+        if (older > 0) {
+            QRectF target(x, rect.top(), older * columnWidth, rect.height());
+            painter.drawImage(target, m_spectrogram, QRectF(m_nextColumn, 0, older, height));
+            x += older * columnWidth;
+        }
+        if (newer > 0) {
+            QRectF target(x, rect.top(), newer * columnWidth, rect.height());
+            painter.drawImage(target, m_spectrogram, QRectF(0, 0, newer, height));
+        }
+    }
+    painter.setPen(QPen(Qt::gray));
+    painter.drawRect(rect);
+}
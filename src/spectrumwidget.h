@@ -0,0 +1,42 @@
+#ifndef SPECTRUMWIDGET_H
+#define SPECTRUMWIDGET_H
+
+#include <QWidget>
+#include <QImage>
+#include <QVector>
+
+#include "spectrumanalyzer.h"
+
+/**
+ * @brief 频谱与时频图显示组件
+ *
+ * 上半部分为最新一帧功率谱（dB 对频率）并标出主要峰值，
+ * 下半部分为时频图：每帧一列，最新在右侧，颜色表示功率。
+ * 时频图保存在定宽 QImage 中按列循环写入，绘制时分两段拼接，不移动像素。
+ */
+class SpectrumWidget : public QWidget {
+    Q_OBJECT
+
+public:
+    explicit SpectrumWidget(QWidget *parent = nullptr);
+
+    void setFrame(const SpectrumFrame &frame);
+    void clear();
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+
+private:
+    void drawSpectrum(QPainter &painter, const QRect &rect);
+    void drawSpectrogram(QPainter &painter, const QRect &rect);
+    QRgb colorFor(float powerDb) const;
+
+    SpectrumFrame m_frame;
+    QImage m_spectrogram;     // 宽为历史帧数，高为频点数，第 0 行为最高频率
+    int m_nextColumn;
+    int m_columns;            // 已写入的列数
+    float m_floorDb;          // 颜色与纵轴量程，随最新帧缓慢调整
+    float m_ceilingDb;
+};
+
+#endif // SPECTRUMWIDGET_H
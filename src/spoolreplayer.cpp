@@ -0,0 +1,168 @@
+#include "spoolreplayer.h"
+#include <climits>
+
+// 每批写入的记录数（一个事务）
+static const int kReplayBatchSize = 20000;
+static const int kReplayIntervalMs = 100;
+static const int kMaxRetryDelayMs = 30000;
+// 每隔多少次回放把映射页刷到磁盘
+static const int kSyncEveryTicks = 10;
+
+SpoolReplayer::SpoolReplayer(SampleSpool *spool, const QString &dbPath, QObject *parent)
+    : QObject(parent)
+    , m_spool(spool)
+    , m_dbPath(dbPath)
+    , m_dataManager(nullptr)
+    , m_timer(nullptr)
+    , m_retryDelayMs(0)
+    , m_isAvailable(true)
+    , m_ticksSinceSync(0)
+    , m_idle(false)
+{
+}
+
+SpoolReplayer::~SpoolReplayer()
+{
+}
+
+void SpoolReplayer::start()
+{
+    // 定时器和数据库连接都在回放线程中创建
+    m_timer = new QTimer(this);
+    connect(m_timer, &QTimer::timeout, this, &SpoolReplayer::onTick);
+    m_timer->start(kReplayIntervalMs);
+    onTick();
+}
+
+void SpoolReplayer::notifyAppended()
+{
+    // 每次空闲只投递一次唤醒
+    if (m_idle.exchange(false)) {
+        QMetaObject::invokeMethod(this, &SpoolReplayer::resume, Qt::QueuedConnection);
+    }
+}
+
+void SpoolReplayer::resume()
+{
+    if (!m_timer->isActive()) {
+        m_timer->start(kReplayIntervalMs);
+    }
+}
+
+void SpoolReplayer::replayNow()
+{
+    if (isBackingOff() || !ensureDatabase()) {
+        return;
+    }
+    replayBatches(INT_MAX);
+}
+
+void SpoolReplayer::onTick()
+{
+    if (++m_ticksSinceSync >= kSyncEveryTicks) {
+        m_ticksSinceSync = 0;
+        m_spool->sync();
+    }
+
+    if (isBackingOff() || !ensureDatabase()) {
+        return;
+    }
+    replayBatches(4);
+
+    // 积压写完：刷盘后停止定时器；置空闲后再查一次，避免漏掉期间追加的样本
+    if (m_isAvailable && m_spool->pendingCount() == 0) {
+        m_spool->sync();
+        m_ticksSinceSync = 0;
+        m_timer->stop();
+        m_idle.store(true);
+        if (m_spool->pendingCount() > 0 && m_idle.exchange(false)) {
+            m_timer->start(kReplayIntervalMs);
+        }
+    }
+}
+
+bool SpoolReplayer::ensureDatabase()
+{
+    if (m_dataManager) {
+        return true;
+    }
+
+    m_dataManager = new DataManager(this);
+    connect(m_dataManager, &DataManager::errorOccurred, this, &SpoolReplayer::errorOccurred);
+    if (!m_dataManager->initialize(m_dbPath, "spool_replayer") || !skipReplayed()) {
+        delete m_dataManager;
+        m_dataManager = nullptr;
+        backOff();
+        return false;
+    }
+    return true;
+}
+
+bool SpoolReplayer::skipReplayed()
+{
+    // 上次批次已提交但暂存文件未标记（崩溃或断电）：按库中水位跳过
+    quint64 watermark = 0;
+    if (!m_dataManager->querySpoolWatermark(m_spool->instanceId(), watermark)) {
+        return false;
+    }
+    quint64 replayed = m_spool->replayedSequence();
+    if (watermark > replayed) {
+        quint64 skip = qMin(watermark - replayed, m_spool->pendingCount());
+        m_spool->markReplayed(static_cast<int>(skip));
+        emit replayed(m_spool->replayedSequence());
+    }
+    return true;
+}
+
+bool SpoolReplayer::isBackingOff() const
+{
+    return m_retryTimer.isValid() && m_retryTimer.elapsed() < m_retryDelayMs;
+}
+
+void SpoolReplayer::backOff()
+{
+    m_retryDelayMs = m_retryDelayMs == 0 ? 500 : qMin(m_retryDelayMs * 2, kMaxRetryDelayMs);
+    m_retryTimer.start();
+
+    if (m_isAvailable) {
+        m_isAvailable = false;
+        emit storageAvailabilityChanged(false);
+    }
+}
+
+int SpoolReplayer::replayBatches(int maxBatches)
+{
+    QVector<SpoolRecord> records;
+    records.reserve(kReplayBatchSize);
+    int total = 0;
+
+    for (int batch = 0; batch < maxBatches; ++batch) {
+        quint64 startSequence = m_spool->replayedSequence();
+        int count = m_spool->read(records, kReplayBatchSize);
+        if (count == 0) {
+            break;
+        }
+        quint64 endSequence = startSequence + count;
+        if (!m_dataManager->insertRecords(records, m_spool->instanceId(), endSequence)) {
+            if (total > 0) {
+                emit recordsReplayed(total);
+            }
+            backOff();
+            return total;
+        }
+        m_spool->markReplayed(count);
+        total += count;
+        emit replayed(endSequence);
+    }
+    if (total > 0) {
+        emit recordsReplayed(total);
+    }
+
+    if (!m_isAvailable) {
+        m_isAvailable = true;
+        m_retryDelayMs = 0;
+        m_retryTimer.invalidate();
+        emit storageAvailabilityChanged(true);
+    }
+    return total;
+}
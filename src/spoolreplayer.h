@@ -0,0 +1,65 @@
+#ifndef SPOOLREPLAYER_H
+#define SPOOLREPLAYER_H
+
+#include <QObject>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <atomic>
+
+#include "datamanager.h"
+#include "samplespool.h"
+
+/**
+ * @brief 暂存文件回放器，运行在后台线程，把暂存样本批量写入数据库
+ *
+ * 数据库不可用时按指数退避重试打开，恢复后自动补写积压的样本。
+ * 积压写完后停止定时器，直到 notifyAppended() 报告新样本，空闲时不唤醒回放线程。
+ *
+ * 每批记录与库中的回放水位（spool_replay）同一事务提交，随后才标记暂存文件；
+ * 两步之间崩溃时，重新打开数据库后按水位跳过已入库的记录，不会重复写入。
+ */
+class SpoolReplayer : public QObject {
+    Q_OBJECT
+
+public:
+    SpoolReplayer(SampleSpool *spool, const QString &dbPath, QObject *parent = nullptr);
+    ~SpoolReplayer();
+
+    // 暂存文件有新样本，可在任意线程调用；回放器空闲时恢复定时回放
+    void notifyAppended();
+
+public slots:
+    void start();
+    // 立即写完积压；退避期间不提前重试
+    void replayNow();
+
+signals:
+    void storageAvailabilityChanged(bool available);
+    void recordsReplayed(int count);
+    // 回放进度：sequence 之前的暂存样本均已入库
+    void replayed(quint64 sequence);
+    void errorOccurred(const QString &error);
+
+private slots:
+    void onTick();
+    void resume();
+
+private:
+    bool ensureDatabase();
+    bool isBackingOff() const;
+    void backOff();
+    bool skipReplayed();
+    int replayBatches(int maxBatches);
+
+    SampleSpool *m_spool;
+    QString m_dbPath;
+    DataManager *m_dataManager;
+    QTimer *m_timer;
+    QElapsedTimer m_retryTimer;
+    int m_retryDelayMs;
+    bool m_isAvailable;
+    int m_ticksSinceSync;
+    std::atomic<bool> m_idle;
+};
+
+#endif // SPOOLREPLAYER_H
@@ -0,0 +1,118 @@
+#include "uiupdatescheduler.h"
+#include <utility>
+
+// 最低帧率对应的帧间隔
+static const int kMaxIntervalMs = 100;
+// 帧处理耗时占帧间隔的比例阈值
+static const double kSlowFrameRatio = 0.5;
+static const double kFastFrameRatio = 0.2;
+
+UiUpdateScheduler::UiUpdateScheduler(QObject *parent)
+    : QObject(parent)
+    , m_timer(new QTimer(this))
+    , m_suspended(false)
+    , m_retainSamples(0)
+    , m_baseIntervalMs(16)
+    , m_intervalMs(16)
+{
+    m_timer->setTimerType(Qt::PreciseTimer);
+    connect(m_timer, &QTimer::timeout, this, &UiUpdateScheduler::onTick);
+}
+
+UiUpdateScheduler::~UiUpdateScheduler()
+{
+}
+
+void UiUpdateScheduler::setTargetFps(int fps)
+{
+    m_baseIntervalMs = qBound(1, 1000 / qMax(1, fps), kMaxIntervalMs);
+    m_intervalMs = m_baseIntervalMs;
+    if (m_timer->isActive()) {
+        m_timer->start(m_intervalMs);
+    }
+}
+
+void UiUpdateScheduler::setSuspended(bool suspended, int retainSamples)
+{
+    if (suspended) {
+        m_suspended = true;
+        m_retainSamples = qMax(0, retainSamples);
+        m_timer->stop();
+        trimPending();
+        return;
+    }
+    if (m_suspended) {
+        m_suspended = false;
+        trimPending();
+    }
+    if (m_pending.sampleCount > 0 && !m_timer->isActive()) {
+        m_timer->start(m_intervalMs);
+    }
+}
+
+void UiUpdateScheduler::trimPending()
+{
+    int excess = m_pending.distances.size() - m_retainSamples;
+    if (excess > 0) {
+        m_pending.distances.remove(0, excess);
+    }
+}
+
+void UiUpdateScheduler::addSamples(const SampleBlock &block)
+{
+    const int count = block.size();
+    if (count == 0) {
+        return;
+    }
+
+    int offset = m_pending.distances.size();
+    m_pending.distances.resize(offset + count);
+    float *out = m_pending.distances.data() + offset;
+    const qint32 *values = block.values.constData();
+    for (int i = 0; i < count; ++i) {
+        out[i] = static_cast<float>(values[i]) / SampleFixed::kScale;
+    }
+    m_pending.lastDistance = block.distanceAt(count - 1);
+    m_pending.lastTimestampUs = block.timestampsUs[count - 1];
+    m_pending.sampleCount += count;
+
+    if (m_suspended) {
+        // 超出一倍再裁剪，移动成本按样本摊销
+        if (m_pending.distances.size() > qMax(2 * m_retainSamples, 1024)) {
+            trimPending();
+        }
+        return;
+    }
+    if (!m_timer->isActive()) {
+        m_timer->start(m_intervalMs);
+    }
+}
+
+void UiUpdateScheduler::onTick()
+{
+    if (m_pending.sampleCount == 0) {
+        // 没有新样本时不再唤醒
+        m_timer->stop();
+        return;
+    }
+
+    UiFrame frame;
+    std::swap(frame, m_pending);
+    m_pending.distances.reserve(frame.distances.size());
+
+    m_frameTimer.start();
+    emit frameReady(frame);
+    qint64 costMs = m_frameTimer.elapsed();
+
+    // 根据帧处理耗时调整帧率
+    int interval = m_intervalMs;
+    if (costMs > interval * kSlowFrameRatio) {
+        interval = qMin(interval * 2, kMaxIntervalMs);
+    } else if (costMs < interval * kFastFrameRatio && interval > m_baseIntervalMs) {
+        interval = qMax(interval / 2, m_baseIntervalMs);
+    }
+    if (interval != m_intervalMs) {
+        m_intervalMs = interval;
+        m_timer->start(m_intervalMs);
+    }
+}
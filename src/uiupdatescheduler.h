@@ -0,0 +1,64 @@
+#ifndef UIUPDATESCHEDULER_H
+#define UIUPDATESCHEDULER_H
+
+#include <QObject>
+#include <QTimer>
+#include <QVector>
+#include <QElapsedTimer>
+
+#include "samplefixed.h"
+
+/**
+ * @brief 一帧内需要显示的样本汇总
+ */
+struct UiFrame {
+    QVector<float> distances;   // 自上一帧以来到达的全部样本
+    double lastDistance = 0.0;
+    qint64 lastTimestampUs = 0;
+    int sampleCount = 0;
+};
+
+/**
+ * @brief 界面刷新调度器，按帧节拍合并样本后统一刷新界面
+ *
+ * 样本到达时只做缓存，定时器每帧发出一次 frameReady()。
+ * 帧处理耗时超过预算时自动降低帧率，负载下降后再恢复；没有新样本时定时器停止。
+ * 窗口不可见时可暂停出帧，期间只保留最近的样本，恢复后合并为一帧发出。
+ */
+class UiUpdateScheduler : public QObject {
+    Q_OBJECT
+
+public:
+    explicit UiUpdateScheduler(QObject *parent = nullptr);
+    ~UiUpdateScheduler();
+
+    void setTargetFps(int fps);
+    int targetFps() const { return 1000 / m_baseIntervalMs; }
+    int currentIntervalMs() const { return m_intervalMs; }
+
+    // 暂停期间 distances 只保留最近 retainSamples 个（计数与最新值照常累计）
+    void setSuspended(bool suspended, int retainSamples = 0);
+    bool isSuspended() const { return m_suspended; }
+
+public slots:
+    void addSamples(const SampleBlock &block);
+
+signals:
+    void frameReady(const UiFrame &frame);
+
+private slots:
+    void onTick();
+
+private:
+    void trimPending();
+
+    QTimer *m_timer;
+    UiFrame m_pending;
+    bool m_suspended;
+    int m_retainSamples;
+    int m_baseIntervalMs;
+    int m_intervalMs;
+    QElapsedTimer m_frameTimer;
+};
+
+#endif // UIUPDATESCHEDULER_H
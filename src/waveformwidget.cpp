@@ -0,0 +1,312 @@
+#include "waveformwidget.h"
+#include <QPainter>
+#include <QPaintEvent>
+#include <QResizeEvent>
+#include <limits>
+
+// 绘图区边距
+static const int kMarginLeft = 60;
+static const int kMarginRight = 15;
+static const int kMarginTop = 30;
+static const int kMarginBottom = 40;
+
+static const int kGridX = 10;
+static const int kGridY = 8;
+
+WaveformWidget::WaveformWidget(QWidget *parent)
+    : QWidget(parent)
+    , m_windowSize(100)
+    , m_yMin(0.0)
+    , m_yMax(400.0)
+    , m_isPaused(false)
+    , m_samplesPerColumn(1)
+    , m_columnCount(1)
+{
+    setAttribute(Qt::WA_OpaquePaintEvent);
+    setMinimumSize(200, 150);
+}
+
+WaveformWidget::~WaveformWidget()
+{
+    qDeleteAll(m_channels);
+}
+
+int WaveformWidget::addChannel(const QString &name, const QColor &color)
+{
+    Channel *channel = new Channel;
+    channel->name = name;
+    channel->color = color;
+    channel->samples.reset(m_windowSize);
+    channel->finalizedColumns = 0;
+    m_channels.append(channel);
+
+    resetColumns();
+    rebuildBackground();
+    update();
+    return m_channels.size() - 1;
+}
+
+void WaveformWidget::appendSample(int channel, float value)
+{
+    if (m_isPaused || channel < 0 || channel >= m_channels.size()) {
+        return;
+    }
+    m_channels[channel]->samples.push(value);
+    update();
+}
+
+void WaveformWidget::appendSamples(int channel, const float *values, int count)
+{
+    if (m_isPaused || channel < 0 || channel >= m_channels.size() || count <= 0) {
+        return;
+    }
+    m_channels[channel]->samples.push(values, count);
+    update();
+}
+
+void WaveformWidget::setWindowSize(int samples)
+{
+    m_windowSize = qMax(2, samples);
+
+    // 保留窗口内已有的样本
+    for (Channel *channel : m_channels) {
+        SampleRingBuffer<float> resized(m_windowSize);
+        const SampleRingBuffer<float> &old = channel->samples;
+        old.forRange(old.totalCount() - m_windowSize, old.totalCount(),
+                     [&resized](const float *data, int count) { resized.push(data, count); });
+        channel->samples = resized;
+    }
+
+    resetColumns();
+    rebuildBackground();
+    update();
+}
+
+void WaveformWidget::setYRange(double min, double max)
+{
+    m_yMin = min;
+    m_yMax = max > min ? max : min + 1.0;
+    rebuildBackground();
+    update();
+}
+
+void WaveformWidget::setTitle(const QString &title)
+{
+    m_title = title;
+    rebuildBackground();
+    update();
+}
+
+void WaveformWidget::clear()
+{
+    for (Channel *channel : m_channels) {
+        channel->samples.clear();
+        channel->finalizedColumns = 0;
+        channel->polyline.clear();
+    }
+    update();
+}
+
+void WaveformWidget::setPaused(bool paused)
+{
+    m_isPaused = paused;
+}
+
+void WaveformWidget::resizeEvent(QResizeEvent *event)
+{
+    QWidget::resizeEvent(event);
+    resetColumns();
+    rebuildBackground();
+}
+
+void WaveformWidget::paintEvent(QPaintEvent *)
+{
+    QPainter painter(this);
+    if (m_background.isNull()) {
+        rebuildBackground();
+    }
+    painter.drawPixmap(0, 0, m_background);
+
+    painter.setClipRect(m_plotRect);
+    for (Channel *channel : m_channels) {
+        if (channel->samples.isEmpty()) {
+            continue;
+        }
+        updateColumns(channel);
+        buildPolyline(channel);
+        painter.setPen(QPen(channel->color, 1));
+        painter.drawPolyline(channel->polyline);
+    }
+}
+
+void WaveformWidget::rebuildBackground()
+{
+    m_plotRect = QRect(kMarginLeft, kMarginTop,
+                       qMax(1, width() - kMarginLeft - kMarginRight),
+                       qMax(1, height() - kMarginTop - kMarginBottom));
+
+    const qreal dpr = devicePixelRatioF();
+    m_background = QPixmap(size() * dpr);
+    m_background.setDevicePixelRatio(dpr);
+    m_background.fill(Qt::white);
+
+    QPainter painter(&m_background);
+    painter.setRenderHint(QPainter::TextAntialiasing);
+
+    // 标题
+    QFont titleFont = font();
+    titleFont.setBold(true);
+    painter.setFont(titleFont);
+    painter.setPen(Qt::black);
+    painter.drawText(QRect(0, 0, width(), kMarginTop), Qt::AlignCenter, m_title);
+    painter.setFont(font());
+
+    // 网格与刻度标签
+    QPen gridPen(QColor(220, 220, 220));
+    QPen labelPen(QColor(80, 80, 80));
+    const QFontMetrics metrics = painter.fontMetrics();
+
+    for (int i = 0; i <= kGridY; ++i) {
+        int y = m_plotRect.bottom() - i * m_plotRect.height() / kGridY;
+        painter.setPen(gridPen);
+        painter.drawLine(m_plotRect.left(), y, m_plotRect.right(), y);
+
+        double value = m_yMin + (m_yMax - m_yMin) * i / kGridY;
+        painter.setPen(labelPen);
+        painter.drawText(QRect(0, y - metrics.height() / 2, kMarginLeft - 6, metrics.height()),
+                         Qt::AlignRight | Qt::AlignVCenter, QString::number(value, 'f', 1));
+    }
+
+    for (int i = 0; i <= kGridX; ++i) {
+        int x = m_plotRect.left() + i * m_plotRect.width() / kGridX;
+        painter.setPen(gridPen);
+        painter.drawLine(x, m_plotRect.top(), x, m_plotRect.bottom());
+
+        // X 轴为相对样本序号，最右侧为最新样本
+        qint64 offset = static_cast<qint64>(m_windowSize) * (kGridX - i) / kGridX;
+        painter.setPen(labelPen);
+        painter.drawText(QRect(x - 40, m_plotRect.bottom() + 2, 80, metrics.height()),
+                         Qt::AlignHCenter | Qt::AlignTop, offset == 0 ? QString("0") : QString("-%1").arg(offset));
+    }
+
+    painter.setPen(QPen(Qt::gray));
+    painter.drawRect(m_plotRect);
+
+    // 轴标题
+    painter.setPen(Qt::black);
+    painter.drawText(QRect(m_plotRect.left(), height() - metrics.height() - 2, m_plotRect.width(), metrics.height()),
+                     Qt::AlignCenter, "Time (samples)");
+    painter.save();
+    painter.translate(12, m_plotRect.center().y());
+    painter.rotate(-90);
+    painter.drawText(QRect(-m_plotRect.height() / 2, -metrics.height() / 2, m_plotRect.height(), metrics.height()),
+                     Qt::AlignCenter, "Distance (cm)");
+    painter.restore();
+
+    // 图例
+    int legendX = m_plotRect.right() - 10;
+    for (int i = m_channels.size() - 1; i >= 0; --i) {
+        const Channel *channel = m_channels[i];
+        int textWidth = metrics.horizontalAdvance(channel->name);
+        legendX -= textWidth;
+        painter.setPen(Qt::black);
+        painter.drawText(legendX, m_plotRect.top() - 8, channel->name);
+        legendX -= 24;
+        painter.setPen(QPen(channel->color, 2));
+        painter.drawLine(legendX, m_plotRect.top() - 12, legendX + 18, m_plotRect.top() - 12);
+        legendX -= 12;
+    }
+}
+
+void WaveformWidget::resetColumns()
+{
+    int plotWidth = qMax(1, width() - kMarginLeft - kMarginRight);
+    if (m_windowSize > plotWidth) {
+        m_samplesPerColumn = (m_windowSize + plotWidth - 1) / plotWidth;
+        m_columnCount = (m_windowSize + m_samplesPerColumn - 1) / m_samplesPerColumn;
+    } else {
+        m_samplesPerColumn = 1;
+        m_columnCount = m_windowSize;
+    }
+
+    for (Channel *channel : m_channels) {
+        channel->columnMin.fill(0.0f, m_columnCount);
+        channel->columnMax.fill(0.0f, m_columnCount);
+        channel->finalizedColumns = 0;
+    }
+}
+
+void WaveformWidget::updateColumns(Channel *channel)
+{
+    if (m_samplesPerColumn <= 1) {
+        return;  // 逐点模式不需要列聚合
+    }
+
+    const qint64 total = channel->samples.totalCount();
+    const qint64 lastColumn = (total - 1) / m_samplesPerColumn;
+    const qint64 firstColumn = qMax<qint64>(channel->finalizedColumns, lastColumn - m_columnCount + 1);
+
+    for (qint64 column = qMax<qint64>(0, firstColumn); column <= lastColumn; ++column) {
+        float columnMin = std::numeric_limits<float>::max();
+        float columnMax = std::numeric_limits<float>::lowest();
+        qint64 from = column * m_samplesPerColumn;
+
+        channel->samples.forRange(from, from + m_samplesPerColumn,
+                                  [&columnMin, &columnMax](const float *data, int count) {
+            for (int i = 0; i < count; ++i) {
+                float v = data[i];
+                columnMin = v < columnMin ? v : columnMin;
+                columnMax = v > columnMax ? v : columnMax;
+            }
+        });
+
+        int slot = static_cast<int>(column % m_columnCount);
+        channel->columnMin[slot] = columnMin;
+        channel->columnMax[slot] = columnMax;
+    }
+
+    // 最后一列可能尚未填满，下次重绘时重新计算
+    channel->finalizedColumns = lastColumn;
+}
+
+void WaveformWidget::buildPolyline(Channel *channel)
+{
+    QPolygonF &polyline = channel->polyline;
+    polyline.clear();
+
+    const double right = m_plotRect.right();
+    const double bottom = m_plotRect.bottom();
+    const double scale = m_plotRect.height() / (m_yMax - m_yMin);
+    const double yMin = m_yMin;
+    const qint64 total = channel->samples.totalCount();
+
+    if (m_samplesPerColumn <= 1) {
+        // 逐点模式：窗口样本数不超过像素宽度
+        const double dx = static_cast<double>(m_plotRect.width()) / qMax(1, m_windowSize - 1);
+        qint64 index = qMax(total - m_windowSize, channel->samples.firstIndex());
+        channel->samples.forRange(index, total, [&](const float *data, int count) {
+            for (int i = 0; i < count; ++i, ++index) {
+                polyline.append(QPointF(right - (total - 1 - index) * dx, bottom - (data[i] - yMin) * scale));
+            }
+        });
+        return;
+    }
+
+    // 列模式：每列一条最小/最大值竖线
+    const double dx = static_cast<double>(m_plotRect.width()) / m_columnCount;
+    const qint64 lastColumn = (total - 1) / m_samplesPerColumn;
+    const qint64 firstColumn = qMax<qint64>(0, lastColumn - m_columnCount + 1);
+    polyline.reserve(static_cast<int>(lastColumn - firstColumn + 1) * 2);
+
+    for (qint64 column = firstColumn; column <= lastColumn; ++column) {
+        int slot = static_cast<int>(column % m_columnCount);
+        float columnMin = channel->columnMin[slot];
+        float columnMax = channel->columnMax[slot];
+        if (columnMin > columnMax) {
+            continue;  // 该列样本已被覆盖
+        }
+        double x = right - (lastColumn - column + 0.5) * dx;
+        polyline.append(QPointF(x, bottom - (columnMin - yMin) * scale));
+        polyline.append(QPointF(x, bottom - (columnMax - yMin) * scale));
+    }
+}
@@ -0,0 +1,78 @@
+#ifndef WAVEFORMWIDGET_H
+#define WAVEFORMWIDGET_H
+
+#include <QWidget>
+#include <QColor>
+#include <QPixmap>
+#include <QPolygonF>
+#include <QString>
+#include <QVector>
+
+#include "sampleringbuffer.h"
+
+/**
+ * @brief 多通道实时波形绘制组件，直接用 QPainter 从环形缓冲区绘制
+ *
+ * 窗口内样本数大于绘图宽度时，每个像素列只画一条最小/最大值竖线；
+ * 列聚合按绝对样本序号对齐并缓存，重绘时只计算新增的列。
+ * 坐标轴、网格与标签绘制到缓存的 QPixmap，仅在尺寸或量程变化时重建。
+ */
+class WaveformWidget : public QWidget {
+    Q_OBJECT
+
+public:
+    explicit WaveformWidget(QWidget *parent = nullptr);
+    ~WaveformWidget();
+
+    // 通道管理
+    int addChannel(const QString &name, const QColor &color);
+    int channelCount() const { return m_channels.size(); }
+
+    // 添加样本
+    void appendSample(int channel, float value);
+    void appendSamples(int channel, const float *values, int count);
+
+    // 显示参数
+    void setWindowSize(int samples);  // 显示窗口样本数
+    int windowSize() const { return m_windowSize; }
+    void setYRange(double min, double max);
+    void setTitle(const QString &title);
+
+    void clear();
+    void setPaused(bool paused);
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+
+private:
+    struct Channel {
+        QString name;
+        QColor color;
+        SampleRingBuffer<float> samples;
+        // 列聚合缓存，按列序号取模存放
+        QVector<float> columnMin;
+        QVector<float> columnMax;
+        qint64 finalizedColumns;  // 已完成聚合的列数（列序号 < 此值的列不会再变化）
+        QPolygonF polyline;
+    };
+
+    QVector<Channel *> m_channels;
+    QString m_title;
+    int m_windowSize;
+    double m_yMin;
+    double m_yMax;
+    bool m_isPaused;
+
+    QPixmap m_background;
+    QRect m_plotRect;
+    int m_samplesPerColumn;
+    int m_columnCount;
+
+    void rebuildBackground();
+    void resetColumns();
+    void updateColumns(Channel *channel);
+    void buildPolyline(Channel *channel);
+};
+
+#endif // WAVEFORMWIDGET_H
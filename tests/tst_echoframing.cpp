@@ -0,0 +1,157 @@
+#include <QtTest>
+#include <cmath>
+
+#include "samplefixed.h"
+#include "serialport.h"
+#include "echoprocessor.h"
+
+/**
+ * @brief 文本行与回波包络帧混合的串口流：到达顺序、帧拆分与校验失败后的重新同步
+ */
+class TestEchoFraming : public QObject {
+    Q_OBJECT
+
+private slots:
+    void parseFrame();
+    void echoKeepsArrivalOrder();
+    void frameSplitAcrossReads();
+    void corruptFrameIsNotParsedAsText();
+    void resyncSkipsBinaryLines();
+
+private:
+    static QVector<qint32> inject(SerialPortHandler &handler, const QByteArray &data);
+};
+
+// 回波位于第 100 个样本（100 kHz，即 1000 µs），往返距离的一半为 17.15 cm
+static const quint32 kRateHz = 100000;
+static const int kPulseStart = 100;
+static const double kPulseDistanceCm = 17.15;
+
+static quint16 crc16(const QByteArray &data)
+{
+    quint16 crc = 0xFFFF;
+    for (char byte : data) {
+        crc ^= quint16(quint8(byte)) << 8;
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc & 0x8000) ? quint16((crc << 1) ^ 0x1021) : quint16(crc << 1);
+        }
+    }
+    return crc;
+}
+
+static void appendLe(QByteArray &data, quint32 value, int bytes)
+{
+    for (int i = 0; i < bytes; ++i) {
+        data.append(char((value >> (8 * i)) & 0xFF));
+    }
+}
+
+static QByteArray makeFrame(const QByteArray &samples, quint32 rateHz, bool corrupt = false)
+{
+    QByteArray body;
+    body.append(char(1));
+    body.append(char(0));
+    appendLe(body, quint32(samples.size()), 2);
+    appendLe(body, rateHz, 4);
+    appendLe(body, 0, 4);
+    body.append(samples);
+
+    quint16 crc = crc16(body);
+    if (corrupt) {
+        crc ^= 0x5555;
+    }
+    QByteArray frame("\xA5\x5A", 2);
+    frame.append(body);
+    appendLe(frame, crc, 2);
+    return frame;
+}
+
+// 与默认参考脉冲同形的 200 µs Hann 脉冲
+static QByteArray pulseEnvelope()
+{
+    const int length = 200;
+    const int width = int(std::lround(200e-6 * kRateHz));
+    QByteArray samples(length, char(0));
+    for (int i = 0; i < width; ++i) {
+        double hann = 0.5 - 0.5 * std::cos(2.0 * M_PI * (i + 0.5) / width);
+        samples[kPulseStart + i] = char(std::lround(200.0 * hann));
+    }
+    return samples;
+}
+
+QVector<qint32> TestEchoFraming::inject(SerialPortHandler &handler, const QByteArray &data)
+{
+    QSignalSpy spy(&handler, &SerialPortHandler::samplesReceived);
+    handler.injectData(data, 1000);
+    QVector<qint32> values;
+    for (const QList<QVariant> &arguments : spy) {
+        values += arguments.at(0).value<SampleBlock>().values;
+    }
+    return values;
+}
+
+void TestEchoFraming::parseFrame()
+{
+    QByteArray frame = makeFrame(pulseEnvelope(), kRateHz);
+    EchoFrame parsed;
+    QCOMPARE(EchoProcessor::parseFrame(frame.constData(), frame.size(), parsed), frame.size());
+    QCOMPARE(parsed.count, 200);
+    QCOMPARE(parsed.sampleRateHz, kRateHz);
+    QCOMPARE(parsed.delayUs, 0u);
+
+    QCOMPARE(EchoProcessor::parseFrame(frame.constData(), frame.size() - 1, parsed), 0);
+    QByteArray corrupt = makeFrame(pulseEnvelope(), kRateHz, true);
+    QCOMPARE(EchoProcessor::parseFrame(corrupt.constData(), corrupt.size(), parsed), -1);
+}
+
+void TestEchoFraming::echoKeepsArrivalOrder()
+{
+    // 一次读取中文本、帧、文本交错：回波距离应插在两个文本样本之间
+    SerialPortHandler handler;
+    QByteArray data = "10\n" + makeFrame(pulseEnvelope(), kRateHz) + "20\n";
+    QVector<qint32> values = inject(handler, data);
+
+    QCOMPARE(values.size(), 3);
+    QCOMPARE(values[0], SampleFixed::fromDouble(10.0));
+    QVERIFY(std::abs(SampleFixed::toDouble(values[1]) - kPulseDistanceCm) < 0.2);
+    QCOMPARE(values[2], SampleFixed::fromDouble(20.0));
+}
+
+void TestEchoFraming::frameSplitAcrossReads()
+{
+    SerialPortHandler handler;
+    QByteArray frame = makeFrame(pulseEnvelope(), kRateHz);
+    QCOMPARE(inject(handler, "5\n" + frame.left(40)), QVector<qint32>{SampleFixed::fromDouble(5.0)});
+
+    QVector<qint32> values = inject(handler, frame.mid(40) + "6\n");
+    QCOMPARE(values.size(), 2);
+    QVERIFY(std::abs(SampleFixed::toDouble(values[0]) - kPulseDistanceCm) < 0.2);
+    QCOMPARE(values[1], SampleFixed::fromDouble(6.0));
+}
+
+void TestEchoFraming::corruptFrameIsNotParsedAsText()
+{
+    // 校验失败的帧载荷全是数字，失步后这些字节不得成为样本
+    SerialPortHandler handler;
+    QByteArray frame = makeFrame("1234567890123456", 1000000, true);
+    QVERIFY(!frame.contains('\n'));
+
+    QVector<qint32> values = inject(handler, "10\n" + frame + "\n55\n");
+    QCOMPARE(values, (QVector<qint32>{SampleFixed::fromDouble(10.0), SampleFixed::fromDouble(55.0)}));
+}
+
+void TestEchoFraming::resyncSkipsBinaryLines()
+{
+    // 重新同步后第一行含控制字节时继续等待，直到出现可打印的文本行
+    SerialPortHandler handler;
+    QByteArray frame = makeFrame("1234567890123456", 1000000, true);
+    QByteArray data = frame + "77\n" + QByteArray("\x01\x02", 2) + "\n42\n43\n";
+    QCOMPARE(inject(handler, data), (QVector<qint32>{SampleFixed::fromDouble(42.0), SampleFixed::fromDouble(43.0)}));
+
+    // 帧在数据尾部校验失败：其后的字节直到换行都丢弃
+    QVERIFY(inject(handler, frame + "88").isEmpty());
+    QCOMPARE(inject(handler, "\n9\n"), QVector<qint32>{SampleFixed::fromDouble(9.0)});
+}
+
+QTEST_GUILESS_MAIN(TestEchoFraming)
+#include "tst_echoframing.moc"
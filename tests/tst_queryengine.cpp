@@ -0,0 +1,248 @@
+#include <QtTest>
+#include <QMap>
+#include <QRandomGenerator>
+#include <QTemporaryDir>
+#include <algorithm>
+#include <cmath>
+
+#include "datamanager.h"
+#include "queryengine.h"
+#include "samplespool.h"
+
+/**
+ * @brief 并行查询：在生成的 SQLite 库上对照直接计算的计数、均值、最值与精确百分位，以及原始记录与增量变更
+ */
+class TestQueryEngine : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void timeBounds();
+    void selectInOrder_data();
+    void selectInOrder();
+    void aggregate_data();
+    void aggregate();
+    void aggregateSubrange();
+    void changes();
+
+private:
+    QString databasePath() const { return m_dir.filePath("query.db"); }
+
+    QTemporaryDir m_dir;
+    QVector<qint64> m_timesMs;     // 存储毫秒，升序
+    QVector<qint32> m_values;      // 定点值
+};
+
+// 2024-06-15 12:00:00（存储毫秒），避开夏令时切换
+static const qint64 kBaseMs = 1718452800000LL;
+static const qint64 kStepMs = 5;
+static const int kRecordCount = 12000;
+static const QVector<double> kPercentiles{0.0, 1.0, 25.0, 50.0, 90.0, 99.9, 100.0};
+
+// 与查询引擎同一口径：定点值排序后在相邻秩之间线性插值
+static double percentile(QVector<qint32> sorted, double percentile)
+{
+    std::sort(sorted.begin(), sorted.end());
+    double position = percentile / 100.0 * (sorted.size() - 1);
+    int lower = int(position);
+    int upper = qMin(lower + 1, sorted.size() - 1);
+    double fraction = position - lower;
+    return SampleFixed::toDouble(sorted[lower]) * (1.0 - fraction) + SampleFixed::toDouble(sorted[upper]) * fraction;
+}
+
+void TestQueryEngine::initTestCase()
+{
+    QVERIFY(m_dir.isValid());
+
+    // 取值限定在少量定点值上，直方图合并时同一值在多个分片中出现
+    QRandomGenerator random(13);
+    QVector<SpoolRecord> records;
+    for (int i = 0; i < kRecordCount; ++i) {
+        qint64 ms = kBaseMs + i * kStepMs;
+        qint32 value = SampleFixed::fromDouble(50.0 + random.bounded(400) / 4.0);
+        m_timesMs.append(ms);
+        m_values.append(value);
+        records.append(SpoolRecord{DataManager::fromStorageMs(ms).toMSecsSinceEpoch() * 1000, value});
+    }
+
+    DataManager dataManager;
+    QVERIFY(dataManager.initialize(databasePath(), "query_writer"));
+    QVERIFY(dataManager.insertRecords(records));
+}
+
+void TestQueryEngine::timeBounds()
+{
+    QueryEngine engine(databasePath(), 2);
+    QVERIFY(engine.open());
+    qint64 firstMs = 0;
+    qint64 lastMs = 0;
+    QVERIFY(engine.timeBounds(firstMs, lastMs));
+    QCOMPARE(firstMs, m_timesMs.first());
+    QCOMPARE(lastMs, m_timesMs.last());
+}
+
+void TestQueryEngine::selectInOrder_data()
+{
+    QTest::addColumn<int>("threads");
+    QTest::newRow("1 thread") << 1;
+    QTest::newRow("4 threads") << 4;
+}
+
+void TestQueryEngine::selectInOrder()
+{
+    QFETCH(int, threads);
+
+    QueryEngine engine(databasePath(), threads);
+    QVERIFY(engine.open());
+    QVector<qint64> times;
+    QVector<double> values;
+    QVERIFY(engine.select(kBaseMs, m_timesMs.last() + 1, [&](const RecordSet &records) {
+        times += records.timestampsMs();
+        values += records.distances();
+        return true;
+    }));
+
+    QCOMPARE(times, m_timesMs);
+    QCOMPARE(values.size(), m_values.size());
+    for (int i = 0; i < values.size(); ++i) {
+        QCOMPARE(SampleFixed::fromDouble(values[i]), m_values[i]);
+    }
+}
+
+void TestQueryEngine::aggregate_data()
+{
+    QTest::addColumn<int>("threads");
+    QTest::addColumn<qint64>("bucketMs");
+
+    // 60 s 的数据：1 s 的桶完全落在分片内（排序取值），10 s 的桶与不分桶跨分片（直方图合并）
+    QTest::newRow("whole range, 1 thread") << 1 << qint64(0);
+    QTest::newRow("whole range, 4 threads") << 4 << qint64(0);
+    QTest::newRow("1 s buckets") << 4 << qint64(1000);
+    QTest::newRow("7 s buckets") << 3 << qint64(7000);
+    QTest::newRow("10 s buckets") << 4 << qint64(10000);
+}
+
+void TestQueryEngine::aggregate()
+{
+    QFETCH(int, threads);
+    QFETCH(qint64, bucketMs);
+
+    const qint64 startMs = kBaseMs;
+    const qint64 endMs = m_timesMs.last() + 1;
+
+    // 直接按桶分组计算期望值
+    QMap<qint64, QVector<qint32>> expected;
+    for (int i = 0; i < m_timesMs.size(); ++i) {
+        qint64 key = bucketMs > 0 ? m_timesMs[i] / bucketMs * bucketMs : startMs;
+        expected[key].append(m_values[i]);
+    }
+
+    QueryEngine engine(databasePath(), threads);
+    QVERIFY(engine.open());
+    QVector<BucketAggregate> buckets;
+    QVERIFY(engine.aggregate(startMs, endMs, bucketMs, kPercentiles, [&](const BucketAggregate &bucket) {
+        buckets.append(bucket);
+        return true;
+    }));
+
+    QCOMPARE(buckets.size(), expected.size());
+    int index = 0;
+    for (auto it = expected.cbegin(); it != expected.cend(); ++it, ++index) {
+        const BucketAggregate &bucket = buckets[index];
+        const QVector<qint32> &values = it.value();
+        QCOMPARE(bucket.startMs, it.key());
+        QCOMPARE(bucket.count, qint64(values.size()));
+
+        double sum = 0.0;
+        for (qint32 value : values) {
+            sum += SampleFixed::toDouble(value);
+        }
+        QVERIFY2(std::abs(bucket.sum - sum) < 1e-6, qPrintable(QString("bucket %1 sum").arg(index)));
+        QCOMPARE(SampleFixed::fromDouble(bucket.min), *std::min_element(values.begin(), values.end()));
+        QCOMPARE(SampleFixed::fromDouble(bucket.max), *std::max_element(values.begin(), values.end()));
+
+        QCOMPARE(bucket.percentiles.size(), kPercentiles.size());
+        for (int p = 0; p < kPercentiles.size(); ++p) {
+            double reference = percentile(values, kPercentiles[p]);
+            QVERIFY2(std::abs(bucket.percentiles[p] - reference) < 1e-9,
+                     qPrintable(QString("bucket %1 p%2: %3 != %4")
+                                .arg(index).arg(kPercentiles[p]).arg(bucket.percentiles[p]).arg(reference)));
+        }
+    }
+}
+
+void TestQueryEngine::aggregateSubrange()
+{
+    // 查询起止不在桶边界上：首尾桶只含区间内的样本，不分桶时桶起点为查询起点
+    const qint64 startMs = kBaseMs + 2503;
+    const qint64 endMs = kBaseMs + 41007;
+    QVector<qint32> inRange;
+    for (int i = 0; i < m_timesMs.size(); ++i) {
+        if (m_timesMs[i] >= startMs && m_timesMs[i] < endMs) {
+            inRange.append(m_values[i]);
+        }
+    }
+
+    QueryEngine engine(databasePath(), 4);
+    QVERIFY(engine.open());
+    QVector<BucketAggregate> buckets;
+    QVERIFY(engine.aggregate(startMs, endMs, 0, {50.0}, [&](const BucketAggregate &bucket) {
+        buckets.append(bucket);
+        return true;
+    }));
+    QCOMPARE(buckets.size(), 1);
+    QCOMPARE(buckets[0].startMs, startMs);
+    QCOMPARE(buckets[0].count, qint64(inRange.size()));
+    QVERIFY(std::abs(buckets[0].percentiles[0] - percentile(inRange, 50.0)) < 1e-9);
+
+    qint64 total = 0;
+    buckets.clear();
+    QVERIFY(engine.aggregate(startMs, endMs, 10000, {}, [&](const BucketAggregate &bucket) {
+        buckets.append(bucket);
+        total += bucket.count;
+        return bucket.percentiles.isEmpty();
+    }));
+    QCOMPARE(total, qint64(inRange.size()));
+    QCOMPARE(buckets.first().startMs, kBaseMs);
+    QCOMPARE(buckets.last().startMs, kBaseMs + 40000);
+
+    // 回调返回 false 时停止
+    int calls = 0;
+    QVERIFY(!engine.aggregate(startMs, endMs, 1000, {}, [&](const BucketAggregate &) { return ++calls < 3; }));
+    QCOMPARE(calls, 3);
+}
+
+void TestQueryEngine::changes()
+{
+    QueryEngine engine(databasePath(), 2);
+    QVERIFY(engine.open());
+
+    // 插入多于一批（8192 条），按序号分批送出
+    QVector<RecordChange> all;
+    int batches = 0;
+    qint64 watermark = 0;
+    QVERIFY(engine.changes(0, [&](const QVector<RecordChange> &changes) {
+        all += changes;
+        ++batches;
+        return true;
+    }, watermark));
+    QCOMPARE(all.size(), kRecordCount);
+    QVERIFY(batches >= 2);
+    QCOMPARE(watermark, all.last().sequence);
+    for (int i = 0; i < all.size(); ++i) {
+        QCOMPARE(all[i].type, RecordChange::Insert);
+        QCOMPARE(all[i].timestampMs, m_timesMs[i]);
+        if (i > 0) {
+            QVERIFY(all[i].sequence > all[i - 1].sequence);
+        }
+    }
+
+    // 没有新变更时水位不变
+    qint64 unchanged = 0;
+    QVERIFY(engine.changes(watermark, [](const QVector<RecordChange> &) { return false; }, unchanged));
+    QCOMPARE(unchanged, watermark);
+}
+
+QTEST_GUILESS_MAIN(TestQueryEngine)
+#include "tst_queryengine.moc"
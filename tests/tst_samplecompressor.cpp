@@ -0,0 +1,297 @@
+#include <QtTest>
+#include <QDateTime>
+#include <QRandomGenerator>
+#include <QTemporaryDir>
+#include <QThread>
+#include <cmath>
+#include <limits>
+
+#include "datamanager.h"
+#include "samplecompressor.h"
+
+/**
+ * @brief 旋转门压缩：重建误差不超过容差、心跳与中断，以及压缩时间段的时间加权统计
+ */
+class TestSampleCompressor : public QObject {
+    Q_OBJECT
+
+private slots:
+    void disabledPassesThrough();
+    void errorBound_data();
+    void errorBound();
+    void quasiStaticSignal();
+    void sharedTimestamps();
+    void heartbeat();
+    void gapSavesBothSides();
+    void timestampRegression();
+    void interpolate();
+    void compressedStatistics();
+};
+
+static const double kPi = 3.14159265358979323846;
+static const qint64 kStepUs = 10000;
+
+static SampleBlock compress(SampleCompressor &compressor, const SampleBlock &input)
+{
+    SampleBlock stored;
+    compressor.push(input, stored);
+    compressor.flush(stored);
+    return stored;
+}
+
+// 在保存点之间按线性插值重建每个输入样本，返回最大误差（定点值）
+static double maxReconstructionError(const SampleBlock &input, const SampleBlock &stored)
+{
+    double maxError = 0.0;
+    int right = 0;
+    for (int i = 0; i < input.size(); ++i) {
+        qint64 t = input.timestampsUs[i];
+        while (right < stored.size() && stored.timestampsUs[right] < t) {
+            ++right;
+        }
+        double value;
+        if (right < stored.size() && stored.timestampsUs[right] == t) {
+            value = stored.values[right];
+        } else if (right == 0 || right == stored.size()) {
+            return std::numeric_limits<double>::infinity();
+        } else {
+            qint64 t0 = stored.timestampsUs[right - 1];
+            qint64 t1 = stored.timestampsUs[right];
+            value = stored.values[right - 1]
+                + double(stored.values[right] - stored.values[right - 1]) * double(t - t0) / double(t1 - t0);
+        }
+        maxError = qMax(maxError, std::abs(value - input.values[i]));
+    }
+    return maxError;
+}
+
+void TestSampleCompressor::disabledPassesThrough()
+{
+    SampleBlock input;
+    for (int i = 0; i < 10; ++i) {
+        input.append(i * kStepUs, 1000);
+    }
+    SampleCompressor compressor;
+    QCOMPARE(compressor.tolerance(), 0);
+    SampleBlock stored = compress(compressor, input);
+    QCOMPARE(stored.timestampsUs, input.timestampsUs);
+    QCOMPARE(stored.values, input.values);
+}
+
+void TestSampleCompressor::errorBound_data()
+{
+    QTest::addColumn<QString>("signal");
+    QTest::addColumn<double>("toleranceCm");
+
+    QTest::newRow("sine") << "sine" << 0.05;
+    QTest::newRow("sine coarse") << "sine" << 1.0;
+    QTest::newRow("ramp") << "ramp" << 0.05;
+    QTest::newRow("steps") << "steps" << 0.05;
+    QTest::newRow("random walk") << "walk" << 0.1;
+}
+
+void TestSampleCompressor::errorBound()
+{
+    QFETCH(QString, signal);
+    QFETCH(double, toleranceCm);
+
+    QRandomGenerator random(3);
+    SampleBlock input;
+    double walk = 100.0;
+    for (int i = 0; i < 3000; ++i) {
+        double t = i * kStepUs / 1e6;
+        double value = 0.0;
+        if (signal == "sine") {
+            value = 100.0 + 5.0 * std::sin(2.0 * kPi * 0.5 * t);
+        } else if (signal == "ramp") {
+            value = 50.0 + 3.0 * t;
+        } else if (signal == "steps") {
+            value = 100.0 + 10.0 * ((i / 400) % 3);
+        } else {
+            walk += random.bounded(0.4) - 0.2;
+            value = walk;
+        }
+        input.append(i * kStepUs, SampleFixed::fromDouble(value));
+    }
+
+    SampleCompressor compressor;
+    compressor.setTolerance(SampleFixed::fromDouble(toleranceCm));
+    SampleBlock stored = compress(compressor, input);
+
+    QVERIFY(stored.size() < input.size());
+    QCOMPARE(stored.timestampsUs.first(), input.timestampsUs.first());
+    QCOMPARE(stored.timestampsUs.last(), reads.last().timestampsUs.last());
+    double error = maxReconstructionError(input, stored);
+    QVERIFY2(error <= compressor.tolerance() + 1e-6,
+             qPrintable(QString("error %1 > tolerance %2").arg(error).arg(compressor.tolerance())));
+}
+
+void TestSampleCompressor::quasiStaticSignal()
+{
+    // 10 s 内读数在 ±0.03 cm 内随机抖动，容差 0.05 cm：行数至少下降一个数量级
+    QRandomGenerator random(5);
+    SampleBlock input;
+    for (int i = 0; i < 1000; ++i) {
+        input.append(i * kStepUs, SampleFixed::fromDouble(80.0 + random.bounded(0.06) - 0.03));
+    }
+    SampleCompressor compressor;
+    compressor.setTolerance(SampleFixed::fromDouble(0.05));
+    SampleBlock stored = compress(compressor, input);
+
+    QVERIFY2(stored.size() * 10 < input.size(), qPrintable(QString::number(stored.size())));
+    QVERIFY(maxReconstructionError(input, stored) <= compressor.tolerance() + 1e-6);
+}
+
+void TestSampleCompressor::sharedTimestamps()
+{
+    // 串口每次读取的 16 个样本共用读取时刻；第一次读取只有一个样本，给出起始时间点
+    const int perRead = 16;
+    QVector<SampleBlock> reads(1);
+    SampleBlock spread;
+    reads[0].append(0, SampleFixed::fromDouble(100.0));
+    spread.append(0, SampleFixed::fromDouble(100.0));
+    int inputCount = 1;
+    for (int read = 1; read <= 200; ++read) {
+        SampleBlock block;
+        for (int j = 0; j < perRead; ++j) {
+            int i = (read - 1) * perRead + j + 1;
+            qint32 value = SampleFixed::fromDouble(100.0 + 5.0 * std::sin(2.0 * kPi * 0.5 * i * kStepUs / 1e6));
+            block.append(read * perRead * kStepUs, value);
+            spread.append(i * kStepUs, value);
+        }
+        inputCount += block.size();
+        reads.append(block);
+    }
+
+    SampleCompressor compressor;
+    compressor.setTolerance(SampleFixed::fromDouble(0.05));
+    SampleBlock stored;
+    for (const SampleBlock &block : reads) {
+        compressor.push(block, stored);
+    }
+    compressor.flush(stored);
+
+    // 共用时间戳在两次读取之间展开：不再逐个当作回退保存
+    QVERIFY2(stored.size() * 5 < inputCount, qPrintable(QString::number(stored.size())));
+    for (int i = 1; i < stored.size(); ++i) {
+        QVERIFY(stored.timestampsUs[i] > stored.timestampsUs[i - 1]);
+    }
+    QCOMPARE(stored.timestampsUs.last(), reads.last().timestampsUs.last());
+    QVERIFY(maxReconstructionError(spread, stored) <= compressor.tolerance() + 1e-6);
+}
+
+void TestSampleCompressor::heartbeat()
+{
+    SampleBlock input;
+    for (int i = 0; i < 600; ++i) {
+        input.append(i * 100000LL, 5000);
+    }
+    SampleCompressor compressor;
+    compressor.setTolerance(5);
+    SampleBlock stored = compress(compressor, input);
+
+    QVERIFY(stored.size() >= 7);
+    for (int i = 1; i < stored.size(); ++i) {
+        QVERIFY(stored.timestampsUs[i] - stored.timestampsUs[i - 1] <= SampleCompressor::kMaxIntervalUs);
+    }
+}
+
+void TestSampleCompressor::gapSavesBothSides()
+{
+    SampleBlock input;
+    for (int i = 0; i <= 50; ++i) {
+        input.append(i * 100000LL, 5000);
+    }
+    for (int i = 300; i <= 350; ++i) {
+        input.append(i * 100000LL, 5000);
+    }
+    SampleCompressor compressor;
+    compressor.setTolerance(5);
+    SampleBlock stored = compress(compressor, input);
+
+    QVERIFY(stored.timestampsUs.contains(5000000LL));
+    QVERIFY(stored.timestampsUs.contains(30000000LL));
+
+    // 读取方不在中断两侧之间插值
+    double value = 0.0;
+    QVERIFY(!SampleCompressor::interpolate(5000, 50.0, 30000, 50.0, 10000, value));
+}
+
+void TestSampleCompressor::timestampRegression()
+{
+    SampleCompressor compressor;
+    compressor.setTolerance(5);
+    SampleBlock stored;
+    compressor.push(1000000, 5000, stored);
+    compressor.push(2000000, 5000, stored);
+    QVERIFY(compressor.hasPending());
+    compressor.push(1500000, 5100, stored);
+    compressor.flush(stored);
+    QVERIFY(!compressor.hasPending());
+
+    QCOMPARE(stored.timestampsUs, (QVector<qint64>{1000000, 2000000, 1500000}));
+    QCOMPARE(stored.values, (QVector<qint32>{5000, 5000, 5100}));
+}
+
+void TestSampleCompressor::interpolate()
+{
+    double value = 0.0;
+    QVERIFY(SampleCompressor::interpolate(1000, 10.0, 2000, 20.0, 1250, value));
+    QCOMPARE(value, 12.5);
+    QVERIFY(SampleCompressor::interpolate(1000, 10.0, 1000, 20.0, 1000, value));
+    QCOMPARE(value, 10.0);
+    QVERIFY(!SampleCompressor::interpolate(1000, 10.0, 2000, 20.0, 999, value));
+    QVERIFY(!SampleCompressor::interpolate(1000, 10.0, 2000, 20.0, 2001, value));
+}
+
+void TestSampleCompressor::compressedStatistics()
+{
+    // 压缩时间段内只存少数保存点：统计按保存的记录计算，另给出折合的原始样本数
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    DataManager dataManager;
+    QVERIFY(dataManager.initialize(dir.filePath("compressed.db"), "compressed_stats"));
+    dataManager.setCompressionTolerance(0.05);
+
+    // 1 s 内 200 个样本，从 10 cm 线性升到 20 cm；时间戳取整到毫秒，与存储精度一致
+    const qint64 startUs = (QDateTime::currentMSecsSinceEpoch() + 50) * 1000;
+    const int count = 200;
+    SampleBlock block;
+    for (int i = 0; i < count; ++i) {
+        block.append(startUs + i * 5000LL, SampleFixed::fromDouble(10.0 + 10.0 * i / (count - 1)));
+    }
+    QVERIFY(dataManager.saveSamples(block));
+    QVERIFY(dataManager.flushCompression());
+
+    qint64 samples = 0;
+    qint64 stored = 0;
+    dataManager.compressionCounts(samples, stored);
+    QCOMPARE(samples, qint64(count));
+    QVERIFY(stored < 10);
+
+    // 样本时间过去后关闭时间段，记下名义采样间隔
+    QThread::msleep(1200);
+    dataManager.setCompressionTolerance(0.0);
+
+    const qint64 startMs = DataManager::toStorageMs(QDateTime::fromMSecsSinceEpoch(startUs / 1000));
+    RangeStatistics stats;
+    QVERIFY(dataManager.queryStatistics(startMs - 1000, startMs + 5000, stats));
+    QCOMPARE(stats.count, stored);
+    QVERIFY2(std::abs(stats.represented - count) <= 2, qPrintable(QString::number(stats.represented)));
+    QCOMPARE(stats.min, 10.0);
+    QCOMPARE(stats.max, 20.0);
+
+    // 与 ultrasonic-query aggregate 同一口径：均值即保存记录的均值
+    RecordSet records;
+    QVERIFY(dataManager.queryRange(startMs - 1000, startMs + 5000, records));
+    QCOMPARE(qint64(records.size()), stored);
+    double sum = 0.0;
+    for (double distance : records.distances()) {
+        sum += distance;
+    }
+    QVERIFY(std::abs(stats.mean() - sum / records.size()) < 1e-9);
+    QVERIFY(!dataManager.compressionNote(startMs - 1000, startMs + 5000).isEmpty());
+}
+
+QTEST_GUILESS_MAIN(TestSampleCompressor)
+#include "tst_samplecompressor.moc"
@@ -0,0 +1,163 @@
+#include <QtTest>
+#include <cstring>
+
+#include "samplefixed.h"
+#include "serialport.h"
+
+/**
+ * @brief 文本样本解析：SampleFixed::parse 与串口行解析（经 injectData 走完整读取路径）
+ */
+class TestSampleParser : public QObject {
+    Q_OBJECT
+
+private slots:
+    void parseFixed_data();
+    void parseFixed();
+    void parseRejects_data();
+    void parseRejects();
+    void formatRoundTrip();
+
+    void parseLines_data();
+    void parseLines();
+    void splitLinesAcrossReads();
+    void commandReplyIsNotASample();
+
+private:
+    static QVector<qint32> inject(SerialPortHandler &handler, const QByteArray &data);
+};
+
+static bool parseText(const char *text, qint32 &value)
+{
+    return SampleFixed::parse(text, text + std::strlen(text), value);
+}
+
+QVector<qint32> TestSampleParser::inject(SerialPortHandler &handler, const QByteArray &data)
+{
+    QSignalSpy spy(&handler, &SerialPortHandler::samplesReceived);
+    handler.injectData(data, 1000);
+    QVector<qint32> values;
+    for (const QList<QVariant> &arguments : spy) {
+        values += arguments.at(0).value<SampleBlock>().values;
+    }
+    return values;
+}
+
+void TestSampleParser::parseFixed_data()
+{
+    QTest::addColumn<QString>("text");
+    QTest::addColumn<double>("expected");
+
+    QTest::newRow("integer") << "65" << 65.0;
+    QTest::newRow("fraction") << "65.25" << 65.25;
+    QTest::newRow("signed") << "-3.5" << -3.5;
+    QTest::newRow("plus") << "+7" << 7.0;
+    QTest::newRow("leading point") << ".5" << 0.5;
+    QTest::newRow("trailing point") << "5." << 5.0;
+    QTest::newRow("leading zeros") << "00012.30" << 12.3;
+    QTest::newRow("whitespace") << " \t42.1 \r" << 42.1;
+    QTest::newRow("round up") << "0.125" << 0.13;
+    QTest::newRow("round down") << "0.124" << 0.12;
+    QTest::newRow("exponent") << "1.2e2" << 120.0;
+    QTest::newRow("upper exponent") << "1.2345E+2" << 123.45;
+    QTest::newRow("negative exponent") << "6525e-2" << 65.25;
+    QTest::newRow("exponent rounds") << "1.23456e2" << 123.46;
+    QTest::newRow("tiny") << "1e-100" << 0.0;
+    QTest::newRow("zero exponent") << "0e400" << 0.0;
+}
+
+void TestSampleParser::parseFixed()
+{
+    QFETCH(QString, text);
+    QFETCH(double, expected);
+
+    qint32 value = 0;
+    QVERIFY(parseText(text.toLatin1().constData(), value));
+    QCOMPARE(value, SampleFixed::fromDouble(expected));
+}
+
+void TestSampleParser::parseRejects_data()
+{
+    QTest::addColumn<QString>("text");
+
+    QTest::newRow("empty") << "";
+    QTest::newRow("blank") << "  ";
+    QTest::newRow("sign only") << "-";
+    QTest::newRow("letters") << "abc";
+    QTest::newRow("unit suffix") << "65 cm";
+    QTest::newRow("exponent without digits") << "1e";
+    QTest::newRow("exponent only") << "e5";
+    QTest::newRow("two points") << "1.2.3";
+    QTest::newRow("overflow") << "123456789";
+    QTest::newRow("exponent overflow") << "1e9";
+}
+
+void TestSampleParser::parseRejects()
+{
+    QFETCH(QString, text);
+
+    qint32 value = 0;
+    QVERIFY(!parseText(text.toLatin1().constData(), value));
+}
+
+void TestSampleParser::formatRoundTrip()
+{
+    const qint32 values[] = {0, 1, -1, 99, 6525, -6525, SampleFixed::kMaxDistance, INT_MAX, INT_MIN + 1};
+    for (qint32 value : values) {
+        char buffer[16];
+        int length = SampleFixed::format(value, buffer);
+        qint32 parsed = 0;
+        QVERIFY(SampleFixed::parse(buffer, buffer + length, parsed));
+        QCOMPARE(parsed, value);
+        QCOMPARE(SampleFixed::toString(value), QString::number(SampleFixed::toDouble(value), 'f', SampleFixed::kFractionDigits));
+    }
+}
+
+void TestSampleParser::parseLines_data()
+{
+    QTest::addColumn<QByteArray>("data");
+    QTest::addColumn<QVector<double>>("expected");
+
+    QTest::newRow("plain") << QByteArray("65.00\n") << QVector<double>{65.0};
+    QTest::newRow("crlf") << QByteArray("65.00\r\n") << QVector<double>{65.0};
+    QTest::newRow("colon") << QByteArray("D:12.5\n") << QVector<double>{12.5};
+    QTest::newRow("equals") << QByteArray("Distance=12.5\n") << QVector<double>{12.5};
+    QTest::newRow("exponent") << QByteArray("DIST:1.2e2\n") << QVector<double>{120.0};
+    QTest::newRow("first separator wins") << QByteArray("D:=12.5\nD=:7\n") << QVector<double>{};
+    QTest::newRow("label with both") << QByteArray("Distance: 12.5\nd=3\n") << QVector<double>{12.5, 3.0};
+    QTest::newRow("out of range") << QByteArray("-1\n500.01\n500\n") << QVector<double>{500.0};
+    QTest::newRow("garbage skipped") << QByteArray("hello\n7\n\n8\n") << QVector<double>{7.0, 8.0};
+}
+
+void TestSampleParser::parseLines()
+{
+    QFETCH(QByteArray, data);
+    QFETCH(QVector<double>, expected);
+
+    SerialPortHandler handler;
+    QVector<qint32> values = inject(handler, data);
+    QCOMPARE(values.size(), expected.size());
+    for (int i = 0; i < expected.size(); ++i) {
+        QCOMPARE(values[i], SampleFixed::fromDouble(expected[i]));
+    }
+}
+
+void TestSampleParser::splitLinesAcrossReads()
+{
+    // 不完整的行留在缓冲区，等下一次读取补齐
+    SerialPortHandler handler;
+    QVERIFY(inject(handler, "12.").isEmpty());
+    QCOMPARE(inject(handler, "5\n4"), QVector<qint32>{SampleFixed::fromDouble(12.5)});
+    QCOMPARE(inject(handler, "2\n"), QVector<qint32>{SampleFixed::fromDouble(42.0)});
+}
+
+void TestSampleParser::commandReplyIsNotASample()
+{
+    SerialPortHandler handler;
+    QSignalSpy replies(&handler, &SerialPortHandler::commandAcknowledged);
+    QCOMPARE(inject(handler, "ACK RATE 100 0.50\n10\n"), QVector<qint32>{SampleFixed::fromDouble(10.0)});
+    QCOMPARE(replies.size(), 1);
+    QCOMPARE(replies.at(0).at(0).toString(), QString("ACK RATE 100 0.50"));
+}
+
+QTEST_GUILESS_MAIN(TestSampleParser)
+#include "tst_sampleparser.moc"
@@ -0,0 +1,218 @@
+#include <QtTest>
+#include <QTemporaryDir>
+#include <algorithm>
+
+#include "datamanager.h"
+#include "samplespool.h"
+#include "spoolreplayer.h"
+
+/**
+ * @brief 暂存文件：逐条校验、崩溃后恢复、复用后旧记录失效，以及回放入库与水位
+ */
+class TestSampleSpool : public QObject {
+    Q_OBJECT
+
+private slots:
+    void init();
+
+    void appendAndRead();
+    void reopenKeepsPending();
+    void corruptRecordEndsRecovery();
+    void reusedFileDropsStaleRecords();
+    void replayIntoDatabase();
+    void replaySkipsCommittedBatch();
+
+private:
+    QString spoolPath() const { return m_dir->filePath("samples.spool"); }
+    QString databasePath() const { return m_dir->filePath("samples.db"); }
+    static void appendSamples(SampleSpool &spool, int first, int count);
+    static QVector<double> storedDistances(const QString &dbPath);
+
+    QScopedPointer<QTemporaryDir> m_dir;
+};
+
+static const qint64 kBaseUs = 1700000000000000LL;
+
+void TestSampleSpool::init()
+{
+    m_dir.reset(new QTemporaryDir());
+    QVERIFY(m_dir->isValid());
+}
+
+void TestSampleSpool::appendSamples(SampleSpool &spool, int first, int count)
+{
+    for (int i = first; i < first + count; ++i) {
+        QVERIFY(spool.append(kBaseUs + i * 1000LL, SampleFixed::fromDouble(10.0 + i)));
+    }
+}
+
+QVector<double> TestSampleSpool::storedDistances(const QString &dbPath)
+{
+    QVector<double> distances;
+    DataManager dataManager;
+    if (dataManager.initialize(dbPath, "spool_check")) {
+        distances = dataManager.queryAll().distances();
+    }
+    // queryAll 按时间倒序；样本值随时间递增，排序后即为写入顺序
+    std::sort(distances.begin(), distances.end());
+    return distances;
+}
+
+void TestSampleSpool::appendAndRead()
+{
+    SampleSpool spool(spoolPath());
+    QVERIFY(spool.open());
+    QVERIFY(spool.instanceId() != 0);
+    appendSamples(spool, 0, 10);
+    QCOMPARE(spool.pendingCount(), quint64(10));
+    QCOMPARE(spool.writeSequence(), quint64(10));
+
+    QVector<SpoolRecord> records;
+    QCOMPARE(spool.read(records, 4), 4);
+    QCOMPARE(records[0].timestampUs, kBaseUs);
+    QCOMPARE(records[3].value, SampleFixed::fromDouble(13.0));
+
+    // read 不移动回放位置
+    QCOMPARE(spool.read(records, 4), 4);
+    QCOMPARE(records[0].timestampUs, kBaseUs);
+
+    spool.markReplayed(4);
+    QCOMPARE(spool.pendingCount(), quint64(6));
+    QCOMPARE(spool.replayedSequence(), quint64(4));
+    QCOMPARE(spool.read(records, 100), 6);
+    QCOMPARE(records[0].value, SampleFixed::fromDouble(14.0));
+}
+
+void TestSampleSpool::reopenKeepsPending()
+{
+    quint64 instanceId = 0;
+    {
+        SampleSpool spool(spoolPath());
+        QVERIFY(spool.open());
+        instanceId = spool.instanceId();
+        appendSamples(spool, 0, 10);
+        spool.markReplayed(3);
+        spool.sync();
+    }
+
+    // 重新打开时从回放位置向后扫描校验通过的记录
+    SampleSpool spool(spoolPath());
+    QVERIFY(spool.open());
+    QCOMPARE(spool.instanceId(), instanceId);
+    QCOMPARE(spool.pendingCount(), quint64(7));
+    QCOMPARE(spool.replayedSequence(), quint64(3));
+
+    QVector<SpoolRecord> records;
+    QCOMPARE(spool.read(records, 100), 7);
+    QCOMPARE(records.first().timestampUs, kBaseUs + 3000);
+    QCOMPARE(records.last().value, SampleFixed::fromDouble(19.0));
+}
+
+void TestSampleSpool::corruptRecordEndsRecovery()
+{
+    {
+        SampleSpool spool(spoolPath());
+        QVERIFY(spool.open());
+        appendSamples(spool, 0, 10);
+    }
+
+    // 文件头 64 字节，每条记录 16 字节；改动第 5 条的定点值
+    QFile file(spoolPath());
+    QVERIFY(file.open(QIODevice::ReadWrite));
+    QVERIFY(file.seek(64 + 5 * 16 + 8));
+    QVERIFY(file.write(QByteArray("\x7F", 1)) == 1);
+    file.close();
+
+    SampleSpool spool(spoolPath());
+    QVERIFY(spool.open());
+    QCOMPARE(spool.pendingCount(), quint64(5));
+
+    // 恢复后的写入位置紧接最后一条有效记录
+    appendSamples(spool, 100, 1);
+    QVector<SpoolRecord> records;
+    QCOMPARE(spool.read(records, 100), 6);
+    QCOMPARE(records[5].value, SampleFixed::fromDouble(110.0));
+}
+
+void TestSampleSpool::reusedFileDropsStaleRecords()
+{
+    {
+        SampleSpool spool(spoolPath());
+        QVERIFY(spool.open());
+        appendSamples(spool, 0, 5);
+        spool.markReplayed(5);
+        QCOMPARE(spool.pendingCount(), quint64(0));
+
+        // 全部回放后从头复用，序号继续递增
+        appendSamples(spool, 5, 2);
+        QCOMPARE(spool.replayedSequence(), quint64(5));
+        QCOMPARE(spool.writeSequence(), quint64(7));
+    }
+
+    // 第 2~4 条是上一轮的记录，CRC 含序号，不会被当作新数据恢复
+    SampleSpool spool(spoolPath());
+    QVERIFY(spool.open());
+    QCOMPARE(spool.pendingCount(), quint64(2));
+    QVector<SpoolRecord> records;
+    QCOMPARE(spool.read(records, 100), 2);
+    QCOMPARE(records[1].value, SampleFixed::fromDouble(16.0));
+}
+
+void TestSampleSpool::replayIntoDatabase()
+{
+    SampleSpool spool(spoolPath());
+    QVERIFY(spool.open());
+    appendSamples(spool, 0, 50);
+
+    {
+        SpoolReplayer replayer(&spool, databasePath());
+        QSignalSpy replayed(&replayer, &SpoolReplayer::recordsReplayed);
+        replayer.start();
+        QCOMPARE(replayed.size(), 1);
+        QCOMPARE(replayed.at(0).at(0).toInt(), 50);
+    }
+    QCOMPARE(spool.pendingCount(), quint64(0));
+
+    QVector<double> distances = storedDistances(databasePath());
+    QCOMPARE(distances.size(), 50);
+    QCOMPARE(distances.first(), 10.0);
+    QCOMPARE(distances.last(), 59.0);
+
+    DataManager dataManager;
+    QVERIFY(dataManager.initialize(databasePath(), "spool_watermark"));
+    quint64 watermark = 0;
+    QVERIFY(dataManager.querySpoolWatermark(spool.instanceId(), watermark));
+    QCOMPARE(watermark, quint64(50));
+}
+
+void TestSampleSpool::replaySkipsCommittedBatch()
+{
+    SampleSpool spool(spoolPath());
+    QVERIFY(spool.open());
+    appendSamples(spool, 0, 20);
+
+    // 模拟批次已提交、暂存文件尚未标记时崩溃
+    {
+        QVector<SpoolRecord> records;
+        QCOMPARE(spool.read(records, 12), 12);
+        DataManager dataManager;
+        QVERIFY(dataManager.initialize(databasePath(), "spool_crash"));
+        QVERIFY(dataManager.insertRecords(records, spool.instanceId(), spool.replayedSequence() + 12));
+    }
+    QCOMPARE(spool.pendingCount(), quint64(20));
+
+    {
+        SpoolReplayer replayer(&spool, databasePath());
+        replayer.start();
+    }
+    QCOMPARE(spool.pendingCount(), quint64(0));
+
+    // 已入库的 12 条按水位跳过，不重复写入
+    QVector<double> distances = storedDistances(databasePath());
+    QCOMPARE(distances.size(), 20);
+    QCOMPARE(distances[11], 21.0);
+    QCOMPARE(distances[12], 22.0);
+}
+
+QTEST_GUILESS_MAIN(TestSampleSpool)
+#include "tst_samplespool.moc"
@@ -0,0 +1,185 @@
+#include <QtTest>
+#include <QTemporaryDir>
+#include <QThread>
+
+#include "datamanager.h"
+#include "samplespool.h"
+
+/**
+ * @brief 录制会话恢复：上次运行未关闭的会话按最后一条记录结束并补算统计，下一个会话与本次运行为边界
+ */
+class TestSessionRecovery : public QObject {
+    Q_OBJECT
+
+private slots:
+    void init();
+
+    void openSessionEndsAtLastRecord();
+    void nextSessionBoundsOpenSession();
+    void emptySessionEndsAtStart();
+    void stoppedSessionIsSummarized();
+    void currentRunIsUntouched();
+
+private:
+    QString databasePath() const { return m_dir->filePath("sessions.db"); }
+    static void insertAfter(DataManager &dataManager, qint64 startMs, const QVector<int> &offsetsMs, double firstCm);
+    static RecordingSession session(const QString &dbPath, qint64 id);
+
+    QScopedPointer<QTemporaryDir> m_dir;
+};
+
+void TestSessionRecovery::init()
+{
+    m_dir.reset(new QTemporaryDir());
+    QVERIFY(m_dir->isValid());
+}
+
+// 在会话开始之后的若干毫秒处写入记录，距离依次为 firstCm、firstCm + 1 ...
+void TestSessionRecovery::insertAfter(DataManager &dataManager, qint64 startMs, const QVector<int> &offsetsMs, double firstCm)
+{
+    QVector<SpoolRecord> records;
+    for (int i = 0; i < offsetsMs.size(); ++i) {
+        qint64 us = DataManager::fromStorageMs(startMs + offsetsMs[i]).toMSecsSinceEpoch() * 1000;
+        records.append(SpoolRecord{us, SampleFixed::fromDouble(firstCm + i)});
+    }
+    QVERIFY(dataManager.insertRecords(records));
+}
+
+RecordingSession TestSessionRecovery::session(const QString &dbPath, qint64 id)
+{
+    RecordingSession result;
+    DataManager dataManager;
+    if (dataManager.initialize(dbPath, "session_check")) {
+        dataManager.querySession(id, result);
+    }
+    return result;
+}
+
+void TestSessionRecovery::openSessionEndsAtLastRecord()
+{
+    qint64 id = -1;
+    qint64 startMs = 0;
+    {
+        DataManager dataManager;
+        QVERIFY(dataManager.initialize(databasePath(), "previous_run"));
+        id = dataManager.startSession("run", "", {"distance"});
+        QVERIFY(id > 0);
+        RecordingSession started;
+        QVERIFY(dataManager.querySession(id, started));
+        QVERIFY(started.isActive());
+        startMs = started.startMs;
+        insertAfter(dataManager, startMs, {10, 20, 30, 40}, 10.0);
+    }
+
+    // 模拟重启：会话未关闭，本次运行在记录之后开始
+    {
+        DataManager dataManager;
+        QVERIFY(dataManager.initialize(databasePath(), "next_run"));
+        QVERIFY(dataManager.recoverSessions(startMs + 1000));
+    }
+
+    RecordingSession recovered = session(databasePath(), id);
+    QVERIFY(!recovered.isActive());
+    QCOMPARE(recovered.endMs, startMs + 41);
+    QVERIFY(recovered.summarized);
+    QCOMPARE(recovered.stats.count, qint64(4));
+    QCOMPARE(recovered.stats.mean(), 11.5);
+    QCOMPARE(recovered.stats.min, 10.0);
+    QCOMPARE(recovered.stats.max, 13.0);
+}
+
+void TestSessionRecovery::nextSessionBoundsOpenSession()
+{
+    DataManager dataManager;
+    QVERIFY(dataManager.initialize(databasePath(), "bounded"));
+    qint64 firstId = dataManager.startSession("first", "", {});
+    QThread::msleep(200);
+    qint64 secondId = dataManager.startSession("second", "", {});
+    QVERIFY(firstId > 0 && secondId > 0);
+
+    RecordingSession first;
+    RecordingSession second;
+    QVERIFY(dataManager.querySession(firstId, first));
+    QVERIFY(dataManager.querySession(secondId, second));
+    QVERIFY(second.startMs - first.startMs >= 100);
+
+    // 第一个会话的最后一条记录在第二个会话开始之前 50 ms；之后的记录属于第二个会话
+    insertAfter(dataManager, first.startMs, {10, int(second.startMs - first.startMs) - 50}, 20.0);
+    insertAfter(dataManager, second.startMs, {0, 30, 60}, 40.0);
+    QVERIFY(dataManager.recoverSessions(second.startMs + 1000));
+
+    QVERIFY(dataManager.querySession(firstId, first));
+    QCOMPARE(first.endMs, second.startMs - 49);
+    QCOMPARE(first.stats.count, qint64(2));
+    QCOMPARE(first.stats.max, 21.0);
+
+    QVERIFY(dataManager.querySession(secondId, second));
+    QCOMPARE(second.endMs, second.startMs + 61);
+    QVERIFY(second.summarized);
+    QCOMPARE(second.stats.count, qint64(3));
+    QCOMPARE(second.stats.mean(), 41.0);
+}
+
+void TestSessionRecovery::emptySessionEndsAtStart()
+{
+    DataManager dataManager;
+    QVERIFY(dataManager.initialize(databasePath(), "empty"));
+    qint64 id = dataManager.startSession("empty", "", {});
+    RecordingSession started;
+    QVERIFY(dataManager.querySession(id, started));
+    QVERIFY(dataManager.recoverSessions(started.startMs + 1000));
+
+    RecordingSession recovered;
+    QVERIFY(dataManager.querySession(id, recovered));
+    QCOMPARE(recovered.endMs, started.startMs);
+    QCOMPARE(recovered.durationMs(), qint64(0));
+    QVERIFY(recovered.summarized);
+    QCOMPARE(recovered.stats.count, qint64(0));
+}
+
+void TestSessionRecovery::stoppedSessionIsSummarized()
+{
+    // 已写入结束时间、未等到样本入库即退出：恢复时只补算统计，结束时间不变
+    DataManager dataManager;
+    QVERIFY(dataManager.initialize(databasePath(), "stopped"));
+    qint64 id = dataManager.startSession("stopped", "", {});
+    RecordingSession stopped;
+    QVERIFY(dataManager.querySession(id, stopped));
+    QVERIFY(dataManager.stopSession(id, stopped.startMs + 500));
+    insertAfter(dataManager, stopped.startMs, {100, 200, 600}, 5.0);
+
+    QVERIFY(dataManager.querySession(id, stopped));
+    QVERIFY(!stopped.summarized);
+    QVERIFY(dataManager.recoverSessions(stopped.startMs + 1000));
+
+    RecordingSession recovered;
+    QVERIFY(dataManager.querySession(id, recovered));
+    QCOMPARE(recovered.endMs, stopped.startMs + 500);
+    QVERIFY(recovered.summarized);
+    QCOMPARE(recovered.stats.count, qint64(2));
+    QCOMPARE(recovered.stats.sum, 11.0);
+
+    // 结束时间只写一次
+    QVERIFY(dataManager.stopSession(id, stopped.startMs + 900));
+    QVERIFY(dataManager.querySession(id, recovered));
+    QCOMPARE(recovered.endMs, stopped.startMs + 500);
+}
+
+void TestSessionRecovery::currentRunIsUntouched()
+{
+    // 本次运行开始之后开始的会话仍在进行，不由恢复结束
+    DataManager dataManager;
+    QVERIFY(dataManager.initialize(databasePath(), "current"));
+    qint64 runStartMs = DataManager::toStorageMs(QDateTime::currentDateTime());
+    QThread::msleep(20);
+    qint64 id = dataManager.startSession("current", "", {});
+    QVERIFY(dataManager.recoverSessions(runStartMs));
+
+    RecordingSession current;
+    QVERIFY(dataManager.querySession(id, current));
+    QVERIFY(current.isActive());
+    QVERIFY(!current.summarized);
+}
+
+QTEST_GUILESS_MAIN(TestSessionRecovery)
+#include "tst_sessionrecovery.moc"
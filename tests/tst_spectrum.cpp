@@ -0,0 +1,164 @@
+#include <QtTest>
+#include <QRandomGenerator>
+#include <cmath>
+
+#include "spectrum.h"
+
+/**
+ * @brief 实数 FFT 与 Welch 功率谱：与直接 DFT 对照、分段重叠、Parseval 能量与峰值频率
+ */
+class TestSpectrum : public QObject {
+    Q_OBJECT
+
+private slots:
+    void fftMatchesDft_data();
+    void fftMatchesDft();
+    void fftImpulse();
+    void overlappedSegments();
+    void whiteNoisePower();
+    void sinePeak();
+};
+
+static const double kPi = 3.14159265358979323846;
+
+void TestSpectrum::fftMatchesDft_data()
+{
+    QTest::addColumn<int>("size");
+    QTest::newRow("8") << 8;
+    QTest::newRow("64") << 64;
+    QTest::newRow("1024") << 1024;
+}
+
+void TestSpectrum::fftMatchesDft()
+{
+    QFETCH(int, size);
+
+    QRandomGenerator random(size);
+    QVector<float> input(size);
+    double scale = 0.0;
+    for (float &value : input) {
+        value = static_cast<float>(random.bounded(2.0) - 1.0);
+        scale += std::abs(value);
+    }
+
+    RealFft fft;
+    fft.setSize(size);
+    QCOMPARE(fft.size(), size);
+    QVector<float> re(size / 2 + 1);
+    QVector<float> im(size / 2 + 1);
+    fft.transform(input.constData(), re.data(), im.data());
+
+    // 单精度蝶形的累计误差与输入总幅度成正比
+    const double tolerance = 1e-5 * scale;
+    for (int k = 0; k <= size / 2; ++k) {
+        double expectedRe = 0.0;
+        double expectedIm = 0.0;
+        for (int n = 0; n < size; ++n) {
+            double angle = -2.0 * kPi * k * n / size;
+            expectedRe += input[n] * std::cos(angle);
+            expectedIm += input[n] * std::sin(angle);
+        }
+        QVERIFY2(std::abs(re[k] - expectedRe) < tolerance, qPrintable(QString("re[%1]").arg(k)));
+        QVERIFY2(std::abs(im[k] - expectedIm) < tolerance, qPrintable(QString("im[%1]").arg(k)));
+    }
+}
+
+void TestSpectrum::fftImpulse()
+{
+    const int size = 16;
+    QVector<float> input(size, 0.0f);
+    input[0] = 1.0f;
+
+    RealFft fft;
+    fft.setSize(size);
+    QVector<float> re(size / 2 + 1);
+    QVector<float> im(size / 2 + 1);
+    fft.transform(input.constData(), re.data(), im.data());
+    for (int k = 0; k <= size / 2; ++k) {
+        QVERIFY(std::abs(re[k] - 1.0f) < 1e-5f);
+        QVERIFY(std::abs(im[k]) < 1e-5f);
+    }
+}
+
+void TestSpectrum::overlappedSegments()
+{
+    WelchSpectrum welch;
+    welch.configure(256, 4);
+    QCOMPARE(welch.segmentLength(), 256);
+    QCOMPARE(welch.binCount(), 129);
+
+    QVector<float> samples(1024, 1.0f);
+    QCOMPARE(welch.push(samples.constData(), 255), 0);
+    QVERIFY(!welch.ready());
+    QCOMPARE(welch.push(samples.constData(), 1), 1);
+    QVERIFY(welch.ready());
+
+    // 段间重叠 50%：之后每 128 个样本完成一段
+    QCOMPARE(welch.push(samples.constData(), 127), 0);
+    QCOMPARE(welch.push(samples.constData(), 1), 1);
+    QCOMPARE(welch.push(samples.constData(), 512), 4);
+
+    welch.reset();
+    QVERIFY(!welch.ready());
+}
+
+void TestSpectrum::whiteNoisePower()
+{
+    // 单边功率谱密度对频率积分等于信号方差；[-1, 1) 均匀分布的方差为 1/3
+    const double sampleRateHz = 1000.0;
+    const int segmentLength = 256;
+    WelchSpectrum welch;
+    welch.configure(segmentLength, 16);
+
+    QRandomGenerator random(7);
+    QVector<float> samples(segmentLength * 9);
+    for (float &value : samples) {
+        value = static_cast<float>(50.0 + random.bounded(2.0) - 1.0);
+    }
+    QCOMPARE(welch.push(samples.constData(), samples.size()), 17);
+
+    QVector<float> powerDb;
+    welch.spectrum(sampleRateHz, powerDb);
+    QCOMPARE(powerDb.size(), welch.binCount());
+
+    double variance = 0.0;
+    for (float db : powerDb) {
+        variance += std::pow(10.0, db / 10.0) * sampleRateHz / segmentLength;
+    }
+    QVERIFY2(std::abs(variance - 1.0 / 3.0) < 0.1 / 3.0, qPrintable(QString::number(variance)));
+}
+
+void TestSpectrum::sinePeak()
+{
+    // 直流 100 cm 上叠加 123.4 Hz、幅度 2 cm 的振动与少量噪声
+    const double sampleRateHz = 1000.0;
+    const double frequencyHz = 123.4;
+    WelchSpectrum welch;
+    welch.configure(256, 8);
+
+    QRandomGenerator random(11);
+    QVector<float> samples(4096);
+    for (int i = 0; i < samples.size(); ++i) {
+        double noise = 0.05 * (random.bounded(2.0) - 1.0);
+        samples[i] = static_cast<float>(100.0 + 2.0 * std::sin(2.0 * kPi * frequencyHz * i / sampleRateHz) + noise);
+    }
+    for (int offset = 0; offset < samples.size(); offset += 100) {
+        welch.push(samples.constData() + offset, qMin(100, samples.size() - offset));
+    }
+
+    QVector<float> powerDb;
+    welch.spectrum(sampleRateHz, powerDb);
+    QVector<SpectralPeak> peaks;
+    welch.findPeaks(powerDb, sampleRateHz, 20.0, 3, peaks);
+
+    QVERIFY(!peaks.isEmpty());
+    QVERIFY(peaks.size() <= 3);
+    const double binHz = sampleRateHz / welch.segmentLength();
+    QVERIFY2(std::abs(peaks.first().frequencyHz - frequencyHz) < binHz / 2,
+             qPrintable(QString::number(peaks.first().frequencyHz)));
+    // 去均值后直流频点不应成为峰
+    QVERIFY(powerDb[0] < peaks.first().powerDb - 20.0);
+}
+
+QTEST_GUILESS_MAIN(TestSpectrum)
+#include "tst_spectrum.moc"
@@ -0,0 +1,494 @@
+/**
+ * ultrasonic-query：对上位机数据库做批量查询，结果输出到标准输出
+ *
+ *   ultrasonic-query [选项] select       原始记录
+ *   ultrasonic-query [选项] aggregate    按桶计数/均值/最值/百分位
+ *   ultrasonic-query [选项] downsample   按桶最小/最大值（汇总表）
+ *   ultrasonic-query [选项] resample     按等间隔时间点线性插值（重建入库压缩的信号）
+ *   ultrasonic-query [选项] bounds       第一条与最后一条记录的时间
+ *   ultrasonic-query --since N changes   水位 N 之后的新增与删除，新水位写到标准错误
+ *
+ * 数据库只读打开，可在上位机运行时查询。输出格式见 README“命令行查询”。
+ */
+
+#include "queryengine.h"
+#include "samplecompressor.h"
+#include "samplefixed.h"
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDate>
+#include <QFile>
+#include <QTextStream>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+
+#ifdef Q_OS_WIN
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+/**
+ * @brief 二进制输出头部，之后是 percentileCount 个 double（请求的百分位），再之后为定长记录直到结束
+ *
+ * 多字节字段为本机字节序（x86/ARM 均为小端），时间为存储毫秒（本地时间按 UTC 计的毫秒数）。
+ */
+struct QueryFileHeader {
+    char magic[4];            // "ULQR"
+    quint32 version;
+    qint32 fractionDigits;    // 定点值的小数位数
+    quint32 kind;             // OutputKind
+    quint32 recordSize;
+    quint32 percentileCount;
+    qint64 startMs;
+    qint64 endMs;
+};
+
+struct QuerySelectRecord {
+    qint64 id;
+    qint64 timestampMs;
+    qint32 value;             // SampleFixed 定点值
+    quint32 reserved;
+};
+
+struct QueryDownsampleRecord {
+    qint64 startMs;
+    qint32 minValue;          // SampleFixed 定点值
+    qint32 maxValue;
+};
+
+struct QueryResampleRecord {
+    qint64 timestampMs;
+    qint32 value;             // SampleFixed 定点值
+    quint32 reserved;
+};
+
+struct QueryChangeRecord {
+    qint64 sequence;
+    qint64 recordId;
+    qint64 timestampMs;       // 仅 insert 有效
+    qint32 value;             // SampleFixed 定点值，仅 insert 有效
+    quint32 type;             // RecordChange::Type
+};
+
+// 聚合记录：startMs, count 之后为 mean/min/max 与各百分位（double）
+struct QueryAggregateRecord {
+    qint64 startMs;
+    qint64 count;
+    double mean;
+    double min;
+    double max;
+};
+
+static_assert(sizeof(QueryFileHeader) == 40, "QueryFileHeader layout changed");
+static_assert(sizeof(QuerySelectRecord) == 24, "QuerySelectRecord layout changed");
+static_assert(sizeof(QueryDownsampleRecord) == 16, "QueryDownsampleRecord layout changed");
+static_assert(sizeof(QueryAggregateRecord) == 40, "QueryAggregateRecord layout changed");
+static_assert(sizeof(QueryResampleRecord) == 16, "QueryResampleRecord layout changed");
+static_assert(sizeof(QueryChangeRecord) == 32, "QueryChangeRecord layout changed");
+
+enum OutputKind {
+    SelectOutput = 1,
+    AggregateOutput = 2,
+    DownsampleOutput = 3,
+    ResampleOutput = 4,
+    ChangesOutput = 5
+};
+
+/**
+ * @brief 标准输出缓冲写入
+ */
+class Output {
+public:
+    Output() { m_buffer.reserve(kFlushSize * 2); }
+    ~Output() { flush(); }
+
+    bool open(bool binary)
+    {
+#ifdef Q_OS_WIN
+        if (binary) {
+            _setmode(_fileno(stdout), _O_BINARY);
+        }
+#else
+        Q_UNUSED(binary);
+#endif
+        return m_file.open(stdout, QIODevice::WriteOnly);
+    }
+
+    void write(const char *data, int size)
+    {
+        m_buffer.append(data, size);
+        if (m_buffer.size() >= kFlushSize) {
+            flush();
+        }
+    }
+    void write(const QByteArray &text) { write(text.constData(), text.size()); }
+    template <typename T>
+    void writeStruct(const T &value) { write(reinterpret_cast<const char *>(&value), sizeof(T)); }
+
+    void writeFixed(double distance)
+    {
+        char text[16];
+        write(text, SampleFixed::format(SampleFixed::fromDouble(distance), text));
+    }
+
+    void writeNumber(double value) { write(QByteArray::number(value, 'f', SampleFixed::kFractionDigits + 2)); }
+
+    // 存储毫秒 -> "yyyy-MM-ddThh:mm:ss.zzz"，日期部分按天缓存
+    void writeTimestamp(qint64 ms)
+    {
+        qint64 day = ms >= 0 ? ms / 86400000 : (ms - 86399999) / 86400000;
+        if (day != m_cachedDay) {
+            m_cachedDay = day;
+            m_cachedDate = QDate(1970, 1, 1).addDays(day).toString("yyyy-MM-dd").toLatin1();
+        }
+        int inDay = int(ms - day * 86400000);
+        char text[16];
+        std::snprintf(text, sizeof(text), "T%02d:%02d:%02d.%03d", inDay / 3600000, inDay / 60000 % 60,
+                      inDay / 1000 % 60, inDay % 1000);
+        write(m_cachedDate);
+        write(text, 13);
+    }
+
+    bool flush()
+    {
+        if (!m_buffer.isEmpty()) {
+            bool ok = m_file.write(m_buffer) == m_buffer.size();
+            m_buffer.clear();
+            m_file.flush();
+            return ok;
+        }
+        return true;
+    }
+
+private:
+    static const int kFlushSize = 1 << 16;
+    QFile m_file;
+    QByteArray m_buffer;
+    qint64 m_cachedDay = LLONG_MIN;
+    QByteArray m_cachedDate;
+};
+
+static bool parseTime(const QString &text, qint64 &ms)
+{
+    QString value = text.trimmed();
+    value.replace(' ', 'T');
+    QDateTime dateTime = QDateTime::fromString(value, Qt::ISODateWithMs);
+    if (!dateTime.isValid()) {
+        QDate date = QDate::fromString(value, Qt::ISODate);
+        if (!date.isValid()) {
+            return false;
+        }
+        dateTime = date.startOfDay();
+    }
+    ms = DataManager::toStorageMs(dateTime);
+    return true;
+}
+
+// "250ms"、"10s"、"5m"、"1h"、"1d"，不带单位时为毫秒
+static bool parseDuration(const QString &text, qint64 &ms)
+{
+    static const struct { const char *suffix; qint64 scale; } kUnits[] = {
+        {"ms", 1}, {"s", 1000}, {"m", 60 * 1000}, {"h", 60 * 60 * 1000}, {"d", 24 * 60 * 60 * 1000},
+    };
+    QString value = text.trimmed();
+    qint64 scale = 1;
+    for (const auto &unit : kUnits) {
+        if (value.endsWith(QLatin1String(unit.suffix))) {
+            value.chop(int(std::strlen(unit.suffix)));
+            scale = unit.scale;
+            break;
+        }
+    }
+    bool ok;
+    qint64 count = value.toLongLong(&ok);
+    ms = count * scale;
+    return ok && ms > 0;
+}
+
+static bool parsePercentiles(const QString &text, QVector<double> &percentiles)
+{
+    for (const QString &part : text.split(',', Qt::SkipEmptyParts)) {
+        bool ok;
+        double value = part.trimmed().toDouble(&ok);
+        if (!ok || value < 0.0 || value > 100.0) {
+            return false;
+        }
+        percentiles.append(value);
+    }
+    return true;
+}
+
+static int fail(const QString &message)
+{
+    QTextStream(stderr) << "ultrasonic-query: " << message << "\n";
+    return 1;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("ultrasonic-query");
+    QCoreApplication::setApplicationVersion("1.0.0");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Query the ultrasonic distance database and write the result to stdout.");
+    parser.addHelpOption();
+    parser.addVersionOption();
+    parser.addPositionalArgument("command", "select | aggregate | downsample | resample | bounds | changes");
+    QCommandLineOption dbOption("db", "Database file (default ultrasonic_data.db).", "path", "ultrasonic_data.db");
+    QCommandLineOption fromOption("from", "Start time, inclusive (yyyy-MM-dd[ hh:mm[:ss[.zzz]]]). Default: first record.", "time");
+    QCommandLineOption toOption("to", "End time, exclusive. Default: after the last record.", "time");
+    QCommandLineOption bucketOption("bucket", "Bucket width, e.g. 500ms, 10s, 5m, 1h, 1d. "
+                                    "aggregate without it reports the whole range.", "duration");
+    QCommandLineOption percentileOption("percentiles", "Comma-separated percentiles for aggregate, e.g. 50,95,99.", "list");
+    QCommandLineOption formatOption("format", "csv (default) or binary.", "format", "csv");
+    QCommandLineOption threadsOption("threads", "Scan threads (default: all cores).", "count", "0");
+    QCommandLineOption sinceOption("since", "changes: cursor returned by the previous run (default 0, everything). "
+                                   "The new cursor is written to stderr.", "cursor", "0");
+    parser.addOptions({dbOption, fromOption, toOption, bucketOption, percentileOption, formatOption, threadsOption,
+                       sinceOption});
+    parser.process(app);
+
+    const QStringList arguments = parser.positionalArguments();
+    const QString command = arguments.value(0);
+    if (arguments.size() != 1
+        || !QStringList({"select", "aggregate", "downsample", "resample", "bounds", "changes"}).contains(command)) {
+        parser.showHelp(1);
+    }
+
+    const QString format = parser.value(formatOption);
+    if (format != "csv" && format != "binary") {
+        return fail("--format must be csv or binary");
+    }
+    const bool binary = format == "binary";
+
+    qint64 bucketMs = 0;
+    if (parser.isSet(bucketOption) && !parseDuration(parser.value(bucketOption), bucketMs)) {
+        return fail("invalid --bucket: " + parser.value(bucketOption));
+    }
+    if ((command == "downsample" || command == "resample") && bucketMs <= 0) {
+        return fail(command + " requires --bucket");
+    }
+    bool sinceOk;
+    const qint64 since = parser.value(sinceOption).toLongLong(&sinceOk);
+    if (!sinceOk || since < 0) {
+        return fail("invalid --since: " + parser.value(sinceOption));
+    }
+    QVector<double> percentiles;
+    if (parser.isSet(percentileOption) && !parsePercentiles(parser.value(percentileOption), percentiles)) {
+        return fail("invalid --percentiles: " + parser.value(percentileOption));
+    }
+
+    QueryEngine engine(parser.value(dbOption), parser.value(threadsOption).toInt());
+    if (!engine.open()) {
+        return fail(engine.errorString());
+    }
+
+    qint64 firstMs = 0;
+    qint64 lastMs = -1;
+    bool hasRecords = engine.timeBounds(firstMs, lastMs);
+    qint64 startMs = firstMs;
+    qint64 endMs = lastMs + 1;
+    if (parser.isSet(fromOption) && !parseTime(parser.value(fromOption), startMs)) {
+        return fail("invalid --from: " + parser.value(fromOption));
+    }
+    if (parser.isSet(toOption) && !parseTime(parser.value(toOption), endMs)) {
+        return fail("invalid --to: " + parser.value(toOption));
+    }
+
+    Output out;
+    if (!out.open(binary)) {
+        return fail("cannot write to stdout");
+    }
+
+    if (command == "bounds") {
+        if (!hasRecords) {
+            return fail(engine.errorString());
+        }
+        out.write("first,last\n");
+        out.writeTimestamp(firstMs);
+        out.write(",", 1);
+        out.writeTimestamp(lastMs);
+        out.write("\n", 1);
+        return out.flush() ? 0 : 1;
+    }
+    if (command == "changes") {
+        // 与时间范围无关：清空后库中没有记录，也可能还有删除要下发
+        static const char *kTypeNames[] = {"insert", "delete", "clear"};
+        if (binary) {
+            QueryFileHeader header = {{'U', 'L', 'Q', 'R'}, 1, SampleFixed::kFractionDigits, quint32(ChangesOutput),
+                                      sizeof(QueryChangeRecord), 0, since, 0};
+            out.writeStruct(header);
+        } else {
+            out.write("sequence,op,id,timestamp,distance\n");
+        }
+        qint64 cursor = since;
+        bool ok = engine.changes(since, [&out, binary](const QVector<RecordChange> &changes) {
+            for (const RecordChange &change : changes) {
+                bool insert = change.type == RecordChange::Insert;
+                if (binary) {
+                    out.writeStruct(QueryChangeRecord{change.sequence, change.recordId, change.timestampMs,
+                                                      insert ? SampleFixed::fromDouble(change.distance) : 0,
+                                                      quint32(change.type)});
+                    continue;
+                }
+                out.write(QByteArray::number(change.sequence) + "," + kTypeNames[change.type] + ","
+                          + QByteArray::number(change.recordId) + ",");
+                if (insert) {
+                    out.writeTimestamp(change.timestampMs);
+                    out.write(",", 1);
+                    out.writeFixed(change.distance);
+                } else {
+                    out.write(",", 1);
+                }
+                out.write("\n", 1);
+            }
+            return out.flush();
+        }, cursor);
+        if (!out.flush()) {
+            return fail("write to stdout failed");
+        }
+        if (!ok) {
+            return fail(engine.errorString().isEmpty() ? QString("query failed") : engine.errorString());
+        }
+        // 标准输出可能是管道，新水位单独写到标准错误，供下次 --since 使用
+        QTextStream(stderr) << "cursor " << cursor << "\n";
+        return 0;
+    }
+    if (!hasRecords) {
+        return 0;
+    }
+
+    if (binary) {
+        OutputKind kind = command == "select" ? SelectOutput : command == "aggregate" ? AggregateOutput
+            : command == "resample" ? ResampleOutput : DownsampleOutput;
+        quint32 recordSize = kind == SelectOutput ? sizeof(QuerySelectRecord)
+            : kind == DownsampleOutput ? sizeof(QueryDownsampleRecord)
+            : kind == ResampleOutput ? sizeof(QueryResampleRecord)
+            : quint32(sizeof(QueryAggregateRecord) + percentiles.size() * sizeof(double));
+        quint32 percentileCount = kind == AggregateOutput ? quint32(percentiles.size()) : 0;
+        QueryFileHeader header = {{'U', 'L', 'Q', 'R'}, 1, SampleFixed::kFractionDigits, quint32(kind),
+                                  recordSize, percentileCount, startMs, endMs};
+        out.writeStruct(header);
+        out.write(reinterpret_cast<const char *>(percentiles.constData()), int(percentileCount * sizeof(double)));
+    }
+
+    bool ok = true;
+    if (command == "select") {
+        if (!binary) {
+            out.write("id,timestamp,distance\n");
+        }
+        ok = engine.select(startMs, endMs, [&out, binary](const RecordSet &records) {
+            for (int i = 0; i < records.size(); ++i) {
+                if (binary) {
+                    out.writeStruct(QuerySelectRecord{records.idAt(i), records.timestampMsAt(i),
+                                                      SampleFixed::fromDouble(records.distanceAt(i)), 0});
+                } else {
+                    out.write(QByteArray::number(records.idAt(i)));
+                    out.write(",", 1);
+                    out.writeTimestamp(records.timestampMsAt(i));
+                    out.write(",", 1);
+                    out.writeFixed(records.distanceAt(i));
+                    out.write("\n", 1);
+                }
+            }
+            return out.flush();
+        });
+    } else if (command == "aggregate") {
+        if (!binary) {
+            QByteArray header = "bucket_start,count,mean,min,max";
+            for (double percentile : percentiles) {
+                header += ",p" + QByteArray::number(percentile);
+            }
+            out.write(header + "\n");
+        }
+        ok = engine.aggregate(startMs, endMs, bucketMs, percentiles, [&out, binary](const BucketAggregate &bucket) {
+            if (binary) {
+                out.writeStruct(QueryAggregateRecord{bucket.startMs, bucket.count, bucket.mean(), bucket.min, bucket.max});
+                out.write(reinterpret_cast<const char *>(bucket.percentiles.constData()),
+                          int(bucket.percentiles.size() * sizeof(double)));
+                return true;
+            }
+            out.writeTimestamp(bucket.startMs);
+            out.write("," + QByteArray::number(bucket.count) + ",");
+            out.writeNumber(bucket.mean());
+            out.write(",", 1);
+            out.writeFixed(bucket.min);
+            out.write(",", 1);
+            out.writeFixed(bucket.max);
+            for (double value : bucket.percentiles) {
+                out.write(",", 1);
+                out.writeNumber(value);
+            }
+            out.write("\n", 1);
+            return true;
+        });
+    } else if (command == "resample") {
+        if (!binary) {
+            out.write("timestamp,distance\n");
+        }
+        // 网格点为 startMs + k * bucketMs；落在中断（相邻记录间隔超过压缩心跳）处的点不输出
+        auto gridAtOrAfter = [startMs, bucketMs](qint64 ms) {
+            return ms <= startMs ? startMs : startMs + (ms - startMs + bucketMs - 1) / bucketMs * bucketMs;
+        };
+        bool hasLeft = false;
+        qint64 leftMs = 0;
+        double leftValue = 0.0;
+        qint64 gridMs = startMs;
+        ok = engine.select(startMs, endMs, [&](const RecordSet &records) {
+            for (int i = 0; i < records.size(); ++i) {
+                qint64 rightMs = records.timestampMsAt(i);
+                double rightValue = records.distanceAt(i);
+                bool restart = !hasLeft || (rightMs - leftMs) * 1000 > SampleCompressor::kMaxIntervalUs;
+                if (restart) {
+                    gridMs = gridAtOrAfter(rightMs);
+                }
+                for (double value; !restart && gridMs <= rightMs; gridMs += bucketMs) {
+                    if (!SampleCompressor::interpolate(leftMs, leftValue, rightMs, rightValue, gridMs, value)) {
+                        continue;
+                    }
+                    if (binary) {
+                        out.writeStruct(QueryResampleRecord{gridMs, SampleFixed::fromDouble(value), 0});
+                    } else {
+                        out.writeTimestamp(gridMs);
+                        out.write(",", 1);
+                        out.writeFixed(value);
+                        out.write("\n", 1);
+                    }
+                }
+                hasLeft = true;
+                leftMs = rightMs;
+                leftValue = rightValue;
+            }
+            return out.flush();
+        });
+    } else {
+        QVector<HistoryBucket> buckets;
+        ok = engine.downsample(startMs, endMs, bucketMs, buckets);
+        if (!binary) {
+            out.write("bucket_start,min,max\n");
+        }
+        for (const HistoryBucket &bucket : buckets) {
+            if (binary) {
+                out.writeStruct(QueryDownsampleRecord{bucket.startMs, SampleFixed::fromDouble(bucket.minDistance),
+                                                      SampleFixed::fromDouble(bucket.maxDistance)});
+            } else {
+                out.writeTimestamp(bucket.startMs);
+                out.write(",", 1);
+                out.writeFixed(bucket.minDistance);
+                out.write(",", 1);
+                out.writeFixed(bucket.maxDistance);
+                out.write("\n", 1);
+            }
+        }
+    }
+
+    if (!out.flush()) {
+        return fail("write to stdout failed");
+    }
+    if (!ok) {
+        return fail(engine.errorString().isEmpty() ? QString("query failed") : engine.errorString());
+    }
+    return 0;
+}